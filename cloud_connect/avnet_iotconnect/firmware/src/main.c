@@ -277,6 +277,12 @@ int main ( void )
 	}
 	else {
 		DPRINT_W(TAG, "WARNING remove R602 on the board to read HTS221 sensor value!");
+
+		/* Keep the sensors running in low power mode, Sensors_Task() samples them. */
+		if (Sensors_Start() != COMPONENT_OK) {
+			DPRINT_W(TAG, "WARNING sensors acquisition disabled!");
+			sensor_enabled = 0;
+		}
 	}
     
 	/* Fetch certificates and ID from ATECC608 and display IoTConnect settings. */
@@ -307,6 +313,11 @@ int main ( void )
         /* Maintain state machines of all polled MPLAB Harmony modules. */
         SYS_Tasks ( );
 
+		/* Sample the sensors that are due, reports use the cached values. */
+		if (sensor_enabled) {
+			Sensors_Task(ms_ticks);
+		}
+
 		/* Socket is not connected. */
 		if (g_iot_data.connected == 0) {
 
@@ -414,16 +425,6 @@ int main ( void )
 			/* Send sensor data to the IOTConnect cloud. */
 			if ((ms_ticks - tick_count_report) > (MQTT_DEVICE_REPORT_MSEC)) {
 
-				/* Read sensor values if ST MEMS extension is connected. */
-				if (sensor_enabled) {
-					Sensors_Accelero_Handler();
-					Sensors_Gyro_Handler();
-					Sensors_Magneto_Handler();
-					Sensors_Pressure_Handler();
-					Sensors_Humidity_Handler();
-					Sensors_Temperature_Handler();
-				}
-
 				/* Build a JSON report that contains sensor values. */
 				gsm_sntp_get_time(curtime);
 				report_len = sprintf(report, "{\"cpId\":\"%s\",\"dtg\":\"%s\",\"t\":\"%s\",\"mt\":0,\"sdk\":{\"l\":\""IOTCONNECT_PROT_LANG"\",\
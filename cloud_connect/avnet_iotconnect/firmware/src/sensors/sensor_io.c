@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    sensor_io.c
+  * @brief   I2C access for the sensor drivers.
+  ******************************************************************************
+  * @attention
+  *
+  * COPYRIGHT(c) 2018 STMicroelectronics - EBV Elektronik
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of STMicroelectronics nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#include "sensors.h"
+#include "twihs_asf.h"
+
+#define SENSORS_I2C_MASTER (TWIHS0_REGS)
+
+uint8_t Sensor_IO_Write(void *handle, uint8_t WriteAddr, uint8_t *pBuffer, uint16_t nBytesToWrite)
+{
+	DrvContextTypeDef *ctx = (DrvContextTypeDef *)handle;
+	
+    twihs_packet_t packet = {
+	    .addr[0]        = WriteAddr,
+	    .addr[1]        = 0,
+	    .addr_length    = 1,
+	    .chip           = ctx->address >> 1,
+	    .buffer         = pBuffer,
+	    .length         = nBytesToWrite,
+    };
+
+    return twihs_master_write(SENSORS_I2C_MASTER, &packet);
+}
+
+uint8_t Sensor_IO_Read(void *handle, uint8_t ReadAddr, uint8_t *pBuffer, uint16_t nBytesToRead)
+{
+	DrvContextTypeDef *ctx = (DrvContextTypeDef *)handle;
+
+    twihs_packet_t packet = {
+	    .addr[0]        = ReadAddr,
+	    .addr[1]        = 0,
+	    .addr_length    = 1,
+	    .chip           = ctx->address >> 1,
+	    .buffer         = pBuffer,
+	    .length         = nBytesToRead,
+    };
+
+	return twihs_master_read(SENSORS_I2C_MASTER, &packet);
+}
@@ -35,7 +35,6 @@
 #include "dprint/dprint.h"
 
 #include "sensors.h"
-#include "twihs_asf.h"
 #include "LSM6DSL_ACC_GYRO_driver_HL.h"
 #include "LIS2MDL_MAG_driver_HL.h"
 #include "LPS22HB_Driver_HL.h"
@@ -44,6 +43,37 @@
 /** Debug tag prefix definition. */
 static const char *TAG = "sensors";
 
+/** Scheduled sampler. */
+typedef struct {
+	Sensors_Sampler_t sampler;
+	uint32_t period_ms;
+	uint32_t next_ms;
+	uint8_t isStarted;
+} Sensors_Schedule_t;
+
+static Sensors_Schedule_t Sensors_Schedule_Table[SENSORS_SCHEDULE_MAX];
+static uint8_t Sensors_Schedule_Count = 0;
+
+/** Sensitivities read once by Sensors_Start(), the ODR and full scale do not change afterwards. */
+static float ACCELERO_Sensitivity = 0;
+static float GYRO_Sensitivity = 0;
+static float MAGNETO_Sensitivity = 0;
+
+/** HTS221 calibration read once by Sensors_Start(). */
+static struct {
+	int16_t H0_rh;
+	int16_t H1_rh;
+	int16_t H0_T0_out;
+	int16_t H1_T0_out;
+	int16_t T0_degC;
+	int16_t T1_degC;
+	int16_t T0_out;
+	int16_t T1_out;
+} HTS221_Calibration;
+
+/** One LSM6DSL FIFO burst, plus room for the words skipped to align on a pattern. */
+static uint8_t LSM6DSL_FIFO_Buffer[(SENSORS_FIFO_PATTERNS + 1) * 12];
+
 SensorAxes_t ACCELERO_Data = { 0, 0, 0 };
 SensorAxes_t GYRO_Data = { 0, 0, 0 };
 SensorAxes_t MAGNETO_Data = { 0, 0, 0 };
@@ -167,40 +197,6 @@ DrvContextTypeDef TEMPERATURE_Handle = {
 		.pExtVTable    = 0,
 };
 
-#define SENSORS_I2C_MASTER (TWIHS0_REGS)
-
-uint8_t Sensor_IO_Write(void *handle, uint8_t WriteAddr, uint8_t *pBuffer, uint16_t nBytesToWrite)
-{
-	DrvContextTypeDef *ctx = (DrvContextTypeDef *)handle;
-	
-    twihs_packet_t packet = {
-	    .addr[0]        = WriteAddr,
-	    .addr[1]        = 0,
-	    .addr_length    = 1,
-	    .chip           = ctx->address >> 1,
-	    .buffer         = pBuffer,
-	    .length         = nBytesToWrite,
-    };
-
-    return twihs_master_write(SENSORS_I2C_MASTER, &packet);
-}
-
-uint8_t Sensor_IO_Read(void *handle, uint8_t ReadAddr, uint8_t *pBuffer, uint16_t nBytesToRead)
-{
-	DrvContextTypeDef *ctx = (DrvContextTypeDef *)handle;
-
-    twihs_packet_t packet = {
-	    .addr[0]        = ReadAddr,
-	    .addr[1]        = 0,
-	    .addr_length    = 1,
-	    .chip           = ctx->address >> 1,
-	    .buffer         = pBuffer,
-	    .length         = nBytesToRead,
-    };
-
-	return twihs_master_read(SENSORS_I2C_MASTER, &packet);
-}
-
 uint8_t Sensors_Init(void)
 {
 	uint8_t status = COMPONENT_OK;
@@ -250,6 +246,8 @@ uint8_t Sensors_DeInit(void)
 {
 	uint8_t status = COMPONENT_OK;
 
+	Sensors_Schedule_Count = 0;
+
 	/* Deinit accelero sensor. */
 	if (ACCELERO_Driver->DeInit((void *)&ACCELERO_Handle) != COMPONENT_OK) {
 		DPRINT_E(TAG, "Sensors_DeInit: LSM6DSL_X deinit error!");
@@ -289,200 +287,269 @@ uint8_t Sensors_DeInit(void)
 	return status;
 }
 
-uint8_t Sensors_Accelero_Handler(void)
+/* LSM6DSL: accelero and gyro at 13 Hz in low power mode, both streamed into the FIFO. */
+static uint8_t Sensors_Start_Motion(void)
 {
-	uint8_t status = 0;
-	int count = 0;
-
-	/* Enable sensor. */
-	ACCELERO_Driver->Sensor_Enable(&ACCELERO_Handle);
-	/* Read once to clear DRDY. */
-	ACCELERO_Driver->Get_Axes(&ACCELERO_Handle, &ACCELERO_Data);
-
-	/* Wait for data ready. */
-	while (ACCELERO_Driver->Get_DRDY_Status(&ACCELERO_Handle, &status) == COMPONENT_OK
-			&& status == 0
-			&& count++ < SENSOR_POLLING) {
+	if (ACCELERO_Driver->Set_ODR_Value(&ACCELERO_Handle, 13.0f) != COMPONENT_OK
+			|| GYRO_Driver->Set_ODR_Value(&GYRO_Handle, 13.0f) != COMPONENT_OK
+			|| LSM6DSL_ACC_GYRO_W_LowPower_XL(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_LP_XL_ENABLED) == MEMS_ERROR
+			|| LSM6DSL_ACC_GYRO_W_LP_Mode(&GYRO_Handle, LSM6DSL_ACC_GYRO_LP_EN_ENABLED) == MEMS_ERROR
+			|| LSM6DSL_ACC_GYRO_W_DEC_FIFO_XL(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_DEC_FIFO_XL_NO_DECIMATION) == MEMS_ERROR
+			|| LSM6DSL_ACC_GYRO_W_DEC_FIFO_G(&GYRO_Handle, LSM6DSL_ACC_GYRO_DEC_FIFO_G_NO_DECIMATION) == MEMS_ERROR
+			/* Limit the FIFO to what one burst reads, older patterns are overwritten. */
+			|| LSM6DSL_ACC_GYRO_W_FIFO_Watermark(&ACCELERO_Handle, SENSORS_FIFO_PATTERNS * 6) == MEMS_ERROR
+			|| LSM6DSL_ACC_GYRO_W_STOP_ON_FTH(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_STOP_ON_FTH_ENABLED) == MEMS_ERROR
+			|| LSM6DSL_ACC_GYRO_W_ODR_FIFO(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_ODR_FIFO_10Hz) == MEMS_ERROR
+			|| LSM6DSL_ACC_GYRO_W_FIFO_MODE(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_FIFO_MODE_STREAM) == MEMS_ERROR
+			|| ACCELERO_Driver->Sensor_Enable(&ACCELERO_Handle) != COMPONENT_OK
+			|| GYRO_Driver->Sensor_Enable(&GYRO_Handle) != COMPONENT_OK
+			|| ACCELERO_Driver->Get_Sensitivity(&ACCELERO_Handle, &ACCELERO_Sensitivity) != COMPONENT_OK
+			|| GYRO_Driver->Get_Sensitivity(&GYRO_Handle, &GYRO_Sensitivity) != COMPONENT_OK) {
+		return COMPONENT_ERROR;
 	}
 
-	if (count < SENSOR_POLLING) {
-		if (ACCELERO_Driver->Get_Axes(&ACCELERO_Handle, &ACCELERO_Data) == COMPONENT_OK) {
-			status = COMPONENT_OK;
-		}
-		else {
-			status = COMPONENT_ERROR;
-		}
-	}
-	else {
-		status = COMPONENT_TIMEOUT;
+	return COMPONENT_OK;
+}
+
+/* LIS2MDL: continuous mode at 10 Hz in low power mode. */
+static uint8_t Sensors_Start_Magneto(void)
+{
+	if (MAGNETO_Driver->Set_ODR(&MAGNETO_Handle, ODR_LOW) != COMPONENT_OK
+			|| LIS2MDL_MAG_W_FastLowPowerXYZ(&MAGNETO_Handle, LIS2MDL_MAG_LP_ENABLE) == MEMS_ERROR
+			|| MAGNETO_Driver->Sensor_Enable(&MAGNETO_Handle) != COMPONENT_OK
+			|| MAGNETO_Driver->Get_Sensitivity(&MAGNETO_Handle, &MAGNETO_Sensitivity) != COMPONENT_OK) {
+		return COMPONENT_ERROR;
 	}
 
-	/* Disable sensor. */
-	ACCELERO_Driver->Sensor_Disable(&ACCELERO_Handle);
-	return status;
+	return COMPONENT_OK;
 }
 
-uint8_t Sensors_Gyro_Handler(void)
+/* LPS22HB: 1 Hz, low current mode is set by Init. */
+static uint8_t Sensors_Start_Pressure(void)
 {
-	uint8_t status = 0;
-	int count = 0;
-
-	/* Enable sensor. */
-	GYRO_Driver->Sensor_Enable(&GYRO_Handle);
-	/* Read once to clear DRDY. */
-	GYRO_Driver->Get_Axes(&GYRO_Handle, &GYRO_Data);
-
-	/* Wait for data ready. */
-	while (GYRO_Driver->Get_DRDY_Status(&GYRO_Handle, &status) == COMPONENT_OK
-			&& status == 0
-			&& count++ < SENSOR_POLLING) {
+	/* Init turns address increment off, the sampler reads the pressure bytes in one go. */
+	if (PRESSURE_Driver->Set_ODR_Value(&PRESSURE_Handle, 1.0f) != COMPONENT_OK
+			|| LPS22HB_Set_AutomaticIncrementRegAddress(&PRESSURE_Handle, LPS22HB_ENABLE) == LPS22HB_ERROR
+			|| PRESSURE_Driver->Sensor_Enable(&PRESSURE_Handle) != COMPONENT_OK) {
+		return COMPONENT_ERROR;
 	}
 
-	if (count < SENSOR_POLLING) {
-		if (GYRO_Driver->Get_Axes(&GYRO_Handle, &GYRO_Data) == COMPONENT_OK) {
-			status = COMPONENT_OK;
-		}
-		else {
-			status = COMPONENT_ERROR;
-		}
-	}
-	else {
-		status = COMPONENT_TIMEOUT;
+	return COMPONENT_OK;
+}
+
+/* HTS221: 1 Hz set by Init, humidity and temperature share the device. */
+static uint8_t Sensors_Start_HumTemp(void)
+{
+	uint8_t buffer[16];
+
+	if (HUMIDITY_Driver->Sensor_Enable(&HUMIDITY_Handle) != COMPONENT_OK
+			|| TEMPERATURE_Driver->Sensor_Enable(&TEMPERATURE_Handle) != COMPONENT_OK
+			|| HTS221_ReadReg(&HUMIDITY_Handle, HTS221_H0_RH_X2, sizeof(buffer), buffer) == HTS221_ERROR) {
+		return COMPONENT_ERROR;
 	}
 
-	/* Disable sensor. */
-	GYRO_Driver->Sensor_Disable(&GYRO_Handle);
-	return status;
+	/* Calibration registers 0x30 to 0x3F, same decoding as HTS221_Get_Humidity/Temperature. */
+	HTS221_Calibration.H0_rh = buffer[0] >> 1;
+	HTS221_Calibration.H1_rh = buffer[1] >> 1;
+	HTS221_Calibration.T0_degC = ((((uint16_t)(buffer[5] & 0x03)) << 8) | buffer[2]) >> 3;
+	HTS221_Calibration.T1_degC = ((((uint16_t)(buffer[5] & 0x0C)) << 6) | buffer[3]) >> 3;
+	HTS221_Calibration.H0_T0_out = (((uint16_t)buffer[7]) << 8) | buffer[6];
+	HTS221_Calibration.H1_T0_out = (((uint16_t)buffer[11]) << 8) | buffer[10];
+	HTS221_Calibration.T0_out = (((uint16_t)buffer[13]) << 8) | buffer[12];
+	HTS221_Calibration.T1_out = (((uint16_t)buffer[15]) << 8) | buffer[14];
+
+	return COMPONENT_OK;
 }
 
-uint8_t Sensors_Magneto_Handler(void)
+/* Average the complete patterns of the LSM6DSL FIFO into ACCELERO_Data and GYRO_Data. */
+static uint8_t Sensors_Sample_Motion(void)
 {
-	uint8_t status = 0;
-	int count = 0;
-
-	/* Enable sensor. */
-	MAGNETO_Driver->Sensor_Enable(&MAGNETO_Handle);
-	/* Read once to clear DRDY. */
-	MAGNETO_Driver->Get_Axes(&MAGNETO_Handle, &MAGNETO_Data);
-
-	/* Wait for data ready. */
-	while (MAGNETO_Driver->Get_DRDY_Status(&MAGNETO_Handle, &status) == COMPONENT_OK
-			&& status == 0
-			&& count++ < SENSOR_POLLING) {
+	uint8_t status[4];
+	uint16_t words;
+	uint16_t skip;
+	uint16_t patterns;
+	int32_t sum[6] = { 0, 0, 0, 0, 0, 0 };
+	uint8_t *data;
+	int i, j;
+
+	/* FIFO_STATUS1..4: unread words and the pattern index of the next one. */
+	if (LSM6DSL_ACC_GYRO_ReadReg(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_FIFO_STATUS1, status, 4) == MEMS_ERROR) {
+		return COMPONENT_ERROR;
 	}
 
-	if (count < SENSOR_POLLING) {
-		if (MAGNETO_Driver->Get_Axes(&MAGNETO_Handle, &MAGNETO_Data) == COMPONENT_OK) {
-			status = COMPONENT_OK;
-		}
-		else {
-			status = COMPONENT_ERROR;
+	words = status[0] | ((uint16_t)(status[1] & LSM6DSL_ACC_GYRO_DIFF_FIFO_STATUS2_MASK) << 8);
+	skip = (6 - (status[2] | ((uint16_t)(status[3] & LSM6DSL_ACC_GYRO_FIFO_STATUS4_PATTERN_MASK) << 8))) % 6;
+
+	if (words > sizeof(LSM6DSL_FIFO_Buffer) / 2) {
+		words = sizeof(LSM6DSL_FIFO_Buffer) / 2;
+	}
+	if (words < skip + 6) {
+		return COMPONENT_TIMEOUT;
+	}
+	patterns = (words - skip) / 6;
+
+	/* The address rolls back from FIFO_DATA_OUT_H to _L, the whole burst is a single read. */
+	if (LSM6DSL_ACC_GYRO_ReadReg(&ACCELERO_Handle, LSM6DSL_ACC_GYRO_FIFO_DATA_OUT_L,
+			LSM6DSL_FIFO_Buffer, (skip + patterns * 6) * 2) == MEMS_ERROR) {
+		return COMPONENT_ERROR;
+	}
+
+	/* Each pattern is gyro X, Y, Z then accelero X, Y, Z. */
+	data = &LSM6DSL_FIFO_Buffer[skip * 2];
+	for (i = 0; i < patterns; i++) {
+		for (j = 0; j < 6; j++, data += 2) {
+			sum[j] += (int16_t)(((uint16_t)data[1] << 8) | data[0]);
 		}
 	}
-	else {
-		status = COMPONENT_TIMEOUT;
+
+	GYRO_Data.AXIS_X = (int32_t)((float)sum[0] / patterns * GYRO_Sensitivity);
+	GYRO_Data.AXIS_Y = (int32_t)((float)sum[1] / patterns * GYRO_Sensitivity);
+	GYRO_Data.AXIS_Z = (int32_t)((float)sum[2] / patterns * GYRO_Sensitivity);
+	ACCELERO_Data.AXIS_X = (int32_t)((float)sum[3] / patterns * ACCELERO_Sensitivity);
+	ACCELERO_Data.AXIS_Y = (int32_t)((float)sum[4] / patterns * ACCELERO_Sensitivity);
+	ACCELERO_Data.AXIS_Z = (int32_t)((float)sum[5] / patterns * ACCELERO_Sensitivity);
+
+	return COMPONENT_OK;
+}
+
+static uint8_t Sensors_Sample_Magneto(void)
+{
+	uint8_t buffer[6];
+
+	/* LIS2MDL increments the address on its own, LIS2MDL_MAG_Get_Magnetic reads byte by byte. */
+	if (Sensor_IO_Read(&MAGNETO_Handle, LIS2MDL_MAG_OUTX_L, buffer, sizeof(buffer))) {
+		return COMPONENT_ERROR;
 	}
 
-	/* Disable sensor. */
-	MAGNETO_Driver->Sensor_Disable(&MAGNETO_Handle);
-	return status;
+	MAGNETO_Data.AXIS_X = (int32_t)((int16_t)(((uint16_t)buffer[1] << 8) | buffer[0]) * MAGNETO_Sensitivity);
+	MAGNETO_Data.AXIS_Y = (int32_t)((int16_t)(((uint16_t)buffer[3] << 8) | buffer[2]) * MAGNETO_Sensitivity);
+	MAGNETO_Data.AXIS_Z = (int32_t)((int16_t)(((uint16_t)buffer[5] << 8) | buffer[4]) * MAGNETO_Sensitivity);
+
+	return COMPONENT_OK;
 }
 
-uint8_t Sensors_Pressure_Handler(void)
+static uint8_t Sensors_Sample_Pressure(void)
 {
-	uint8_t status = 0;
-	int count = 0;
-
-	/* Enable sensor. */
-	PRESSURE_Driver->Sensor_Enable(&PRESSURE_Handle);
-	/* Read once to clear DRDY. */
-	PRESSURE_Driver->Get_Press(&PRESSURE_Handle, &PRESSURE_Data);
-
-	/* Wait for data ready. */
-	while (PRESSURE_Driver->Get_DRDY_Status(&PRESSURE_Handle, &status) == COMPONENT_OK
-			&& status == 0
-			&& count++ < SENSOR_POLLING) {
+	uint8_t buffer[3];
+	uint32_t raw;
+
+	/* LPS22HB_ReadReg reads one byte per transfer, read PRESS_OUT_XL/L/H directly. */
+	if (Sensor_IO_Read(&PRESSURE_Handle, LPS22HB_PRESS_OUT_XL_REG, buffer, sizeof(buffer))) {
+		return COMPONENT_ERROR;
 	}
 
-	if (count < SENSOR_POLLING) {
-		if (PRESSURE_Driver->Get_Press(&PRESSURE_Handle, &PRESSURE_Data) == COMPONENT_OK) {
-			status = COMPONENT_OK;
-		}
-		else {
-			status = COMPONENT_ERROR;
-		}
+	raw = ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[1] << 8) | buffer[0];
+	if (raw & 0x00800000) {
+		raw |= 0xFF000000;
 	}
-	else {
-		status = COMPONENT_TIMEOUT;
+
+	/* Same rounding as LPS22HB_Get_Pressure. */
+	PRESSURE_Data = (float)(((int32_t)raw * 100) / 4096) / 100.0f;
+
+	return COMPONENT_OK;
+}
+
+static uint8_t Sensors_Sample_HumTemp(void)
+{
+	uint8_t buffer[4];
+	int16_t H_T_out, T_out;
+	float tmp_f;
+
+	/* HUMIDITY_OUT_L/H and TEMP_OUT_L/H are contiguous. */
+	if (HTS221_ReadReg(&HUMIDITY_Handle, HTS221_HR_OUT_L_REG, sizeof(buffer), buffer) == HTS221_ERROR) {
+		return COMPONENT_ERROR;
 	}
 
-	/* Disable sensor. */
-	PRESSURE_Driver->Sensor_Disable(&PRESSURE_Handle);
-	return status;
+	H_T_out = (((uint16_t)buffer[1]) << 8) | buffer[0];
+	T_out = (((uint16_t)buffer[3]) << 8) | buffer[2];
+
+	tmp_f = (float)(H_T_out - HTS221_Calibration.H0_T0_out) * (float)(HTS221_Calibration.H1_rh - HTS221_Calibration.H0_rh)
+			/ (float)(HTS221_Calibration.H1_T0_out - HTS221_Calibration.H0_T0_out) + HTS221_Calibration.H0_rh;
+	tmp_f *= 10.0f;
+	HUMIDITY_Data = (float)((tmp_f > 1000.0f) ? 1000 : (tmp_f < 0.0f) ? 0 : (uint16_t)tmp_f) / 10.0f;
+
+	tmp_f = (float)(T_out - HTS221_Calibration.T0_out) * (float)(HTS221_Calibration.T1_degC - HTS221_Calibration.T0_degC)
+			/ (float)(HTS221_Calibration.T1_out - HTS221_Calibration.T0_out) + HTS221_Calibration.T0_degC;
+	tmp_f *= 10.0f;
+	TEMPERATURE_Data = (float)(int16_t)tmp_f / 10.0f;
+
+	return COMPONENT_OK;
 }
 
-uint8_t Sensors_Humidity_Handler(void)
+uint8_t Sensors_Start(void)
 {
-	uint8_t status = 0;
-	int count = 0;
-
-	/* Enable sensor. */
-	HUMIDITY_Driver->Sensor_Enable(&HUMIDITY_Handle);
-	/* Read once to clear DRDY. */
-	HUMIDITY_Driver->Get_Hum(&HUMIDITY_Handle, &HUMIDITY_Data);
-
-	/* Wait for data ready. */
-	while (HUMIDITY_Driver->Get_DRDY_Status(&HUMIDITY_Handle, &status) == COMPONENT_OK
-			&& status == 0
-			&& count++ < SENSOR_POLLING) {
+	uint8_t status = COMPONENT_OK;
+
+	DPRINT_I(TAG, "Sensors_Start: sampling every %d ms...", SENSORS_SAMPLE_MSEC);
+
+	/* Sensors that fail to start are left out, the others keep being sampled. */
+	if (Sensors_Start_Motion() != COMPONENT_OK
+			|| Sensors_Schedule(Sensors_Sample_Motion, SENSORS_SAMPLE_MSEC) != COMPONENT_OK) {
+		DPRINT_E(TAG, "Sensors_Start: LSM6DSL start error!");
+		status = COMPONENT_ERROR;
 	}
 
-	if (count < SENSOR_POLLING) {
-		if (HUMIDITY_Driver->Get_Hum(&HUMIDITY_Handle, &HUMIDITY_Data) == COMPONENT_OK) {
-			status = COMPONENT_OK;
-		}
-		else {
-			status = COMPONENT_ERROR;
-		}
+	if (Sensors_Start_Magneto() != COMPONENT_OK
+			|| Sensors_Schedule(Sensors_Sample_Magneto, SENSORS_SAMPLE_MSEC) != COMPONENT_OK) {
+		DPRINT_E(TAG, "Sensors_Start: LIS2MDL start error!");
+		status = COMPONENT_ERROR;
+	}
+
+	if (Sensors_Start_Pressure() != COMPONENT_OK
+			|| Sensors_Schedule(Sensors_Sample_Pressure, SENSORS_SAMPLE_MSEC) != COMPONENT_OK) {
+		DPRINT_E(TAG, "Sensors_Start: LPS22HB start error!");
+		status = COMPONENT_ERROR;
 	}
-	else {
-		status = COMPONENT_TIMEOUT;
+
+	if (Sensors_Start_HumTemp() != COMPONENT_OK
+			|| Sensors_Schedule(Sensors_Sample_HumTemp, SENSORS_SAMPLE_MSEC) != COMPONENT_OK) {
+		DPRINT_E(TAG, "Sensors_Start: HTS221 start error!");
+		status = COMPONENT_ERROR;
 	}
 
-	/* Disable sensor. */
-	HUMIDITY_Driver->Sensor_Disable(&HUMIDITY_Handle);
 	return status;
 }
 
-uint8_t Sensors_Temperature_Handler(void)
+uint8_t Sensors_Schedule(Sensors_Sampler_t sampler, uint32_t period_ms)
 {
-	uint8_t status = 0;
-	int count = 0;
-
-	/* Enable sensor. */
-	TEMPERATURE_Driver->Sensor_Enable(&TEMPERATURE_Handle);
-	/* Read once to clear DRDY. */
-	TEMPERATURE_Driver->Get_Temp(&TEMPERATURE_Handle, &TEMPERATURE_Data);
-
-	/* Wait for data ready. */
-	while (TEMPERATURE_Driver->Get_DRDY_Status(&TEMPERATURE_Handle, &status) == COMPONENT_OK
-			&& status == 0
-			&& count++ < SENSOR_POLLING) {
+	Sensors_Schedule_t *entry;
+
+	if (Sensors_Schedule_Count == SENSORS_SCHEDULE_MAX || period_ms == 0) {
+		return COMPONENT_ERROR;
 	}
 
-	if (count < SENSOR_POLLING) {
-		if (TEMPERATURE_Driver->Get_Temp(&TEMPERATURE_Handle, &TEMPERATURE_Data) == COMPONENT_OK) {
-			status = COMPONENT_OK;
+	entry = &Sensors_Schedule_Table[Sensors_Schedule_Count++];
+	entry->sampler = sampler;
+	entry->period_ms = period_ms;
+	entry->next_ms = 0;
+	entry->isStarted = 0;
+
+	return COMPONENT_OK;
+}
+
+void Sensors_Task(uint32_t now_ms)
+{
+	Sensors_Schedule_t *entry;
+	int i;
+
+	/* Samplers due in the same pass run back to back, ones sharing a period stay together. */
+	for (i = 0; i < Sensors_Schedule_Count; i++) {
+		entry = &Sensors_Schedule_Table[i];
+
+		if (entry->isStarted && (int32_t)(now_ms - entry->next_ms) < 0) {
+			continue;
+		}
+
+		/* A failed read keeps the previous cached value. */
+		entry->sampler();
+
+		if (!entry->isStarted || (int32_t)(now_ms - (entry->next_ms + entry->period_ms)) >= 0) {
+			/* First run or late by more than a period, restart from now. */
+			entry->next_ms = now_ms + entry->period_ms;
+			entry->isStarted = 1;
 		}
 		else {
-			status = COMPONENT_ERROR;
+			entry->next_ms += entry->period_ms;
 		}
 	}
-	else {
-		status = COMPONENT_TIMEOUT;
-	}
-
-	/* Disable sensor. */
-	TEMPERATURE_Driver->Sensor_Disable(&TEMPERATURE_Handle);
-	return status;
 }
@@ -42,7 +42,15 @@
 #include "temperature.h"
 #include "pressure.h"
 
-#define SENSOR_POLLING			1000
+/** Default sampling period of the sensors started by Sensors_Start(). */
+#define SENSORS_SAMPLE_MSEC		2000
+/** Maximum number of samplers in the schedule. */
+#define SENSORS_SCHEDULE_MAX	8
+/** LSM6DSL FIFO depth in gyro + accelero patterns (6 words each). */
+#define SENSORS_FIFO_PATTERNS	32
+
+/** Sampler run by Sensors_Task(), reads its device and updates the cached values. */
+typedef uint8_t (*Sensors_Sampler_t)(void);
 
 extern SensorAxes_t ACCELERO_Data;
 extern SensorAxes_t GYRO_Data;
@@ -53,12 +61,9 @@ extern float TEMPERATURE_Data;
 
 uint8_t Sensors_Init(void);
 uint8_t Sensors_DeInit(void);
-uint8_t Sensors_Accelero_Handler(void);
-uint8_t Sensors_Gyro_Handler(void);
-uint8_t Sensors_Magneto_Handler(void);
-uint8_t Sensors_Pressure_Handler(void);
-uint8_t Sensors_Humidity_Handler(void);
-uint8_t Sensors_Temperature_Handler(void);
+uint8_t Sensors_Start(void);
+uint8_t Sensors_Schedule(Sensors_Sampler_t sampler, uint32_t period_ms);
+void Sensors_Task(uint32_t now_ms);
 
 uint8_t Sensor_IO_Write(void *handle, uint8_t WriteAddr, uint8_t *pBuffer, uint16_t nBytesToWrite);
 uint8_t Sensor_IO_Read(void *handle, uint8_t ReadAddr, uint8_t *pBuffer, uint16_t nBytesToRead);
@@ -260,6 +260,42 @@ AZ_NODISCARD bool az_json_token_is_text_equal(
     az_json_token const* json_token,
     az_span expected_text);
 
+/**
+ * @brief Finds which of the \p names the unescaped JSON token value that the #az_json_token points
+ * to is equal to, by doing a case-sensitive comparison.
+ *
+ * @param[in] json_token A pointer to an #az_json_token instance containing the JSON string token.
+ * @param[in] names An array of the lookup texts to compare the token against, such as the property
+ * names a parser dispatches on.
+ * @param[in] names_count The number of elements in \p names.
+ *
+ * @return The index of the first element of \p names that the current JSON token value in the JSON
+ * source semantically matches, with the exact casing; otherwise, -1.
+ *
+ * @remarks The result is the same as calling #az_json_token_is_text_equal() with each element of \p
+ * names in turn, but the names whose size can't match are ruled out without reading the token, and
+ * a token with escaped characters is unescaped only once for all of them.
+ *
+ * @remarks This operation is only valid for the string and property name token kinds. For all other
+ * token kinds, it returns -1.
+ *
+ * Example:
+ * \code{.c}
+ *  static const az_span names[] = { AZ_SPAN_LITERAL_FROM_STR("deviceId"),
+ *                                  AZ_SPAN_LITERAL_FROM_STR("status") };
+ *
+ *  switch (az_json_token_find_text(&jr.token, names, (int32_t)(sizeof(names) / sizeof(names[0]))))
+ *  {
+ *    case 0: // deviceId
+ *    ...
+ *  }
+ * \endcode
+ */
+AZ_NODISCARD int32_t az_json_token_find_text(
+    az_json_token const* json_token,
+    az_span const names[],
+    int32_t names_count);
+
 /************************************ JSON WRITER ******************/
 
 /**
@@ -38,6 +38,10 @@ enum
   _az_MAX_UNESCAPED_STRING_SIZE
   = _az_MAX_ESCAPED_STRING_SIZE / _az_MAX_EXPANSION_FACTOR_WHILE_ESCAPING, // 166_666_666 bytes
 
+  // az_json_token_find_text() keeps one bit per name of a uint64_t candidate mask, so it matches up
+  // to 64 names in each pass over the token.
+  _az_MAX_NAMES_PER_TEXT_SEARCH = 64,
+
   // [-][0-9]{16}.[0-9]{15}, i.e. 1+16+1+15 since _az_MAX_SUPPORTED_FRACTIONAL_DIGITS is 15
   _az_MAX_SIZE_FOR_WRITING_DOUBLE = 33,
 
@@ -162,6 +162,58 @@ AZ_NODISCARD static az_result _az_json_reader_get_next_buffer(
   return AZ_OK;
 }
 
+AZ_NODISCARD AZ_INLINE bool _az_json_is_whitespace(uint8_t byte)
+{
+  return byte == ' ' || byte == '\n' || byte == '\r' || byte == '\t';
+}
+
+// Number of whitespace bytes at the start of the `size` bytes at `ptr`.
+AZ_NODISCARD static int32_t _az_json_whitespace_size(uint8_t const* ptr, int32_t size)
+{
+  int32_t i = 0;
+
+  // Compact JSON has no whitespace at all between tokens, don't bother with the bulk scan for it.
+  if (size < 1 || !_az_json_is_whitespace(ptr[0]))
+  {
+    return 0;
+  }
+
+#if defined(_az_SPAN_SSE2)
+  for (; i <= size - 16; i += 16)
+  {
+    __m128i const bytes = _mm_loadu_si128((__m128i const*)(ptr + i));
+    __m128i const whitespace = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))));
+    int const mask = _mm_movemask_epi8(whitespace);
+    if (mask != 0xFFFF)
+    {
+      return i + _az_span_lowest_set_bit((uint64_t)(~mask & 0xFFFF));
+    }
+  }
+#elif defined(_az_SPAN_SWAR)
+  for (; i <= size - (int32_t)sizeof(_az_span_word); i += (int32_t)sizeof(_az_span_word))
+  {
+    _az_span_word const word = _az_span_word_load(ptr + i);
+    if ((_az_span_word_match(word, ' ') | _az_span_word_match(word, '\n')
+         | _az_span_word_match(word, '\r') | _az_span_word_match(word, '\t'))
+        != _az_SPAN_WORD_HIGHS)
+    {
+      break;
+    }
+  }
+#endif
+
+  // The byte loop finds the first non-whitespace byte within the last word, or the tail.
+  while (i < size && _az_json_is_whitespace(ptr[i]))
+  {
+    i++;
+  }
+  return i;
+}
+
 AZ_NODISCARD static az_span _az_json_reader_skip_whitespace(az_json_reader* ref_json_reader)
 {
   az_span json;
@@ -169,10 +221,9 @@ AZ_NODISCARD static az_span _az_json_reader_skip_whitespace(az_json_reader* ref_
 
   while (true)
   {
-    json = _az_span_trim_whitespace_from_start(remaining);
-
-    // Find out how many whitespace characters were trimmed.
-    int32_t consumed = _az_span_diff(json, remaining);
+    // Find out how many whitespace characters there are before the next token.
+    int32_t consumed = _az_json_whitespace_size(az_span_ptr(remaining), az_span_size(remaining));
+    json = az_span_slice_to_end(remaining, consumed);
 
     ref_json_reader->_internal.bytes_consumed += consumed;
     ref_json_reader->_internal.total_bytes_consumed += consumed;
@@ -243,6 +294,55 @@ AZ_NODISCARD static bool _az_is_valid_escaped_character(uint8_t byte)
   }
 }
 
+// Number of bytes at the start of the `size` bytes at `ptr` that need no checks within a string,
+// that is up to the first '"', '\\' or control character.
+AZ_NODISCARD static int32_t _az_json_string_plain_size(uint8_t const* ptr, int32_t size)
+{
+  int32_t i = 0;
+
+#if defined(_az_SPAN_SSE2)
+  for (; i <= size - 16; i += 16)
+  {
+    __m128i const bytes = _mm_loadu_si128((__m128i const*)(ptr + i));
+    // There is no unsigned byte compare, a byte is at most 0x1F when max(byte, 0x1F) is 0x1F.
+    __m128i const control = _mm_set1_epi8(_az_ASCII_SPACE_CHARACTER - 1);
+    __m128i const special = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'))),
+        _mm_cmpeq_epi8(_mm_max_epu8(bytes, control), control));
+    int const mask = _mm_movemask_epi8(special);
+    if (mask != 0)
+    {
+      return i + _az_span_lowest_set_bit((uint64_t)mask);
+    }
+  }
+#elif defined(_az_SPAN_SWAR)
+  for (; i <= size - (int32_t)sizeof(_az_span_word); i += (int32_t)sizeof(_az_span_word))
+  {
+    _az_span_word const word = _az_span_word_load(ptr + i);
+    // The high bit of a byte of at_least_space is set for bytes >= 0x20 within the low 7 bits.
+    _az_span_word const at_least_space
+        = (word & ~_az_SPAN_WORD_HIGHS) + _az_SPAN_WORD_ONES * (0x80 - _az_ASCII_SPACE_CHARACTER);
+    _az_span_word const control = ~(at_least_space | word) & _az_SPAN_WORD_HIGHS;
+    if ((_az_span_word_match(word, '"') | _az_span_word_match(word, '\\') | control) != 0)
+    {
+      break;
+    }
+  }
+#endif
+
+  // The byte loop finds the special byte within the last word, or the tail.
+  for (; i < size; i++)
+  {
+    uint8_t const byte = ptr[i];
+    if (byte == '"' || byte == '\\' || byte < _az_ASCII_SPACE_CHARACTER)
+    {
+      break;
+    }
+  }
+  return i;
+}
+
 AZ_NODISCARD static az_result _az_json_reader_process_string(az_json_reader* ref_json_reader)
 {
   // Move past the first '"' character
@@ -251,22 +351,32 @@ AZ_NODISCARD static az_result _az_json_reader_process_string(az_json_reader* ref
   az_span token = _get_remaining_json(ref_json_reader);
   int32_t remaining_size = az_span_size(token);
 
-  if (remaining_size < 1)
-  {
-    _az_RETURN_IF_FAILED(_az_json_reader_get_next_buffer(ref_json_reader, &token, false));
-    remaining_size = az_span_size(token);
-  }
-
   int32_t current_index = 0;
   int32_t string_length = 0;
   uint8_t* token_ptr = az_span_ptr(token);
-  uint8_t next_byte = token_ptr[0];
+  uint8_t next_byte = 0;
 
   // Clear the state of any previous string token.
   ref_json_reader->token._internal.string_has_escaped_chars = false;
 
   while (true)
   {
+    // Skip the plain bytes in bulk, only the end of a segment or a special byte stops the scan.
+    int32_t const plain_size
+        = _az_json_string_plain_size(token_ptr + current_index, remaining_size - current_index);
+    current_index += plain_size;
+    string_length += plain_size;
+
+    if (current_index >= remaining_size)
+    {
+      _az_RETURN_IF_FAILED(_az_json_reader_get_next_buffer(ref_json_reader, &token, false));
+      current_index = 0;
+      token_ptr = az_span_ptr(token);
+      remaining_size = az_span_size(token);
+      continue;
+    }
+    next_byte = token_ptr[current_index];
+
     if (next_byte == '"')
     {
       break;
@@ -327,23 +437,13 @@ AZ_NODISCARD static az_result _az_json_reader_process_string(az_json_reader* ref
     else
     {
       // Control characters are invalid within a JSON string and should be correctly escaped.
-      if (next_byte < _az_ASCII_SPACE_CHARACTER)
-      {
-        return AZ_ERROR_UNEXPECTED_CHAR;
-      }
+      return AZ_ERROR_UNEXPECTED_CHAR;
     }
 
+    // Move past the escaped character, the scan at the top of the loop moves to the next segment
+    // if this was the last byte of this one.
     current_index++;
     string_length++;
-
-    if (current_index >= remaining_size)
-    {
-      _az_RETURN_IF_FAILED(_az_json_reader_get_next_buffer(ref_json_reader, &token, false));
-      current_index = 0;
-      token_ptr = az_span_ptr(token);
-      remaining_size = az_span_size(token);
-    }
-    next_byte = token_ptr[current_index];
   }
 
   _az_json_reader_update_state(
@@ -243,6 +243,151 @@ AZ_NODISCARD bool az_json_token_is_text_equal(
   return az_span_size(expected_text) == 0;
 }
 
+AZ_NODISCARD static int32_t _az_json_token_find_text_in_group(
+    az_json_token const* json_token,
+    az_span const names[],
+    int32_t names_count)
+{
+  int32_t const token_size = json_token->size;
+  bool const has_escaped_chars = json_token->_internal.string_has_escaped_chars;
+
+  // Rule out the names whose size can't match. Unescaping always shrinks the string, at most by a
+  // factor of 6.
+  uint64_t candidates = 0;
+  for (int32_t i = 0; i < names_count; i++)
+  {
+    int32_t const name_size = az_span_size(names[i]);
+    if (has_escaped_chars ? (name_size <= token_size
+                             && token_size / _az_MAX_EXPANSION_FACTOR_WHILE_ESCAPING <= name_size)
+                          : name_size == token_size)
+    {
+      candidates |= 1ULL << i;
+    }
+  }
+
+  // There is nothing to unescape here, so only names of the token's exact size are left, which is
+  // usually one or none. Compare them directly.
+  if (!has_escaped_chars)
+  {
+    for (; candidates != 0; candidates &= candidates - 1)
+    {
+      int32_t const i = _az_span_lowest_set_bit(candidates);
+      if (json_token->_internal.is_multisegment
+              ? az_json_token_is_text_equal(json_token, names[i])
+              : az_span_is_content_equal(json_token->slice, names[i]))
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // Otherwise, read the token once, unescaping each byte and dropping the names that differ at its
+  // position in the unescaped text.
+  int32_t text_size = 0;
+  bool next_char_escaped = false;
+  int32_t const first_buffer_index
+      = json_token->_internal.is_multisegment ? json_token->_internal.start_buffer_index : 0;
+  int32_t const last_buffer_index
+      = json_token->_internal.is_multisegment ? json_token->_internal.end_buffer_index : 0;
+
+  for (int32_t b = first_buffer_index; b <= last_buffer_index; b++)
+  {
+    az_span source = json_token->slice;
+    if (json_token->_internal.is_multisegment)
+    {
+      source = json_token->_internal.pointer_to_first_buffer[b];
+      if (b == json_token->_internal.start_buffer_index)
+      {
+        source = az_span_slice_to_end(source, json_token->_internal.start_buffer_offset);
+      }
+      else if (b == json_token->_internal.end_buffer_index)
+      {
+        source = az_span_slice(source, 0, json_token->_internal.end_buffer_offset);
+      }
+    }
+
+    uint8_t const* source_ptr = az_span_ptr(source);
+    int32_t const source_size = az_span_size(source);
+    for (int32_t k = 0; k < source_size; k++)
+    {
+      uint8_t token_byte = source_ptr[k];
+      if (next_char_escaped)
+      {
+        next_char_escaped = false;
+        token_byte = _az_json_unescape_single_byte(token_byte);
+
+        // Like az_json_token_is_text_equal(), \uXXXX escapes are not supported and never match.
+        if (token_byte == 'u')
+        {
+          return -1;
+        }
+      }
+      else if (token_byte == '\\')
+      {
+        next_char_escaped = true;
+        continue;
+      }
+
+      for (uint64_t remaining = candidates; remaining != 0; remaining &= remaining - 1)
+      {
+        int32_t const i = _az_span_lowest_set_bit(remaining);
+        if (text_size >= az_span_size(names[i]) || az_span_ptr(names[i])[text_size] != token_byte)
+        {
+          candidates &= ~(1ULL << i);
+        }
+      }
+
+      if (candidates == 0)
+      {
+        return -1;
+      }
+      text_size++;
+    }
+  }
+
+  // Only a name of the exact size of the unescaped token matches.
+  for (int32_t i = 0; i < names_count; i++)
+  {
+    if ((candidates >> i & 1) != 0 && az_span_size(names[i]) == text_size)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+AZ_NODISCARD int32_t az_json_token_find_text(
+    az_json_token const* json_token,
+    az_span const names[],
+    int32_t names_count)
+{
+  _az_PRECONDITION_NOT_NULL(json_token);
+  _az_PRECONDITION(names_count >= 0);
+  _az_PRECONDITION(names_count == 0 || names != NULL);
+
+  // Cannot compare the value of non-string token kinds
+  if (json_token->kind != AZ_JSON_TOKEN_STRING && json_token->kind != AZ_JSON_TOKEN_PROPERTY_NAME)
+  {
+    return -1;
+  }
+
+  for (int32_t first = 0; first < names_count; first += _az_MAX_NAMES_PER_TEXT_SEARCH)
+  {
+    int32_t const group_count = names_count - first < _az_MAX_NAMES_PER_TEXT_SEARCH
+        ? names_count - first
+        : _az_MAX_NAMES_PER_TEXT_SEARCH;
+
+    int32_t const index = _az_json_token_find_text_in_group(json_token, names + first, group_count);
+    if (index >= 0)
+    {
+      return first + index;
+    }
+  }
+
+  return -1;
+}
+
 AZ_NODISCARD az_result az_json_token_get_boolean(az_json_token const* json_token, bool* out_value)
 {
   _az_PRECONDITION_NOT_NULL(json_token);
@@ -10,7 +10,6 @@
 #include <azure/core/internal/az_span_internal.h>
 
 #include <ctype.h>
-#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -21,6 +20,18 @@
 // An IEEE 64-bit double has 52 bits of mantissa
 #define _az_MAX_SAFE_INTEGER 9007199254740991
 
+// The 52 explicitly stored bits of an IEEE 754 double mantissa. Normal numbers have an implicit
+// leading 1 above them.
+#define _az_DOUBLE_MANTISSA_BITS 52
+#define _az_DOUBLE_MANTISSA_MASK ((1ULL << _az_DOUBLE_MANTISSA_BITS) - 1)
+
+// A subnormal double is its mantissa / 2^1074, and a normal one (mantissa + 2^52) / 2^(1075 -
+// biased exponent).
+#define _az_DOUBLE_SUBNORMAL_SHIFT 1074
+
+// A fraction of at most 53 bits times 10^15 fits in 103 bits.
+#define _az_DOUBLE_MAX_FRACTION_PRODUCT_BITS 103
+
 #ifndef AZ_NO_PRECONDITION_CHECKING
 // Note: If you are modifying this function, make sure to modify the inline version in the az_span.h
 // file as well.
@@ -83,6 +94,23 @@ AZ_NODISCARD AZ_INLINE uint8_t _az_tolower(uint8_t value)
   return value;
 }
 
+#ifdef _az_SPAN_SWAR
+// Lower cases the 'A' to 'Z' bytes of a word, the same as _az_tolower() on each byte.
+AZ_NODISCARD AZ_INLINE _az_span_word _az_span_word_tolower(_az_span_word word)
+{
+  // Adding to the low 7 bits of each byte cannot carry into the next byte. The high bit of a byte
+  // of at_least_a is set for bytes >= 'A', the one of above_z for bytes > 'Z', and bytes with their
+  // own high bit set are never letters.
+  _az_span_word const low_bits = word & ~_az_SPAN_WORD_HIGHS;
+  _az_span_word const at_least_a = low_bits + _az_SPAN_WORD_ONES * (0x80 - 'A');
+  _az_span_word const above_z = low_bits + _az_SPAN_WORD_ONES * (0x80 - 'Z' - 1);
+  _az_span_word const upper = at_least_a & ~above_z & ~word & _az_SPAN_WORD_HIGHS;
+
+  // 0x80 >> 2 is the 0x20 difference between upper and lower case letters.
+  return word | (upper >> 2);
+}
+#endif // _az_SPAN_SWAR
+
 AZ_NODISCARD bool az_span_is_content_equal_ignoring_case(az_span span1, az_span span2)
 {
   int32_t const size = az_span_size(span1);
@@ -90,9 +118,27 @@ AZ_NODISCARD bool az_span_is_content_equal_ignoring_case(az_span span1, az_span
   {
     return false;
   }
-  for (int32_t i = 0; i < size; ++i)
+
+  uint8_t const* const ptr1 = az_span_ptr(span1);
+  uint8_t const* const ptr2 = az_span_ptr(span2);
+  int32_t i = 0;
+
+#ifdef _az_SPAN_SWAR
+  for (; i <= size - (int32_t)sizeof(_az_span_word); i += (int32_t)sizeof(_az_span_word))
+  {
+    _az_span_word const word1 = _az_span_word_load(ptr1 + i);
+    _az_span_word const word2 = _az_span_word_load(ptr2 + i);
+
+    if (word1 != word2 && _az_span_word_tolower(word1) != _az_span_word_tolower(word2))
+    {
+      return false;
+    }
+  }
+#endif
+
+  for (; i < size; ++i)
   {
-    if (_az_tolower(az_span_ptr(span1)[i]) != _az_tolower(az_span_ptr(span2)[i]))
+    if (_az_tolower(ptr1[i]) != _az_tolower(ptr2[i]))
     {
       return false;
     }
@@ -402,26 +448,87 @@ AZ_NODISCARD az_result az_span_atod(az_span source, double* out_number)
 #pragma warning(pop)
 #endif
 
+// Index of the first `value` byte in the `size` bytes at `ptr`, -1 if there is none.
+AZ_NODISCARD static int32_t _az_span_find_byte(uint8_t const* ptr, int32_t size, uint8_t value)
+{
+  int32_t i = 0;
+
+#if defined(_az_SPAN_SSE2)
+  __m128i const pattern = _mm_set1_epi8((char)value);
+  for (; i <= size - 16; i += 16)
+  {
+    // The byte loop below finds the exact position within these 16 bytes.
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)(ptr + i)), pattern))
+        != 0)
+    {
+      break;
+    }
+  }
+#elif defined(_az_SPAN_SWAR)
+  _az_span_word const pattern = _az_SPAN_WORD_ONES * value;
+  for (; i <= size - (int32_t)sizeof(_az_span_word); i += (int32_t)sizeof(_az_span_word))
+  {
+    // A zero byte in `word` is a byte equal to `value`.
+    _az_span_word const word = _az_span_word_load(ptr + i) ^ pattern;
+    if (((word - _az_SPAN_WORD_ONES) & ~word & _az_SPAN_WORD_HIGHS) != 0)
+    {
+      break;
+    }
+  }
+#endif
+
+  for (; i < size; i++)
+  {
+    if (ptr[i] == value)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Targets at least this long, searched for in a source with at least this many more bytes, are
+// found with the Horspool algorithm, everything shorter with the first byte scan. Topics and
+// property bags stay on the first byte scan: filling the skip table costs more than it saves.
+#define _az_SPAN_FIND_HORSPOOL_MIN_TARGET_SIZE 16
+#define _az_SPAN_FIND_HORSPOOL_MIN_EXTRA_SIZE 256
+
+// Boyer-Moore-Horspool. Skips are capped at UINT8_MAX so the table takes 256 bytes of stack.
+AZ_NODISCARD static int32_t _az_span_find_horspool(
+    uint8_t const* source_ptr,
+    int32_t source_size,
+    uint8_t const* target_ptr,
+    int32_t target_size)
+{
+  uint8_t skip[UINT8_MAX + 1];
+  int32_t const last = target_size - 1;
+  int32_t const max_skip = target_size < UINT8_MAX ? target_size : UINT8_MAX;
+
+  memset(skip, max_skip, sizeof(skip));
+  for (int32_t i = target_size - max_skip; i < last; i++)
+  {
+    skip[target_ptr[i]] = (uint8_t)(last - i);
+  }
+
+  uint8_t const last_byte = target_ptr[last];
+  for (int32_t i = 0; i <= source_size - target_size;)
+  {
+    uint8_t const byte = source_ptr[i + last];
+    if (byte == last_byte && memcmp(source_ptr + i, target_ptr, (size_t)last) == 0)
+    {
+      return i;
+    }
+    i += skip[byte];
+  }
+  return -1;
+}
+
 AZ_NODISCARD int32_t az_span_find(az_span source, az_span target)
 {
-  /* This function implements the Naive string-search algorithm.
-   * The rationale to use this algorithm instead of other potentially more
-   * performing ones (Rabin-Karp, e.g.) is due to no additional space needed.
-   * The logic:
-   * 1. The function will look into each position of `source` if it contains the same value as the
-   * first position of `target`.
-   * 2. If it does, it could be that the next bytes in `source` are a perfect match of the remaining
-   * bytes of `target`.
-   * 3. Being so, it loops through the remaining bytes of `target` and see if they match exactly the
-   * next bytes of `source`.
-   * 4. If the loop gets to the end (all bytes of `target` are evaluated), it means `target` indeed
-   * occurs in that position of `source`.
-   * 5. If the loop gets interrupted before cruising through the entire `target`, the function must
-   * go back to step 1. from  the next position in `source`.
-   *   The loop in 5. gets interrupted if
-   *     - a byte in `target` is different than `source`, in the expected corresponding position;
-   *     - the loop has reached the end of `source` (and there are still remaining bytes of `target`
-   *         to be checked).
+  /* Short targets, which includes every topic and property name the SDK looks for, are found by
+   * scanning `source` for the first byte of `target` (several bytes at a time where the target
+   * allows it) and comparing the rest of `target` at each candidate. Long targets in long sources
+   * use the Horspool algorithm. Neither needs any memory beyond the stack.
    */
 
   int32_t source_size = az_span_size(source);
@@ -441,39 +548,30 @@ AZ_NODISCARD int32_t az_span_find(az_span source, az_span target)
   uint8_t* source_ptr = az_span_ptr(source);
   uint8_t* target_ptr = az_span_ptr(target);
 
-  // This loop traverses `source` position by position (step 1.)
-  for (int32_t i = 0; i < (source_size - target_size + 1); i++)
+  if (target_size >= _az_SPAN_FIND_HORSPOOL_MIN_TARGET_SIZE
+      && source_size - target_size >= _az_SPAN_FIND_HORSPOOL_MIN_EXTRA_SIZE)
   {
-    // This is the check done in step 1. above.
-    if (source_ptr[i] == target_ptr[0])
-    {
-      // The condition in step 2. has been satisfied.
-      int32_t j = 1;
-      // This is the loop defined in step 3.
-      // The loop must be broken if it reaches the ends of `target` (step 3.) OR `source`
-      // (step 5.).
-      for (; j < target_size && (i + j) < source_size; j++)
-      {
-        // Condition defined in step 5.
-        if (source_ptr[i + j] != target_ptr[j])
-        {
-          break;
-        }
-      }
+    return _az_span_find_horspool(source_ptr, source_size, target_ptr, target_size);
+  }
 
-      if (j == target_size)
-      {
-        // All bytes in `target` have been checked and matched the corresponding bytes in `source`
-        // (from the start point `i`), so this is indeed an instance of `target` in that position
-        // of `source` (step 4.).
+  // The last position of `source` where `target` still fits.
+  int32_t const last_start = source_size - target_size;
+  for (int32_t i = 0; i <= last_start;)
+  {
+    int32_t const candidate = _az_span_find_byte(source_ptr + i, last_start - i + 1, target_ptr[0]);
+    if (candidate < 0)
+    {
+      break;
+    }
 
-        return i;
-      }
+    i += candidate;
+    if (memcmp(source_ptr + i + 1, target_ptr + 1, (size_t)(target_size - 1)) == 0)
+    {
+      return i;
     }
+    i++;
   }
 
-  // If the function hasn't returned before, all positions
-  // of `source` have been evaluated but `target` could not be found.
   return target_not_found;
 }
 
@@ -558,41 +656,117 @@ void az_span_to_str(char* destination, int32_t destination_max_size, az_span sou
   destination[size_to_write] = 0;
 }
 
-AZ_INLINE uint8_t _az_decimal_to_ascii(uint8_t d)
+// "00" to "99", so that two digits are written for every division by 100.
+static char const _az_two_digits[] = "00010203040506070809"
+                                     "10111213141516171819"
+                                     "20212223242526272829"
+                                     "30313233343536373839"
+                                     "40414243444546474849"
+                                     "50515253545556575859"
+                                     "60616263646566676869"
+                                     "70717273747576777879"
+                                     "80818283848586878889"
+                                     "90919293949596979899";
+
+// 10^0 to 10^19, to count digits with comparisons instead of divisions.
+static uint64_t const _az_powers_of_ten[_az_MAX_SIZE_FOR_UINT64] = {
+  1ULL,
+  10ULL,
+  100ULL,
+  1000ULL,
+  10000ULL,
+  100000ULL,
+  1000000ULL,
+  10000000ULL,
+  100000000ULL,
+  1000000000ULL,
+  10000000000ULL,
+  100000000000ULL,
+  1000000000000ULL,
+  10000000000000ULL,
+  100000000000000ULL,
+  1000000000000000ULL,
+  10000000000000000ULL,
+  100000000000000000ULL,
+  1000000000000000000ULL,
+  _az_SMALLEST_20_DIGIT_NUMBER,
+};
+
+AZ_NODISCARD AZ_INLINE int32_t _az_span_digit_count(uint64_t n)
 {
-  return (uint8_t)((uint32_t)('0' + d) & (uint8_t)UINT8_MAX);
+  int32_t digit_count = 1;
+  while (digit_count < _az_MAX_SIZE_FOR_UINT64 && n >= _az_powers_of_ten[digit_count])
+  {
+    digit_count++;
+  }
+  return digit_count;
 }
 
-static AZ_NODISCARD az_result _az_span_builder_append_uint64(az_span* ref_span, uint64_t n)
+AZ_INLINE void _az_span_write_two_digits(uint8_t* ptr, uint32_t n)
+{
+  ptr[0] = (uint8_t)_az_two_digits[n * 2];
+  ptr[1] = (uint8_t)_az_two_digits[n * 2 + 1];
+}
+
+// Writes `n` as exactly `digit_count` decimal digits, zero padded on the left, where n is less than
+// 10^digit_count. Cortex-M0+ has no divide instruction, so this divides once per four digits and
+// splits those with a multiply: (n * 5243) >> 19 is n / 100 for every n below 43699.
+static void _az_span_write_uint32(uint8_t* ptr, uint32_t n, int32_t digit_count)
 {
-  _az_RETURN_IF_NOT_ENOUGH_SIZE(*ref_span, 1);
+  uint8_t* end = ptr + digit_count;
 
-  if (n == 0)
+  while (digit_count > 4)
   {
-    *ref_span = az_span_copy_u8(*ref_span, '0');
-    return AZ_OK;
+    uint32_t const quotient = n / 10000;
+    uint32_t const four_digits = n - quotient * 10000;
+    uint32_t const high = (four_digits * 5243) >> 19;
+    end -= 4;
+    _az_span_write_two_digits(end, high);
+    _az_span_write_two_digits(end + 2, four_digits - high * 100);
+    n = quotient;
+    digit_count -= 4;
   }
 
-  uint64_t div = _az_SMALLEST_20_DIGIT_NUMBER;
-  uint64_t nn = n;
-  int32_t digit_count = _az_MAX_SIZE_FOR_UINT64;
-  while (nn / div == 0)
+  if (digit_count > 2)
   {
-    div /= _az_NUMBER_OF_DECIMAL_VALUES;
-    digit_count--;
+    uint32_t const high = (n * 5243) >> 19;
+    end -= 2;
+    _az_span_write_two_digits(end, n - high * 100);
+    n = high;
+    digit_count -= 2;
   }
 
-  _az_RETURN_IF_NOT_ENOUGH_SIZE(*ref_span, digit_count);
+  if (digit_count == 2)
+  {
+    _az_span_write_two_digits(end - 2, n);
+  }
+  else
+  {
+    *(end - 1) = (uint8_t)('0' + n);
+  }
+}
 
-  while (div > 1)
+// Same as _az_span_write_uint32(), for 64-bit values. Eight digits are split off with a 64-bit
+// division until the rest fits in 32 bits, which takes at most two of them.
+static void _az_span_write_uint64(uint8_t* ptr, uint64_t n, int32_t digit_count)
+{
+  while (n > UINT32_MAX)
   {
-    uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)(nn / div));
-    *ref_span = az_span_copy_u8(*ref_span, value_to_append);
-    nn %= div;
-    div /= _az_NUMBER_OF_DECIMAL_VALUES;
+    uint64_t const quotient = n / 100000000;
+    digit_count -= 8;
+    _az_span_write_uint32(ptr + digit_count, (uint32_t)(n - quotient * 100000000), 8);
+    n = quotient;
   }
-  uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)nn);
-  *ref_span = az_span_copy_u8(*ref_span, value_to_append);
+  _az_span_write_uint32(ptr, (uint32_t)n, digit_count);
+}
+
+static AZ_NODISCARD az_result _az_span_builder_append_uint64(az_span* ref_span, uint64_t n)
+{
+  int32_t const digit_count = _az_span_digit_count(n);
+  _az_RETURN_IF_NOT_ENOUGH_SIZE(*ref_span, digit_count);
+
+  _az_span_write_uint64(az_span_ptr(*ref_span), n, digit_count);
+  *ref_span = az_span_slice_to_end(*ref_span, digit_count);
   return AZ_OK;
 }
 
@@ -614,7 +788,8 @@ AZ_NODISCARD az_result az_span_i64toa(az_span destination, int64_t source, az_sp
   {
     _az_RETURN_IF_NOT_ENOUGH_SIZE(destination, 1);
     *out_span = az_span_copy_u8(destination, '-');
-    return _az_span_builder_append_uint64(out_span, (uint64_t)-source);
+    // Negate as unsigned, INT64_MIN has no positive int64_t counterpart.
+    return _az_span_builder_append_uint64(out_span, 0 - (uint64_t)source);
   }
 
   // make out_span point to destination before trying to write on it (might be an empty az_span or
@@ -626,38 +801,11 @@ AZ_NODISCARD az_result az_span_i64toa(az_span destination, int64_t source, az_sp
 static AZ_NODISCARD az_result
 _az_span_builder_append_u32toa(az_span destination, uint32_t n, az_span* out_span)
 {
-  _az_RETURN_IF_NOT_ENOUGH_SIZE(destination, 1);
-
-  if (n == 0)
-  {
-    *out_span = az_span_copy_u8(destination, '0');
-    return AZ_OK;
-  }
-
-  uint32_t div = _az_SMALLEST_10_DIGIT_NUMBER;
-  uint32_t nn = n;
-  int32_t digit_count = _az_MAX_SIZE_FOR_UINT32;
-  while (nn / div == 0)
-  {
-    div /= _az_NUMBER_OF_DECIMAL_VALUES;
-    digit_count--;
-  }
-
+  int32_t const digit_count = _az_span_digit_count(n);
   _az_RETURN_IF_NOT_ENOUGH_SIZE(destination, digit_count);
 
-  *out_span = destination;
-
-  while (div > 1)
-  {
-    uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)(nn / div));
-    *out_span = az_span_copy_u8(*out_span, value_to_append);
-
-    nn %= div;
-    div /= _az_NUMBER_OF_DECIMAL_VALUES;
-  }
-
-  uint8_t value_to_append = _az_decimal_to_ascii((uint8_t)nn);
-  *out_span = az_span_copy_u8(*out_span, value_to_append);
+  _az_span_write_uint32(az_span_ptr(destination), n, digit_count);
+  *out_span = az_span_slice_to_end(destination, digit_count);
   return AZ_OK;
 }
 
@@ -679,7 +827,8 @@ AZ_NODISCARD az_result az_span_i32toa(az_span destination, int32_t source, az_sp
   {
     _az_RETURN_IF_NOT_ENOUGH_SIZE(*out_span, 1);
     *out_span = az_span_copy_u8(*out_span, '-');
-    source = -source;
+    // Negate as unsigned, INT32_MIN has no positive int32_t counterpart.
+    return _az_span_builder_append_u32toa(*out_span, 0 - (uint32_t)source, out_span);
   }
 
   return _az_span_builder_append_u32toa(*out_span, (uint32_t)source, out_span);
@@ -702,28 +851,43 @@ az_span_dtoa(az_span destination, double source, int32_t fractional_digits, az_s
     return AZ_ERROR_NOT_SUPPORTED;
   }
 
-  if (source < 0)
+  // The digits are computed from the IEEE 754 fields with integer arithmetic only, which keeps a
+  // software floating point library out of the picture on targets without an FPU. The value is
+  // mantissa / 2^shift.
+  uint64_t binary_value = 0;
+  // NOLINTNEXTLINE(clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+  memcpy(&binary_value, &source, sizeof(binary_value));
+
+  uint64_t mantissa = binary_value & _az_DOUBLE_MANTISSA_MASK;
+  int32_t const biased_exponent = (int32_t)((binary_value >> _az_DOUBLE_MANTISSA_BITS) & 0x7FF);
+  int32_t shift = _az_DOUBLE_SUBNORMAL_SHIFT;
+  if (biased_exponent != 0)
+  {
+    mantissa |= _az_DOUBLE_MANTISSA_MASK + 1;
+    shift = _az_DOUBLE_SUBNORMAL_SHIFT + 1 - biased_exponent;
+  }
+
+  // Negative zero is written as 0.
+  if ((binary_value >> 63) != 0 && mantissa != 0)
   {
     _az_RETURN_IF_NOT_ENOUGH_SIZE(*out_span, 1);
     *out_span = az_span_copy_u8(*out_span, '-');
-    source = -source;
   }
 
-  double integer_part = 0;
-  double after_decimal_part = modf(source, &integer_part);
-
-  if (integer_part > _az_MAX_SAFE_INTEGER)
+  // With a normal mantissa of 53 bits, any left shift takes the integer part past
+  // _az_MAX_SAFE_INTEGER.
+  if (shift < 0)
   {
     return AZ_ERROR_NOT_SUPPORTED;
   }
 
-  // The double to uint64_t cast should be safe without loss of precision.
   // Append the integer part.
-  _az_RETURN_IF_FAILED(_az_span_builder_append_uint64(out_span, (uint64_t)integer_part));
+  uint64_t const integer_part = shift < 64 ? mantissa >> shift : 0;
+  _az_RETURN_IF_FAILED(_az_span_builder_append_uint64(out_span, integer_part));
 
   // Only print decimal digits if the user asked for at least one to be printed.
   // Or if the decimal part is non-zero.
-  if (fractional_digits <= 0)
+  if (fractional_digits <= 0 || shift == 0)
   {
     return AZ_OK;
   }
@@ -734,31 +898,42 @@ az_span_dtoa(az_span destination, double source, int32_t fractional_digits, az_s
     fractional_digits = _az_MAX_SUPPORTED_FRACTIONAL_DIGITS;
   }
 
-  int32_t leading_zeros = 0;
-  double shifted_fractional = after_decimal_part;
+  // A fraction of at most 53 bits times 10^15 is below 2^103, so anything shifted further right
+  // than that has no fractional digits.
+  if (shift >= _az_DOUBLE_MAX_FRACTION_PRODUCT_BITS)
+  {
+    return AZ_OK;
+  }
+
+  // The fraction is multiplied by 10 once per digit and each product is rounded to 53 significant
+  // bits, ties to even, the way a double multiply rounds it. This gives the same digits as
+  // repeatedly multiplying the fractional part of the double by 10, so 0.3 is written as 0.3 rather
+  // than as its exact binary value 0.299999999999999.
+  uint64_t fraction = shift < 64 ? mantissa & ((1ULL << shift) - 1) : mantissa;
   for (int32_t d = 0; d < fractional_digits; d++)
   {
-    shifted_fractional *= _az_NUMBER_OF_DECIMAL_VALUES;
+    fraction *= _az_NUMBER_OF_DECIMAL_VALUES;
+
+    // The fraction had at most 53 bits, so the product has at most 4 more.
+    uint64_t const excess = fraction >> (_az_DOUBLE_MANTISSA_BITS + 1);
+    int32_t const dropped_bits
+        = excess >= 8 ? 4 : excess >= 4 ? 3 : excess >= 2 ? 2 : (int32_t)excess;
 
-    // Any decimal component that is less than 0.1, when multiplied by 10, will be less than 1,
-    // which indicate a leading zero is present after the decimal point. For example, the decimal
-    // part could be 0.00, 0.09, 0.00010, etc.
-    if (shifted_fractional < 1)
+    if (dropped_bits > 0)
     {
-      leading_zeros++;
-      continue;
+      uint64_t const dropped = fraction & ((1ULL << dropped_bits) - 1);
+      uint64_t const half = 1ULL << (dropped_bits - 1);
+      fraction >>= dropped_bits;
+      shift -= dropped_bits;
+      if (dropped > half || (dropped == half && (fraction & 1) != 0))
+      {
+        fraction++;
+      }
     }
   }
 
-  double shifted_fractional_integer_part = 0;
-  double unused = modf(shifted_fractional, &shifted_fractional_integer_part);
-  (void)unused;
-
-  // Since the maximum allowed fractional_digits is 15, this is guaranteed to be true.
-  _az_PRECONDITION(shifted_fractional_integer_part <= _az_MAX_SAFE_INTEGER);
-
-  // The double to uint64_t cast should be safe without loss of precision.
-  uint64_t fractional_part = (uint64_t)shifted_fractional_integer_part;
+  // The digits are the integer part of the last product, and it is below 10^fractional_digits.
+  uint64_t const fractional_part = shift < 64 ? fraction >> shift : 0;
 
   // If there is no fractional part (at least within the number of fractional digits the user
   // specified), or if they were all non-significant zeros, don't print the decimal point or any
@@ -768,23 +943,21 @@ az_span_dtoa(az_span destination, double source, int32_t fractional_digits, az_s
     return AZ_OK;
   }
 
-  // Remove trailing zeros of the fraction part that don't need to be printed since they aren't
-  // significant.
-  while (fractional_part % _az_NUMBER_OF_DECIMAL_VALUES == 0)
+  // Write the digits with their leading zeros, then drop the trailing zeros that don't need to be
+  // printed since they aren't significant.
+  uint8_t digits[_az_MAX_SUPPORTED_FRACTIONAL_DIGITS];
+  _az_span_write_uint64(digits, fractional_part, fractional_digits);
+  while (digits[fractional_digits - 1] == '0')
   {
-    fractional_part /= _az_NUMBER_OF_DECIMAL_VALUES;
+    fractional_digits--;
   }
 
-  _az_RETURN_IF_NOT_ENOUGH_SIZE(*out_span, 1 + leading_zeros);
+  _az_RETURN_IF_NOT_ENOUGH_SIZE(*out_span, 1 + fractional_digits);
   *out_span = az_span_copy_u8(*out_span, '.');
 
-  for (int32_t z = 0; z < leading_zeros; z++)
-  {
-    *out_span = az_span_copy_u8(*out_span, '0');
-  }
-
   // Append the fractional part.
-  return _az_span_builder_append_uint64(out_span, fractional_part);
+  *out_span = az_span_copy(*out_span, az_span_create(digits, fractional_digits));
+  return AZ_OK;
 }
 
 // TODO: pass az_span by value
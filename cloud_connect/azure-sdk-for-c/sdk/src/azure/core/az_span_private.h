@@ -10,6 +10,8 @@
 #include <azure/core/internal/az_precondition_internal.h>
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <azure/core/_az_cfg_prefix.h>
 
@@ -73,6 +75,63 @@ AZ_NODISCARD AZ_INLINE bool _az_isfinite(double value)
       != _az_BINARY_VALUE_OF_POSITIVE_INFINITY;
 }
 
+// Word-at-a-time (SWAR) helpers for az_span_find(), az_span_is_content_equal_ignoring_case() and
+// the az_json_reader string and whitespace scans. Words are loaded with memcpy, which compiles to a
+// single load where unaligned access is allowed. ARMv6-M (Cortex-M0/M0+) has no unaligned loads, so
+// the byte loops are kept there. Define AZ_SPAN_NO_SWAR to keep them on any other target.
+#if !defined(AZ_SPAN_NO_SWAR) && !defined(__ARM_ARCH_6M__)
+#define _az_SPAN_SWAR
+
+#if UINTPTR_MAX > UINT32_MAX
+typedef uint64_t _az_span_word;
+#else
+typedef uint32_t _az_span_word;
+#endif
+
+// 0x0101...01 and 0x8080...80
+#define _az_SPAN_WORD_ONES ((_az_span_word)-1 / UINT8_MAX)
+#define _az_SPAN_WORD_HIGHS (_az_SPAN_WORD_ONES * 0x80)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _az_SPAN_SSE2
+#include <emmintrin.h>
+#endif
+
+AZ_NODISCARD AZ_INLINE _az_span_word _az_span_word_load(uint8_t const* ptr)
+{
+  _az_span_word word;
+  // NOLINTNEXTLINE(clang-analyzer-security.insecureAPI.DeprecatedOrUnsafeBufferHandling)
+  memcpy(&word, ptr, sizeof(word));
+  return word;
+}
+
+// Sets the high bit of exactly the bytes of `word` equal to `value`, and clears every other bit.
+AZ_NODISCARD AZ_INLINE _az_span_word _az_span_word_match(_az_span_word word, uint8_t value)
+{
+  // The bytes equal to `value` become zero, and only those keep the high bit clear once 0x7F is
+  // added to their low 7 bits, which cannot carry into the next byte.
+  _az_span_word const zeros = word ^ (_az_SPAN_WORD_ONES * value);
+  return ~(((zeros & ~_az_SPAN_WORD_HIGHS) + ~_az_SPAN_WORD_HIGHS) | zeros) & _az_SPAN_WORD_HIGHS;
+}
+#endif // _az_SPAN_SWAR
+
+// Index of the lowest set bit of a non-zero `mask`, such as the position of the first matching byte
+// in a _mm_movemask_epi8() result or the first remaining candidate of a bit set.
+AZ_NODISCARD AZ_INLINE int32_t _az_span_lowest_set_bit(uint64_t mask)
+{
+#if defined(__GNUC__)
+  return (int32_t)__builtin_ctzll(mask);
+#else
+  int32_t index = 0;
+  while ((mask & 1) == 0)
+  {
+    mask >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
 AZ_NODISCARD az_result _az_is_expected_span(az_span* ref_span, az_span expected);
 
 /**
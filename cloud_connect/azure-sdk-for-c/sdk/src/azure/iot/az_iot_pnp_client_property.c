@@ -184,21 +184,18 @@ static bool is_component_in_model(
     az_json_token const* component_name,
     az_span* out_component_name)
 {
-  int32_t index = 0;
+  int32_t const index = az_json_token_find_text(
+      component_name,
+      client->_internal.options.component_names,
+      client->_internal.options.component_names_length);
 
-  while (index < client->_internal.options.component_names_length)
+  if (index < 0)
   {
-    if (az_json_token_is_text_equal(
-            component_name, client->_internal.options.component_names[index]))
-    {
-      *out_component_name = client->_internal.options.component_names[index];
-      return true;
-    }
-
-    index++;
+    return false;
   }
 
-  return false;
+  *out_component_name = client->_internal.options.component_names[index];
+  return true;
 }
 
 AZ_NODISCARD az_result az_iot_pnp_client_property_get_property_version(
@@ -271,6 +271,15 @@ AZ_INLINE az_result _az_iot_provisioning_client_parse_payload_error_code(
   return AZ_ERROR_ITEM_NOT_FOUND;
 }
 
+// The registrationState properties, indexed by the cases of the switch in
+// _az_iot_provisioning_client_payload_registration_state_parse().
+static const az_span registration_state_property_names[] = {
+  AZ_SPAN_LITERAL_FROM_STR("assignedHub"),
+  AZ_SPAN_LITERAL_FROM_STR("deviceId"),
+  AZ_SPAN_LITERAL_FROM_STR("errorMessage"),
+  AZ_SPAN_LITERAL_FROM_STR("lastUpdatedDateTimeUtc"),
+};
+
 AZ_INLINE az_result _az_iot_provisioning_client_payload_registration_state_parse(
     az_json_reader* jr,
     az_iot_provisioning_client_registration_state* out_state)
@@ -287,53 +296,44 @@ AZ_INLINE az_result _az_iot_provisioning_client_payload_registration_state_parse
          && az_result_succeeded(az_json_reader_next_token(jr))
          && jr->token.kind != AZ_JSON_TOKEN_END_OBJECT)
   {
-    if (az_json_token_is_text_equal(&jr->token, AZ_SPAN_FROM_STR("assignedHub")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(jr));
-      if (jr->token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_state->assigned_hub_hostname = jr->token.slice;
-      found_assigned_hub = true;
-    }
-    else if (az_json_token_is_text_equal(&jr->token, AZ_SPAN_FROM_STR("deviceId")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(jr));
-      if (jr->token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_state->device_id = jr->token.slice;
-      found_device_id = true;
-    }
-    else if (az_json_token_is_text_equal(&jr->token, AZ_SPAN_FROM_STR("errorMessage")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(jr));
-      if (jr->token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_state->error_message = jr->token.slice;
-    }
-    else if (az_json_token_is_text_equal(&jr->token, AZ_SPAN_FROM_STR("lastUpdatedDateTimeUtc")))
+    int32_t const property = az_json_token_find_text(
+        &jr->token,
+        registration_state_property_names,
+        (int32_t)(sizeof(registration_state_property_names)
+                  / sizeof(registration_state_property_names[0])));
+
+    if (property >= 0)
     {
       _az_RETURN_IF_FAILED(az_json_reader_next_token(jr));
       if (jr->token.kind != AZ_JSON_TOKEN_STRING)
       {
         return AZ_ERROR_ITEM_NOT_FOUND;
       }
-      out_state->error_timestamp = jr->token.slice;
-    }
-    else if (az_result_succeeded(
-                 _az_iot_provisioning_client_parse_payload_error_code(jr, out_state)))
-    {
-      // Do nothing
     }
-    else
+
+    switch (property)
     {
-      // ignore other tokens
-      _az_RETURN_IF_FAILED(az_json_reader_skip_children(jr));
+      case 0: // assignedHub
+        out_state->assigned_hub_hostname = jr->token.slice;
+        found_assigned_hub = true;
+        break;
+      case 1: // deviceId
+        out_state->device_id = jr->token.slice;
+        found_device_id = true;
+        break;
+      case 2: // errorMessage
+        out_state->error_message = jr->token.slice;
+        break;
+      case 3: // lastUpdatedDateTimeUtc
+        out_state->error_timestamp = jr->token.slice;
+        break;
+      default:
+        if (az_result_failed(_az_iot_provisioning_client_parse_payload_error_code(jr, out_state)))
+        {
+          // ignore other tokens
+          _az_RETURN_IF_FAILED(az_json_reader_skip_children(jr));
+        }
+        break;
     }
   }
 
@@ -380,6 +380,17 @@ AZ_NODISCARD static az_result _az_iot_provisioning_client_parse_operation_status
   return AZ_OK;
 }
 
+// The top level payload properties, indexed by the cases of the switch in
+// az_iot_provisioning_client_parse_payload().
+static const az_span payload_property_names[] = {
+  AZ_SPAN_LITERAL_FROM_STR("operationId"),
+  AZ_SPAN_LITERAL_FROM_STR("status"),
+  AZ_SPAN_LITERAL_FROM_STR("registrationState"),
+  AZ_SPAN_LITERAL_FROM_STR("trackingId"),
+  AZ_SPAN_LITERAL_FROM_STR("message"),
+  AZ_SPAN_LITERAL_FROM_STR("timestampUtc"),
+};
+
 AZ_INLINE az_result az_iot_provisioning_client_parse_payload(
     az_span received_payload,
     az_iot_provisioning_client_register_response* out_response)
@@ -403,70 +414,72 @@ AZ_INLINE az_result az_iot_provisioning_client_parse_payload(
   while (az_result_succeeded(az_json_reader_next_token(&jr))
          && jr.token.kind != AZ_JSON_TOKEN_END_OBJECT)
   {
-    if (az_json_token_is_text_equal(&jr.token, AZ_SPAN_FROM_STR("operationId")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
-      if (jr.token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_response->operation_id = jr.token.slice;
-      found_operation_id = true;
-    }
-    else if (az_json_token_is_text_equal(&jr.token, AZ_SPAN_FROM_STR("status")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
-      if (jr.token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      _az_RETURN_IF_FAILED(_az_iot_provisioning_client_parse_operation_status(
-          jr.token.slice, &out_response->operation_status));
-
-      found_operation_status = true;
-    }
-    else if (az_json_token_is_text_equal(&jr.token, AZ_SPAN_FROM_STR("registrationState")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
-      _az_RETURN_IF_FAILED(_az_iot_provisioning_client_payload_registration_state_parse(
-          &jr, &out_response->registration_state));
-    }
-    else if (az_json_token_is_text_equal(&jr.token, AZ_SPAN_FROM_STR("trackingId")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
-      if (jr.token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_response->registration_state.error_tracking_id = jr.token.slice;
-    }
-    else if (az_json_token_is_text_equal(&jr.token, AZ_SPAN_FROM_STR("message")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
-      if (jr.token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_response->registration_state.error_message = jr.token.slice;
-    }
-    else if (az_json_token_is_text_equal(&jr.token, AZ_SPAN_FROM_STR("timestampUtc")))
-    {
-      _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
-      if (jr.token.kind != AZ_JSON_TOKEN_STRING)
-      {
-        return AZ_ERROR_ITEM_NOT_FOUND;
-      }
-      out_response->registration_state.error_timestamp = jr.token.slice;
-    }
-    else if (az_result_succeeded(_az_iot_provisioning_client_parse_payload_error_code(
-                 &jr, &out_response->registration_state)))
-    {
-      found_error = true;
-    }
-    else
+    switch (az_json_token_find_text(
+        &jr.token,
+        payload_property_names,
+        (int32_t)(sizeof(payload_property_names) / sizeof(payload_property_names[0]))))
     {
-      // ignore other tokens
-      _az_RETURN_IF_FAILED(az_json_reader_skip_children(&jr));
+      case 0: // operationId
+        _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
+        if (jr.token.kind != AZ_JSON_TOKEN_STRING)
+        {
+          return AZ_ERROR_ITEM_NOT_FOUND;
+        }
+        out_response->operation_id = jr.token.slice;
+        found_operation_id = true;
+        break;
+      case 1: // status
+        _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
+        if (jr.token.kind != AZ_JSON_TOKEN_STRING)
+        {
+          return AZ_ERROR_ITEM_NOT_FOUND;
+        }
+        _az_RETURN_IF_FAILED(_az_iot_provisioning_client_parse_operation_status(
+            jr.token.slice, &out_response->operation_status));
+
+        found_operation_status = true;
+        break;
+      case 2: // registrationState
+        _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
+        _az_RETURN_IF_FAILED(_az_iot_provisioning_client_payload_registration_state_parse(
+            &jr, &out_response->registration_state));
+        break;
+      case 3: // trackingId
+        _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
+        if (jr.token.kind != AZ_JSON_TOKEN_STRING)
+        {
+          return AZ_ERROR_ITEM_NOT_FOUND;
+        }
+        out_response->registration_state.error_tracking_id = jr.token.slice;
+        break;
+      case 4: // message
+        _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
+        if (jr.token.kind != AZ_JSON_TOKEN_STRING)
+        {
+          return AZ_ERROR_ITEM_NOT_FOUND;
+        }
+        out_response->registration_state.error_message = jr.token.slice;
+        break;
+      case 5: // timestampUtc
+        _az_RETURN_IF_FAILED(az_json_reader_next_token(&jr));
+        if (jr.token.kind != AZ_JSON_TOKEN_STRING)
+        {
+          return AZ_ERROR_ITEM_NOT_FOUND;
+        }
+        out_response->registration_state.error_timestamp = jr.token.slice;
+        break;
+      default:
+        if (az_result_succeeded(_az_iot_provisioning_client_parse_payload_error_code(
+                &jr, &out_response->registration_state)))
+        {
+          found_error = true;
+        }
+        else
+        {
+          // ignore other tokens
+          _az_RETURN_IF_FAILED(az_json_reader_skip_children(&jr));
+        }
+        break;
     }
   }
 
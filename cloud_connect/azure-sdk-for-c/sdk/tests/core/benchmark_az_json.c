@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+// Measures az_json_reader throughput on twin shaped documents: the full twin the hub sends in
+// response to a GET, as received (compact) and pretty printed, and a desired property PATCH.
+// This is not a unit test, run az_core_json_benchmark by hand and compare the MB/s columns.
+
+#include <azure/core/az_json.h>
+#include <azure/core/az_span.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <az_test_benchmark.h>
+
+#include <azure/core/_az_cfg.h>
+
+#define ITERATIONS 50000
+
+// Bytes per segment when the document is read from az_json_reader_chunked_init().
+#define CHUNK_SIZE 64
+
+static char twin_compact[]
+    = "{\"desired\":{\"telemetryInterval\":10,\"led_blue\":3,\"led_yellow\":1,"
+      "\"$metadata\":{\"$lastUpdated\":\"2021-03-04T18:42:27.4385434Z\","
+      "\"$lastUpdatedVersion\":15,\"telemetryInterval\":{\"$lastUpdated\":"
+      "\"2021-03-04T18:42:27.4385434Z\",\"$lastUpdatedVersion\":15},\"led_blue\":{"
+      "\"$lastUpdated\":\"2021-03-04T18:40:02.1124452Z\",\"$lastUpdatedVersion\":14},"
+      "\"led_yellow\":{\"$lastUpdated\":\"2021-03-04T18:40:02.1124452Z\","
+      "\"$lastUpdatedVersion\":14}},\"$version\":15},\"reported\":{\"led_red\":1,"
+      "\"led_blue\":{\"value\":3,\"ac\":200,\"av\":15,\"ad\":\"Successfully updated LED "
+      "state to blinking\"},\"telemetryInterval\":{\"value\":10,\"ac\":200,\"av\":15,"
+      "\"ad\":\"Successfully updated telemetry interval\"},\"serialNumber\":"
+      "\"012311B3A2C4D5E6F7EE\",\"ipAddress\":\"192.168.1.157\",\"firmwareVersion\":"
+      "\"1.0.0 (Mar  4 2021 10:21:43)\",\"deviceInfo\":{\"__t\":\"c\",\"manufacturer\":"
+      "\"Microchip Technology Inc\",\"model\":\"SAM-IoT WG\",\"swVersion\":\"1.0.0\","
+      "\"osName\":\"Harmony 3\",\"processorArchitecture\":\"ATSAMD21G18A\","
+      "\"processorManufacturer\":\"Microchip\",\"totalStorage\":256,\"totalMemory\":32},"
+      "\"$metadata\":{\"$lastUpdated\":\"2021-03-04T18:42:31.1127381Z\"},\"$version\":42}}";
+
+static char twin_pretty[]
+    = "{\n"
+      "  \"desired\": {\n"
+      "    \"telemetryInterval\": 10,\n"
+      "    \"led_blue\": 3,\n"
+      "    \"led_yellow\": 1,\n"
+      "    \"$metadata\": {\n"
+      "      \"$lastUpdated\": \"2021-03-04T18:42:27.4385434Z\",\n"
+      "      \"$lastUpdatedVersion\": 15,\n"
+      "      \"telemetryInterval\": {\n"
+      "        \"$lastUpdated\": \"2021-03-04T18:42:27.4385434Z\",\n"
+      "        \"$lastUpdatedVersion\": 15\n"
+      "      },\n"
+      "      \"led_blue\": {\n"
+      "        \"$lastUpdated\": \"2021-03-04T18:40:02.1124452Z\",\n"
+      "        \"$lastUpdatedVersion\": 14\n"
+      "      }\n"
+      "    },\n"
+      "    \"$version\": 15\n"
+      "  },\n"
+      "  \"reported\": {\n"
+      "    \"led_red\": 1,\n"
+      "    \"led_blue\": {\n"
+      "      \"value\": 3,\n"
+      "      \"ac\": 200,\n"
+      "      \"av\": 15,\n"
+      "      \"ad\": \"Successfully updated LED state to blinking\"\n"
+      "    },\n"
+      "    \"serialNumber\": \"012311B3A2C4D5E6F7EE\",\n"
+      "    \"deviceInfo\": {\n"
+      "      \"__t\": \"c\",\n"
+      "      \"manufacturer\": \"Microchip Technology Inc\",\n"
+      "      \"model\": \"SAM-IoT WG\",\n"
+      "      \"processorArchitecture\": \"ATSAMD21G18A\"\n"
+      "    },\n"
+      "    \"$metadata\": {\n"
+      "      \"$lastUpdated\": \"2021-03-04T18:42:31.1127381Z\"\n"
+      "    },\n"
+      "    \"$version\": 42\n"
+      "  }\n"
+      "}\n";
+
+static char twin_patch[]
+    = "{\"telemetryInterval\":5,\"led_yellow\":2,\"$version\":16}";
+
+static char* const documents[] = { twin_compact, twin_pretty, twin_patch };
+static char const* const document_names[] = { "twin, compact", "twin, pretty", "desired PATCH" };
+
+// Reads every token of `json`, either from one buffer or from CHUNK_SIZE segments. Returns the
+// number of tokens, or -1 if the document did not read to the end.
+static int32_t read_document(az_span json, bool chunked)
+{
+  az_span buffers[32];
+  az_json_reader reader;
+  int32_t tokens = 0;
+
+  if (chunked)
+  {
+    int32_t count = 0;
+    for (int32_t offset = 0; offset < az_span_size(json); offset += CHUNK_SIZE)
+    {
+      int32_t const size
+          = az_span_size(json) - offset < CHUNK_SIZE ? az_span_size(json) - offset : CHUNK_SIZE;
+      buffers[count++] = az_span_slice(json, offset, offset + size);
+    }
+    if (az_result_failed(az_json_reader_chunked_init(&reader, buffers, count, NULL)))
+    {
+      return -1;
+    }
+  }
+  else if (az_result_failed(az_json_reader_init(&reader, json, NULL)))
+  {
+    return -1;
+  }
+
+  az_result result;
+  while (az_result_succeeded(result = az_json_reader_next_token(&reader)))
+  {
+    tokens++;
+  }
+  return result == AZ_ERROR_JSON_READER_DONE ? tokens : -1;
+}
+
+int main(void)
+{
+  int result = 0;
+
+  for (int32_t d = 0; d < (int32_t)(sizeof(documents) / sizeof(documents[0])); d++)
+  {
+    az_span const json = az_span_create_from_str(documents[d]);
+    double rates[2];
+
+    for (int32_t chunked = 0; chunked < 2; chunked++)
+    {
+      rates[chunked] = 0;
+      for (int32_t trial = 0; trial < TRIALS; trial++)
+      {
+        int64_t tokens = 0;
+        clock_t const start = clock();
+        for (int32_t n = 0; n < ITERATIONS; n++)
+        {
+          int32_t const count = read_document(json, chunked != 0);
+          if (count < 0)
+          {
+            printf("%s: the document did not read\n", document_names[d]);
+            return 1;
+          }
+          tokens += count;
+        }
+        double const rate
+            = (double)az_span_size(json) * ITERATIONS / (1024.0 * 1024.0) / seconds_since(start);
+        rates[chunked] = rate > rates[chunked] ? rate : rates[chunked];
+        result |= tokens == 0;
+      }
+    }
+
+    printf(
+        "%-14s %5d bytes  %7.1f MB/s  %7.1f MB/s in %d byte segments\n",
+        document_names[d],
+        az_span_size(json),
+        rates[0],
+        rates[1],
+        CHUNK_SIZE);
+  }
+
+  return result;
+}
@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+// Times resolving the property names of IoT Hub and DPS documents against the names a device
+// expects, with one az_json_token_find_text() call per name and with one
+// az_json_token_is_text_equal() call per candidate, which is what the SDK and the samples did
+// before. The documents are the twin and registration payloads from the tests in sdk/tests/iot.
+// Each is read once, from one buffer or from small segments, and only the name lookups are timed.
+// This is not a unit test, run az_core_json_token_benchmark by hand and compare the columns.
+
+#include <azure/core/az_json.h>
+#include <azure/core/az_span.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <az_test_benchmark.h>
+
+#include <azure/core/_az_cfg.h>
+
+#define ITERATIONS 200000
+
+// Bytes per segment when a document is read from az_json_reader_chunked_init(), small enough that
+// many property names straddle two segments.
+#define CHUNK_SIZE 7
+
+#define MAX_TOKENS 64
+
+// The full twin, as in tests/iot/pnp, with the desired and reported properties of the samples.
+static char twin[]
+    = "{\"desired\":{\"thermostat1\":{\"__t\":\"c\",\"targetTemperature\":47},"
+      "\"telemetryInterval\":10,\"led_blue\":3,\"led_yellow\":1,\"$version\":4},"
+      "\"reported\":{\"manufacturer\":\"Sample-Manufacturer\",\"model\":\"pnp-sample-Model-123\","
+      "\"swVersion\":\"1.0.0.0\",\"osName\":\"Contoso\",\"led_red\":1,\"telemetryInterval\":{"
+      "\"value\":10,\"ac\":200,\"av\":4,\"ad\":\"Successfully updated telemetry interval\"},"
+      "\"$version\":42}}";
+
+static char desired_patch[]
+    = "{\"thermostat1\":{\"__t\":\"c\",\"targetTemperature\":21},\"telemetryInterval\":5,"
+      "\"led_yellow\":2,\"$version\":16}";
+
+// The same PATCH with every name escaped where JSON allows it, which takes the unescaping path.
+static char desired_patch_escaped[]
+    = "{\"thermostat\\u0031\":{\"__t\":\"c\",\"target\\/Temperature\":21},\"telemetry\\/Interval\""
+      ":5,\"led\\/yellow\":2,\"$version\":16}";
+
+// A DPS registration result, as in tests/iot/provisioning.
+static char dps_assigned[]
+    = "{\"operationId\":\"4.d0a671905ea5b2c8.42d78160-4c78-479e-8be7-61d5e55dac0d\","
+      "\"status\":\"assigned\",\"registrationState\":{\"x509\":{},\"registrationId\":\"myRegId\","
+      "\"createdDateTimeUtc\":\"2020-04-10T03:11:13.0276997Z\","
+      "\"assignedHub\":\"contoso.azure-devices.net\",\"deviceId\":\"my-device-id\","
+      "\"status\":\"assigned\",\"substatus\":\"initialAssignment\","
+      "\"lastUpdatedDateTimeUtc\":\"2020-04-10T03:11:13.2096201Z\","
+      "\"etag\":\"IjYxMDA4ZDQ2LTAwMDAtMDEwMC0wMDAwLTVlOGZlM2QxMDAwMCI=\"}}";
+
+// What a device looks for in a twin, and the sections and properties az_iot_provisioning_client
+// looks for in a registration result.
+static const az_span twin_names[] = {
+  AZ_SPAN_LITERAL_FROM_STR("desired"),
+  AZ_SPAN_LITERAL_FROM_STR("reported"),
+  AZ_SPAN_LITERAL_FROM_STR("$version"),
+  AZ_SPAN_LITERAL_FROM_STR("thermostat1"),
+  AZ_SPAN_LITERAL_FROM_STR("targetTemperature"),
+  AZ_SPAN_LITERAL_FROM_STR("telemetryInterval"),
+  AZ_SPAN_LITERAL_FROM_STR("led_blue"),
+  AZ_SPAN_LITERAL_FROM_STR("led_yellow"),
+  AZ_SPAN_LITERAL_FROM_STR("led_red"),
+  AZ_SPAN_LITERAL_FROM_STR("value"),
+  AZ_SPAN_LITERAL_FROM_STR("ac"),
+  AZ_SPAN_LITERAL_FROM_STR("av"),
+};
+
+static const az_span dps_names[] = {
+  AZ_SPAN_LITERAL_FROM_STR("operationId"),
+  AZ_SPAN_LITERAL_FROM_STR("status"),
+  AZ_SPAN_LITERAL_FROM_STR("registrationState"),
+  AZ_SPAN_LITERAL_FROM_STR("trackingId"),
+  AZ_SPAN_LITERAL_FROM_STR("message"),
+  AZ_SPAN_LITERAL_FROM_STR("timestampUtc"),
+  AZ_SPAN_LITERAL_FROM_STR("assignedHub"),
+  AZ_SPAN_LITERAL_FROM_STR("deviceId"),
+  AZ_SPAN_LITERAL_FROM_STR("errorMessage"),
+  AZ_SPAN_LITERAL_FROM_STR("lastUpdatedDateTimeUtc"),
+};
+
+typedef struct
+{
+  char const* name;
+  char* json;
+  az_span const* names;
+  int32_t names_count;
+} document;
+
+static document const documents[] = {
+  { "twin", twin, twin_names, sizeof(twin_names) / sizeof(twin_names[0]) },
+  { "desired PATCH", desired_patch, twin_names, sizeof(twin_names) / sizeof(twin_names[0]) },
+  { "PATCH, escaped",
+    desired_patch_escaped,
+    twin_names,
+    sizeof(twin_names) / sizeof(twin_names[0]) },
+  { "DPS assigned", dps_assigned, dps_names, sizeof(dps_names) / sizeof(dps_names[0]) },
+};
+
+// Reads `json`, from one buffer or from CHUNK_SIZE segments kept in `buffers`, and keeps its
+// property name tokens. Returns how many there are, or -1 if the document did not read to the end.
+static int32_t read_property_names(
+    az_span json,
+    bool chunked,
+    az_span buffers[],
+    int32_t buffers_size,
+    az_json_token tokens[])
+{
+  az_json_reader reader;
+  int32_t count = 0;
+
+  if (chunked)
+  {
+    int32_t buffers_count = 0;
+    for (int32_t offset = 0; offset < az_span_size(json); offset += CHUNK_SIZE)
+    {
+      int32_t const size
+          = az_span_size(json) - offset < CHUNK_SIZE ? az_span_size(json) - offset : CHUNK_SIZE;
+      if (buffers_count == buffers_size)
+      {
+        return -1;
+      }
+      buffers[buffers_count++] = az_span_slice(json, offset, offset + size);
+    }
+    if (az_result_failed(az_json_reader_chunked_init(&reader, buffers, buffers_count, NULL)))
+    {
+      return -1;
+    }
+  }
+  else if (az_result_failed(az_json_reader_init(&reader, json, NULL)))
+  {
+    return -1;
+  }
+
+  az_result result;
+  while (az_result_succeeded(result = az_json_reader_next_token(&reader)))
+  {
+    if (reader.token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
+    {
+      if (count == MAX_TOKENS)
+      {
+        return -1;
+      }
+      tokens[count++] = reader.token;
+    }
+  }
+  return result == AZ_ERROR_JSON_READER_DONE ? count : -1;
+}
+
+static int32_t find_one_by_one(az_json_token const* token, az_span const names[], int32_t count)
+{
+  for (int32_t i = 0; i < count; i++)
+  {
+    if (az_json_token_is_text_equal(token, names[i]))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int main(void)
+{
+  az_span buffers[128];
+  az_json_token tokens[MAX_TOKENS];
+  int64_t checksum = 0;
+
+  printf("%-15s %-9s %6s  %17s  %17s\n", "", "", "names", "find_text", "is_text_equal");
+
+  for (int32_t d = 0; d < (int32_t)(sizeof(documents) / sizeof(documents[0])); d++)
+  {
+    document const* const doc = &documents[d];
+
+    for (int32_t chunked = 0; chunked < 2; chunked++)
+    {
+      int32_t const count = read_property_names(
+          az_span_create_from_str(doc->json),
+          chunked != 0,
+          buffers,
+          (int32_t)(sizeof(buffers) / sizeof(buffers[0])),
+          tokens);
+      if (count <= 0)
+      {
+        printf("%s: the document did not read\n", doc->name);
+        return 1;
+      }
+
+      // Both ways must agree before they are timed.
+      for (int32_t t = 0; t < count; t++)
+      {
+        if (az_json_token_find_text(&tokens[t], doc->names, doc->names_count)
+            != find_one_by_one(&tokens[t], doc->names, doc->names_count))
+        {
+          printf("%s: property name %d resolved differently\n", doc->name, t);
+          return 1;
+        }
+      }
+
+      double best_ns[2] = { 0, 0 };
+      for (int32_t method = 0; method < 2; method++)
+      {
+        for (int32_t trial = 0; trial < TRIALS; trial++)
+        {
+          clock_t const start = clock();
+          for (int32_t n = 0; n < ITERATIONS; n++)
+          {
+            for (int32_t t = 0; t < count; t++)
+            {
+              checksum += method == 0
+                  ? az_json_token_find_text(&tokens[t], doc->names, doc->names_count)
+                  : find_one_by_one(&tokens[t], doc->names, doc->names_count);
+            }
+          }
+          double const ns = seconds_since(start) * 1e9 / ITERATIONS / count;
+          best_ns[method] = trial == 0 || ns < best_ns[method] ? ns : best_ns[method];
+        }
+      }
+
+      printf(
+          "%-15s %-9s %6d  %8.1f ns/name  %8.1f ns/name\n",
+          doc->name,
+          chunked ? "segments" : "contig",
+          count,
+          best_ns[0],
+          best_ns[1]);
+    }
+  }
+
+  return checksum == 0;
+}
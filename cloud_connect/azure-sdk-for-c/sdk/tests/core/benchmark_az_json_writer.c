@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+// Times building the telemetry messages a device sends, with az_json_writer, per message. Build it
+// once with PRECONDITIONS=ON and once with PRECONDITIONS=OFF to see what the checks cost.
+// This is not a unit test, run az_core_json_writer_benchmark by hand and compare the columns.
+
+#include <azure/core/az_json.h>
+#include <azure/core/az_span.h>
+#include <azure/core/internal/az_result_internal.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <az_test_benchmark.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CYCLES() __rdtsc()
+#endif
+
+#include <azure/core/_az_cfg.h>
+
+#define ITERATIONS 1000000
+
+typedef struct
+{
+  int32_t heart_rate_min;
+  int32_t heart_rate_max;
+  int32_t heart_rate_samples;
+  int32_t heart_rate_confidence;
+  double heart_rate;
+  double temperature;
+  double pressure;
+  int32_t light;
+} telemetry;
+
+// {"heartRate":72.48,"heartRateMin":61,...,"temperature":23.5,"pressure":1013.25,"light":512}
+static az_result build_telemetry(az_span buffer, telemetry const* values, az_span* out_message)
+{
+  az_json_writer writer;
+
+  _az_RETURN_IF_FAILED(az_json_writer_init(&writer, buffer, NULL));
+  _az_RETURN_IF_FAILED(az_json_writer_append_begin_object(&writer));
+  _az_RETURN_IF_FAILED(az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("heartRate")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_double(&writer, values->heart_rate, 2));
+  _az_RETURN_IF_FAILED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("heartRateMin")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_int32(&writer, values->heart_rate_min));
+  _az_RETURN_IF_FAILED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("heartRateMax")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_int32(&writer, values->heart_rate_max));
+  _az_RETURN_IF_FAILED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("heartRateSamples")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_int32(&writer, values->heart_rate_samples));
+  _az_RETURN_IF_FAILED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("heartRateConfidence")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_int32(&writer, values->heart_rate_confidence));
+  _az_RETURN_IF_FAILED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("temperature")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_double(&writer, values->temperature, 2));
+  _az_RETURN_IF_FAILED(az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("pressure")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_double(&writer, values->pressure, 2));
+  _az_RETURN_IF_FAILED(az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("light")));
+  _az_RETURN_IF_FAILED(az_json_writer_append_int32(&writer, values->light));
+  _az_RETURN_IF_FAILED(az_json_writer_append_end_object(&writer));
+
+  *out_message = az_json_writer_get_bytes_used_in_destination(&writer);
+  return AZ_OK;
+}
+
+int main(void)
+{
+  uint8_t buffer[256];
+  az_span message = AZ_SPAN_EMPTY;
+  int64_t bytes = 0;
+  double best_ns = 0;
+#ifdef CYCLES
+  uint64_t best_cycles = 0;
+#endif
+
+  telemetry values = {
+    .heart_rate_min = 61,
+    .heart_rate_max = 88,
+    .heart_rate_samples = 25,
+    .heart_rate_confidence = 97,
+    .heart_rate = 72.48,
+    .temperature = 23.5,
+    .pressure = 1013.25,
+    .light = 512,
+  };
+
+  for (int32_t trial = 0; trial < TRIALS; trial++)
+  {
+    clock_t const start = clock();
+#ifdef CYCLES
+    uint64_t const start_cycles = CYCLES();
+#endif
+    for (int32_t n = 0; n < ITERATIONS; n++)
+    {
+      // Vary the readings so that every message is formatted from scratch.
+      values.light = 400 + (n & 0xFF);
+      values.temperature = 20.0 + (double)(n & 0x3F) * 0.25;
+      if (az_result_failed(build_telemetry(AZ_SPAN_FROM_BUFFER(buffer), &values, &message)))
+      {
+        printf("the telemetry message did not fit\n");
+        return 1;
+      }
+      bytes += az_span_size(message);
+    }
+#ifdef CYCLES
+    uint64_t const cycles = (CYCLES() - start_cycles) / ITERATIONS;
+    best_cycles = trial == 0 || cycles < best_cycles ? cycles : best_cycles;
+#endif
+    double const ns = seconds_since(start) * 1e9 / ITERATIONS;
+    best_ns = trial == 0 || ns < best_ns ? ns : best_ns;
+  }
+
+  printf("%.*s\n", az_span_size(message), (char*)az_span_ptr(message));
+#ifdef CYCLES
+  printf(
+      "%7.1f ns/message, %llu TSC cycles/message\n", best_ns, (unsigned long long)best_cycles);
+#else
+  printf("%7.1f ns/message\n", best_ns);
+#endif
+
+  return bytes == 0;
+}
@@ -0,0 +1,308 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+// Times az_span_find() and az_span_is_content_equal_ignoring_case() on the topics and names the
+// IoT clients parse for every received message, and az_span_i32toa() and az_span_dtoa() on
+// telemetry readings, next to the byte at a time loops they replace.
+// This is not a unit test, run az_core_span_benchmark by hand and compare the ns/op columns.
+
+#include <azure/core/az_span.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <az_test_benchmark.h>
+
+#include <azure/core/_az_cfg.h>
+
+#define ITERATIONS 200000
+
+// Received topics, as the hub and DPS send them.
+static char* const topics[] = {
+  "$iothub/methods/POST/reboot/?$rid=1",
+  "$iothub/methods/POST/getMaxMinReport/?$rid=b4a1d2d1-6e1f-4ea0-93b9-2c43f31b7d46",
+  "$iothub/twin/res/200/?$rid=12&$version=3",
+  "$iothub/twin/res/204/?$rid=7&$version=18",
+  "$iothub/twin/PATCH/properties/desired/?$version=15",
+  "$dps/registrations/res/202/?$rid=1&retry-after=3",
+  "$dps/registrations/res/200/?$rid=1",
+  "devices/sam-iot-device-01/messages/devicebound/%24.mid=8f2a8e44-3e1b-4c62-a2e0-df35a9c9ab91"
+  "&%24.to=%2Fdevices%2Fsam-iot-device-01%2Fmessages%2FdeviceBound&iothub-ack=full&led=on",
+};
+
+// Targets the SDK looks for in those topics.
+static char* const targets[] = {
+  "$iothub/methods/POST/",
+  "/?$rid=",
+  "$iothub/twin/",
+  "res/",
+  "PATCH/properties/desired/",
+  "$dps/registrations/res/",
+  "retry-after=",
+  "$version=",
+  "/",
+  "iothub-ack=",
+};
+
+// Names compared ignoring case, on matching and on mismatching pairs.
+static char* const names[][2] = {
+  { "retry-after-ms", "Retry-After-Ms" },
+  { "x-ms-retry-after-ms", "X-MS-Retry-After-MS" },
+  { "Content-Type", "content-type" },
+  { "application/json; charset=utf-8", "Application/JSON; charset=UTF-8" },
+  { "retry-after-ms", "retry-after-mz" },
+  { "x-ms-client-request-id", "x-ms-client-request-ix" },
+};
+
+#define COUNT(array) (int32_t)(sizeof(array) / sizeof((array)[0]))
+
+static int32_t naive_find(az_span source, az_span target)
+{
+  int32_t const source_size = az_span_size(source);
+  int32_t const target_size = az_span_size(target);
+  uint8_t const* const source_ptr = az_span_ptr(source);
+  uint8_t const* const target_ptr = az_span_ptr(target);
+
+  for (int32_t i = 0; i <= source_size - target_size; i++)
+  {
+    int32_t j = 0;
+    while (j < target_size && source_ptr[i + j] == target_ptr[j])
+    {
+      j++;
+    }
+    if (j == target_size)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static uint8_t naive_tolower(uint8_t value)
+{
+  return (uint8_t)(value >= 'A' && value <= 'Z' ? value + ('a' - 'A') : value);
+}
+
+static bool naive_equal_ignoring_case(az_span span1, az_span span2)
+{
+  if (az_span_size(span1) != az_span_size(span2))
+  {
+    return false;
+  }
+  for (int32_t i = 0; i < az_span_size(span1); i++)
+  {
+    if (naive_tolower(az_span_ptr(span1)[i]) != naive_tolower(az_span_ptr(span2)[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The formatting loops az_span_i32toa() and az_span_dtoa() used before: three divisions per digit,
+// and a floating point multiply per fractional digit.
+static int32_t naive_u64toa(uint8_t* buffer, uint64_t n)
+{
+  uint64_t div = 10000000000000000000ULL;
+  int32_t size = 0;
+  while (div > 1 && n / div == 0)
+  {
+    div /= 10;
+  }
+  while (div > 1)
+  {
+    buffer[size++] = (uint8_t)('0' + n / div);
+    n %= div;
+    div /= 10;
+  }
+  buffer[size++] = (uint8_t)('0' + n);
+  return size;
+}
+
+static int32_t naive_i32toa(uint8_t* buffer, int32_t n)
+{
+  if (n < 0)
+  {
+    buffer[0] = '-';
+    return 1 + naive_u64toa(buffer + 1, 0 - (uint64_t)n);
+  }
+  return naive_u64toa(buffer, (uint64_t)n);
+}
+
+static int32_t naive_dtoa(uint8_t* buffer, double n, int32_t fractional_digits)
+{
+  int32_t size = 0;
+  if (n < 0)
+  {
+    buffer[size++] = '-';
+    n = -n;
+  }
+  double integer_part = 0;
+  double shifted = modf(n, &integer_part);
+  size += naive_u64toa(buffer + size, (uint64_t)integer_part);
+
+  int32_t leading_zeros = 0;
+  for (int32_t d = 0; d < fractional_digits; d++)
+  {
+    shifted *= 10;
+    leading_zeros += shifted < 1;
+  }
+  double fractional_double = 0;
+  (void)modf(shifted, &fractional_double);
+  uint64_t fractional = (uint64_t)fractional_double;
+  if (fractional == 0)
+  {
+    return size;
+  }
+  while (fractional % 10 == 0)
+  {
+    fractional /= 10;
+  }
+  buffer[size++] = '.';
+  while (leading_zeros-- > 0)
+  {
+    buffer[size++] = '0';
+  }
+  return size + naive_u64toa(buffer + size, fractional);
+}
+
+static double ns_per_op(clock_t start, int32_t ops)
+{
+  return seconds_since(start) * 1e9 / ops;
+}
+
+int main(void)
+{
+  // Sums of the results keep the calls from being optimized out, and have to agree.
+  int64_t checks[2] = { 0, 0 };
+  double times[2];
+
+  for (int32_t pass = 0; pass < 2; pass++)
+  {
+    clock_t const start = clock();
+    for (int32_t n = 0; n < ITERATIONS; n++)
+    {
+      for (int32_t t = 0; t < COUNT(topics); t++)
+      {
+        az_span const topic = az_span_create_from_str(topics[t]);
+        for (int32_t k = 0; k < COUNT(targets); k++)
+        {
+          az_span const target = az_span_create_from_str(targets[k]);
+          checks[pass] += pass == 0 ? az_span_find(topic, target) : naive_find(topic, target);
+        }
+      }
+    }
+    times[pass] = ns_per_op(start, ITERATIONS * COUNT(topics) * COUNT(targets));
+  }
+
+  printf(
+      "az_span_find                           %7.1f ns/op, byte loop %7.1f ns/op%s\n",
+      times[0],
+      times[1],
+      checks[0] == checks[1] ? "" : "  RESULTS DIFFER");
+
+  checks[0] = checks[1] = 0;
+  for (int32_t pass = 0; pass < 2; pass++)
+  {
+    clock_t const start = clock();
+    for (int32_t n = 0; n < ITERATIONS * 10; n++)
+    {
+      for (int32_t k = 0; k < COUNT(names); k++)
+      {
+        az_span const name1 = az_span_create_from_str(names[k][0]);
+        az_span const name2 = az_span_create_from_str(names[k][1]);
+        checks[pass] += pass == 0 ? az_span_is_content_equal_ignoring_case(name1, name2)
+                                  : naive_equal_ignoring_case(name1, name2);
+      }
+    }
+    times[pass] = ns_per_op(start, ITERATIONS * 10 * COUNT(names));
+  }
+
+  printf(
+      "az_span_is_content_equal_ignoring_case %7.1f ns/op, byte loop %7.1f ns/op%s\n",
+      times[0],
+      times[1],
+      checks[0] == checks[1] ? "" : "  RESULTS DIFFER");
+
+  // Readings as the sensors report them: light and heart rate counts, temperatures and pressures
+  // with two fractional digits.
+  int32_t const integers[] = { 0, 7, 61, 512, -40, 1013, 65535, 123456789, -2147483647 - 1 };
+  double const doubles[] = { 72.48, 23.5, -4.25, 1013.25, 0.07, 36.6, 98765.43, 0 };
+  uint8_t buffer[40];
+  int64_t sizes[2] = { 0, 0 };
+
+  for (int32_t pass = 0; pass < 2; pass++)
+  {
+    clock_t const start = clock();
+    for (int32_t n = 0; n < ITERATIONS * 10; n++)
+    {
+      for (int32_t k = 0; k < COUNT(integers); k++)
+      {
+        if (pass == 0)
+        {
+          az_span out_span;
+          if (az_result_failed(
+                  az_span_i32toa(AZ_SPAN_FROM_BUFFER(buffer), integers[k], &out_span)))
+          {
+            return 1;
+          }
+          sizes[pass] += az_span_ptr(out_span) - buffer;
+        }
+        else
+        {
+          sizes[pass] += naive_i32toa(buffer, integers[k]);
+        }
+      }
+    }
+    times[pass] = ns_per_op(start, ITERATIONS * 10 * COUNT(integers));
+  }
+
+  printf(
+      "az_span_i32toa                         %7.1f ns/op, byte loop %7.1f ns/op%s\n",
+      times[0],
+      times[1],
+      sizes[0] == sizes[1] ? "" : "  RESULTS DIFFER");
+
+  for (int32_t fractional_digits = 2; fractional_digits <= 15; fractional_digits += 13)
+  {
+    sizes[0] = sizes[1] = 0;
+    for (int32_t pass = 0; pass < 2; pass++)
+    {
+      clock_t const start = clock();
+      for (int32_t n = 0; n < ITERATIONS * 10; n++)
+      {
+        for (int32_t k = 0; k < COUNT(doubles); k++)
+        {
+          if (pass == 0)
+          {
+            az_span out_span;
+            if (az_result_failed(az_span_dtoa(
+                    AZ_SPAN_FROM_BUFFER(buffer), doubles[k], fractional_digits, &out_span)))
+            {
+              return 1;
+            }
+            sizes[pass] += az_span_ptr(out_span) - buffer;
+          }
+          else
+          {
+            sizes[pass] += naive_dtoa(buffer, doubles[k], fractional_digits);
+          }
+        }
+      }
+      times[pass] = ns_per_op(start, ITERATIONS * 10 * COUNT(doubles));
+    }
+
+    // The byte loop's repeated multiplications round, so at 15 digits it can differ from the
+    // exact digits in the last places and the sizes are not compared.
+    printf(
+        "az_span_dtoa, %2d fractional digits    %7.1f ns/op, byte loop %7.1f ns/op%s\n",
+        fractional_digits,
+        times[0],
+        times[1],
+        fractional_digits > 2 || sizes[0] == sizes[1] ? "" : "  RESULTS DIFFER");
+  }
+
+  return checks[0] == checks[1] ? 0 : 1;
+}
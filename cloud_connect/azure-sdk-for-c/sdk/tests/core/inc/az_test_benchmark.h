@@ -0,0 +1,23 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// SPDX-License-Identifier: MIT
+
+/**
+ * @file az_test_benchmark.h
+ *
+ * @brief Timing shared by the benchmark executables in this folder.
+ */
+
+#ifndef _az_TEST_BENCHMARK_H
+#define _az_TEST_BENCHMARK_H
+
+#include <time.h>
+
+// The best of this many runs is reported, which filters out the time lost to other processes.
+#define TRIALS 5
+
+static inline double seconds_since(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+#endif // _az_TEST_BENCHMARK_H
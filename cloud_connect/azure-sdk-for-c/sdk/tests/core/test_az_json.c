@@ -3,6 +3,8 @@
 
 #include "az_test_definitions.h"
 #include <azure/core/az_json.h>
+#include <azure/core/az_precondition.h>
+#include <azure/core/internal/az_precondition_internal.h>
 #include <azure/core/internal/az_result_internal.h>
 #include <azure/core/internal/az_span_internal.h>
 
@@ -10,6 +12,7 @@
 #include <setjmp.h>
 #include <stdarg.h>
 
+#include <az_test_precondition.h>
 #include <cmocka.h>
 
 #include <azure/core/_az_cfg.h>
@@ -141,6 +144,14 @@ static void test_json_writer(void** state)
       az_span_to_str((char*)array, 33, az_json_writer_get_bytes_used_in_destination(&writer));
       assert_string_equal(array, "0");
     }
+    {
+      TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+
+      TEST_EXPECT_SUCCESS(az_json_writer_append_double(&writer, 0.3, 5));
+
+      az_span_to_str((char*)array, 33, az_json_writer_get_bytes_used_in_destination(&writer));
+      assert_string_equal(array, "0.3");
+    }
   }
   {
     // json with AZ_JSON_TOKEN_STRING
@@ -2760,27 +2771,325 @@ static void test_az_json_reader_chunked(void** state)
   assert_true(az_span_is_content_equal(expected, az_span_create_from_str(m.name_string)));
 }
 
+#ifndef AZ_NO_PRECONDITION_CHECKING
+ENABLE_PRECONDITION_CHECK_TESTS()
+
+// Writer misuse that only the preconditions catch, so a build with PRECONDITIONS=OFF accepts it.
+static void test_json_writer_misuse_preconditions(void** state)
+{
+  (void)state;
+
+  uint8_t array[64];
+  az_json_writer writer = { 0 };
+
+  // A second value outside of any container.
+  TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_int32(&writer, 1));
+  ASSERT_PRECONDITION_CHECKED(az_json_writer_append_int32(&writer, 2));
+
+  // A value without a property name within an object.
+  TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_begin_object(&writer));
+  ASSERT_PRECONDITION_CHECKED(az_json_writer_append_double(&writer, 1.5, 2));
+
+  // Two property names in a row.
+  TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_begin_object(&writer));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("a")));
+  ASSERT_PRECONDITION_CHECKED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("b")));
+
+  // A property name within an array.
+  TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_begin_array(&writer));
+  ASSERT_PRECONDITION_CHECKED(
+      az_json_writer_append_property_name(&writer, AZ_SPAN_FROM_STR("a")));
+
+  // Closing an array with the end of an object.
+  TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_begin_array(&writer));
+  ASSERT_PRECONDITION_CHECKED(az_json_writer_append_end_object(&writer));
+
+  // A property name without a buffer.
+  TEST_EXPECT_SUCCESS(az_json_writer_init(&writer, AZ_SPAN_FROM_BUFFER(array), NULL));
+  TEST_EXPECT_SUCCESS(az_json_writer_append_begin_object(&writer));
+  ASSERT_PRECONDITION_CHECKED(az_json_writer_append_property_name(&writer, (az_span){ 0 }));
+}
+#endif // AZ_NO_PRECONDITION_CHECKING
+
+// Reads every token of the two buffer split of `json` at every position, and checks that they
+// match the tokens read from `json` in one buffer.
+static void _az_json_reader_check_every_split(az_span json, int32_t expected_token_count)
+{
+  az_json_token_kind kinds[128];
+  int32_t sizes[128];
+  char strings[128][64];
+  az_result results[128];
+  int32_t count = 0;
+
+  az_json_reader reader = { 0 };
+  assert_int_equal(az_json_reader_init(&reader, json, NULL), AZ_OK);
+  while (az_result_succeeded(az_json_reader_next_token(&reader)))
+  {
+    assert_true(count < expected_token_count);
+    kinds[count] = reader.token.kind;
+    sizes[count] = reader.token.size;
+    strings[count][0] = 0;
+    results[count] = AZ_OK;
+    if (reader.token.kind == AZ_JSON_TOKEN_STRING
+        || reader.token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
+    {
+      // \uXXXX escapes are not unescaped, their error has to match as well.
+      results[count]
+          = az_json_token_get_string(&reader.token, strings[count], sizeof(strings[count]), NULL);
+    }
+    count++;
+  }
+  assert_int_equal(count, expected_token_count);
+
+  for (int32_t split = 1; split < az_span_size(json); split++)
+  {
+    az_span buffers[2] = { az_span_slice(json, 0, split), az_span_slice_to_end(json, split) };
+    assert_int_equal(az_json_reader_chunked_init(&reader, buffers, 2, NULL), AZ_OK);
+    for (int32_t i = 0; i < count; i++)
+    {
+      char value[64] = { 0 };
+      assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+      assert_int_equal(reader.token.kind, kinds[i]);
+      assert_int_equal(reader.token.size, sizes[i]);
+      if (reader.token.kind == AZ_JSON_TOKEN_STRING
+          || reader.token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
+      {
+        assert_int_equal(
+            az_json_token_get_string(&reader.token, value, sizeof(value), NULL), results[i]);
+        if (results[i] == AZ_OK)
+        {
+          assert_string_equal(value, strings[i]);
+        }
+      }
+    }
+    assert_int_equal(az_json_reader_next_token(&reader), AZ_ERROR_JSON_READER_DONE);
+  }
+}
+
+static void test_az_json_reader_string_and_whitespace_scan(void** state)
+{
+  (void)state;
+
+  // Strings and whitespace runs around every word and vector width, with the escapes, the end of a
+  // string and the next token at every position within them.
+  for (int32_t length = 0; length <= 40; length++)
+  {
+    uint8_t buffer[512];
+    az_span const json = AZ_SPAN_FROM_BUFFER(buffer);
+    az_span remainder = json;
+    int32_t tokens = 2;
+
+    remainder = az_span_copy(remainder, AZ_SPAN_FROM_STR("{"));
+    for (int32_t i = 0; i < length; i++)
+    {
+      remainder = az_span_copy_u8(remainder, i % 3 == 0 ? '\n' : ' ');
+    }
+    remainder = az_span_copy(remainder, AZ_SPAN_FROM_STR("\"name\":["));
+    tokens += 2;
+
+    static char* const escapes[] = { "\\n", "\\\"", "\\\\", "\\u00e9", "\\/" };
+    for (int32_t e = 0; e < 5; e++)
+    {
+      remainder = az_span_copy_u8(remainder, '"');
+      for (int32_t i = 0; i < length; i++)
+      {
+        remainder = az_span_copy_u8(remainder, (uint8_t)('a' + i % 26));
+      }
+      remainder = az_span_copy(remainder, az_span_create_from_str(escapes[e]));
+      remainder = az_span_copy(remainder, AZ_SPAN_FROM_STR("tail\",\t"));
+      tokens++;
+    }
+    remainder = az_span_copy_u8(remainder, '"');
+    for (int32_t i = 0; i < length; i++)
+    {
+      remainder = az_span_copy_u8(remainder, (uint8_t)('A' + i % 26));
+    }
+    remainder = az_span_copy(remainder, AZ_SPAN_FROM_STR("\"\r\n]}"));
+    tokens += 2;
+
+    _az_json_reader_check_every_split(
+        az_span_slice(json, 0, az_span_size(json) - az_span_size(remainder)), tokens);
+  }
+
+  // A control character is found at any position of a string, whole or split.
+  for (int32_t length = 1; length <= 40; length++)
+  {
+    for (int32_t position = 0; position < length; position++)
+    {
+      uint8_t buffer[64] = { 0 };
+      az_span json = az_span_create(buffer, length + 2);
+      az_span_fill(json, 'x');
+      buffer[0] = '"';
+      buffer[1 + position] = (uint8_t)(position % 2 == 0 ? 0x01 : 0x1F);
+      buffer[length + 1] = '"';
+
+      az_json_reader reader = { 0 };
+      assert_int_equal(az_json_reader_init(&reader, json, NULL), AZ_OK);
+      assert_int_equal(az_json_reader_next_token(&reader), AZ_ERROR_UNEXPECTED_CHAR);
+
+      for (int32_t split = 1; split < az_span_size(json); split++)
+      {
+        az_span buffers[2] = { az_span_slice(json, 0, split), az_span_slice_to_end(json, split) };
+        assert_int_equal(az_json_reader_chunked_init(&reader, buffers, 2, NULL), AZ_OK);
+        assert_int_equal(az_json_reader_next_token(&reader), AZ_ERROR_UNEXPECTED_CHAR);
+      }
+    }
+  }
+}
+
+// The index that az_json_token_is_text_equal() finds, one name at a time.
+static int32_t _az_json_token_find_text_one_by_one(
+    az_json_token const* token,
+    az_span const names[],
+    int32_t names_count)
+{
+  for (int32_t i = 0; i < names_count; i++)
+  {
+    if (az_json_token_is_text_equal(token, names[i]))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void _az_json_token_find_text_check_every_split(
+    az_span json,
+    az_span const names[],
+    int32_t names_count)
+{
+  az_json_reader reader = { 0 };
+  assert_int_equal(az_json_reader_init(&reader, json, NULL), AZ_OK);
+  while (az_result_succeeded(az_json_reader_next_token(&reader)))
+  {
+    assert_int_equal(
+        az_json_token_find_text(&reader.token, names, names_count),
+        _az_json_token_find_text_one_by_one(&reader.token, names, names_count));
+  }
+
+  for (int32_t split = 1; split < az_span_size(json); split++)
+  {
+    az_span buffers[2] = { az_span_slice(json, 0, split), az_span_slice_to_end(json, split) };
+    assert_int_equal(az_json_reader_chunked_init(&reader, buffers, 2, NULL), AZ_OK);
+    while (az_result_succeeded(az_json_reader_next_token(&reader)))
+    {
+      assert_int_equal(
+          az_json_token_find_text(&reader.token, names, names_count),
+          _az_json_token_find_text_one_by_one(&reader.token, names, names_count));
+    }
+  }
+}
+
+static void test_az_json_token_find_text(void** state)
+{
+  (void)state;
+
+  static const az_span names[] = {
+    AZ_SPAN_LITERAL_FROM_STR("desired"),
+    AZ_SPAN_LITERAL_FROM_STR("reported"),
+    AZ_SPAN_LITERAL_FROM_STR("$version"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetryInterval"),
+    AZ_SPAN_LITERAL_FROM_STR("led_blue"),
+    AZ_SPAN_LITERAL_FROM_STR("a\"b"),
+    AZ_SPAN_LITERAL_FROM_STR("tab\there"),
+    AZ_SPAN_LITERAL_FROM_STR("back\\slash"),
+    AZ_SPAN_LITERAL_FROM_STR("/path"),
+    AZ_SPAN_LITERAL_FROM_STR(""),
+    AZ_SPAN_LITERAL_FROM_STR("des"),
+    AZ_SPAN_LITERAL_FROM_STR("desired"),
+  };
+  int32_t const names_count = (int32_t)(sizeof(names) / sizeof(names[0]));
+
+  az_span const json = AZ_SPAN_FROM_STR(
+      "{\"desired\":{\"telemetryInterval\":10,\"$version\":15},\"reported\":\"desired\","
+      "\"a\\\"b\":1,\"tab\\there\":2,\"back\\\\slash\":3,\"\\/path\":4,\"\":5,"
+      "\"des\\u0069red\":6,\"desire\":7,\"desiredd\":8,\"\\\"\":9,\"de\\/sired\":10,"
+      "\"led_blue\":true,\"x\":[1,\"des\",null,\"\\u0000\"]}");
+
+  _az_json_token_find_text_check_every_split(json, names, names_count);
+
+  az_json_reader reader = { 0 };
+  assert_int_equal(az_json_reader_init(&reader, json, NULL), AZ_OK);
+  assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+  assert_int_equal(az_json_token_find_text(&reader.token, names, names_count), -1);
+  assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+  assert_int_equal(az_json_token_find_text(&reader.token, names, names_count), 0);
+  assert_int_equal(az_json_token_find_text(&reader.token, names + 1, names_count - 1), 10);
+  assert_int_equal(az_json_token_find_text(&reader.token, names, 0), -1);
+
+  int32_t const expected[] = { 3, -1, 2, -1, 1, 0, 5, -1, 6, -1, 7, -1, 8, -1, 9, -1, -1, -1 };
+  assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+  for (int32_t i = 0; i < (int32_t)(sizeof(expected) / sizeof(expected[0])); i++)
+  {
+    assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+    if (reader.token.kind == AZ_JSON_TOKEN_END_OBJECT)
+    {
+      assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+    }
+    assert_int_equal(az_json_token_find_text(&reader.token, names, names_count), expected[i]);
+  }
+
+  // More names than fit in one candidate mask.
+  char text[100][4];
+  az_span many_names[100];
+  for (int32_t i = 0; i < 100; i++)
+  {
+    text[i][0] = 'n';
+    text[i][1] = (char)('0' + i / 10);
+    text[i][2] = (char)('0' + i % 10);
+    many_names[i] = az_span_create((uint8_t*)text[i], 3);
+  }
+  _az_json_token_find_text_check_every_split(
+      AZ_SPAN_FROM_STR("[\"n00\",\"n63\",\"n64\",\"n\\u0037\",\"n99\",\"n\\/1\",\"n100\",99]"),
+      many_names,
+      100);
+
+  az_span const escaped_digits = AZ_SPAN_FROM_STR("[\"n64\",\"n\\u0036\\u0034\"]");
+  assert_int_equal(az_json_reader_init(&reader, escaped_digits, NULL), AZ_OK);
+  assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+  assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+  assert_int_equal(az_json_token_find_text(&reader.token, many_names, 100), 64);
+  assert_int_equal(az_json_reader_next_token(&reader), AZ_OK);
+  assert_int_equal(az_json_token_find_text(&reader.token, many_names, 100), -1);
+}
+
 int test_az_json()
 {
-  const struct CMUnitTest tests[]
-      = { cmocka_unit_test(test_json_reader_init),
-          cmocka_unit_test(test_json_writer),
-          cmocka_unit_test(test_json_writer_append_nested),
-          cmocka_unit_test(test_json_writer_append_nested_invalid),
-          cmocka_unit_test(test_json_writer_chunked),
-          cmocka_unit_test(test_json_writer_chunked_no_callback),
-          cmocka_unit_test(test_json_writer_large_string_chunked),
-          cmocka_unit_test(test_json_reader),
-          cmocka_unit_test(test_json_reader_invalid),
-          cmocka_unit_test(test_json_reader_incomplete),
-          cmocka_unit_test(test_json_skip_children),
-          cmocka_unit_test(test_json_value),
-          cmocka_unit_test(test_az_json_token_get_string_and_text_equal),
-          cmocka_unit_test(test_az_json_token_get_string_and_text_equal_discontiguous),
-          cmocka_unit_test(test_az_json_reader_double),
-          cmocka_unit_test(test_az_json_token_number_too_large),
-          cmocka_unit_test(test_az_json_token_literal),
-          cmocka_unit_test(test_az_json_token_copy),
-          cmocka_unit_test(test_az_json_reader_chunked) };
+#ifndef AZ_NO_PRECONDITION_CHECKING
+  SETUP_PRECONDITION_CHECK_TESTS();
+#endif // AZ_NO_PRECONDITION_CHECKING
+
+  const struct CMUnitTest tests[] = {
+#ifndef AZ_NO_PRECONDITION_CHECKING
+    cmocka_unit_test(test_json_writer_misuse_preconditions),
+#endif // AZ_NO_PRECONDITION_CHECKING
+    cmocka_unit_test(test_json_reader_init),
+    cmocka_unit_test(test_json_writer),
+    cmocka_unit_test(test_json_writer_append_nested),
+    cmocka_unit_test(test_json_writer_append_nested_invalid),
+    cmocka_unit_test(test_json_writer_chunked),
+    cmocka_unit_test(test_json_writer_chunked_no_callback),
+    cmocka_unit_test(test_json_writer_large_string_chunked),
+    cmocka_unit_test(test_json_reader),
+    cmocka_unit_test(test_json_reader_invalid),
+    cmocka_unit_test(test_json_reader_incomplete),
+    cmocka_unit_test(test_json_skip_children),
+    cmocka_unit_test(test_json_value),
+    cmocka_unit_test(test_az_json_token_get_string_and_text_equal),
+    cmocka_unit_test(test_az_json_token_get_string_and_text_equal_discontiguous),
+    cmocka_unit_test(test_az_json_token_find_text),
+    cmocka_unit_test(test_az_json_reader_double),
+    cmocka_unit_test(test_az_json_token_number_too_large),
+    cmocka_unit_test(test_az_json_token_literal),
+    cmocka_unit_test(test_az_json_token_copy),
+    cmocka_unit_test(test_az_json_reader_chunked),
+    cmocka_unit_test(test_az_json_reader_string_and_whitespace_scan),
+  };
   return cmocka_run_group_tests_name("az_core_json", tests, NULL, NULL);
 }
@@ -92,6 +92,42 @@ static void az_span_to_lower_test(void** state)
   assert_false(az_span_is_content_equal_ignoring_case(a, d));
 }
 
+static void az_span_is_content_equal_ignoring_case_all_bytes_test(void** state)
+{
+  (void)state;
+
+  // Long enough for whole words plus a tail, every byte pair at every position.
+  uint8_t buffer1[19];
+  uint8_t buffer2[19];
+  memcpy(buffer1, "$IoTHub/Methods/Po", sizeof(buffer1));
+  memcpy(buffer2, "$iothub/METHODS/pO", sizeof(buffer2));
+  az_span span1 = AZ_SPAN_FROM_BUFFER(buffer1);
+  az_span span2 = AZ_SPAN_FROM_BUFFER(buffer2);
+  assert_true(az_span_is_content_equal_ignoring_case(span1, span2));
+
+  for (int32_t position = 0; position < (int32_t)sizeof(buffer1); position++)
+  {
+    uint8_t const saved1 = buffer1[position];
+    uint8_t const saved2 = buffer2[position];
+
+    for (int32_t i = 0; i <= UINT8_MAX; i++)
+    {
+      for (int32_t j = 0; j <= UINT8_MAX; j++)
+      {
+        buffer1[position] = (uint8_t)i;
+        buffer2[position] = (uint8_t)j;
+
+        bool const expected = i == j || (i >= 'A' && i <= 'Z' && j == i + 32)
+            || (j >= 'A' && j <= 'Z' && i == j + 32);
+        assert_true(az_span_is_content_equal_ignoring_case(span1, span2) == expected);
+      }
+    }
+
+    buffer1[position] = saved1;
+    buffer2[position] = saved2;
+  }
+}
+
 static void test_az_span_is_content_equal(void** state)
 {
   (void)state;
@@ -934,6 +970,91 @@ static void az_span_find_overlapping_checks_success(void** state)
   assert_int_equal(az_span_find(source, az_span_slice(span, 2, 4)), 1);
 }
 
+static int32_t _naive_find(az_span source, az_span target)
+{
+  for (int32_t i = 0; i <= az_span_size(source) - az_span_size(target); i++)
+  {
+    if (az_span_is_content_equal(az_span_slice(source, i, i + az_span_size(target)), target))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void az_span_find_matches_naive_search(void** state)
+{
+  (void)state;
+
+  // A two letter alphabet makes partial matches common, source sizes go past the point where
+  // the long target search is used.
+  uint8_t buffer[700];
+  uint32_t seed = 12345;
+  for (int32_t i = 0; i < (int32_t)sizeof(buffer); i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    buffer[i] = (uint8_t)('a' + ((seed >> 16) & 1));
+  }
+
+  for (int32_t offset = 0; offset < 9; offset++)
+  {
+    for (int32_t source_size = 0; source_size <= 600; source_size += 37)
+    {
+      az_span source = az_span_create(buffer + offset, source_size);
+      for (int32_t target_size = 1; target_size <= 40; target_size++)
+      {
+        az_span target = az_span_create(buffer + 650 - target_size - offset, target_size);
+        assert_int_equal(az_span_find(source, target), _naive_find(source, target));
+      }
+    }
+  }
+}
+
+static void az_span_find_every_position_success(void** state)
+{
+  (void)state;
+
+  uint8_t buffer[48];
+  for (int32_t position = 0; position < (int32_t)sizeof(buffer); position++)
+  {
+    memset(buffer, '/', sizeof(buffer));
+    buffer[position] = '$';
+    az_span source = AZ_SPAN_FROM_BUFFER(buffer);
+
+    assert_int_equal(az_span_find(source, AZ_SPAN_FROM_STR("$")), position);
+    assert_int_equal(az_span_find(source, AZ_SPAN_FROM_STR("x")), -1);
+    assert_int_equal(
+        az_span_find(source, AZ_SPAN_FROM_STR("$/")),
+        position == (int32_t)sizeof(buffer) - 1 ? -1 : position);
+    assert_int_equal(
+        az_span_find(az_span_slice(source, 0, position), AZ_SPAN_FROM_STR("$")), -1);
+  }
+}
+
+static void az_span_find_long_target_success(void** state)
+{
+  (void)state;
+
+  uint8_t buffer[1024];
+  memset(buffer, 'a', sizeof(buffer));
+  az_span source = AZ_SPAN_FROM_BUFFER(buffer);
+
+  az_span target = az_span_create(buffer + 700, 300);
+  memset(buffer + 700, 'b', 300);
+  buffer[700] = 'a';
+
+  // Longer than the 255 byte skip limit, preceded by partial matches.
+  assert_int_equal(az_span_find(source, target), 700);
+  assert_int_equal(az_span_find(az_span_slice(source, 0, 999), target), -1);
+
+  az_span short_target = AZ_SPAN_FROM_STR("abbbbbbbbbbbbbbbbbbc");
+  buffer[1003] = 'a';
+  memset(buffer + 1004, 'b', 18);
+  buffer[1022] = 'c';
+  assert_int_equal(az_span_find(source, short_target), 1003);
+  assert_int_equal(az_span_find(source, AZ_SPAN_FROM_STR("abbbbbbbbbbbbbbbbbbd")), -1);
+}
+
 static void az_span_i64toa_test(void** state)
 {
   (void)state;
@@ -1493,6 +1614,141 @@ static void az_span_dtoa_too_large(void** state)
   assert_int_equal(az_span_dtoa(buff, 1.7e308, 15, &o), AZ_ERROR_NOT_SUPPORTED);
 }
 
+static void az_span_dtoa_digits(void** state)
+{
+  (void)state;
+
+  uint8_t raw_buffer[33] = { 0 };
+
+  // The digits are those of the fractional part multiplied by 10 in double arithmetic, once per
+  // digit, so the binary representation error of values like 0.3 is not written.
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.5, 15, AZ_SPAN_FROM_STR("0.5"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.25, 15, AZ_SPAN_FROM_STR("0.25"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.1, 15, AZ_SPAN_FROM_STR("0.1"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.1, 1, AZ_SPAN_FROM_STR("0.1"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.3, 15, AZ_SPAN_FROM_STR("0.3"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.3, 5, AZ_SPAN_FROM_STR("0.3"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.1 + 0.2, 15, AZ_SPAN_FROM_STR("0.3"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.7, 2, AZ_SPAN_FROM_STR("0.7"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.29, 2, AZ_SPAN_FROM_STR("0.29"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.678, 2, AZ_SPAN_FROM_STR("0.67"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(23.45, 2, AZ_SPAN_FROM_STR("23.44"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.999999999999999, 15, AZ_SPAN_FROM_STR("0.999999999999998"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(0.9999999999999999, 15, AZ_SPAN_FROM_STR("0.999999999999999"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(9.5367431640625e-07, 15, AZ_SPAN_FROM_STR("0.000000953674316"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(1.7763568394002505e-15, 15, AZ_SPAN_FROM_STR("0.000000000000001"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(8.881784197001252e-16, 15, AZ_SPAN_FROM_STR("0"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(2.2250738585072014e-308, 15, AZ_SPAN_FROM_STR("0"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(5e-324, 15, AZ_SPAN_FROM_STR("0"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(-0.0, 15, AZ_SPAN_FROM_STR("0"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(1234567.890625, 6, AZ_SPAN_FROM_STR("1234567.890625"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(1234567.890625, 5, AZ_SPAN_FROM_STR("1234567.89062"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(4503599627370495.5, 1, AZ_SPAN_FROM_STR("4503599627370495.5"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(4503599627370495.5, 15, AZ_SPAN_FROM_STR("4503599627370495.5"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(72.48, 2, AZ_SPAN_FROM_STR("72.48"));
+  AZ_SPAN_DTOA_SUCCEEDS_HELPER(-1013.25, 2, AZ_SPAN_FROM_STR("-1013.25"));
+}
+
+// Writes the digits of n from the last one, one division at a time.
+static az_span reference_u64toa(uint8_t* buffer, size_t size, bool negative, uint64_t n)
+{
+  size_t i = size;
+  do
+  {
+    buffer[--i] = (uint8_t)('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  if (negative)
+  {
+    buffer[--i] = '-';
+  }
+  return az_span_create(buffer + i, (int32_t)(size - i));
+}
+
+static az_span written(az_span buffer, az_span out_span)
+{
+  return az_span_slice(buffer, 0, _az_span_diff(out_span, buffer));
+}
+
+static void az_span_integer_to_ascii_matches_reference(void** state)
+{
+  (void)state;
+
+  uint8_t expected_buffer[21];
+  uint8_t raw_buffer[21];
+  az_span const buffer = AZ_SPAN_FROM_BUFFER(raw_buffer);
+  az_span out_span;
+  uint64_t values[20 * 3 + 200];
+  int32_t count = 0;
+
+  // Every digit count change, and pseudo-random values of every bit length.
+  uint64_t power = 1;
+  for (int32_t p = 0; p < 20; p++, power *= 10)
+  {
+    values[count++] = power - 1;
+    values[count++] = power;
+    values[count++] = power + 1;
+  }
+  uint64_t random = 88172645463325252ULL;
+  for (int32_t r = 0; r < 200; r++)
+  {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    values[count++] = random >> (r % 64);
+  }
+
+  for (int32_t i = 0; i < count; i++)
+  {
+    uint64_t const v = values[i];
+    az_span expected = reference_u64toa(expected_buffer, sizeof(expected_buffer), false, v);
+
+    assert_int_equal(az_span_u64toa(buffer, v, &out_span), AZ_OK);
+    assert_true(az_span_is_content_equal(written(buffer, out_span), expected));
+
+    if (v <= INT64_MAX)
+    {
+      assert_int_equal(az_span_i64toa(buffer, (int64_t)v, &out_span), AZ_OK);
+      assert_true(az_span_is_content_equal(written(buffer, out_span), expected));
+
+      expected = reference_u64toa(expected_buffer, sizeof(expected_buffer), true, v);
+      assert_int_equal(az_span_i64toa(buffer, -(int64_t)v, &out_span), AZ_OK);
+      assert_true(az_span_is_content_equal(
+          written(buffer, out_span), v == 0 ? AZ_SPAN_FROM_STR("0") : expected));
+    }
+
+    if (v <= UINT32_MAX)
+    {
+      expected = reference_u64toa(expected_buffer, sizeof(expected_buffer), false, v);
+      assert_int_equal(az_span_u32toa(buffer, (uint32_t)v, &out_span), AZ_OK);
+      assert_true(az_span_is_content_equal(written(buffer, out_span), expected));
+
+      // One byte short.
+      az_span const too_small = az_span_slice(buffer, 0, az_span_size(expected) - 1);
+      assert_int_equal(
+          az_span_u32toa(too_small, (uint32_t)v, &out_span), AZ_ERROR_NOT_ENOUGH_SPACE);
+    }
+
+    if (v <= INT32_MAX)
+    {
+      expected = reference_u64toa(expected_buffer, sizeof(expected_buffer), true, v);
+      assert_int_equal(az_span_i32toa(buffer, -(int32_t)v, &out_span), AZ_OK);
+      assert_true(az_span_is_content_equal(
+          written(buffer, out_span), v == 0 ? AZ_SPAN_FROM_STR("0") : expected));
+    }
+  }
+
+  az_span const int32_min = AZ_SPAN_FROM_STR("-2147483648");
+  az_span const int64_min = AZ_SPAN_FROM_STR("-9223372036854775808");
+  az_span const uint64_max = AZ_SPAN_FROM_STR("18446744073709551615");
+  assert_int_equal(az_span_i32toa(buffer, INT32_MIN, &out_span), AZ_OK);
+  assert_true(az_span_is_content_equal(written(buffer, out_span), int32_min));
+  assert_int_equal(az_span_i64toa(buffer, INT64_MIN, &out_span), AZ_OK);
+  assert_true(az_span_is_content_equal(written(buffer, out_span), int64_min));
+  assert_int_equal(az_span_u64toa(buffer, UINT64_MAX, &out_span), AZ_OK);
+  assert_true(az_span_is_content_equal(written(buffer, out_span), uint64_max));
+}
+
 static void az_span_copy_empty(void** state)
 {
   (void)state;
@@ -1756,6 +2012,7 @@ int test_az_span()
     cmocka_unit_test(test_az_span_getters),
     cmocka_unit_test(az_single_char_ascii_lower_test),
     cmocka_unit_test(az_span_to_lower_test),
+    cmocka_unit_test(az_span_is_content_equal_ignoring_case_all_bytes_test),
     cmocka_unit_test(az_span_to_str_test),
     cmocka_unit_test(test_az_span_is_content_equal),
     cmocka_unit_test(az_span_find_beginning_success),
@@ -1771,6 +2028,9 @@ int test_az_span()
     cmocka_unit_test(az_span_find_embedded_NULLs_success),
     cmocka_unit_test(az_span_find_capacity_checks_success),
     cmocka_unit_test(az_span_find_overlapping_checks_success),
+    cmocka_unit_test(az_span_find_matches_naive_search),
+    cmocka_unit_test(az_span_find_every_position_success),
+    cmocka_unit_test(az_span_find_long_target_success),
     cmocka_unit_test(az_span_atox_return_errors),
     cmocka_unit_test(az_span_atou32_test),
     cmocka_unit_test(az_span_atoi32_test),
@@ -1798,6 +2058,8 @@ int test_az_span()
     cmocka_unit_test(az_span_dtoa_succeeds),
     cmocka_unit_test(az_span_dtoa_overflow_fails),
     cmocka_unit_test(az_span_dtoa_too_large),
+    cmocka_unit_test(az_span_dtoa_digits),
+    cmocka_unit_test(az_span_integer_to_ascii_matches_reference),
     cmocka_unit_test(az_span_copy_empty),
     cmocka_unit_test(test_az_span_is_valid),
     cmocka_unit_test(test_az_span_overlap),
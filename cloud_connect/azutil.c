@@ -1,13 +1,22 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // SPDX-License-Identifier: MIT
 
+#include <math.h>
 #include "azutil.h"
 #include "nmdrv.h"
 #include "led.h"
 #include "dti.h"
+#include "dti_frame.h"
 #include "cloud_wifi_config.h"
 #include "debug_print.h"
 #include "MQTTClient.h"
+#include "cloud_wifi_task.h"
+#include "telemetry_log.h"
+#include "twin_request.h"
+#include "reported_cache.h"
+#include "twin_property_dispatch.h"
+#include "hr9_model.h"
+#include "heartrate9_stats.h"
 
 
 static const az_span twin_request_id_span = AZ_SPAN_LITERAL_FROM_STR("initial_get");
@@ -17,7 +26,8 @@ extern az_iot_pnp_client pnp_client;
 #else
 extern az_iot_hub_client iothub_client;
 #endif
-extern volatile uint32_t telemetryInterval;
+extern volatile uint32_t       telemetryInterval;
+extern heartrate9_aggregate_t heartrate9_aggregate;
 
 extern char deviceIpAddress;
 
@@ -28,45 +38,140 @@ extern uint16_t packet_identifier;
 
 userdata_status_t userdata_status;
 
+// Telemetry payloads are written straight into the MQTT send buffer
 static char pnp_telemetry_topic_buffer[128];
-static char pnp_telemetry_payload_buffer[128];
-
-// use another set of buffers in case two telemetry collides
 static char pnp_uart_telemetry_topic_buffer[128];
-static char pnp_uart_telemetry_payload_buffer[128 + DTI_PAYLOADDATA_NUMBYTES];
+
+// Telemetry batching, see commit_telemetry_payload()
+#define TELEMETRY_BATCH_BUFFER_SIZE 512
+static uint32_t telemetry_batch_window = 0;
+static char     telemetry_sample_buffer[128];
+static char     telemetry_batch_buffer[TELEMETRY_BATCH_BUFFER_SIZE];
+static int32_t  telemetry_batch_length = 0;
+static Timer    telemetry_batch_timer;
+
+// Store-and-forward of telemetry produced while offline, see store_offline_telemetry()
+#define TELEMETRY_REPLAY_INTERVAL_MS 1000
+static telemetry_log_flash_t telemetry_log_flash;
+static telemetry_log_t       telemetry_log;
+static bool                  telemetry_log_ready       = false;
+static bool                  telemetry_log_mount_tried = false;
+static Timer                 telemetry_replay_timer;
+static uint16_t              telemetry_replay_packet_id = 0;   // replayed record waiting for its PUBACK
 
 static char pnp_property_topic_buffer[128];
-static char pnp_property_payload_buffer[512];
 
 static char command_topic_buffer[128];
 static char command_resp_buffer[128];
 
+// Direct method router, see register_direct_method(). A deferred call keeps
+// its payload, the largest is sendMsg: a UART message of up to
+// SERCOM3_USART_WRITE_BUFFER_SIZE bytes in {"sendMsg":"..."} and whitespace.
+#define DIRECT_METHOD_JSON_OVERHEAD 32
+#define DIRECT_METHOD_PAYLOAD_SIZE  (SERCOM3_USART_WRITE_BUFFER_SIZE + DIRECT_METHOD_JSON_OVERHEAD)
+
+#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
+typedef az_iot_pnp_client_command_request direct_method_request_t;
+#else
+typedef az_iot_hub_client_method_request direct_method_request_t;
+#endif
+
+static direct_method_router_t direct_method_router;
+static uint8_t                direct_method_payloads[DIRECT_METHOD_SLOTS][DIRECT_METHOD_PAYLOAD_SIZE];
+static bool                   direct_methods_initialized = false;
+static char                   command_message_buffer[SERCOM3_USART_WRITE_BUFFER_SIZE + 2];   // message, "\4" and null
+
 // Plug and Play Connection Values
 static uint32_t request_id_int = 0;
 static char     request_id_buffer[16];
 
-// IoT Plug and Play properties
-#ifndef IOT_PLUG_AND_PLAY_MODEL_ID
-static const az_span iot_hub_property_desired         = AZ_SPAN_LITERAL_FROM_STR("desired");
-static const az_span iot_hub_property_desired_version = AZ_SPAN_LITERAL_FROM_STR("$version");
-#endif
+// Reported property cache, see send_reported_property() and check_reported_properties()
+#define REPORTED_DIAGNOSTICS_INTERVAL_MS (10 * 60 * 1000)
 
-static const az_span telemetry_name_temperature_span = AZ_SPAN_LITERAL_FROM_STR("temperature");
-static const az_span telemetry_name_light_span       = AZ_SPAN_LITERAL_FROM_STR("light");
-
-static const az_span telemetry_name_long       = AZ_SPAN_LITERAL_FROM_STR("telemetry_Lng");
-static const az_span telemetry_name_bool       = AZ_SPAN_LITERAL_FROM_STR("telemetry_Bool");
-static const az_span telemetry_name_string_1   = AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_1");
-static const az_span telemetry_name_string_2   = AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_2");
-static const az_span telemetry_name_string_3   = AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_3");
-static const az_span telemetry_name_string_4   = AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_4");
+typedef enum
+{
+    REPORTED_TELEMETRY_INTERVAL,
+    REPORTED_TELEMETRY_BATCH_WINDOW,
+    REPORTED_LED_YELLOW,
+    REPORTED_LED_GREEN,
+    REPORTED_DEBUG_LEVEL,
+    REPORTED_IP_ADDRESS,
+    REPORTED_APP_PROPERTY_1,
+    REPORTED_APP_PROPERTY_2,
+    REPORTED_APP_PROPERTY_3,
+    REPORTED_APP_PROPERTY_4,
+    REPORTED_DISABLE_TELEMETRY,
+    REPORTED_FIRMWARE_VERSION,
+    REPORTED_TWIN_DIAGNOSTICS,
+    REPORTED_PROPERTY_COUNT     // at most REPORTED_CACHE_MAX_PROPERTIES
+} reported_property_id_t;
+
+typedef struct
+{
+    az_span name;
+    bool    is_writable;   // acknowledged with ac/av/ad under Plug and Play
+    bool    is_string;     // value is the hash of the string, see reported_property_string()
+} reported_property_t;
+
+static const reported_property_t reported_property_table[REPORTED_PROPERTY_COUNT] = {
+    {AZ_SPAN_LITERAL_FROM_STR("telemetryInterval"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("telemetryBatchWindow"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("led_y"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("led_g"), false, false},
+    {AZ_SPAN_LITERAL_FROM_STR("debugLevel"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("ipAddress"), false, true},
+    {AZ_SPAN_LITERAL_FROM_STR("property_1"), false, false},
+    {AZ_SPAN_LITERAL_FROM_STR("property_2"), false, false},
+    {AZ_SPAN_LITERAL_FROM_STR("property_3"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("property_4"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("disableTelemetry"), true, false},
+    {AZ_SPAN_LITERAL_FROM_STR("firmwareVersion"), false, true},
+    {AZ_SPAN_LITERAL_FROM_STR("twinDiagnostics"), false, false},
+};
+
+static reported_cache_t reported_cache;
+static Timer            reported_diagnostics_timer;
+static bool             twin_responses_subscribed = false;   // $iothub/twin/res/# SUBACK received
+static char             firmware_version_buffer[18];   // 8bit + 8bit + 8bit + 16bit + 3 dots
+
+// Twin requests waiting for their response, see resolve_twin_request()
+#define TWIN_REQUEST_TIMEOUT_MS 30000
+static twin_request_table_t twin_requests;
+
+// Pieces of a twin document bigger than the MQTT read buffer, see receive_device_twin_chunk()
+#define TWIN_DOCUMENT_BUFFER_SIZE 1024
+#define TWIN_DOCUMENT_CHUNKS      8
+static char    twin_topic_buffer[128];
+static uint8_t twin_document_buffer[TWIN_DOCUMENT_BUFFER_SIZE];
+static az_span twin_document_chunks[TWIN_DOCUMENT_CHUNKS];
+static int32_t twin_document_chunk_count = 0;
+static int32_t twin_document_length      = 0;
+
+// Largest magnitude az_json_writer_append_double() prints, 2^53 - 1
+#define JSON_DOUBLE_MAX 9007199254740991.0
+
+// UART telemetry names by DTI telemetry index, see dti_frame.h
+static const az_span telemetry_name_table[DTI_TELEMETRY_INDEX_MAX + 1] = {
+    AZ_SPAN_LITERAL_FROM_STR(""),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Int_1"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Int_2"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Int_3"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Int_4"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Dbl_1"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Dbl_2"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Flt_1"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Flt_2"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Lng"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Bool"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_1"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_2"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_3"),
+    AZ_SPAN_LITERAL_FROM_STR("telemetry_Str_4")
+};
 
-// Telemetry Interval writable property
-static const az_span property_telemetry_interval_span = AZ_SPAN_LITERAL_FROM_STR("telemetryInterval");
 
 // Button Press
 button_press_data_t button_press_data = {0};
-static char         button_event_buffer[128];
 
 static const az_span event_name_button_event_span = AZ_SPAN_LITERAL_FROM_STR("button_event");
 static const az_span event_name_button_name_span  = AZ_SPAN_LITERAL_FROM_STR("button_name");
@@ -76,29 +181,12 @@ static const az_span event_name_press_count_span  = AZ_SPAN_LITERAL_FROM_STR("pr
 
 // LED Properties
 static const az_span led_blue_property_name_span   = AZ_SPAN_LITERAL_FROM_STR("led_b");
-static const az_span led_green_property_name_span  = AZ_SPAN_LITERAL_FROM_STR("led_g");
-static const az_span led_yellow_property_name_span = AZ_SPAN_LITERAL_FROM_STR("led_y");
 static const az_span led_red_property_name_span    = AZ_SPAN_LITERAL_FROM_STR("led_r");
 
-// Debug Level
-static const az_span debug_level_property_name_span = AZ_SPAN_LITERAL_FROM_STR("debugLevel");
-
-// IP Address property
-static const az_span ip_address_property_name_span = AZ_SPAN_LITERAL_FROM_STR("ipAddress");
 #define DISABLE_LIGHT       0x1
 #define DISABLE_TEMPERATURE 0x2
 #define DISABLE_BUTTON      0x4
 
-// App MCU properties
-static const az_span app_property_1_name_span = AZ_SPAN_LITERAL_FROM_STR("property_1");
-static const az_span app_property_2_name_span = AZ_SPAN_LITERAL_FROM_STR("property_2");
-static const az_span app_property_3_name_span = AZ_SPAN_LITERAL_FROM_STR("property_3");
-static const az_span app_property_4_name_span = AZ_SPAN_LITERAL_FROM_STR("property_4");
-
-// Firmware Version Property
-static const az_span fw_version_property_name_span = AZ_SPAN_LITERAL_FROM_STR("firmwareVersion");
-
-static const az_span disable_telemetry_name_span = AZ_SPAN_LITERAL_FROM_STR("disableTelemetry");
 static uint32_t telemetry_disable_flag = 0;
 
 static const az_span resp_success_span                     = AZ_SPAN_LITERAL_FROM_STR("Success");
@@ -115,7 +203,9 @@ static const az_span command_resp_not_supported_span       = AZ_SPAN_LITERAL_FRO
 static const az_span command_name_sendMsg_span               = AZ_SPAN_LITERAL_FROM_STR("sendMsg");
 static const az_span command_sendMsg_payload_span            = AZ_SPAN_LITERAL_FROM_STR("sendMsgString");
 static const az_span command_resp_empty_sendMsg_payload_span = AZ_SPAN_LITERAL_FROM_STR("Message string is empty. Specify string.");
-static const az_span command_resp_alloc_error_sendMsg_span   = AZ_SPAN_LITERAL_FROM_STR("Failed to allocate memory for the message.");
+static const az_span command_resp_too_long_sendMsg_span      = AZ_SPAN_LITERAL_FROM_STR("Message too long for the UART buffer.");
+static const az_span command_resp_busy_span                  = AZ_SPAN_LITERAL_FROM_STR("Busy with other commands, try again later.");
+static const az_span command_resp_too_large_span             = AZ_SPAN_LITERAL_FROM_STR("Payload too large.");
 
 static SYS_TIME_HANDLE reboot_task_handle = SYS_TIME_HANDLE_INVALID;
 
@@ -137,6 +227,386 @@ void init_twin_data(twin_properties_t* twin_properties)
     twin_properties->telemetry_disable_flag = 0;
 }
 
+/**********************************************
+* Reserve the payload space of a publish in the
+* MQTT send buffer. The span is empty when the
+* client is not connected, or for QoS1 when the
+* in-flight window is full.
+**********************************************/
+static az_span reserve_publish_payload(
+    char* topic,
+    int   qos)
+{
+    uint16_t max_payload_len = 0;
+    uint8_t* payload         = CLOUD_publishReserve((uint8_t*)topic, qos, &max_payload_len);
+
+    return payload == NULL ? AZ_SPAN_EMPTY : az_span_create(payload, max_payload_len);
+}
+
+/**********************************************
+* Telemetry log flash access. The log lives in a
+* region of the MCU flash set aside below, so the
+* WINC SPI flash is never touched while the WINC
+* firmware runs. The SAMD21 flash has no ECC, so
+* a page can be programmed again to clear more
+* bits, which is all the log asks of a write.
+* The CPU stalls while a row is erased or a page
+* is programmed, a few ms at most.
+**********************************************/
+#define TELEMETRY_LOG_SECTOR_SIZE  (8 * NVMCTRL_FLASH_ROWSIZE)
+#define TELEMETRY_LOG_SECTOR_COUNT (8)
+
+// Whatever the programmer leaves here is formatted by the first mount
+static const uint8_t telemetry_log_region[TELEMETRY_LOG_SECTOR_COUNT * TELEMETRY_LOG_SECTOR_SIZE]
+    __attribute__((aligned(NVMCTRL_FLASH_ROWSIZE), used));
+
+static bool telemetry_log_flash_wait(void)
+{
+    while (NVMCTRL_IsBusy())
+    {
+    }
+
+    // Reads go through the NVM cache, drop what it held of the changed row
+    NVMCTRL_CacheInvalidate();
+
+    return NVMCTRL_ErrorGet() == NVMCTRL_ERROR_NONE;
+}
+
+static bool telemetry_log_flash_read(uint32_t offset, uint8_t* data, uint32_t length)
+{
+    return NVMCTRL_Read((uint32_t*)data, length, (uint32_t)telemetry_log_region + offset);
+}
+
+static bool telemetry_log_flash_write(uint32_t offset, const uint8_t* data, uint32_t length)
+{
+    uint32_t page_buffer[NVMCTRL_FLASH_PAGESIZE / sizeof(uint32_t)];
+    uint32_t address = (uint32_t)telemetry_log_region + offset;
+
+    while (length > 0)
+    {
+        uint32_t page  = address & ~(NVMCTRL_FLASH_PAGESIZE - 1);
+        uint32_t start = address - page;
+        uint32_t count = min(length, NVMCTRL_FLASH_PAGESIZE - start);
+
+        // Programming 0xFF leaves a bit as it is, so only the bytes given change
+        memset(page_buffer, 0xFF, sizeof(page_buffer));
+        memcpy((uint8_t*)page_buffer + start, data, count);
+
+        if (!NVMCTRL_PageWrite(page_buffer, page) || !telemetry_log_flash_wait())
+        {
+            return false;
+        }
+
+        address += count;
+        data += count;
+        length -= count;
+    }
+
+    return true;
+}
+
+static bool telemetry_log_flash_erase(uint32_t offset)
+{
+    uint32_t address = (uint32_t)telemetry_log_region + offset;
+    uint32_t row;
+
+    for (row = 0; row < TELEMETRY_LOG_SECTOR_SIZE / NVMCTRL_FLASH_ROWSIZE; row++)
+    {
+        if (!NVMCTRL_RowErase(address + row * NVMCTRL_FLASH_ROWSIZE) || !telemetry_log_flash_wait())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**********************************************
+* Mount the telemetry log, once.
+**********************************************/
+static bool mount_telemetry_log(void)
+{
+    if (telemetry_log_mount_tried)
+    {
+        return telemetry_log_ready;
+    }
+
+    telemetry_log_mount_tried = true;
+
+    telemetry_log_flash.read         = telemetry_log_flash_read;
+    telemetry_log_flash.write        = telemetry_log_flash_write;
+    telemetry_log_flash.erase        = telemetry_log_flash_erase;
+    telemetry_log_flash.sector_size  = TELEMETRY_LOG_SECTOR_SIZE;
+    telemetry_log_flash.sector_count = TELEMETRY_LOG_SECTOR_COUNT;
+
+    telemetry_log_ready = telemetry_log_mount(&telemetry_log, &telemetry_log_flash);
+
+    if (!telemetry_log_ready)
+    {
+        debug_printError("AZURE: Unable to mount the telemetry log");
+    }
+
+    TimerInit(&telemetry_replay_timer);
+
+    return telemetry_log_ready;
+}
+
+/**********************************************
+* Keep telemetry that could not be published in
+* the flash log, to be sent after reconnecting.
+**********************************************/
+static bool store_offline_telemetry(
+    const uint8_t* data,
+    int32_t        length)
+{
+    if (!mount_telemetry_log())
+    {
+        debug_printWarn("AZURE: Offline telemetry dropped");
+        return false;
+    }
+
+    if (!telemetry_log_append(&telemetry_log, data, (uint16_t)length))
+    {
+        debug_printError("AZURE: Unable to store offline telemetry");
+        return false;
+    }
+
+    debug_printInfo("AZURE: Stored %ld bytes of offline telemetry", length);
+    return true;
+}
+
+/**********************************************
+* Get the space to build a telemetry payload in.
+* Without batching this is the MQTT send buffer,
+* otherwise, or while it has no room, a scratch
+* buffer for one sample. Samples held back for
+* a full in-flight window go out first.
+**********************************************/
+static az_span reserve_telemetry_payload(void)
+{
+    if (telemetry_batch_window == 0 && telemetry_batch_length == 0)
+    {
+        az_span payload_span = reserve_publish_payload(pnp_telemetry_topic_buffer, 1);
+
+        if (az_span_size(payload_span) > 0)
+        {
+            return payload_span;
+        }
+    }
+
+    return AZ_SPAN_FROM_BUFFER(telemetry_sample_buffer);
+}
+
+/**********************************************
+* Publish the pending telemetry batch as one
+* JSON array. While the client is not connected
+* the batch goes to the flash log instead, while
+* the in-flight window is full it stays here for
+* the next pass.
+**********************************************/
+static void flush_telemetry_batch(void)
+{
+    uint16_t max_payload_len = 0;
+    uint8_t* payload;
+
+    if (telemetry_batch_length == 0)
+    {
+        return;
+    }
+
+    payload = CLOUD_publishReserve((uint8_t*)pnp_telemetry_topic_buffer, 1, &max_payload_len);
+
+    if (payload == NULL && CLOUD_isConnected())
+    {
+        // Every in-flight slot is waiting for its PUBACK, try again next pass
+        return;
+    }
+
+    if (payload == NULL && !mount_telemetry_log())
+    {
+        // Nowhere to put it yet, keep collecting
+        return;
+    }
+
+    telemetry_batch_buffer[telemetry_batch_length++] = ']';
+
+    if (payload == NULL)
+    {
+        store_offline_telemetry((uint8_t*)telemetry_batch_buffer, telemetry_batch_length);
+    }
+    else if (telemetry_batch_length > max_payload_len)
+    {
+        debug_printError("AZURE: Telemetry batch too long : %d", telemetry_batch_length);
+    }
+    else
+    {
+        debug_printGood("AZURE: %.*s", telemetry_batch_length, telemetry_batch_buffer);
+        memcpy(payload, telemetry_batch_buffer, telemetry_batch_length);
+        CLOUD_publishCommit(telemetry_batch_length);
+    }
+
+    telemetry_batch_length = 0;
+}
+
+/**********************************************
+* Send a telemetry payload built in the span from
+* reserve_telemetry_payload(). With batching on,
+* the sample is appended to the batch instead, and
+* the batch goes out when it is full or when
+* telemetryBatchWindow seconds have passed since
+* its first sample. Without batching, a sample
+* the full in-flight window had no room for is
+* held in the batch until the next pass.
+**********************************************/
+static void commit_telemetry_payload(
+    az_span payload_span)
+{
+    int32_t payload_size = az_span_size(payload_span);
+
+    if (az_span_ptr(payload_span) != (uint8_t*)telemetry_sample_buffer)
+    {
+        CLOUD_publishCommit(payload_size);
+        return;
+    }
+
+    if (telemetry_batch_window == 0 && !CLOUD_isConnected())
+    {
+        store_offline_telemetry(az_span_ptr(payload_span), payload_size);
+        return;
+    }
+
+    // Room for the separator and the closing ']'
+    if (telemetry_batch_length + payload_size + 2 > sizeof(telemetry_batch_buffer))
+    {
+        flush_telemetry_batch();
+    }
+
+    if (telemetry_batch_length + payload_size + 2 > sizeof(telemetry_batch_buffer))
+    {
+        debug_printWarn("AZURE: Telemetry batch full, sample dropped");
+        return;
+    }
+
+    if (telemetry_batch_length == 0)
+    {
+        telemetry_batch_buffer[telemetry_batch_length++] = '[';
+        TimerInit(&telemetry_batch_timer);
+        TimerCountdown(&telemetry_batch_timer, telemetry_batch_window);
+    }
+    else
+    {
+        telemetry_batch_buffer[telemetry_batch_length++] = ',';
+    }
+
+    memcpy(&telemetry_batch_buffer[telemetry_batch_length], az_span_ptr(payload_span), payload_size);
+    telemetry_batch_length += payload_size;
+}
+
+/**********************************************
+* Flush the telemetry batch once its window has
+* passed, or when batching was turned off.
+**********************************************/
+void check_telemetry_batch(void)
+{
+    if (telemetry_batch_length == 0)
+    {
+        return;
+    }
+
+    if (telemetry_batch_window == 0 || TimerIsExpired(&telemetry_batch_timer))
+    {
+        flush_telemetry_batch();
+    }
+}
+
+/**********************************************
+* Replay telemetry stored while offline, one
+* record per TELEMETRY_REPLAY_INTERVAL_MS so live
+* traffic keeps going while the log drains. The
+* record stays in the log until its PUBACK comes,
+* see process_publish_complete().
+**********************************************/
+void check_telemetry_replay(void)
+{
+    az_span   payload_span;
+    int32_t   payload_size;
+    az_result rc;
+
+    if (telemetry_replay_packet_id != 0 || !mount_telemetry_log() || !TimerIsExpired(&telemetry_replay_timer))
+    {
+        return;
+    }
+
+    TimerCountdownMS(&telemetry_replay_timer, TELEMETRY_REPLAY_INTERVAL_MS);
+
+    // Reserving takes a packet id, only do it for a record to send
+    if (telemetry_log_pending(&telemetry_log) <= 0)
+    {
+        return;
+    }
+
+#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
+    rc = az_iot_pnp_client_telemetry_get_publish_topic(&pnp_client,
+                                                       AZ_SPAN_EMPTY,
+#else
+    rc = az_iot_hub_client_telemetry_get_publish_topic(&iothub_client,
+#endif
+                                                       NULL,
+                                                       pnp_telemetry_topic_buffer,
+                                                       sizeof(pnp_telemetry_topic_buffer),
+                                                       NULL);
+
+    RETURN_IF_FAILED(rc);
+
+    // Read the record straight into the MQTT send buffer
+    payload_span = reserve_publish_payload(pnp_telemetry_topic_buffer, 1);
+
+    if (az_span_size(payload_span) == 0)
+    {
+        return;
+    }
+
+    payload_size = telemetry_log_peek(&telemetry_log, az_span_ptr(payload_span), az_span_size(payload_span));
+
+    if (payload_size <= 0)
+    {
+        return;
+    }
+
+    debug_printInfo("AZURE: Replaying %ld bytes of offline telemetry", payload_size);
+
+    if (CLOUD_publishCommit(payload_size) == SUCCESS)
+    {
+        telemetry_replay_packet_id = CLOUD_publishId();
+    }
+}
+
+/**********************************************
+* A QoS1 publish got its PUBACK, or failed after
+* its resends or with the connection. A replayed
+* record leaves the log only once it is delivered.
+**********************************************/
+void process_publish_complete(
+    uint16_t packet_id,
+    int      rc)
+{
+    if (packet_id == 0 || packet_id != telemetry_replay_packet_id)
+    {
+        return;
+    }
+
+    telemetry_replay_packet_id = 0;
+
+    if (rc == SUCCESS)
+    {
+        telemetry_log_consume(&telemetry_log);
+    }
+    else
+    {
+        debug_printWarn("AZURE: Replayed telemetry not acknowledged, kept in the log");
+    }
+}
+
 /**************************************
  Start JSON_BUILDER for JSON Document
  This creates a new JSON with "{"
@@ -176,31 +646,39 @@ az_result append_json_property_int32(
 }
 
 /**********************************************
-*	Add a JSON key-value pair with float data
+*	Add a JSON key-value pair with double data
 *	e.g. "property_name" : property_val (number)
+*	NaN, infinity and values past 2^53, which
+*	the JSON writer cannot print, are sent as null
 **********************************************/
-az_result append_json_property_float(
+az_result append_json_property_double(
     az_json_writer* jw,
     az_span         property_name_span,
-    float           property_val)
+    double          property_val)
 {
     RETURN_ERR_IF_FAILED(az_json_writer_append_property_name(jw, property_name_span));
-    RETURN_ERR_IF_FAILED(az_json_writer_append_double(jw, (double)property_val, 5));
+
+    if (!isfinite(property_val) || fabs(property_val) > JSON_DOUBLE_MAX)
+    {
+        RETURN_ERR_IF_FAILED(az_json_writer_append_null(jw));
+    }
+    else
+    {
+        RETURN_ERR_IF_FAILED(az_json_writer_append_double(jw, property_val, 5));
+    }
     return AZ_OK;
 }
 
 /**********************************************
-*	Add a JSON key-value pair with double data
+*	Add a JSON key-value pair with float data
 *	e.g. "property_name" : property_val (number)
 **********************************************/
-az_result append_json_property_double(
+az_result append_json_property_float(
     az_json_writer* jw,
     az_span         property_name_span,
-    double          property_val)
+    float           property_val)
 {
-    RETURN_ERR_IF_FAILED(az_json_writer_append_property_name(jw, property_name_span));
-    RETURN_ERR_IF_FAILED(az_json_writer_append_double(jw, property_val, 5));
-    return AZ_OK;
+    return append_json_property_double(jw, property_name_span, (double)property_val);
 }
 
 /**********************************************
@@ -212,8 +690,14 @@ az_result append_json_property_long(
     az_span         property_name_span,
     int64_t         property_val)
 {
+    uint8_t digits_buffer[20];
+    az_span digits_span;
+
+    // every digit, a double would round past 2^53
+    RETURN_ERR_IF_FAILED(az_span_i64toa(AZ_SPAN_FROM_BUFFER(digits_buffer), property_val, &digits_span));
     RETURN_ERR_IF_FAILED(az_json_writer_append_property_name(jw, property_name_span));
-    RETURN_ERR_IF_FAILED(az_json_writer_append_double(jw, property_val, 5));
+    RETURN_ERR_IF_FAILED(az_json_writer_append_json_text(
+        jw, az_span_create(digits_buffer, sizeof(digits_buffer) - az_span_size(digits_span))));
     return AZ_OK;
 }
 
@@ -271,30 +755,30 @@ static az_result append_reported_property_response_int32(
 }
 #endif
 /**********************************************
-* Build sensor telemetry JSON
+* Build sensor telemetry JSON, the encoder is generated from the device model.
+* Without readings in the interval only the
+* sample count and confidence are sent.
 **********************************************/
 az_result build_sensor_telemetry_message(
-    az_span* out_payload_span,
-    int32_t  temperature,
-    int32_t  light)
+    az_span                       payload_span,
+    az_span*                      out_payload_span,
+    const heartrate9_aggregate_t* aggregate)
 {
-    az_json_writer jw;
-    memset(&pnp_telemetry_payload_buffer, 0, sizeof(pnp_telemetry_payload_buffer));
-    RETURN_ERR_IF_FAILED(start_json_object(&jw, AZ_SPAN_FROM_BUFFER(pnp_telemetry_payload_buffer)));
+    hr9_telemetry_t telemetry;
+    uint32_t        mask = HR9_TELEMETRY_HEART_RATE_SAMPLES | HR9_TELEMETRY_HEART_RATE_CONFIDENCE;
 
-    if ((telemetry_disable_flag & DISABLE_LIGHT) == 0)
-    {
-        RETURN_ERR_IF_FAILED(append_json_property_int32(&jw, telemetry_name_light_span, light));
-    }
+    telemetry.heart_rate            = aggregate->mean;
+    telemetry.heart_rate_min        = aggregate->min;
+    telemetry.heart_rate_max        = aggregate->max;
+    telemetry.heart_rate_samples    = aggregate->samples;
+    telemetry.heart_rate_confidence = aggregate->confidence;
 
-    if ((telemetry_disable_flag & DISABLE_TEMPERATURE) == 0)
+    if (aggregate->samples != 0)
     {
-        RETURN_ERR_IF_FAILED(append_json_property_int32(&jw, telemetry_name_temperature_span, temperature));
+        mask = HR9_TELEMETRY_ALL;
     }
 
-    RETURN_ERR_IF_FAILED(end_json_object(&jw));
-    *out_payload_span = az_json_writer_get_bytes_used_in_destination(&jw);
-    return AZ_OK;
+    return hr9_telemetry_encode(&telemetry, mask, payload_span, out_payload_span);
 }
 
 /**********************************************
@@ -402,7 +886,7 @@ static az_result append_button_press_telemetry(
 **********************************************/
 void check_button_status(void)
 {
-    az_span        button_event_payload_span = AZ_SPAN_FROM_BUFFER(button_event_buffer);
+    az_span        button_event_payload_span;
     az_json_writer jw;
     az_result      rc = AZ_OK;
 
@@ -423,24 +907,6 @@ void check_button_status(void)
         return;
     }
 
-    RETURN_IF_FAILED(start_json_object(&jw, button_event_payload_span));
-
-    if (sw0_pressed)
-    {
-        debug_printInfo("AZURE: Button SW0 Count %lu", button_press_data.sw0_press_count);
-        RETURN_IF_FAILED(append_button_press_telemetry(&jw, event_name_button_sw0_span, button_press_data.sw0_press_count));
-    }
-
-    if (sw1_pressed)
-    {
-        debug_printInfo("AZURE: Button SW1 Count %lu", button_press_data.sw1_press_count);
-        RETURN_IF_FAILED(append_button_press_telemetry(&jw, event_name_button_sw1_span, button_press_data.sw1_press_count));
-    }
-
-    RETURN_IF_FAILED(end_json_object(&jw));
-
-    button_event_payload_span = az_json_writer_get_bytes_used_in_destination(&jw);
-
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
     rc = az_iot_pnp_client_telemetry_get_publish_topic(
         &pnp_client,
@@ -454,13 +920,29 @@ void check_button_status(void)
         sizeof(pnp_telemetry_topic_buffer),
         NULL);
 
-    if (az_result_succeeded(rc))
+    RETURN_IF_FAILED(rc);
+
+    button_event_payload_span = reserve_telemetry_payload();
+
+    RETURN_IF_FAILED(start_json_object(&jw, button_event_payload_span));
+
+    if (sw0_pressed)
     {
-        CLOUD_publishData((uint8_t*)pnp_telemetry_topic_buffer,
-                          az_span_ptr(button_event_payload_span),
-                          az_span_size(button_event_payload_span),
-                          1);
+        debug_printInfo("AZURE: Button SW0 Count %lu", button_press_data.sw0_press_count);
+        RETURN_IF_FAILED(append_button_press_telemetry(&jw, event_name_button_sw0_span, button_press_data.sw0_press_count));
+    }
+
+    if (sw1_pressed)
+    {
+        debug_printInfo("AZURE: Button SW1 Count %lu", button_press_data.sw1_press_count);
+        RETURN_IF_FAILED(append_button_press_telemetry(&jw, event_name_button_sw1_span, button_press_data.sw1_press_count));
     }
+
+    RETURN_IF_FAILED(end_json_object(&jw));
+
+    button_event_payload_span = az_json_writer_get_bytes_used_in_destination(&jw);
+
+    commit_telemetry_payload(button_event_payload_span);
     return;
 }
 
@@ -474,7 +956,6 @@ az_result send_telemetry_message(void)
     az_result rc = AZ_OK;
 
     az_span   telemetry_payload_span;
-    int32_t temp=0,light=0;
 
 
     if ((telemetry_disable_flag & (DISABLE_LIGHT | DISABLE_TEMPERATURE)) == 0x3)
@@ -493,12 +974,6 @@ az_result send_telemetry_message(void)
        
     }
 
-    RETURN_ERR_WITH_MESSAGE_IF_FAILED(
-        build_sensor_telemetry_message(&telemetry_payload_span, temp, light),
-        "Failed to build sensor telemetry JSON payload");
-
-    debug_printGood("AZURE: %s", az_span_ptr(telemetry_payload_span));
-
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
     rc = az_iot_pnp_client_telemetry_get_publish_topic(&pnp_client,
                                                        AZ_SPAN_EMPTY,
@@ -510,13 +985,17 @@ az_result send_telemetry_message(void)
                                                        sizeof(pnp_telemetry_topic_buffer),
                                                        NULL);
 
-    if (az_result_succeeded(rc))
-    {
-        CLOUD_publishData((uint8_t*)pnp_telemetry_topic_buffer,
-                          az_span_ptr(telemetry_payload_span),
-                          az_span_size(telemetry_payload_span),
-                          1);
-    }
+    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "Failed to get telemetry publish topic");
+
+    rc = build_sensor_telemetry_message(reserve_telemetry_payload(),
+                                        &telemetry_payload_span,
+                                        &heartrate9_aggregate);
+
+    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "Failed to build sensor telemetry JSON payload");
+
+    debug_printGood("AZURE: %.*s", az_span_size(telemetry_payload_span), az_span_ptr(telemetry_payload_span));
+
+    commit_telemetry_payload(telemetry_payload_span);
 
     return rc;
 }
@@ -770,9 +1249,9 @@ static az_result process_sendMsg_command(
     az_span*  out_response_span,
     uint16_t* out_response_status)
 {
-    az_result      ret           = AZ_OK;
-    size_t         spanSize      = -1;
-    char*          messageString = NULL;
+    az_result      ret            = AZ_OK;
+    size_t         spanSize       = -1;
+    int32_t        message_length = 0;
     az_json_reader jr;
 
     *out_response_status = AZ_IOT_STATUS_SERVER_ERROR;
@@ -829,140 +1308,246 @@ static az_result process_sendMsg_command(
         debug_printError("AZURE: Message too big for TX Buffer %lu", spanSize);
 
         ret = build_command_error_response_payload(response_span,
-                                                   command_resp_alloc_error_sendMsg_span,
-                                                   out_response_span);
-
-        *out_response_status = AZ_IOT_STATUS_BAD_REQUEST;
-    }
-    else if ((messageString = malloc(spanSize + 1)) == NULL)
-    {
-        debug_printError("AZURE: Failed to allocate memory for message string : Size %ld", spanSize);
-
-        ret = build_command_error_response_payload(response_span,
-                                                   command_resp_alloc_error_sendMsg_span,
+                                                   command_resp_too_long_sendMsg_span,
                                                    out_response_span);
 
         *out_response_status = AZ_IOT_STATUS_BAD_REQUEST;
     }
     else
     {
-        RETURN_ERR_IF_FAILED(az_json_token_get_string(&jr.token, messageString, spanSize + 1, NULL));
+        // room is left for the terminating "\4"
+        RETURN_ERR_IF_FAILED(az_json_token_get_string(&jr.token,
+                                                      command_message_buffer,
+                                                      sizeof(command_message_buffer) - 1,
+                                                      &message_length));
 
-        strlcat(messageString, "\4", spanSize + 1);
+        command_message_buffer[message_length]     = '\4';
+        command_message_buffer[message_length + 1] = '\0';
         debug_disable(true);
-        SYS_CONSOLE_Message(0, messageString);
+        SYS_CONSOLE_Message(0, command_message_buffer);
         debug_disable(false);
         RETURN_ERR_IF_FAILED(build_command_resp_payload(response_span, out_response_span));
 
         *out_response_status = AZ_IOT_STATUS_ACCEPTED;
     }
 
-    if (messageString)
+    return ret;
+}
+
+/**********************************************
+* Direct method router, see direct_method_router.h.
+* The name span must stay valid, e.g. a literal.
+*
+* A method registered with DIRECT_METHOD_INLINE runs
+* straight from process_direct_method_command().
+* Otherwise its request is copied into a slot of the
+* router and it runs from check_direct_methods()
+* defer_ms later, so the MQTT connection keeps being
+* serviced meanwhile. Nothing is allocated at run time.
+**********************************************/
+static void init_direct_methods(void)
+{
+    if (!direct_methods_initialized)
+    {
+        direct_methods_initialized = true;
+        direct_method_router_init(&direct_method_router, &direct_method_payloads[0][0], DIRECT_METHOD_PAYLOAD_SIZE);
+        register_direct_method(command_name_reboot_span, process_reboot_command, DIRECT_METHOD_INLINE);
+        // writing to the UART may wait for room in its buffer
+        register_direct_method(command_name_sendMsg_span, process_sendMsg_command, 0);
+    }
+}
+
+bool register_direct_method(
+    az_span                 name_span,
+    direct_method_handler_t handler,
+    int32_t                 defer_ms)
+{
+    init_direct_methods();
+
+    if (!direct_method_register(&direct_method_router, name_span, handler, defer_ms))
     {
-        free(messageString);
+        debug_printError("AZURE: No room to register command %.*s", az_span_size(name_span), az_span_ptr(name_span));
+        return false;
     }
 
-    return ret;
+    return true;
 }
 
 /**********************************************
-* Process Command
+* Run a command handler and send its response
 **********************************************/
-az_result process_direct_method_command(
-    uint8_t* payload,
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    az_iot_pnp_client_command_request* command_request)
-#else
-    az_iot_hub_client_method_request* method_request)
-#endif
+static az_result run_direct_method(
+    const direct_method_t*   method,
+    az_span                  payload_span,
+    direct_method_request_t* request)
 {
-    az_result rc                = AZ_OK;
+    az_result rc;
     uint16_t  response_status   = AZ_IOT_STATUS_BAD_REQUEST;   // assume error
-    az_span   command_resp_span = AZ_SPAN_FROM_BUFFER(command_resp_buffer);
-    az_span   payload_span      = az_span_create_from_str((char*)payload);
+    az_span   command_resp_span = AZ_SPAN_EMPTY;
 
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    debug_printInfo("AZURE: Processing Command '%s'", command_request->command_name);
-#else
-    debug_printInfo("AZURE: Processing Command '%s'", method_request->name);
-#endif
+    rc = method->handler(payload_span, AZ_SPAN_FROM_BUFFER(command_resp_buffer), &command_resp_span, &response_status);
 
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    if (az_span_is_content_equal(command_name_reboot_span, command_request->command_name))
-#else
-    if (az_span_is_content_equal(command_name_reboot_span, method_request->name))
-#endif
+    if (az_result_failed(rc))
     {
-        rc = process_reboot_command(payload_span, command_resp_span, &command_resp_span, &response_status);
+        debug_printError("AZURE: Failed command %.*s, status 0x%08x",
+                         az_span_size(method->name),
+                         az_span_ptr(method->name),
+                         rc);
 
-        if (az_result_failed(rc))
+        if (az_span_size(command_resp_span) == 0)
         {
-            debug_printError("AZURE: Failed process_reboot_command, status 0x%08x", rc);
-            if (az_span_size(command_resp_span) == 0)
+            // if response is empty, payload was not in the right format.
+            if (az_result_failed(rc = build_command_error_response_payload(AZ_SPAN_FROM_BUFFER(command_resp_buffer),
+                                                                           command_resp_error_processing_span,
+                                                                           &command_resp_span)))
             {
-                // if response is empty, payload was not in the right format.
-                if (az_result_failed(rc = build_command_error_response_payload(command_resp_span,
-                                                                               command_resp_error_processing_span,
-                                                                               &command_resp_span)))
-                {
-                    debug_printError("AZURE: Failed to build error response. (0x%08x)", rc);
-                }
+                debug_printError("AZURE: Failed to build error response. (0x%08x)", rc);
             }
         }
     }
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    else if (az_span_is_content_equal(command_name_sendMsg_span, command_request->command_name))
-#else
-    else if (az_span_is_content_equal(command_name_sendMsg_span, method_request->name))
-#endif
+
+    if ((rc = send_command_response(request, response_status, command_resp_span)) != 0)
     {
-        rc = process_sendMsg_command(payload_span, command_resp_span, &command_resp_span, &response_status);
+        debug_printError("AZURE: Unable to send %d response, status %d", response_status, rc);
+    }
 
-        if (az_result_failed(rc))
-        {
-            debug_printError("AZURE: Failed process_sendMsg_command, status 0x%08x", rc);
-            if (az_span_size(command_resp_span) == 0)
-            {
-                // if response is empty, payload was not in the right format.
-                if (az_result_failed(rc = build_command_error_response_payload(
-                            command_resp_span, command_resp_error_processing_span, &command_resp_span)))
-                {
-                    debug_printError("AZURE: Failed to build error response. (0x%08x)", rc);
-                }
-            }
-        }
+    return rc;
+}
+
+static az_result reply_direct_method_error(
+    direct_method_request_t* request,
+    uint16_t                 status,
+    az_span                  status_string_span)
+{
+    az_result rc;
+    az_span   command_resp_span;
+
+    if (az_result_failed(rc = build_command_error_response_payload(AZ_SPAN_FROM_BUFFER(command_resp_buffer),
+                                                                   status_string_span,
+                                                                   &command_resp_span)))
+    {
+        debug_printError("AZURE: Failed to build error response. (0x%08x)", rc);
+        return rc;
     }
-    else
+
+    return send_command_response(request, status, command_resp_span);
+}
+
+static void direct_method_timer_callback(uintptr_t context)
+{
+    // SYS_TIME callbacks run from the timer interrupt, the handler runs from check_direct_methods()
+    direct_method_slot_ready(&direct_method_router, (uint32_t)context);
+}
+
+/**********************************************
+* Copy a deferred command into a free router slot
+* and start its timer
+**********************************************/
+static az_result defer_direct_method(
+    const direct_method_t*   method,
+    az_span                  payload_span,
+    direct_method_request_t* request)
+{
+    uint32_t  index;
+    az_result rc = direct_method_defer(&direct_method_router, method, payload_span, request->request_id, &index);
+
+    if (rc == AZ_ERROR_OUT_OF_MEMORY)
     {
-        rc = AZ_ERROR_NOT_SUPPORTED;
-        // Unsupported command
+        debug_printWarn("AZURE: No free command slot for %.*s", az_span_size(method->name), az_span_ptr(method->name));
+        return reply_direct_method_error(request, AZ_IOT_STATUS_SERVICE_UNAVAILABLE, command_resp_busy_span);
+    }
+
+    if (az_result_failed(rc))
+    {
+        debug_printError("AZURE: Command %.*s too large to defer", az_span_size(method->name), az_span_ptr(method->name));
+        return reply_direct_method_error(request, AZ_IOT_STATUS_REQUEST_TOO_LARGE, command_resp_too_large_span);
+    }
+
+    if (method->defer_ms != 0 &&
+        SYS_TIME_CallbackRegisterMS(direct_method_timer_callback,
+                                    (uintptr_t)index,
+                                    method->defer_ms,
+                                    SYS_TIME_SINGLE) == SYS_TIME_HANDLE_INVALID)
+    {
+        debug_printWarn("AZURE: Failed to schedule command timer, running it now");
+        direct_method_slot_ready(&direct_method_router, index);
+    }
+
+    return AZ_OK;
+}
+
+/**********************************************
+* Run one deferred command whose time has come.
+* One per call, so a slow command is followed by
+* a pass of the MQTT loop before the next one.
+**********************************************/
+void check_direct_methods(void)
+{
+    direct_method_slot_t*   slot = direct_method_next_ready(&direct_method_router);
+    direct_method_request_t request;
+
+    if (slot == NULL)
+    {
+        return;
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.request_id = az_span_create(slot->request_id, slot->request_id_length);
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-        debug_printError("AZURE: Unsupported command received: %s.", az_span_ptr(command_request->command_name));
+    request.command_name = slot->method->name;
 #else
-        debug_printError("AZURE: Unsupported command received: %s.", az_span_ptr(method_request->name));
+    request.name = slot->method->name;
 #endif
-        // if response is empty, payload was not in the right format.
-        if (az_result_failed(rc = build_command_error_response_payload(command_resp_span,
-                                                                       command_resp_not_supported_span,
-                                                                       &command_resp_span)))
-        {
-            debug_printError("AZURE: Failed to build error response. (0x%08x)", rc);
-        }
-    }
 
+    run_direct_method(slot->method, az_span_create(slot->payload, slot->payload_length), &request);
+
+    direct_method_slot_free(slot);
+}
+
+/**********************************************
+* Process Command
+**********************************************/
+az_result process_direct_method_command(
+    uint8_t* payload,
+#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
+    az_iot_pnp_client_command_request* command_request)
+#else
+    az_iot_hub_client_method_request* method_request)
+#endif
+{
+    az_span          payload_span = az_span_create_from_str((char*)payload);
+    const direct_method_t* method;
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    if ((rc = send_command_response(command_request, response_status, command_resp_span)) != 0)
+    direct_method_request_t* request = command_request;
+    az_span                  name    = command_request->command_name;
 #else
-    if ((rc = send_command_response(method_request, response_status, command_resp_span)) != 0)
+    direct_method_request_t* request = method_request;
+    az_span                  name    = method_request->name;
 #endif
+
+    init_direct_methods();
+
+    debug_printInfo("AZURE: Processing Command '%.*s'", az_span_size(name), az_span_ptr(name));
+
+    method = direct_method_find(&direct_method_router, name);
+
+    if (method == NULL)
     {
-        debug_printError("AZURE: Unable to send %d response, status %d", response_status, rc);
+        // Unsupported command
+        debug_printError("AZURE: Unsupported command received: %.*s.", az_span_size(name), az_span_ptr(name));
+
+        reply_direct_method_error(request, AZ_IOT_STATUS_BAD_REQUEST, command_resp_not_supported_span);
+        return AZ_ERROR_NOT_SUPPORTED;
     }
 
-    return rc;
+    if (method->defer_ms == DIRECT_METHOD_INLINE)
+    {
+        return run_direct_method(method, payload_span, request);
+    }
+
+    return defer_direct_method(method, payload_span, request);
 }
 
-#ifndef IOT_PLUG_AND_PLAY_MODEL_ID
 // from az_iot_pnp_client_property.c
 az_result json_child_token_move(az_json_reader* ref_jr, az_span property_name)
 {
@@ -991,54 +1576,94 @@ az_result json_child_token_move(az_json_reader* ref_jr, az_span property_name)
 }
 
 
-static az_result get_twin_version(
-    az_json_reader*                      ref_json_reader,
-    az_iot_hub_client_twin_response_type response_type,
-    int32_t*                             out_version)
+/**********************************************
+* Source of the string reported properties. The
+* cache only keeps their hash.
+**********************************************/
+static az_span reported_property_string(reported_property_id_t id)
 {
-    RETURN_ERR_IF_FAILED(az_json_reader_next_token(ref_json_reader));
-
-    if (ref_json_reader->token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)
+    if (id == REPORTED_IP_ADDRESS)
     {
-        return AZ_ERROR_UNEXPECTED_CHAR;
+        return az_span_create_from_str(&deviceIpAddress);
     }
 
-    RETURN_ERR_IF_FAILED(az_json_reader_next_token(ref_json_reader));
+    return az_span_create_from_str(firmware_version_buffer);
+}
 
-    if (response_type == AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_TYPE_GET)
-    {
-        RETURN_ERR_IF_FAILED(json_child_token_move(ref_json_reader, iot_hub_property_desired));
-        RETURN_ERR_IF_FAILED(az_json_reader_next_token(ref_json_reader));
-    }
+static int32_t reported_string_hash(az_span value)
+{
+    return (int32_t)twin_request_hash(az_span_ptr(value), az_span_size(value));
+}
 
-    RETURN_ERR_IF_FAILED(json_child_token_move(ref_json_reader, iot_hub_property_desired_version));
-    RETURN_ERR_IF_FAILED(az_json_token_get_int32(&ref_json_reader->token, out_version));
+static int32_t twin_diagnostics_hash(void)
+{
+    uint32_t counters = ((uint32_t)twin_requests.timeouts << 16) | twin_requests.unmatched;
 
-    return AZ_OK;
+    return (int32_t)(twin_request_hash((const uint8_t*)twin_requests.rtt_histogram,
+                                       sizeof(twin_requests.rtt_histogram)) ^ counters);
+}
+
+static uint32_t twin_request_now_ms(void)
+{
+    return (uint32_t)(SYS_TIME_Counter64Get() * 1000 / SYS_TIME_FrequencyGet());
+}
+
+/**********************************************
+* Set the value to report for one property, see
+* reported_cache_set(). Desired property versions
+* are only acknowledged under Plug and Play.
+**********************************************/
+static void set_reported_property(
+    reported_property_id_t id,
+    int32_t                value,
+    int32_t                version)
+{
+#ifndef IOT_PLUG_AND_PLAY_MODEL_ID
+    version = 0;
+#endif
+
+    reported_cache_set(&reported_cache, id, value, version, twin_request_now_ms());
 }
 
-static az_result get_twin_desired(
-    az_json_reader*                      ref_json_reader,
-    az_iot_hub_client_twin_response_type response_type)
+/**********************************************
+* Match a twin response to its request by the $rid
+* of its topic, which also counts the round trip
+* time. Ids that are not numbers, e.g. initial_get,
+* are not tracked.
+**********************************************/
+static bool resolve_twin_request(
+    az_span   request_id_span,
+    uint32_t* request_id)
 {
-    RETURN_ERR_IF_FAILED(az_json_reader_next_token(ref_json_reader));
+    twin_request_t request;
+    uint32_t       now_ms = twin_request_now_ms();
 
-    if (ref_json_reader->token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)
+    if (az_result_failed(az_span_atou32(request_id_span, request_id)))
     {
-        return AZ_ERROR_UNEXPECTED_CHAR;
+        return false;
     }
 
-    RETURN_ERR_IF_FAILED(az_json_reader_next_token(ref_json_reader));
-
-    if (response_type == AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_TYPE_GET)
+    if (!twin_request_resolve(&twin_requests, *request_id, now_ms, &request))
     {
-        RETURN_ERR_IF_FAILED(json_child_token_move(ref_json_reader, iot_hub_property_desired));
+        debug_printTrace("AZURE: Stale twin response %lu", *request_id);
+        return false;
     }
 
-    return AZ_OK;
+    debug_printTrace("AZURE: Twin response %lu after %lu ms", *request_id, now_ms - request.sent_ms);
+    return true;
+}
+
+/**********************************************
+* Response to a reported property PATCH, see
+* reported_cache_ack()
+**********************************************/
+static void ack_reported_properties(
+    uint32_t      request_id,
+    az_iot_status status)
+{
+    reported_cache_ack(&reported_cache, request_id, az_iot_status_succeeded(status), twin_request_now_ms());
 }
 
-#endif
 /**********************************************
 * Parse Desired Property (Writable Property)
 * Respond by updating Writable Property with IoT Plug and Play convention
@@ -1056,22 +1681,182 @@ az_result process_device_twin_property(
     uint8_t*           topic,
     uint8_t*           payload,
     twin_properties_t* twin_properties)
+{
+    az_span payload_span = az_span_create_from_str((char*)payload);
+
+    return process_device_twin_property_chunks(topic, &payload_span, 1, twin_properties);
+}
+
+static void print_unknown_property(az_json_token* token)
+{
+    char buffer[32];
+
+    // the name may be split over payload chunks, copy it out rather than using the token slice
+    if (token->size < (int32_t)sizeof(buffer))
+    {
+        az_span_copy_u8(az_json_token_copy_into_span(token, AZ_SPAN_FROM_BUFFER(buffer)), 0);
+        debug_printWarn("AZURE: Received unknown property '%s'", buffer);
+    }
+    else
+    {
+        debug_printWarn("AZURE: Received unknown property of %d bytes", token->size);
+    }
+}
+
+/**********************************************
+* Desired property handlers, called with the property value token
+**********************************************/
+static az_result twin_property_version(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    RETURN_ERR_IF_FAILED(az_json_token_get_int32(value, &twin_properties->version_num));
+    twin_properties->flag.version_found = 1;
+    return AZ_OK;
+}
+
+static az_result twin_property_telemetry_interval(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    uint32_t data;
+    // found writable property to adjust telemetry interval
+    RETURN_ERR_IF_FAILED(az_json_token_get_uint32(value, &data));
+    twin_properties->flag.telemetry_interval_found = 1;
+    telemetryInterval                              = data;
+    return AZ_OK;
+}
+
+static az_result twin_property_telemetry_batch_window(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    uint32_t data;
+    // found writable property to adjust telemetry batching
+    RETURN_ERR_IF_FAILED(az_json_token_get_uint32(value, &data));
+    twin_properties->flag.telemetry_batch_window_found = 1;
+    telemetry_batch_window                             = data;
+    return AZ_OK;
+}
+
+static az_result twin_property_led_yellow(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    // found writable property to control Yellow LED
+    RETURN_ERR_IF_FAILED(az_json_token_get_int32(value, &twin_properties->desired_led_yellow));
+    twin_properties->flag.yellow_led_found = 1;
+    return AZ_OK;
+}
+
+static az_result twin_property_debug_level(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    // found writable property to control debug level
+    RETURN_ERR_IF_FAILED(az_json_token_get_int32(value, &twin_properties->debugLevel));
+    twin_properties->flag.debug_level_found = 1;
+    return AZ_OK;
+}
+
+static az_result twin_property_app_property_3(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    // found writable property : Property 3
+    RETURN_ERR_IF_FAILED(az_json_token_get_int32(value, &twin_properties->app_property_3));
+    twin_properties->flag.app_property_3_found = 1;
+    return AZ_OK;
+}
+
+static az_result twin_property_app_property_4(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    // found writable property : Property 4
+    RETURN_ERR_IF_FAILED(az_json_token_get_int32(value, &twin_properties->app_property_4));
+    twin_properties->flag.app_property_4_found = 1;
+    return AZ_OK;
+}
+
+static az_result twin_property_disable_telemetry(az_json_token* value, void* context)
+{
+    twin_properties_t* twin_properties = context;
+    // found writable property : Disable Telemetry
+    RETURN_ERR_IF_FAILED(az_json_token_get_uint32(value, &twin_properties->telemetry_disable_flag));
+    twin_properties->flag.telemetry_disable_found = 1;
+    return AZ_OK;
+}
+
+// Generated by device_model/twin_property_hash.py from cryptoauthtrustplatform_hr9-2.json, do not edit
+#define TWIN_PROPERTY_HASH_SEED  2166136264u
+#define TWIN_PROPERTY_TABLE_SIZE 16
+#define TWIN_PROPERTY_NAME_MAX   20
+
+static const twin_property_t twin_property_table[TWIN_PROPERTY_TABLE_SIZE] = {
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR("disableTelemetry"), twin_property_disable_telemetry},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR("telemetryInterval"), twin_property_telemetry_interval},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR("$version"), twin_property_version},
+    {AZ_SPAN_LITERAL_FROM_STR("telemetryBatchWindow"), twin_property_telemetry_batch_window},
+    {AZ_SPAN_LITERAL_FROM_STR("property_4"), twin_property_app_property_4},
+    {AZ_SPAN_LITERAL_FROM_STR("property_3"), twin_property_app_property_3},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR("led_y"), twin_property_led_yellow},
+    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},
+    {AZ_SPAN_LITERAL_FROM_STR("debugLevel"), twin_property_debug_level},
+};
+// End of generated code
+
+#if TWIN_PROPERTY_NAME_MAX >= TWIN_PROPERTY_NAME_SIZE
+#error "A desired property name is too long for twin_property_find()"
+#endif
+
+static const twin_property_table_t twin_property_dispatch_table = {
+    twin_property_table,
+    TWIN_PROPERTY_TABLE_SIZE,
+    TWIN_PROPERTY_HASH_SEED,
+    print_unknown_property,
+};
+
+/**********************************************
+* Walk the desired properties once, from a full twin document (GET) or a
+* desired property update, see twin_property_dispatch(). $version may come
+* anywhere among the properties, but must be there.
+**********************************************/
+static az_result dispatch_twin_properties(
+    az_json_reader*    jr,
+    bool               is_full_twin,
+    twin_properties_t* twin_properties)
+{
+    az_result rc = twin_property_dispatch(&twin_property_dispatch_table, jr, is_full_twin, twin_properties);
+
+    RETURN_ERR_IF_FAILED(rc);
+
+    return twin_properties->flag.version_found ? AZ_OK : AZ_ERROR_ITEM_NOT_FOUND;
+}
+
+/**********************************************
+* Same as process_device_twin_property() for a payload held in several buffers,
+* e.g. the pieces of a publish received with MQTTSubscribeChunked(), so a
+* property document bigger than any one buffer can be parsed in place.
+**********************************************/
+az_result process_device_twin_property_chunks(
+    uint8_t*           topic,
+    az_span            payload_chunks[],
+    int32_t            chunk_count,
+    twin_properties_t* twin_properties)
 {
     az_result rc;
     az_span   property_topic_span;
-    az_span   payload_span;
 
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    az_span component_name_span;
-
     az_iot_pnp_client_property_response property_response;
 #else
     az_iot_hub_client_twin_response property_response;
 #endif
     az_json_reader jr;
+    uint32_t       request_id;
 
     property_topic_span = az_span_create(topic, strlen((char*)topic));
-    payload_span        = az_span_create_from_str((char*)payload);
 
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
     rc = az_iot_pnp_client_property_parse_received_topic(&pnp_client,
@@ -1085,12 +1870,15 @@ az_result process_device_twin_property(
     {
         debug_printTrace("AZURE: Property Topic   : %s", az_span_ptr(property_topic_span));
         debug_printTrace("AZURE: Property Type    : %d", property_response.response_type);
-        debug_printTrace("AZURE: Property Payload : %s", (char*)payload);
+        debug_printTrace("AZURE: Property Payload : %.*s%s",
+                         az_span_size(payload_chunks[0]),
+                         az_span_ptr(payload_chunks[0]),
+                         chunk_count > 1 ? "..." : "");
     }
     else
     {
         debug_printError("AZURE: Failed to parse property topic 0x%08x.", rc);
-        debug_printError("AZURE: Topic: '%s' Payload: '%s'", (char*)topic, (char*)payload);
+        debug_printError("AZURE: Topic: '%s'", (char*)topic);
         return rc;
     }
 
@@ -1107,6 +1895,7 @@ az_result process_device_twin_property(
         }
         else
         {
+            resolve_twin_request(property_response.request_id, &request_id);
             debug_printInfo("AZURE: Property GET Received");
         }
     }
@@ -1134,6 +1923,10 @@ az_result process_device_twin_property(
         }
 
         // This is an acknowledgement from the service that it received our properties. No need to respond.
+        if (resolve_twin_request(property_response.request_id, &request_id))
+        {
+            ack_reported_properties(request_id, property_response.status);
+        }
         return rc;
     }
     else
@@ -1145,200 +1938,110 @@ az_result process_device_twin_property(
                         az_span_ptr(property_response.version));
     }
 
-    rc = az_json_reader_init(&jr,
-                             payload_span,
-                             NULL);
-    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "az_json_reader_init() for get version failed");
+    rc = az_json_reader_chunked_init(&jr,
+                                     payload_chunks,
+                                     chunk_count,
+                                     NULL);
+    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "az_json_reader_init() failed");
 
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
+    rc = dispatch_twin_properties(&jr,
+                                  property_response.response_type == AZ_IOT_PNP_CLIENT_PROPERTY_RESPONSE_TYPE_GET,
+                                  twin_properties);
+#else
+    rc = dispatch_twin_properties(&jr,
+                                  property_response.response_type == AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_TYPE_GET,
+                                  twin_properties);
+#endif
+    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "dispatch_twin_properties() failed");
 
-    rc = az_iot_pnp_client_property_get_property_version(&pnp_client,
-                                                         &jr,
-                                                         property_response.response_type,
-                                                         &twin_properties->version_num);
-
-    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "az_iot_pnp_client_property_get_property_version() failed");
-    twin_properties->flag.version_found = 1;
+    return rc;
+}
 
-#else
-    rc = get_twin_version(&jr,
-                          property_response.response_type,
-                          &twin_properties->version_num);
+static void process_received_twin_document(
+    az_span payload_chunks[],
+    int32_t chunk_count)
+{
+    twin_properties_t twin_properties;
 
-    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "get_twin_version() failed");
-    twin_properties->flag.version_found = 1;
+    init_twin_data(&twin_properties);
 
-#endif
+    if (az_result_succeeded(process_device_twin_property_chunks((uint8_t*)twin_topic_buffer,
+                                                                payload_chunks,
+                                                                chunk_count,
+                                                                &twin_properties)) &&
+        twin_properties.flag.as_uint16 != 0)
+    {
+        update_leds(&twin_properties);
+        send_reported_property(&twin_properties);
+    }
+}
 
-    rc = az_json_reader_init(&jr,
-                             payload_span,
-                             NULL);
-    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "az_json_reader_init() failed");
+/**********************************************
+* Twin topic handler for MQTTSubscribeChunkedAsync().
+* A document that came in one piece is parsed where
+* it is in the MQTT read buffer. The pieces of a
+* bigger one are collected, each as its own span,
+* and parsed once the last one is in.
+**********************************************/
+void receive_device_twin_chunk(
+    const uint8_t* topic,
+    int32_t        topic_length,
+    const uint8_t* chunk,
+    int32_t        chunk_length,
+    uint32_t       offset,
+    uint32_t       total_length)
+{
+    az_span chunk_span;
 
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    while (az_result_succeeded(az_iot_pnp_client_property_get_next_component_property(
-        &pnp_client,
-        &jr,
-        property_response.response_type,
-        &component_name_span)))
+    if (offset == 0)
     {
-        if (az_json_token_is_text_equal(&jr.token, property_telemetry_interval_span))
-        {
-            uint32_t data;
-            // found writable property to adjust telemetry interval
-            RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-            RETURN_ERR_IF_FAILED(az_json_token_get_uint32(&jr.token, &data));
-            twin_properties->flag.telemetry_interval_found = 1;
-            telemetryInterval                              = data;
-        }
-        else if (az_json_token_is_text_equal(&jr.token, led_yellow_property_name_span))
-        {
-            // found writable property to control Yellow LED
-            RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-            RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                         &twin_properties->desired_led_yellow));
-            twin_properties->flag.yellow_led_found = 1;
-        }
-        else if (az_json_token_is_text_equal(&jr.token, debug_level_property_name_span))
-        {
-            // found writable property to control Yellow LED
-            RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-            RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                         &twin_properties->debugLevel));
-            twin_properties->flag.debug_level_found = 1;
-        }
-        else if (az_json_token_is_text_equal(&jr.token, app_property_3_name_span))
-        {
-            // found writable property : Property 3
-            RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-            RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                         &twin_properties->app_property_3));
-            twin_properties->flag.app_property_3_found = 1;
-        }
-        else if (az_json_token_is_text_equal(&jr.token, app_property_4_name_span))
-        {
-            // found writable property : Property 4
-            RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-            RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                         &twin_properties->app_property_4));
-            twin_properties->flag.app_property_4_found = 1;
-        }
-        else if (az_json_token_is_text_equal(&jr.token, disable_telemetry_name_span))
+        twin_document_chunk_count = 0;
+        twin_document_length      = 0;
+
+        if (topic_length >= (int32_t)sizeof(twin_topic_buffer))
         {
-            // found writable property : Disable Telemetry
-            RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-            RETURN_ERR_IF_FAILED(az_json_token_get_uint32(&jr.token,
-                                                          &twin_properties->telemetry_disable_flag));
-            twin_properties->flag.telemetry_disable_found = 1;
+            debug_printError("AZURE: Twin topic too long");
+            twin_document_chunk_count = -1;
+            return;
         }
-        else
-        {
-            char   buffer[32];
-            size_t spanSize = (size_t)az_span_size(jr.token.slice);
-            size_t size     = sizeof(buffer) < spanSize ? sizeof(buffer) : spanSize;
-            snprintf(buffer, size, "%s", az_span_ptr(jr.token.slice));
 
-            debug_printWarn("AZURE: Received unknown property '%s'", buffer);
+        memcpy(twin_topic_buffer, topic, topic_length);
+        twin_topic_buffer[topic_length] = '\0';
+
+        if (total_length == (uint32_t)chunk_length)
+        {
+            chunk_span = az_span_create((uint8_t*)chunk, chunk_length);
+            process_received_twin_document(&chunk_span, 1);
+            return;
         }
-        RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
     }
-#else
 
-    if (twin_properties->flag.is_initial_get == 1)
-    {
-        get_twin_desired(&jr, property_response.response_type);
-    }
-    else
+    // an earlier piece did not fit, the rest of the document is dropped
+    if (twin_document_chunk_count < 0)
     {
-        RETURN_ERR_WITH_MESSAGE_IF_FAILED((az_json_reader_next_token(&jr)), "az_json_reader_next_token() failed.");
+        return;
     }
 
-    if (jr.token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)
+    if (twin_document_chunk_count == TWIN_DOCUMENT_CHUNKS ||
+        chunk_length > TWIN_DOCUMENT_BUFFER_SIZE - twin_document_length)
     {
-        debug_printError(
-            "`%.*s` property was not in the expected format. Token Kind %d",
-            az_span_ptr(jr.token.slice),
-            jr.token.kind);
-        rc = AZ_ERROR_JSON_INVALID_STATE;
+        debug_printError("AZURE: Twin document of %lu bytes too large", total_length);
+        twin_document_chunk_count = -1;
+        return;
     }
-    else
-    {
-        RETURN_ERR_WITH_MESSAGE_IF_FAILED((az_json_reader_next_token(&jr)), "az_json_reader_next_token() failed.");
 
-        while (jr.token.kind != AZ_JSON_TOKEN_END_OBJECT)
-        {
-            if (jr.token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
-            {
-                if (az_json_token_is_text_equal(&jr.token, property_telemetry_interval_span))
-                {
-                    uint32_t data;
-                    // found writable property to adjust telemetry interval
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                    RETURN_ERR_IF_FAILED(az_json_token_get_uint32(&jr.token, &data));
-                    twin_properties->flag.telemetry_interval_found = 1;
-                    telemetryInterval                              = data;
-                }
-                else if (az_json_token_is_text_equal(&jr.token, led_yellow_property_name_span))
-                {
-                    // found writable property to control Yellow LED
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                    RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                                 &twin_properties->desired_led_yellow));
-                    twin_properties->flag.yellow_led_found = 1;
-                }
-                else if (az_json_token_is_text_equal(&jr.token, debug_level_property_name_span))
-                {
-                    // found writable property to control debug level
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                    RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                                &twin_properties->debugLevel));
-                    twin_properties->flag.debug_level_found = 1;
-                }
-                else if (az_json_token_is_text_equal(&jr.token, app_property_3_name_span))
-                {
-                    // found writable property to control property_3
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                    RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                                &twin_properties->app_property_3));
-                    twin_properties->flag.app_property_3_found = 1;
-                }
-                else if (az_json_token_is_text_equal(&jr.token, app_property_4_name_span))
-                {
-                    // found writable property to control property_4
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                    RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr.token,
-                                                                &twin_properties->app_property_4));
-                    twin_properties->flag.app_property_4_found = 1;
-                }
-                else if (az_json_token_is_text_equal(&jr.token, disable_telemetry_name_span))
-                {
-                    // found writable property : Disable Telemetry
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                    RETURN_ERR_IF_FAILED(az_json_token_get_uint32(&jr.token,
-                                                                  &twin_properties->telemetry_disable_flag));
-                    twin_properties->flag.telemetry_disable_found = 1;
-                }
-                else if (az_json_token_is_text_equal(&jr.token, iot_hub_property_desired_version))
-                {
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                }
-                else
-                {
-                    char   buffer[32];
-                    size_t spanSize = (size_t)az_span_size(jr.token.slice) + 1;
-                    size_t size     = sizeof(buffer) < spanSize ? sizeof(buffer) : spanSize;
-                    snprintf(buffer, size, "%s", az_span_ptr(jr.token.slice));
+    chunk_span = az_span_create(&twin_document_buffer[twin_document_length], chunk_length);
+    az_span_copy(chunk_span, az_span_create((uint8_t*)chunk, chunk_length));
+    twin_document_chunks[twin_document_chunk_count++] = chunk_span;
+    twin_document_length += chunk_length;
 
-                    debug_printWarn("AZURE: Received unknown property '%s'", buffer);
-                    RETURN_ERR_IF_FAILED(az_json_reader_next_token(&jr));
-                }
-                RETURN_ERR_WITH_MESSAGE_IF_FAILED((az_json_reader_next_token(&jr)), "az_json_reader_next_token() failed.");
-            }
-        }
+    if (offset + (uint32_t)chunk_length == total_length)
+    {
+        process_received_twin_document(twin_document_chunks, twin_document_chunk_count);
+        twin_document_chunk_count = 0;
+        twin_document_length      = 0;
     }
-#endif
-
-    return rc;
 }
 
 int32_t get_led_value(uint16_t led_flag)
@@ -1364,14 +2067,16 @@ int32_t get_led_value(uint16_t led_flag)
 /**********************************************
 * Create AZ Span for Reported Property Request ID 
 **********************************************/
-static az_span get_request_id(void)
+static az_span get_request_id(uint32_t* request_id)
 {
     az_span remainder;
     az_span out_span = az_span_create((uint8_t*)request_id_buffer,
                                       sizeof(request_id_buffer));
 
+    *request_id = request_id_int++;
+
     az_result rc = az_span_u32toa(out_span,
-                                  request_id_int++,
+                                  *request_id,
                                   &remainder);
 
     EXIT_WITH_MESSAGE_IF_FAILED(rc, "Failed to get request id");
@@ -1380,371 +2085,242 @@ static az_span get_request_id(void)
 }
 
 /**********************************************
-* Send Reported Property 
+* Queue Reported Properties
+* Takes the values picked by the twin property flags
+* into the reported property cache, and applies the
+* desired ones. check_reported_properties() sends the
+* changed values in one PATCH.
 **********************************************/
 az_result send_reported_property(
     twin_properties_t* twin_properties)
 {
-    az_result      rc;
-    az_json_writer jw;
-    az_span        identifier_span;
-    int32_t        led_property_value;
+    bool    is_initial_get = twin_properties->flag.is_initial_get == 1;
+    int32_t version        = twin_properties->version_num;
 
-    if (twin_properties->flag.as_uint16 == 0)
+    debug_printTrace("AZURE: Queue Property flag 0x%x", twin_properties->flag.as_uint16);
+
+    if (is_initial_get)
     {
-        // Nothing to do.
-        debug_printTrace("AZURE: No property update");
-        return AZ_OK;
+        // The twin may have changed while offline, report everything again
+        reported_cache_forget(&reported_cache);
     }
 
-    debug_printTrace("AZURE: Sending Property flag 0x%x", twin_properties->flag.as_uint16);
-
-    // Clear buffer and initialize JSON Payload. This creates "{"
-    memset(pnp_property_payload_buffer, 0, sizeof(pnp_property_payload_buffer));
-    az_span payload_span = AZ_SPAN_FROM_BUFFER(pnp_property_payload_buffer);
-
-    rc = start_json_object(&jw, payload_span);
-    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "AZURE:Unable to initialize json writer for property PATCH");
-
-    if (twin_properties->flag.telemetry_interval_found)
+    if (twin_properties->flag.telemetry_interval_found || is_initial_get)
     {
-        if (az_result_failed(
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    property_telemetry_interval_span,
-                    telemetryInterval,
-                    AZ_IOT_STATUS_OK,
-                    twin_properties->version_num,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    property_telemetry_interval_span,
-                    telemetryInterval)))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for telemetry interval, return code 0x%08x", rc);
-            return rc;
-        }
+        set_reported_property(REPORTED_TELEMETRY_INTERVAL,
+                              telemetryInterval,
+                              twin_properties->flag.telemetry_interval_found ? version : 1);
     }
-    else if (twin_properties->flag.is_initial_get)
-    {
-        if (az_result_failed(
 
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    property_telemetry_interval_span,
-                    telemetryInterval,
-                    AZ_IOT_STATUS_OK,
-                    1,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    property_telemetry_interval_span,
-                    telemetryInterval)))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for telemetry interval, return code 0x%08x", rc);
-            return rc;
-        }
-    }
-    // Add Yellow LED to the reported property
-    // Example with integer Enum
-    if (twin_properties->desired_led_yellow != LED_TWIN_NO_CHANGE)
+    if (twin_properties->flag.telemetry_batch_window_found || is_initial_get)
     {
-        led_property_value = get_led_value(led_status.state_flag.yellow);
-
-        if (az_result_failed(
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    led_yellow_property_name_span,
-                    led_property_value,
-                    AZ_IOT_STATUS_OK,
-                    twin_properties->version_num,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    led_yellow_property_name_span,
-                    led_property_value)))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for Yellow LED, return code 0x%08x", rc);
-            return rc;
-        }
+        set_reported_property(REPORTED_TELEMETRY_BATCH_WINDOW,
+                              telemetry_batch_window,
+                              twin_properties->flag.telemetry_batch_window_found ? version : 1);
     }
-    else if (twin_properties->flag.is_initial_get)
-    {
-        led_property_value = get_led_value(led_status.state_flag.yellow);
 
-        if (az_result_failed(
-
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    led_yellow_property_name_span,
-                    led_property_value,
-                    AZ_IOT_STATUS_OK,
-                    1,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    led_yellow_property_name_span,
-                    led_property_value)))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for Yellow LED, return code 0x%08x", rc);
-            return rc;
-        }
+    // Yellow LED, example with integer Enum
+    if (twin_properties->desired_led_yellow != LED_TWIN_NO_CHANGE || is_initial_get)
+    {
+        set_reported_property(REPORTED_LED_YELLOW,
+                              get_led_value(led_status.state_flag.yellow),
+                              twin_properties->desired_led_yellow != LED_TWIN_NO_CHANGE ? version : 1);
     }
 
-    // Set debug level
     if (twin_properties->flag.debug_level_found)
     {
         debug_setSeverity((debug_severity_t)twin_properties->debugLevel);
-
-        if (az_result_failed(
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    debug_level_property_name_span,
-                    (uint32_t)debug_getSeverity(),
-                    AZ_IOT_STATUS_OK,
-                    twin_properties->version_num,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    debug_level_property_name_span,
-                    (uint32_t)debug_getSeverity)))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for Debug Level, return code 0x%08x", rc);
-            return rc;
-        }
     }
-    else if (twin_properties->flag.is_initial_get)
-    {
-        if (az_result_failed(
 
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    debug_level_property_name_span,
-                    (uint32_t)debug_getSeverity(),
-                    AZ_IOT_STATUS_OK,
-                    1,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    debug_level_property_name_span,
-                    (uint32_t)debug_getSeverity())))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for Debug Level, return code 0x%08x", rc);
-            return rc;
-        }
+    if (twin_properties->flag.debug_level_found || is_initial_get)
+    {
+        set_reported_property(REPORTED_DEBUG_LEVEL,
+                              (int32_t)debug_getSeverity(),
+                              twin_properties->flag.debug_level_found ? version : 1);
     }
 
-    // Add Green LED
-    if (twin_properties->flag.is_initial_get || twin_properties->reported_led_yellow != LED_TWIN_NO_CHANGE)
+    // Green LED
+    if (twin_properties->reported_led_yellow != LED_TWIN_NO_CHANGE || is_initial_get)
     {
-        if (az_result_failed(
-                rc = append_json_property_int32(
-                    &jw,
-                    led_green_property_name_span,
-                    twin_properties->reported_led_yellow)))
-        {
-            debug_printError("AZURE: Unable to add property for Green LED, return code  0x%08x", rc);
-            return rc;
-        }
+        set_reported_property(REPORTED_LED_GREEN, twin_properties->reported_led_yellow, 0);
     }
 
-    // Add IP Address
-    if (twin_properties->flag.is_initial_get || twin_properties->flag.ip_address_updated != 0)
+    if (twin_properties->flag.ip_address_updated != 0 || is_initial_get)
     {
-        if (az_result_failed(
-                rc = append_json_property_string(
-                    &jw,
-                    ip_address_property_name_span,
-                    az_span_create_from_str((char*)&deviceIpAddress))))
-        {
-            debug_printError("AZURE: Unable to add property for IP Address, return code  0x%08x", rc);
-            return rc;
-        }
-
-        shared_networking_params.reported = 1;
+        set_reported_property(REPORTED_IP_ADDRESS,
+                              reported_string_hash(reported_property_string(REPORTED_IP_ADDRESS)),
+                              0);
     }
 
-    // Add properties from UART
+    // Properties from UART
     if (twin_properties->flag.app_property_1_updated != 0)
     {
-        if (az_result_failed(
-                rc = append_json_property_int32(
-                    &jw,
-                    app_property_1_name_span,
-                    twin_properties->app_property_1)))
-        {
-            debug_printError("AZURE: Unable to add property for App MCU Property 1, return code  0x%08x", rc);
-            return rc;
-        }
+        set_reported_property(REPORTED_APP_PROPERTY_1, twin_properties->app_property_1, 0);
     }
 
     if (twin_properties->flag.app_property_2_updated != 0)
     {
-        if (az_result_failed(
-                rc = append_json_property_int32(
-                    &jw,
-                    app_property_2_name_span,
-                    twin_properties->app_property_2)))
-        {
-            debug_printError("AZURE: Unable to add property for App MCU Property 2, return code  0x%08x", rc);
-            return rc;
-        }
+        set_reported_property(REPORTED_APP_PROPERTY_2, twin_properties->app_property_2, 0);
     }
 
-    if (twin_properties->flag.is_initial_get || twin_properties->flag.app_property_3_found != 0)
+    if (twin_properties->flag.app_property_3_found != 0)
     {
-        if (twin_properties->flag.app_property_3_found != 0)
-        {
-            char messageString[11 + 8 + 1]; // 11 for 'property 3,' + 8 for uint32 in string in hex + null
+        char messageString[11 + 8 + 1]; // 11 for 'property 3,' + 8 for uint32 in string in hex + null
 
-            sprintf(messageString, "property 3,%lx\4", twin_properties->app_property_3);
-            debug_disable(true);
-            SYS_CONSOLE_Message(0, messageString);
-            debug_disable(false);
+        sprintf(messageString, "property 3,%lx\4", twin_properties->app_property_3);
+        debug_disable(true);
+        SYS_CONSOLE_Message(0, messageString);
+        debug_disable(false);
 
-            if (az_result_failed(
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                    rc = append_reported_property_response_int32(
-                        &jw,
-                        app_property_3_name_span,
-                        twin_properties->app_property_3,
-                        AZ_IOT_STATUS_OK,
-                        twin_properties->version_num,
-                        resp_success_span)))
-#else
-                    rc = append_json_property_int32(
-                        &jw,
-                        app_property_3_name_span,
-                        twin_properties->app_property_3)))
-#endif
-            {
-                debug_printError("AZURE: Unable to add property for App MCU Property 3, return code 0x%08x", rc);
-                return rc;
-            }
-        }
+        set_reported_property(REPORTED_APP_PROPERTY_3, twin_properties->app_property_3, version);
     }
 
-    if (twin_properties->flag.is_initial_get || twin_properties->flag.app_property_4_found != 0)
+    if (twin_properties->flag.app_property_4_found != 0)
     {
-        if (twin_properties->flag.app_property_4_found != 0)
-        {
-            char messageString[11 + 8 + 1]; // 11 for 'property 3,' + 8 for uint32 in string in hex + null
+        char messageString[11 + 8 + 1]; // 11 for 'property 4,' + 8 for uint32 in string in hex + null
 
-            sprintf(messageString, "property 4,%lx\4", twin_properties->app_property_4);
-            debug_disable(true);
-            SYS_CONSOLE_Message(0, messageString);
-            debug_disable(false);
+        sprintf(messageString, "property 4,%lx\4", twin_properties->app_property_4);
+        debug_disable(true);
+        SYS_CONSOLE_Message(0, messageString);
+        debug_disable(false);
 
-            if (az_result_failed(
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                    rc = append_reported_property_response_int32(
-                        &jw,
-                        app_property_4_name_span,
-                        twin_properties->app_property_4,
-                        AZ_IOT_STATUS_OK,
-                        twin_properties->version_num,
-                        resp_success_span)))
-#else
-                    rc = append_json_property_int32(
-                        &jw,
-                        app_property_4_name_span,
-                        twin_properties->app_property_4)))
-#endif
-            {
-                debug_printError("AZURE: Unable to add property for App MCU Property 4, return code 0x%08x", rc);
-                return rc;
-            }
-        }
+        set_reported_property(REPORTED_APP_PROPERTY_4, twin_properties->app_property_4, version);
     }
 
-    if (twin_properties->flag.is_initial_get || twin_properties->flag.telemetry_disable_found != 0)
+    if (twin_properties->flag.telemetry_disable_found != 0 || is_initial_get)
     {
         telemetry_disable_flag = twin_properties->telemetry_disable_flag;
 
-        if (az_result_failed(
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-                rc = append_reported_property_response_int32(
-                    &jw,
-                    disable_telemetry_name_span,
-                    telemetry_disable_flag,
-                    AZ_IOT_STATUS_OK,
-                    twin_properties->version_num,
-                    resp_success_span)))
-#else
-                rc = append_json_property_int32(
-                    &jw,
-                    disable_telemetry_name_span,
-                    telemetry_disable_flag)))
-#endif
-        {
-            debug_printError("AZURE: Unable to add property for Telemetry Disabled Flag, return code 0x%08x", rc);
-            return rc;
-        }
+        set_reported_property(REPORTED_DISABLE_TELEMETRY,
+                              (int32_t)telemetry_disable_flag,
+                              twin_properties->flag.telemetry_disable_found ? version : 1);
     }
 
-    if (twin_properties->flag.is_initial_get)
+    if (is_initial_get)
     {
         tstrM2mRev fwInfo;
-        char firmwareString[18] = {0}; // 8bit + 8bit + 8bit + 16bit + 3 dots
 
         nm_get_firmware_full_info(&fwInfo);
 
-        sprintf(firmwareString, "%u.%u.%u.%u", 
+        sprintf(firmware_version_buffer, "%u.%u.%u.%u",
                     fwInfo.u8FirmwareMajor,
                     fwInfo.u8FirmwareMinor,
                     fwInfo.u8FirmwarePatch,
                     fwInfo.u16FirmwareSvnNum);
 
-        if (az_result_failed(
-                rc = append_json_property_string(
-                    &jw,
-                    fw_version_property_name_span,
-                    az_span_create_from_str((char*)&firmwareString))))
+        set_reported_property(REPORTED_FIRMWARE_VERSION,
+                              reported_string_hash(reported_property_string(REPORTED_FIRMWARE_VERSION)),
+                              0);
+    }
+
+    return AZ_OK;
+}
+
+/**********************************************
+* Twin request round trip times, e.g.
+* "twinDiagnostics": {
+*   "rttBucketMs": 64,
+*   "getRtt": [0, 0, 0, 0, 0, 0, 0, 0],
+*   "patchRtt": [12, 30, 4, 1, 0, 0, 0, 0],
+*   "timeouts": 1,
+*   "unmatched": 0
+* }
+* Bucket n counts round trips below rttBucketMs << n,
+* the last one all longer ones.
+**********************************************/
+static az_result append_twin_diagnostics(
+    az_json_writer* jw,
+    az_span         property_name_span)
+{
+    static const az_span kind_name_spans[TWIN_REQUEST_KIND_COUNT] = {
+        AZ_SPAN_LITERAL_FROM_STR("getRtt"),
+        AZ_SPAN_LITERAL_FROM_STR("patchRtt"),
+    };
+    int32_t kind;
+    int32_t bucket;
+
+    RETURN_ERR_IF_FAILED(az_json_writer_append_property_name(jw, property_name_span));
+    RETURN_ERR_IF_FAILED(az_json_writer_append_begin_object(jw));
+    RETURN_ERR_IF_FAILED(append_json_property_int32(jw, AZ_SPAN_FROM_STR("rttBucketMs"), TWIN_REQUEST_RTT_BUCKET_MS));
+
+    for (kind = 0; kind < TWIN_REQUEST_KIND_COUNT; kind++)
+    {
+        RETURN_ERR_IF_FAILED(az_json_writer_append_property_name(jw, kind_name_spans[kind]));
+        RETURN_ERR_IF_FAILED(az_json_writer_append_begin_array(jw));
+
+        for (bucket = 0; bucket < TWIN_REQUEST_RTT_BUCKETS; bucket++)
         {
-            debug_printError("AZURE: Unable to add property for Firmware Version, return code  0x%08x", rc);
-            return rc;
+            RETURN_ERR_IF_FAILED(az_json_writer_append_int32(jw, twin_requests.rtt_histogram[kind][bucket]));
         }
+
+        RETURN_ERR_IF_FAILED(az_json_writer_append_end_array(jw));
     }
 
-    // Close JSON Payload (appends "}")
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    if (az_result_failed(rc = az_iot_pnp_client_property_builder_end_reported_status(&pnp_client, &jw)))
-#else
-    if (az_result_failed(rc = az_json_writer_append_end_object(&jw)))
-#endif
+    RETURN_ERR_IF_FAILED(append_json_property_int32(jw, AZ_SPAN_FROM_STR("timeouts"), twin_requests.timeouts));
+    RETURN_ERR_IF_FAILED(append_json_property_int32(jw, AZ_SPAN_FROM_STR("unmatched"), twin_requests.unmatched));
+
+    return az_json_writer_append_end_object(jw);
+}
+
+static az_result append_reported_property(
+    az_json_writer*        jw,
+    reported_property_id_t id)
+{
+    const reported_property_t*    property = &reported_property_table[id];
+    const reported_cache_value_t* reported = &reported_cache.values[id];
+
+    if (id == REPORTED_TWIN_DIAGNOSTICS)
     {
-        debug_printError("AZURE: Unable to append end object, return code  0x%08x", rc);
-        return rc;
+        reported_cache_sent(&reported_cache, id, twin_diagnostics_hash(), 0);
+        return append_twin_diagnostics(jw, property->name);
     }
 
-    az_span property_payload_span = az_json_writer_get_bytes_used_in_destination(&jw);
-   
-    if (az_span_size(property_payload_span) > sizeof(pnp_property_payload_buffer))
+    if (property->is_string)
     {
-        debug_printError("AZURE: Payload too long : %d", az_span_size(property_payload_span));
-        return AZ_ERROR_NOT_ENOUGH_SPACE;
+        az_span value_span = reported_property_string(id);
+
+        // the string may have changed since it was queued, remember what actually went out
+        reported_cache_sent(&reported_cache, id, reported_string_hash(value_span), 0);
+
+        if (id == REPORTED_IP_ADDRESS)
+        {
+            shared_networking_params.reported = 1;
+        }
+
+        return append_json_property_string(jw, property->name, value_span);
     }
 
-    // Publish the reported property payload to IoT Hub
-    identifier_span = get_request_id();
+    reported_cache_sent(&reported_cache, id, reported->value, reported->version);
+
+#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
+    if (property->is_writable)
+    {
+        return append_reported_property_response_int32(jw,
+                                                        property->name,
+                                                        reported->value,
+                                                        AZ_IOT_STATUS_OK,
+                                                        reported->version,
+                                                        resp_success_span);
+    }
+#endif
+
+    return append_json_property_int32(jw, property->name, reported->value);
+}
+
+/**********************************************
+* Send the dirty reported properties in one PATCH,
+* straight from the MQTT send buffer
+**********************************************/
+static az_result publish_reported_properties(void)
+{
+    az_result              rc;
+    az_json_writer         jw;
+    az_span                identifier_span;
+    az_span                payload_span;
+    uint32_t               request_id;
+    reported_property_id_t id;
+
+    identifier_span = get_request_id(&request_id);
 
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
     rc = az_iot_pnp_client_property_patch_get_publish_topic(&pnp_client,
@@ -1757,158 +2333,338 @@ az_result send_reported_property(
                                                             NULL);
     RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "AZURE:Failed to get property PATCH topic");
 
-    // Send the reported property
+    payload_span = reserve_publish_payload(pnp_property_topic_buffer, 1);
+
+    if (az_span_size(payload_span) == 0)
+    {
+        // not connected, try again after the next debounce window
+        return AZ_ERROR_NOT_ENOUGH_SPACE;
+    }
 
-    CLOUD_publishData((uint8_t*)pnp_property_topic_buffer,
-                     az_span_ptr(property_payload_span),
-                   az_span_size(property_payload_span),
-                  1);
+    // This creates "{"
+    rc = start_json_object(&jw, payload_span);
+    RETURN_ERR_WITH_MESSAGE_IF_FAILED(rc, "AZURE:Unable to initialize json writer for property PATCH");
 
-    return rc;
+    for (id = 0; id < REPORTED_PROPERTY_COUNT; id++)
+    {
+        if ((reported_cache.dirty & REPORTED_CACHE_BIT(id)) == 0)
+        {
+            continue;
+        }
+
+        if (az_result_failed(rc = append_reported_property(&jw, id)))
+        {
+            debug_printError("AZURE: Unable to add property %s, return code 0x%08x",
+                             az_span_ptr(reported_property_table[id].name),
+                             rc);
+            return rc;
+        }
+    }
+
+    // Close JSON Payload (appends "}")
+    if (az_result_failed(rc = az_json_writer_append_end_object(&jw)))
+    {
+        debug_printError("AZURE: Unable to append end object, return code  0x%08x", rc);
+        return rc;
+    }
+
+    payload_span = az_json_writer_get_bytes_used_in_destination(&jw);
+
+    debug_printTrace("AZURE: Property PATCH %lu : %.*s",
+                     request_id,
+                     az_span_size(payload_span),
+                     az_span_ptr(payload_span));
+
+    if (CLOUD_publishCommit(az_span_size(payload_span)) != SUCCESS)
+    {
+        // not sent, try again after the next debounce window
+        return AZ_ERROR_CANCELED;
+    }
+
+    reported_cache_in_flight(&reported_cache, request_id);
+    twin_request_add(&twin_requests,
+                     request_id,
+                     TWIN_REQUEST_PATCH,
+                     twin_request_hash(az_span_ptr(payload_span), az_span_size(payload_span)),
+                     twin_request_now_ms());
+
+    return AZ_OK;
+}
+
+/**********************************************
+* Called by the MQTT task when the SUBACK of the
+* twin response topic arrives, and with false when
+* a new MQTT session starts. Requests are neither
+* timed out nor sent while no response can arrive.
+**********************************************/
+void set_twin_responses_subscribed(bool subscribed)
+{
+    if (subscribed && !twin_responses_subscribed)
+    {
+        // the first diagnostics go out one interval after the subscription
+        TimerInit(&reported_diagnostics_timer);
+        TimerCountdownMS(&reported_diagnostics_timer, REPORTED_DIAGNOSTICS_INTERVAL_MS);
+    }
+
+    twin_responses_subscribed = subscribed;
 }
 
+/**********************************************
+* Send the reported properties changed since the
+* last acknowledged PATCH, once their debounce
+* window has passed. Only one PATCH is in flight
+* at a time; one without a response is sent again
+* after TWIN_REQUEST_TIMEOUT_MS. The twin request
+* round trip times are reported every
+* REPORTED_DIAGNOSTICS_INTERVAL_MS when they changed.
+* Nothing happens until the twin responses are
+* subscribed, see set_twin_responses_subscribed().
+**********************************************/
+void check_reported_properties(void)
+{
+    twin_request_t request;
+
+    if (!twin_responses_subscribed)
+    {
+        return;
+    }
+
+    while (twin_request_expire(&twin_requests, twin_request_now_ms(), TWIN_REQUEST_TIMEOUT_MS, &request))
+    {
+        debug_printWarn("AZURE: No response to twin request %lu, payload hash 0x%08lx",
+                        request.request_id,
+                        request.payload_hash);
+
+        // A lost PATCH leaves its values dirty, they go out again
+        reported_cache_lost(&reported_cache, request.request_id);
+    }
+
+    if (TimerIsExpired(&reported_diagnostics_timer))
+    {
+        TimerCountdownMS(&reported_diagnostics_timer, REPORTED_DIAGNOSTICS_INTERVAL_MS);
+        set_reported_property(REPORTED_TWIN_DIAGNOSTICS, twin_diagnostics_hash(), 0);
+    }
+
+    if (!reported_cache_due(&reported_cache, twin_request_now_ms()))
+    {
+        return;
+    }
+
+    if (az_result_failed(publish_reported_properties()))
+    {
+        reported_cache_retry(&reported_cache, twin_request_now_ms());
+    }
+}
+
+/**********************************************
+* Start a telemetry message for values from the
+* UART in the MQTT send buffer
+**********************************************/
+static az_result start_uart_telemetry(az_json_writer* jw)
+{
+    az_result rc;
+
+#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
+    rc = az_iot_pnp_client_telemetry_get_publish_topic(&pnp_client,
+                                                       AZ_SPAN_EMPTY,
+#else
+    rc = az_iot_hub_client_telemetry_get_publish_topic(&iothub_client,
+#endif
+                                                       NULL,
+                                                       pnp_uart_telemetry_topic_buffer,
+                                                       sizeof(pnp_uart_telemetry_topic_buffer),
+                                                       NULL);
+
+    if (az_result_failed(rc))
+    {
+        return rc;
+    }
+
+    return start_json_object(jw, reserve_publish_payload(pnp_uart_telemetry_topic_buffer, 1));
+}
+
+/**********************************************
+* Send the telemetry message built in the MQTT
+* send buffer
+**********************************************/
+static void send_uart_telemetry(az_json_writer* jw)
+{
+    az_span telemetry_payload_span;
+
+    end_json_object(jw);
+    telemetry_payload_span = az_json_writer_get_bytes_used_in_destination(jw);
+
+    CLOUD_publishCommit(az_span_size(telemetry_payload_span));
+}
+
+/**********************************************
+* Add a JSON key-value pair for a value from the
+* UART, named after its telemetry index
+**********************************************/
+static az_result append_uart_telemetry_value(
+    az_json_writer*    jw,
+    dti_value_t const* value)
+{
+    az_span name_span = telemetry_name_table[value->index];
+
+    switch (value->type)
+    {
+        case DTI_VALUE_INT32:
+            return append_json_property_int32(jw, name_span, value->as.i32);
+
+        case DTI_VALUE_DOUBLE:
+            return append_json_property_double(jw, name_span, value->as.f64);
+
+        case DTI_VALUE_FLOAT:
+            return append_json_property_float(jw, name_span, value->as.f32);
+
+        case DTI_VALUE_INT64:
+            return append_json_property_long(jw, name_span, value->as.i64);
+
+        case DTI_VALUE_BOOL:
+            return append_json_property_bool(jw, name_span, value->as.b);
+
+        default:
+            return append_json_property_string(jw,
+                                               name_span,
+                                               az_span_create((uint8_t*)value->as.string.ptr, value->as.string.length));
+    }
+}
+
+/**********************************************
+* Send one telemetry value given as text by the
+* DTI 'T' / 't' commands. Numbers are hex, floats
+* and doubles carry their IEEE bits.
+**********************************************/
 bool process_telemetry_command(int cmdIndex, char* data)
 {
-    az_result      rc = AZ_OK;
     az_json_writer jw;
-    char           telemetry_name_buffer[64];
-    az_span        telemetry_name_span;
-    az_span        telemetry_payload_span;
+    dti_value_t    value;
+    uint64_t       bits;
+    uint32_t       bits32;
 
-    memset(&pnp_uart_telemetry_payload_buffer, 0, sizeof(pnp_uart_telemetry_payload_buffer));
-    start_json_object(&jw, AZ_SPAN_FROM_BUFFER(pnp_uart_telemetry_payload_buffer));
+    if (cmdIndex == 0)
+    {
+        // Reset the DTI command buffer pointer to the start of the array
+        return true;
+    }
+
+    if (cmdIndex < 0 || cmdIndex > DTI_TELEMETRY_INDEX_MAX)
+    {
+        debug_printError("AZURE: Unknown telemetry index %d", cmdIndex);
+        return true;
+    }
+
+    value.index = (uint8_t)cmdIndex;
 
     switch (cmdIndex)
     {
-        case 0:
-            // Reset the DTI command buffer pointer to the start of the array
-            
-            return true;
-        break;
         case 1:
         case 2:
         case 3:
         case 4:
-        {
-            // integer
             // A signed 4-byte integer
-            int32_t data_i = strtoll(data, 0, 16);
-            sprintf(telemetry_name_buffer, "telemetry_Int_%d", cmdIndex);
-            telemetry_name_span = az_span_create_from_str((char*)telemetry_name_buffer);
-            append_json_property_int32(&jw, telemetry_name_span, data_i);
-        }
-        break;
+            value.type   = DTI_VALUE_INT32;
+            value.as.i32 = (int32_t)strtoul(data, 0, 16);
+            break;
 
         case 5:
         case 6:
-        {
-            // double
             // An IEEE 8-byte floating point
-            uint64_t data_d = strtoll(data, 0, 16);
-            sprintf(telemetry_name_buffer, "telemetry_Dbl_%d", cmdIndex - 4);
-            telemetry_name_span = az_span_create_from_str((char*)telemetry_name_buffer);
-            append_json_property_double(&jw, telemetry_name_span, data_d);
-        }
-        break;
+            value.type = DTI_VALUE_DOUBLE;
+            bits       = strtoull(data, 0, 16);
+            memcpy(&value.as.f64, &bits, sizeof(bits));
+            break;
+
         case 7:
         case 8:
-        {
-            // float
             // An IEEE 4-byte floating point
-            uint32_t data_l = strtol(data, 0, 16);
-
-            float negative = ((data_l >> 31) & 0x1) ? -1.0000 : 1.0000;
-            uint32_t exponent = (data_l & 0x7F800000) >> 23;
-            uint32_t mantissa = data_l &  0x007FFFFF;
-
-            float data_f = (float)(1.00000 + mantissa  / (2 << 22));
-            data_f  = (float)(negative * (data_f * (2 << ((exponent - 127) - 1))));
+            value.type = DTI_VALUE_FLOAT;
+            bits32     = strtoul(data, 0, 16);
+            memcpy(&value.as.f32, &bits32, sizeof(bits32));
+            break;
 
-            sprintf(telemetry_name_buffer, "telemetry_Flt_%d", cmdIndex - 6);
-            telemetry_name_span = az_span_create_from_str((char*)telemetry_name_buffer);
-            append_json_property_float(&jw, telemetry_name_span, data_f);
-        }
-        break;
         case 9:
-        {
-            // long
             // A signed 8-byte integer
-            int64_t data_l = (int64_t)strtoll(data, 0, 16);
-            append_json_property_long(&jw, telemetry_name_long, data_l);
-        }
-        break;
+            value.type   = DTI_VALUE_INT64;
+            value.as.i64 = (int64_t)strtoull(data, 0, 16);
+            break;
+
         case 10:
-        {
-            // bool
-            bool bValue;
+            value.type = DTI_VALUE_BOOL;
 
             if (strcmp(data, "true") == 0)
             {
-                bValue = true;
+                value.as.b = true;
             }
             else if (strcmp(data, "false") == 0)
             {
-                bValue = false;
+                value.as.b = false;
             }
             else
             {
                 debug_printError("AZURE: Case sensitive boolean value not 'true' or 'false' : %s", data);
-                break;
+                return true;
             }
-            append_json_property_bool(&jw, telemetry_name_bool, bValue);
-        }
-        break;
-        case 11:
-        {
-            // string #1
-            append_json_property_string(&jw, telemetry_name_string_1, az_span_create_from_str(data));
-        }
-        break;
-        case 12:
-        {
-            // string #2
-            append_json_property_string(&jw, telemetry_name_string_2, az_span_create_from_str(data));
-        }
-        break;
-        case 13:
-        {
-            // string #3
-            append_json_property_string(&jw, telemetry_name_string_3, az_span_create_from_str(data));
-        }
-        break;
-        case 14:
-        {
-            // string #4
-            append_json_property_string(&jw, telemetry_name_string_4, az_span_create_from_str(data));
-        }
-        break;
+            break;
+
+        default:
+            value.type = DTI_VALUE_STRING;
+            value.as.string.ptr    = (const uint8_t*)data;
+            value.as.string.length = (uint16_t)strnlen(data, DTI_PAYLOADDATA_NUMBYTES);
+            break;
     }
 
-    end_json_object(&jw);
-    telemetry_payload_span = az_json_writer_get_bytes_used_in_destination(&jw);
+    if (az_result_failed(start_uart_telemetry(&jw)))
+    {
+        return true;
+    }
 
-#ifdef IOT_PLUG_AND_PLAY_MODEL_ID
-    rc = az_iot_pnp_client_telemetry_get_publish_topic(&pnp_client,
-                                                       AZ_SPAN_EMPTY,
-#else
-    rc = az_iot_hub_client_telemetry_get_publish_topic(&iothub_client,
-#endif
-                                                       NULL,
-                                                       pnp_uart_telemetry_topic_buffer,
-                                                       sizeof(pnp_uart_telemetry_topic_buffer),
-                                                       NULL);
+    if (az_result_failed(append_uart_telemetry_value(&jw, &value)))
+    {
+        debug_printError("AZURE: Telemetry %d does not fit the MQTT buffer", cmdIndex);
+        return true;
+    }
 
-    if (az_result_succeeded(rc))
+    send_uart_telemetry(&jw);
+
+    return true;
+}
+
+/**********************************************
+* Send the values of a binary DTI frame, see
+* dti_frame.h, as one telemetry message. A frame
+* failing its CRC or layout check is dropped.
+**********************************************/
+bool process_telemetry_frame(const uint8_t* frame, uint32_t length)
+{
+    az_json_writer     jw;
+    dti_frame_reader_t reader;
+    dti_value_t        value;
+
+    if (!dti_frame_open(&reader, frame, length))
     {
+        debug_printError("AZURE: Bad DTI frame, %lu bytes", length);
+        return false;
+    }
 
-      CLOUD_publishData((uint8_t*)pnp_uart_telemetry_topic_buffer,
-                    az_span_ptr(telemetry_payload_span),
-                   az_span_size(telemetry_payload_span),
-                   1);
+    if (az_result_failed(start_uart_telemetry(&jw)))
+    {
+        return true;
     }
 
-    return true;
+    while (dti_frame_next(&reader, &value))
+    {
+        if (az_result_failed(append_uart_telemetry_value(&jw, &value)))
+        {
+            debug_printError("AZURE: DTI frame does not fit the MQTT buffer");
+            return true;
+        }
+    }
+
+    send_uart_telemetry(&jw);
 
+    return true;
 }
 
 bool send_property_from_uart(int cmdIndex, char* data)
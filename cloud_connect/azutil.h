@@ -14,6 +14,7 @@
 #include "azure/core/az_json.h"
 #include "azure/core/az_http.h"
 #include "azure/iot/az_iot_pnp_client.h"
+#include "direct_method_router.h"
 
 #define LED_TWIN_NO_CHANGE (-1)
 #define LED_TWIN_ON        (1)
@@ -103,7 +104,8 @@ typedef union
         uint16_t app_property_3_found : 1;
         uint16_t app_property_4_found : 1;
         uint16_t telemetry_disable_found : 1;
-        uint16_t reserved : 5;
+        uint16_t telemetry_batch_window_found : 1;
+        uint16_t reserved : 4;
     };
     uint16_t as_uint16;
 } twin_update_flag_t;
@@ -168,9 +170,28 @@ void check_button_status(void);
 
 az_result send_telemetry_message(void);
 
+void check_telemetry_batch(void);
+
+void check_telemetry_replay(void);
+
+void process_publish_complete(
+    uint16_t packet_id,
+    int      rc);
+
 az_result send_reported_property(
     twin_properties_t* twin_properties);
 
+void set_twin_responses_subscribed(bool subscribed);
+
+void check_reported_properties(void);
+
+bool register_direct_method(
+    az_span                 name_span,
+    direct_method_handler_t handler,
+    int32_t                 defer_ms);
+
+void check_direct_methods(void);
+
 az_result process_direct_method_command(
     uint8_t*                           payload,
 #ifdef IOT_PLUG_AND_PLAY_MODEL_ID
@@ -185,12 +206,34 @@ az_result process_device_twin_property(
     uint8_t*           payload,
     twin_properties_t* twin_properties);
 
+az_result process_device_twin_property_chunks(
+    uint8_t*           topic,
+    az_span            payload_chunks[],
+    int32_t            chunk_count,
+    twin_properties_t* twin_properties);
+
+void receive_device_twin_chunk(
+    const uint8_t* topic,
+    int32_t        topic_length,
+    const uint8_t* chunk,
+    int32_t        chunk_length,
+    uint32_t       offset,
+    uint32_t       total_length);
+
 void update_leds(twin_properties_t* twin_properties);
 
+// DTI commands from the SERCOM3 UART, see dti.h. The task that reads and
+// splits the DTI stream is not part of this tree, so these have no caller
+// here. It hands process_telemetry_frame() a binary frame once it has read
+// dti_frame_length() bytes of it, and the hex commands to the other two.
 bool process_telemetry_command(
     int   cmdIndex,
     char* data);
 
+bool process_telemetry_frame(
+    const uint8_t* frame,
+    uint32_t       length);
+
 bool send_property_from_uart(
     int   cmdIndex,
     char* data);
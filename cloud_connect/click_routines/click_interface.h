@@ -74,7 +74,8 @@
 #define CLICK_HEARTRATE9_USART_ReadCallbackRegister          SERCOM0_USART_ReadCallbackRegister
 #define CLICK_HEARTRATE9_USART_ReadCountGet                  SERCOM0_USART_ReadCountGet
 #define CLICK_HEARTRATE9_USART_EVENT_READ_THRESHOLD_REACHED  SERCOM_USART_EVENT_READ_THRESHOLD_REACHED
-#define CLICK_HEARTRATE9_USART_READ_BUFFER_SIZE              128                 //Define value same as SERCOM0_USART_READ_BUFFER_SIZE defined in the respective USART PLIB '.c' file
+#define CLICK_HEARTRATE9_USART_EVENT_READ_BUFFER_FULL        SERCOM_USART_EVENT_READ_BUFFER_FULL
+#define CLICK_HEARTRATE9_USART_READ_BUFFER_SIZE              512                 //Define value same as SERCOM0_USART_READ_BUFFER_SIZE defined in the respective USART PLIB '.c' file
 
 // Timer Definitions
 #define CLICK_HEARTRATE9_TimerStart                         SYSTICK_TimerStart
@@ -51,82 +51,55 @@
 #include "definitions.h"                // SYS function prototypes
 #include "../click_interface.h"
 #include "heartrate9.h"
+#include "heartrate9_parser.h"
 
 /**
-  Section: Macro Declarations
+  Section: Variable Definitions
  */
-#define RECEIVE_BUFFER_SIZE     (CLICK_HEARTRATE9_USART_READ_BUFFER_SIZE * 10)
 
-typedef enum
-{
-    HEADER_BYTE1 = 0,
-    HEADER_BYTE2,
-    HEADER_BYTE3,
-    HEART_RATE_BYTE_POS_FIND,
-    HEART_RATE_READ,
-}HEART_RATE_DATA_BUF_PROCESS_STATE;
+/* Received bytes stay in the PLIB ring buffer until heartrate9_task() reads
+ * them out in chunks of this size and parses them from the stack */
+#define HEARTRATE9_READ_CHUNK_SIZE      32
 
-/**
-  Section: Variable Definitions
- */
-static HEART_RATE_DATA_BUF_PROCESS_STATE    heartrate9_read_byte_state = HEADER_BYTE1;
-
-static volatile char rx_data[CLICK_HEARTRATE9_USART_READ_BUFFER_SIZE]   = {0};
-static volatile char rx_buff[RECEIVE_BUFFER_SIZE]   = {0};
-static volatile uint16_t rx_buff_in_index           = 0;
-static          uint16_t rx_buff_out_index          = 0;
-static          bool hr9_click_intrfce_initialized  = false;
-static          bool hr9_rx_data_buf_clr_state      = false;
-static          uint16_t heartrate_pross_cnt        = 0;
-static volatile bool hr9_data_rx_flag               = false;
-static volatile uint32_t no_of_bytes_rcvd = 0;
+static volatile uint32_t hr9_rx_dropped = 0;
+
+static heartrate9_parser_t  hr9_parser;
+static bool                 hr9_click_intrfce_initialized = false;
+
+/* Readings waiting for the telemetry. Both ends run in the task loop, so a
+ * full queue drops its oldest reading to keep the newest. */
+static heartrate9_sample_t  hr9_samples[HEARTRATE9_SAMPLE_QUEUE_SIZE];
+static uint32_t             hr9_sample_head     = 0;
+static uint32_t             hr9_sample_tail     = 0;
+static uint32_t             hr9_sample_dropped  = 0;
 
 /**
   Section: Private function prototypes
  */
 
-static void heartrate9_click_initialize(void);
 static void heartrate9_set_rst(uint8_t state);
-static void heartrate9_click_initialize(void);
-static void hr9_rx_buff_update(void);
+static void heartrate9_sample_put(uint8_t bpm);
 
 /**
   Section: Driver APIs
  */
 
-static void hr9_rx_buff_update(void)
+static void heartrate9_read_flush(void)
 {
-    if(true == hr9_data_rx_flag)
+    uint8_t chunk[HEARTRATE9_READ_CHUNK_SIZE];
+
+    while (CLICK_HEARTRATE9_USART_Read(chunk, sizeof(chunk)) != 0)
     {
-        hr9_data_rx_flag = false;
-        if((rx_buff_in_index + no_of_bytes_rcvd) >= RECEIVE_BUFFER_SIZE)
-        {
-            memcpy((char *)&rx_buff[rx_buff_in_index], (char *)rx_data, (RECEIVE_BUFFER_SIZE - rx_buff_in_index));
-            memcpy((char *)rx_buff, (char *)&rx_data[RECEIVE_BUFFER_SIZE - rx_buff_in_index], (rx_buff_in_index + no_of_bytes_rcvd - RECEIVE_BUFFER_SIZE));
-        }
-        else
-        {
-            memcpy((char *)&rx_buff[rx_buff_in_index], (char *)rx_data, no_of_bytes_rcvd);
-        }
-        
-        rx_buff_in_index += no_of_bytes_rcvd;
-        if(rx_buff_in_index >= RECEIVE_BUFFER_SIZE)
-        {
-            rx_buff_in_index = rx_buff_in_index - RECEIVE_BUFFER_SIZE;
-        }
     }
 }
+
 static void heartrate9_ReadCallback(SERCOM_USART_EVENT event, uintptr_t context)
 {
-    uint32_t nBytesAvailable = 0;
-    
-    if (event == CLICK_HEARTRATE9_USART_EVENT_READ_THRESHOLD_REACHED)
+    /* Called from the ISR for every byte that finds the ring buffer full, the
+     * byte is lost and the parser resynchronizes on the next record */
+    if (event == CLICK_HEARTRATE9_USART_EVENT_READ_BUFFER_FULL)
     {
-        /* Receiver should atleast have the thershold number of bytes in the ring buffer */
-        nBytesAvailable = CLICK_HEARTRATE9_USART_ReadCountGet();
-        
-        no_of_bytes_rcvd = CLICK_HEARTRATE9_USART_Read((uint8_t*)&rx_data[0], nBytesAvailable);
-        hr9_data_rx_flag = true;
+        hr9_rx_dropped++;
     }
 }
 
@@ -138,135 +111,80 @@ static void heartrate9_set_rst(uint8_t state)
         WDRV_WINC_RESETN_Clear();
 }
 
-static void heartrate9_click_initialize(void)
+static void heartrate9_sample_put(uint8_t bpm)
 {
-    /* Register callback functions and send start message */
+    heartrate9_sample_t *sample;
+
+    if ((hr9_sample_head - hr9_sample_tail) == HEARTRATE9_SAMPLE_QUEUE_SIZE)
+    {
+        hr9_sample_tail++;
+        hr9_sample_dropped++;
+    }
+
+    sample          = &hr9_samples[hr9_sample_head & (HEARTRATE9_SAMPLE_QUEUE_SIZE - 1)];
+    sample->bpm     = bpm;
+    sample->time_ms = (uint32_t)(SYS_TIME_Counter64Get() * 1000 / SYS_TIME_FrequencyGet());
+    hr9_sample_head++;
+}
+
+void heartrate9_initialize(void)
+{
+    heartrate9_parser_init(&hr9_parser);
+
+    /* Register callback functions, drop what came in before and start */
     CLICK_HEARTRATE9_USART_ReadCallbackRegister(heartrate9_ReadCallback, 0);
-    CLICK_HEARTRATE9_USART_Read((uint8_t*)rx_buff, RECEIVE_BUFFER_SIZE);
-    CLICK_HEARTRATE9_USART_ReadThresholdSet(10);
-    CLICK_HEARTRATE9_USART_ReadNotificationEnable(true, false);
+    heartrate9_read_flush();
     CLICK_HEARTRATE9_TimerStart();
     heartrate9_set_rst(0);
     CLICK_HEARTRATE9_DelayMs(1);
     heartrate9_set_rst(1);
-}
-
-bool is_heartrate9_byte_ready(void)
-{
-    if (false == hr9_click_intrfce_initialized)
-    {
-        heartrate9_click_initialize();
-        hr9_click_intrfce_initialized  = true;
-        return true;
-    }
-    if (false == hr9_rx_data_buf_clr_state)
-    {
-        CLICK_HEARTRATE9_DelayMs(5000);
-        memset((char*)rx_buff, 0x00, RECEIVE_BUFFER_SIZE);
-        hr9_rx_data_buf_clr_state  = true;
-        rx_buff_in_index     = 0;
-        rx_buff_out_index    = 0;
-        hr9_data_rx_flag     = false;
-    }
-    while((rx_buff_in_index == rx_buff_out_index) && (false == hr9_data_rx_flag));
 
-    return true;
+    hr9_click_intrfce_initialized = true;
 }
 
-int8_t heartrate9_read_byte(void)
+void heartrate9_task(void)
 {
-    static uint8_t current_heartrate = 0;
-    static uint8_t semicoln_cnt = 0;
-    uint16_t lcl_rx_buff_in_index = rx_buff_in_index;
+    uint8_t       chunk[HEARTRATE9_READ_CHUNK_SIZE];
+    const uint8_t *next;
+    size_t        length;
+    uint8_t       bpm;
 
-    hr9_rx_buff_update();
-    if(rx_buff_out_index > lcl_rx_buff_in_index)
+    if (false == hr9_click_intrfce_initialized)
     {
-        lcl_rx_buff_in_index    = RECEIVE_BUFFER_SIZE;
+        heartrate9_initialize();
     }
-    while(rx_buff_out_index < lcl_rx_buff_in_index)
+
+    /* The parser keeps its state between chunks, so a record may span two */
+    while ((length = CLICK_HEARTRATE9_USART_Read(chunk, sizeof(chunk))) != 0)
     {
-        switch(heartrate9_read_byte_state)
+        next = chunk;
+
+        while (heartrate9_parser_feed(&hr9_parser, &next, chunk + length, &bpm))
         {
-            case HEADER_BYTE1:
-                for(; rx_buff_out_index < lcl_rx_buff_in_index; rx_buff_out_index++)
-                {
-                    if(rx_buff[rx_buff_out_index] == '1')
-                    {
-                        heartrate9_read_byte_state  = HEADER_BYTE2;
-                        rx_buff_out_index++;
-                        break;
-                    }
-                }
-                break;
-            case HEADER_BYTE2:
-                if(rx_buff[rx_buff_out_index] == '5')
-                {
-                    heartrate9_read_byte_state  = HEADER_BYTE3;
-                }
-                else
-                {
-                    heartrate9_read_byte_state  = HEADER_BYTE1;
-                }
-                rx_buff_out_index++;
-                break;
-            case HEADER_BYTE3:
-                if(rx_buff[rx_buff_out_index] == ';')
-                {
-                    heartrate9_read_byte_state  = HEART_RATE_BYTE_POS_FIND;
-                }
-                else
-                {
-                    heartrate9_read_byte_state  = HEADER_BYTE1;
-                }
-                rx_buff_out_index++;
-                break;
-            case HEART_RATE_BYTE_POS_FIND:
-                for(; rx_buff_out_index < lcl_rx_buff_in_index; rx_buff_out_index++)
-                {
-                    if(rx_buff[rx_buff_out_index] == ';')
-                    {
-                        semicoln_cnt++;
-                        if(semicoln_cnt == 3)
-                        {
-                            semicoln_cnt                = 0;
-                            rx_buff_out_index++;
-                            current_heartrate           = 0;
-                            heartrate9_read_byte_state  = HEART_RATE_READ;
-                            break;
-                        }
-                    }
-                }
-                break;
-            case HEART_RATE_READ:
-                for(; rx_buff_out_index < lcl_rx_buff_in_index; rx_buff_out_index++)
-                {
-                    if(rx_buff[rx_buff_out_index] != ';')
-                    {
-                        current_heartrate   = (current_heartrate * 10) + (rx_buff[rx_buff_out_index] - 0x30);
-                    }
-                    else
-                    {
-                        heartrate9_read_byte_state  = HEADER_BYTE1;
-                        heartrate_pross_cnt++;
-                        if(heartrate_pross_cnt == 100)
-                        {
-                            heartrate_pross_cnt         = 0;
-                            hr9_rx_data_buf_clr_state   = false;
-                            return((int8_t)current_heartrate);
-                        }
-                        break;
-                    }
-                }
-                break;
-            default:
-                break;
+            heartrate9_sample_put(bpm);
         }
     }
-    if(rx_buff_out_index == RECEIVE_BUFFER_SIZE)
+}
+
+bool heartrate9_sample_get(heartrate9_sample_t *sample)
+{
+    if (hr9_sample_head == hr9_sample_tail)
     {
-        rx_buff_out_index = 0;
+        return false;
     }
 
-    return(-1);
+    *sample = hr9_samples[hr9_sample_tail & (HEARTRATE9_SAMPLE_QUEUE_SIZE - 1)];
+    hr9_sample_tail++;
+
+    return true;
+}
+
+uint32_t heartrate9_samples_dropped(void)
+{
+    return hr9_sample_dropped;
+}
+
+uint32_t heartrate9_bytes_dropped(void)
+{
+    return hr9_rx_dropped;
 }
@@ -51,22 +51,53 @@
  */
 
 #include <xc.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+/**
+  Section: Macro Declarations
+ */
+#define HEARTRATE9_SAMPLE_QUEUE_SIZE    64      // power of two
+
+/**
+  Section: Data Types
+ */
+
+typedef struct
+{
+    uint32_t time_ms;   // SYS_TIME when the reading was parsed
+    uint8_t  bpm;
+} heartrate9_sample_t;
+
 /**
   Section: heartrate9 Click Driver APIs
  */
 
 /*
- * Called to check the sensor data ready status
+ * Called to set up the click, the first heartrate9_task() does it otherwise
  */
-bool  is_heartrate9_byte_ready(void);
+void heartrate9_initialize(void);
 
 /*
- * Called to read sensor data
+ * Called from the application task loop to parse the bytes received since
+ * the last call, never waits for data
  */
-int8_t  heartrate9_read_byte(void);
+void heartrate9_task(void);
 
+/*
+ * Called to take the oldest reading, returns false when there is none
+ */
+bool heartrate9_sample_get(heartrate9_sample_t *sample);
 
+/*
+ * Called to read the number of readings lost to a full queue
+ */
+uint32_t heartrate9_samples_dropped(void);
+
+/*
+ * Called to read the number of received bytes lost to a full USART ring
+ * buffer, heartrate9_task() was not called often enough
+ */
+uint32_t heartrate9_bytes_dropped(void);
 
 #endif // _HEARTRATE9_H
@@ -50,33 +50,45 @@
 #include <stdint.h>
 #include "definitions.h"                // SYS function prototypes
 #include "heartrate9.h"
+#include "heartrate9_stats.h"
 #include "app.h"
 
 volatile int8_t last_heart_rate=0;
+
+// Summary of the last telemetry interval, sent by send_telemetry_message()
+heartrate9_aggregate_t heartrate9_aggregate;
+
+static heartrate9_stats_t heartrate9_stats;
 /**
   Section: Example Code
  */
 
 void heartrate9_example(void) {
-    int8_t  heartrate_data = -1;
-    // Check the Heartrate Ready Status
-    if(true == is_heartrate9_byte_ready())
+    heartrate9_sample_t sample;
+
+    // Filter the readings parsed since the last report and sum them up
+    while (true == heartrate9_sample_get(&sample))
     {
-        // Return the Heartrate 
-        while(heartrate_data == -1)
-        {
-            heartrate_data      = heartrate9_read_byte();
-            last_heart_rate =  heartrate_data;
-        }
-        APP_DebugPrintf("Heartrate = %d bpm \t\r\n", (uint8_t)heartrate_data);
+        heartrate9_stats_add(&heartrate9_stats, sample.bpm);
+    }
+
+    heartrate9_stats_take(&heartrate9_stats, &heartrate9_aggregate);
+
+    if (heartrate9_aggregate.samples != 0)
+    {
+        last_heart_rate = (int8_t)heartrate9_aggregate.mean;
+        APP_DebugPrintf("Heartrate = %d bpm (%d - %d, %d readings, %d%%) \t\r\n",
+                        heartrate9_aggregate.mean,
+                        heartrate9_aggregate.min,
+                        heartrate9_aggregate.max,
+                        heartrate9_aggregate.samples,
+                        heartrate9_aggregate.confidence);
     }
 }
 
 void heartrate9_example_initialize(void) {
     
-    // Check the Heartrate Ready Status
-    if(true == is_heartrate9_byte_ready())
-    {
-        // initialize success.
-    }
+    // Set up the click, readings are parsed by heartrate9_task()
+    heartrate9_stats_init(&heartrate9_stats);
+    heartrate9_initialize();
 }
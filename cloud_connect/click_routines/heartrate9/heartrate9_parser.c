@@ -0,0 +1,156 @@
+/*******************************************************************************
+  Heart Rate 9 click stream parser source file
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    heartrate9_parser.c
+
+  Summary
+    Heart Rate 9 click stream parser Implementation File.
+
+  Description
+    This file implements the incremental parser of the Heart Rate 9 click
+    UART stream, see heartrate9_parser.h for the record layout.
+
+  Remarks:
+    None.
+ 
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*
+    (c) 2021 Microchip Technology Inc. and its subsidiaries. You may use this
+    software and any derivatives exclusively with Microchip products.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION
+    WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+    MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE
+    TERMS.
+*/
+// DOM-IGNORE-END
+
+/**
+  Section: Included Files
+ */
+
+#include "heartrate9_parser.h"
+
+/**
+  Section: Macro Declarations
+ */
+#define HEART_RATE_SKIP_FIELDS  3
+#define HEART_RATE_MAX          255
+
+typedef enum
+{
+    HEADER_BYTE1 = 0,
+    HEADER_BYTE2,
+    HEADER_BYTE3,
+    HEART_RATE_BYTE_POS_FIND,
+    HEART_RATE_READ_FIRST,
+    HEART_RATE_READ,
+}HEART_RATE_PARSER_STATE;
+
+/**
+  Section: Parser APIs
+ */
+
+void heartrate9_parser_init(heartrate9_parser_t *parser)
+{
+    parser->state       = HEADER_BYTE1;
+    parser->field_count = 0;
+    parser->value       = 0;
+}
+
+bool heartrate9_parser_feed(heartrate9_parser_t *parser, const uint8_t **data, const uint8_t *end, uint8_t *bpm)
+{
+    const uint8_t *next  = *data;
+    uint8_t        state = parser->state;
+    uint8_t        byte;
+
+    while (next < end)
+    {
+        byte = *next++;
+
+        /* Records never hold a line break, one ends a truncated record */
+        if (byte == '\r' || byte == '\n')
+        {
+            state = HEADER_BYTE1;
+            continue;
+        }
+
+        switch (state)
+        {
+            case HEADER_BYTE1:
+                if (byte == '1')
+                {
+                    state = HEADER_BYTE2;
+                }
+                break;
+            case HEADER_BYTE2:
+                /* A mismatch may itself start the header, as in "115;" */
+                state = (byte == '5') ? HEADER_BYTE3 : (byte == '1') ? HEADER_BYTE2 : HEADER_BYTE1;
+                break;
+            case HEADER_BYTE3:
+                if (byte == ';')
+                {
+                    state               = HEART_RATE_BYTE_POS_FIND;
+                    parser->field_count = 0;
+                }
+                else
+                {
+                    state = (byte == '1') ? HEADER_BYTE2 : HEADER_BYTE1;
+                }
+                break;
+            case HEART_RATE_BYTE_POS_FIND:
+                if (byte == ';' && ++parser->field_count == HEART_RATE_SKIP_FIELDS)
+                {
+                    state         = HEART_RATE_READ_FIRST;
+                    parser->value = 0;
+                }
+                break;
+            case HEART_RATE_READ_FIRST:
+            case HEART_RATE_READ:
+                if (byte >= '0' && byte <= '9')
+                {
+                    parser->value = (uint16_t)(parser->value * 10 + (byte - '0'));
+                    state         = (parser->value > HEART_RATE_MAX) ? HEADER_BYTE1 : HEART_RATE_READ;
+                }
+                else if (byte == ';' && state == HEART_RATE_READ)
+                {
+                    parser->state = HEADER_BYTE1;
+                    *bpm          = (uint8_t)parser->value;
+                    *data         = next;
+                    return true;
+                }
+                else
+                {
+                    /* Not a number, drop the record */
+                    state = (byte == '1') ? HEADER_BYTE2 : HEADER_BYTE1;
+                }
+                break;
+            default:
+                state = HEADER_BYTE1;
+                break;
+        }
+    }
+
+    parser->state = state;
+    *data         = next;
+
+    return false;
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+  Heart Rate 9 click stream parser header file
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    heartrate9_parser.h
+
+  Summary
+    Heart Rate 9 click stream parser Interface File.
+
+  Description
+    This file declares the incremental parser of the Heart Rate 9 click UART
+    stream. It keeps its state between calls, so the stream can be fed in
+    pieces of any size as the bytes arrive, and it has no hardware
+    dependencies.
+
+    A reading is a record starting with "15;". The heart rate is the field
+    following the next three ';' terminated fields, in decimal, and ends with
+    ';'. A line break drops a record that is not complete yet.
+
+  Remarks:
+    None.
+ 
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*
+    (c) 2021 Microchip Technology Inc. and its subsidiaries. You may use this
+    software and any derivatives exclusively with Microchip products.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION
+    WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+    MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE
+    TERMS.
+*/
+// DOM-IGNORE-END
+
+#ifndef _HEARTRATE9_PARSER_H
+#define	_HEARTRATE9_PARSER_H
+
+/**
+  Section: Included Files
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+  Section: Data Types
+ */
+
+typedef struct
+{
+    uint8_t  state;
+    uint8_t  field_count;
+    uint16_t value;
+} heartrate9_parser_t;
+
+/**
+  Section: Heart Rate 9 stream parser APIs
+ */
+
+/*
+ * Called to start parsing a new stream
+ */
+void heartrate9_parser_init(heartrate9_parser_t *parser);
+
+/*
+ * Called to parse the bytes from *data up to end. Stops right after a
+ * complete reading and returns it in *bpm, *data then points to the first
+ * byte not parsed yet. Returns false once every byte is parsed.
+ */
+bool heartrate9_parser_feed(heartrate9_parser_t *parser, const uint8_t **data, const uint8_t *end, uint8_t *bpm);
+
+#endif // _HEARTRATE9_PARSER_H
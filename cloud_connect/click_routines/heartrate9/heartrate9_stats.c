@@ -0,0 +1,194 @@
+/*******************************************************************************
+  Heart Rate 9 reading statistics source file
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    heartrate9_stats.c
+
+  Summary
+    Heart Rate 9 reading statistics Implementation File.
+
+  Description
+    This file implements the moving median, the outlier rejection and the
+    per interval aggregate of the Heart Rate 9 readings.
+
+  Remarks:
+    None.
+ 
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*
+    (c) 2021 Microchip Technology Inc. and its subsidiaries. You may use this
+    software and any derivatives exclusively with Microchip products.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION
+    WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+    MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE
+    TERMS.
+*/
+// DOM-IGNORE-END
+
+/**
+  Section: Included Files
+ */
+
+#include "heartrate9_stats.h"
+
+/**
+  Section: Private functions
+ */
+
+static void heartrate9_stats_interval_reset(heartrate9_stats_t *stats)
+{
+    stats->sum      = 0;
+    stats->accepted = 0;
+    stats->rejected = 0;
+    stats->min      = UINT8_MAX;
+    stats->max      = 0;
+}
+
+/* Replace the oldest reading of the window, keeping the sorted copy sorted */
+static void heartrate9_stats_window_push(heartrate9_stats_t *stats, uint8_t bpm)
+{
+    uint8_t count = stats->window_count;
+    uint8_t old;
+    uint8_t i;
+
+    if (count == HEARTRATE9_MEDIAN_WINDOW)
+    {
+        old = stats->window[0];
+
+        for (i = 1; i < count; i++)
+        {
+            stats->window[i - 1] = stats->window[i];
+        }
+
+        /* Close the gap of the oldest value in the sorted copy */
+        for (i = 0; stats->sorted[i] != old; i++)
+        {
+        }
+        for (; i + 1 < count; i++)
+        {
+            stats->sorted[i] = stats->sorted[i + 1];
+        }
+
+        count--;
+    }
+
+    stats->window[count] = bpm;
+
+    /* Insertion into the sorted copy */
+    for (i = count; i > 0 && stats->sorted[i - 1] > bpm; i--)
+    {
+        stats->sorted[i] = stats->sorted[i - 1];
+    }
+    stats->sorted[i] = bpm;
+
+    stats->window_count = count + 1;
+}
+
+/**
+  Section: Heart Rate 9 reading statistics APIs
+ */
+
+void heartrate9_stats_init(heartrate9_stats_t *stats)
+{
+    stats->window_count = 0;
+    heartrate9_stats_interval_reset(stats);
+}
+
+bool heartrate9_stats_add(heartrate9_stats_t *stats, uint8_t bpm)
+{
+    uint8_t median;
+    uint8_t deviation;
+    uint8_t allowed;
+
+    if (bpm < HEARTRATE9_BPM_MIN || bpm > HEARTRATE9_BPM_MAX)
+    {
+        stats->rejected++;
+        return false;
+    }
+
+    /* Compare with the median of the readings before this one, once there are
+     * enough of them for the median to mean something. The reading joins the
+     * window either way, so a real change of rate takes over the median after
+     * half a window. */
+    if (stats->window_count > HEARTRATE9_MEDIAN_WINDOW / 2)
+    {
+        median    = stats->sorted[stats->window_count / 2];
+        deviation = (bpm > median) ? (bpm - median) : (median - bpm);
+        allowed   = median >> HEARTRATE9_OUTLIER_SHIFT;
+
+        if (allowed < HEARTRATE9_OUTLIER_MIN_BPM)
+        {
+            allowed = HEARTRATE9_OUTLIER_MIN_BPM;
+        }
+
+        if (deviation > allowed)
+        {
+            heartrate9_stats_window_push(stats, bpm);
+            stats->rejected++;
+            return false;
+        }
+    }
+
+    heartrate9_stats_window_push(stats, bpm);
+    median = stats->sorted[stats->window_count / 2];
+
+    stats->sum += median;
+    stats->accepted++;
+
+    if (median < stats->min)
+    {
+        stats->min = median;
+    }
+    if (median > stats->max)
+    {
+        stats->max = median;
+    }
+
+    return true;
+}
+
+void heartrate9_stats_take(heartrate9_stats_t *stats, heartrate9_aggregate_t *aggregate)
+{
+    uint32_t total    = (uint32_t)stats->accepted + stats->rejected;
+    uint32_t accepted = stats->accepted;
+
+    aggregate->samples  = stats->accepted;
+    aggregate->rejected = stats->rejected;
+    aggregate->mean     = 0;
+    aggregate->min      = 0;
+    aggregate->max      = 0;
+
+    /* The share of readings accepted, scaled down while there are too few of
+     * them to trust */
+    aggregate->confidence = 0;
+
+    if (accepted != 0)
+    {
+        aggregate->mean       = (uint8_t)((stats->sum + accepted / 2) / accepted);
+        aggregate->min        = stats->min;
+        aggregate->max        = stats->max;
+        aggregate->confidence = (uint8_t)((accepted * 100 / total) *
+                                          (accepted < HEARTRATE9_CONFIDENT_SAMPLES ? accepted : HEARTRATE9_CONFIDENT_SAMPLES) /
+                                          HEARTRATE9_CONFIDENT_SAMPLES);
+    }
+
+    heartrate9_stats_interval_reset(stats);
+}
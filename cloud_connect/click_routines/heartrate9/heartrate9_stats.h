@@ -0,0 +1,120 @@
+/*******************************************************************************
+  Heart Rate 9 reading statistics header file
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    heartrate9_stats.h
+
+  Summary
+    Heart Rate 9 reading statistics Interface File.
+
+  Description
+    This file declares the processing stage between the Heart Rate 9 readings
+    and the telemetry. Every reading goes through a moving median, readings
+    too far from the median are rejected, and the median of the accepted ones
+    is summed up per telemetry interval as min, max, mean and a confidence.
+    It uses integer arithmetic only and has no hardware dependencies.
+
+  Remarks:
+    None.
+ 
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*
+    (c) 2021 Microchip Technology Inc. and its subsidiaries. You may use this
+    software and any derivatives exclusively with Microchip products.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION
+    WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+    MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE
+    TERMS.
+*/
+// DOM-IGNORE-END
+
+#ifndef _HEARTRATE9_STATS_H
+#define	_HEARTRATE9_STATS_H
+
+/**
+  Section: Included Files
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+  Section: Macro Declarations
+ */
+#define HEARTRATE9_MEDIAN_WINDOW            5       // odd
+#define HEARTRATE9_BPM_MIN                  30      // below is no contact or noise
+#define HEARTRATE9_BPM_MAX                  250
+#define HEARTRATE9_OUTLIER_MIN_BPM          10      // always allowed from the median
+#define HEARTRATE9_OUTLIER_SHIFT            2       // and a quarter of the median
+#define HEARTRATE9_CONFIDENT_SAMPLES        10      // accepted readings for full confidence
+
+/**
+  Section: Data Types
+ */
+
+typedef struct
+{
+    /* Moving median over the last readings in range, oldest first, and the
+     * same values sorted */
+    uint8_t  window[HEARTRATE9_MEDIAN_WINDOW];
+    uint8_t  sorted[HEARTRATE9_MEDIAN_WINDOW];
+    uint8_t  window_count;
+
+    /* The current telemetry interval */
+    uint32_t sum;
+    uint16_t accepted;
+    uint16_t rejected;
+    uint8_t  min;
+    uint8_t  max;
+} heartrate9_stats_t;
+
+typedef struct
+{
+    uint16_t samples;       // readings accepted
+    uint16_t rejected;      // readings out of range or too far from the median
+    uint8_t  mean;
+    uint8_t  min;
+    uint8_t  max;
+    uint8_t  confidence;    // percent
+} heartrate9_aggregate_t;
+
+/**
+  Section: Heart Rate 9 reading statistics APIs
+ */
+
+/*
+ * Called to start with an empty median window and interval
+ */
+void heartrate9_stats_init(heartrate9_stats_t *stats);
+
+/*
+ * Called with every reading, returns whether it was accepted
+ */
+bool heartrate9_stats_add(heartrate9_stats_t *stats, uint8_t bpm);
+
+/*
+ * Called at the end of a telemetry interval to get its aggregate and start
+ * the next one, the median window carries over. min, max and mean are only
+ * valid when samples is not 0.
+ */
+void heartrate9_stats_take(heartrate9_stats_t *stats, heartrate9_aggregate_t *aggregate);
+
+#endif // _HEARTRATE9_STATS_H
@@ -9,6 +9,11 @@
 
  *******************************************************************************/
 
+#ifndef _DTI_H
+#define _DTI_H
+
+#include <stdint.h>
+
 // *****************************************************************************
 // *****************************************************************************
 // Section: Definitions
@@ -32,6 +37,11 @@
 /* Valid command byte values */
 #define DTI_CMDCHAR_TELEMETRY_1 'T'
 #define DTI_CMDCHAR_TELEMETRY_2 't'
+#define DTI_CMDCHAR_TELEMETRY_BINARY 'B'   // one typed value, parameter1 is the telemetry index
+#define DTI_CMDCHAR_TELEMETRY_BATCH  'b'   // typed values, parameter1 is the value count
+
+/* Binary frames end with a CRC-16 of the header and payload, see dti_frame.h */
+#define DTI_CRC_NUMBYTES 2
 
 #define CHAR_NULL '\0'
 
@@ -42,6 +52,8 @@ typedef struct {
     uint8_t *payloadData; // pointer to the beginning of the payload array/string
 } DTI_DataFrameInfo;
 
+#endif // _DTI_H
+
 /*******************************************************************************
  End of File
 */
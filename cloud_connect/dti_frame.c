@@ -0,0 +1,238 @@
+/*******************************************************************************
+  Source File
+
+  Company:
+    Microchip Technology Inc.
+
+  File Name:
+    dti_frame.c
+
+  Summary:
+    Binary DTI telemetry frames, see dti_frame.h for the layout
+
+ *******************************************************************************/
+
+#include <string.h>
+#include "dti_frame.h"
+
+#define DTI_VALUE_INVALID 0xFF
+
+/* Type of each telemetry index, index 0 is not used */
+static const uint8_t dti_value_type_table[DTI_TELEMETRY_INDEX_MAX + 1] = {
+    DTI_VALUE_INVALID,
+    DTI_VALUE_INT32,  DTI_VALUE_INT32,  DTI_VALUE_INT32, DTI_VALUE_INT32,
+    DTI_VALUE_DOUBLE, DTI_VALUE_DOUBLE,
+    DTI_VALUE_FLOAT,  DTI_VALUE_FLOAT,
+    DTI_VALUE_INT64,
+    DTI_VALUE_BOOL,
+    DTI_VALUE_STRING, DTI_VALUE_STRING, DTI_VALUE_STRING, DTI_VALUE_STRING
+};
+
+/* Encoded size of each dti_value_type_t, strings add their length byte */
+static const uint8_t dti_value_size_table[] = {4, 8, 4, 8, 1, 1};
+
+uint16_t dti_crc16(uint16_t crc, const uint8_t* data, uint32_t length)
+{
+    uint32_t value = crc;
+    uint32_t x;
+
+    // byte at a time without a table, the polynomial terms folded into shifts
+    while (length--)
+    {
+        x = ((value >> 8) ^ *data++) & 0xFF;
+        x ^= x >> 4;
+        value = ((value << 8) ^ (x << 12) ^ (x << 5) ^ x) & 0xFFFF;
+    }
+
+    return (uint16_t)value;
+}
+
+uint32_t dti_frame_length(const uint8_t* header)
+{
+    uint32_t payload_length;
+
+    if (header[DTI_pIDX_CMDCHAR] != DTI_CMDCHAR_TELEMETRY_BINARY &&
+        header[DTI_pIDX_CMDCHAR] != DTI_CMDCHAR_TELEMETRY_BATCH)
+    {
+        return 0;
+    }
+
+    payload_length = ((uint32_t)header[DTI_pIDX_PAYLENMSB] << 8) | header[DTI_pIDX_PAYLENLSB];
+
+    if (payload_length > DTI_PAYLOADDATA_NUMBYTES)
+    {
+        return 0;
+    }
+
+    return DTI_HEADER_NUMBYTES + payload_length + DTI_CRC_NUMBYTES;
+}
+
+/**********************************************
+* Encoded size of a value of the given telemetry
+* index starting at data, 0 if it does not fit
+* before end or is not valid.
+**********************************************/
+static uint32_t dti_value_size(uint8_t index, const uint8_t* data, const uint8_t* end)
+{
+    uint8_t  type;
+    uint32_t size;
+
+    if (index == 0 || index > DTI_TELEMETRY_INDEX_MAX)
+    {
+        return 0;
+    }
+
+    type = dti_value_type_table[index];
+    size = dti_value_size_table[type];
+
+    if ((uint32_t)(end - data) < size)
+    {
+        return 0;
+    }
+
+    if (type == DTI_VALUE_STRING)
+    {
+        size += data[0];
+    }
+    else if (type == DTI_VALUE_BOOL && data[0] > 1)
+    {
+        return 0;
+    }
+
+    return (uint32_t)(end - data) < size ? 0 : size;
+}
+
+bool dti_frame_open(dti_frame_reader_t* reader, const uint8_t* frame, uint32_t length)
+{
+    const uint8_t* data;
+    const uint8_t* end;
+    uint32_t       payload_length;
+    uint32_t       size;
+    uint16_t       crc;
+    uint8_t        count;
+
+    if (length < DTI_HEADER_NUMBYTES + DTI_CRC_NUMBYTES || dti_frame_length(frame) != length)
+    {
+        return false;
+    }
+
+    payload_length = length - DTI_HEADER_NUMBYTES - DTI_CRC_NUMBYTES;
+    crc            = dti_crc16(0xFFFF, frame, DTI_HEADER_NUMBYTES + payload_length);
+
+    if (frame[length - 2] != (uint8_t)crc || frame[length - 1] != (uint8_t)(crc >> 8))
+    {
+        return false;
+    }
+
+    data = frame + DTI_HEADER_NUMBYTES;
+    end  = data + payload_length;
+
+    if (frame[DTI_pIDX_CMDCHAR] == DTI_CMDCHAR_TELEMETRY_BINARY)
+    {
+        if (dti_value_size(frame[DTI_pIDX_PARAM1], data, end) != payload_length)
+        {
+            return false;
+        }
+
+        reader->index = frame[DTI_pIDX_PARAM1];
+    }
+    else
+    {
+        // walk the whole batch first so a bad value does not leave half a message
+        for (count = frame[DTI_pIDX_PARAM1]; count != 0; count--)
+        {
+            if (data == end || (size = dti_value_size(data[0], data + 1, end)) == 0)
+            {
+                return false;
+            }
+
+            data += 1 + size;
+        }
+
+        if (data != end)
+        {
+            return false;
+        }
+
+        reader->index = 0;
+    }
+
+    reader->next = frame + DTI_HEADER_NUMBYTES;
+    reader->end  = end;
+
+    return true;
+}
+
+static uint32_t dti_read_u32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+bool dti_frame_next(dti_frame_reader_t* reader, dti_value_t* value)
+{
+    const uint8_t* data = reader->next;
+    uint64_t       bits;
+    uint32_t       bits32;
+
+    if (data == reader->end)
+    {
+        return false;
+    }
+
+    if (reader->index != 0)
+    {
+        value->index = reader->index;
+    }
+    else
+    {
+        value->index = *data++;
+    }
+
+    value->type = dti_value_type_table[value->index];
+
+    switch (value->type)
+    {
+        case DTI_VALUE_INT32:
+            value->as.i32 = (int32_t)dti_read_u32(data);
+            data += 4;
+            break;
+
+        case DTI_VALUE_FLOAT:
+            // copy the bits, the value is never converted
+            bits32 = dti_read_u32(data);
+            memcpy(&value->as.f32, &bits32, sizeof(bits32));
+            data += 4;
+            break;
+
+        case DTI_VALUE_INT64:
+        case DTI_VALUE_DOUBLE:
+            bits = (uint64_t)dti_read_u32(data) | ((uint64_t)dti_read_u32(data + 4) << 32);
+
+            if (value->type == DTI_VALUE_INT64)
+            {
+                value->as.i64 = (int64_t)bits;
+            }
+            else
+            {
+                memcpy(&value->as.f64, &bits, sizeof(bits));
+            }
+
+            data += 8;
+            break;
+
+        case DTI_VALUE_BOOL:
+            value->as.b = data[0] != 0;
+            data += 1;
+            break;
+
+        default:
+            value->as.string.length = data[0];
+            value->as.string.ptr    = data + 1;
+            data += 1 + data[0];
+            break;
+    }
+
+    reader->next = data;
+
+    return true;
+}
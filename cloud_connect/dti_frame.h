@@ -0,0 +1,115 @@
+/*******************************************************************************
+  Main Header File
+
+  Company:
+    Microchip Technology Inc.
+
+  File Name:
+    dti_frame.h
+
+  Summary:
+    Binary DTI telemetry frames
+
+  Description:
+    A binary frame keeps the DTI header (command, parameter1, payload length
+    MSB first) and is followed by a CRC-16/CCITT (polynomial 0x1021, initial
+    value 0xFFFF) of the header and payload, sent LSB first.
+
+    The payload holds typed values in little endian byte order. The type of a
+    value follows from its telemetry index, the same index the hex command
+    uses:
+
+      1 - 4    int32, 4 bytes
+      5 - 6    IEEE double, 8 bytes
+      7 - 8    IEEE float, 4 bytes
+      9        int64, 8 bytes
+      10       bool, 1 byte (0 or 1)
+      11 - 14  string, 1 length byte then the characters
+
+    DTI_CMDCHAR_TELEMETRY_BINARY carries one value, its index is parameter1.
+    DTI_CMDCHAR_TELEMETRY_BATCH carries parameter1 values, each one preceded
+    by its index byte.
+
+ *******************************************************************************/
+
+#ifndef _DTI_FRAME_H
+#define _DTI_FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dti.h"
+
+#define DTI_TELEMETRY_INDEX_MAX 14
+
+typedef enum
+{
+    DTI_VALUE_INT32,
+    DTI_VALUE_DOUBLE,
+    DTI_VALUE_FLOAT,
+    DTI_VALUE_INT64,
+    DTI_VALUE_BOOL,
+    DTI_VALUE_STRING
+} dti_value_type_t;
+
+typedef struct
+{
+    uint8_t index;  // telemetry index, 1 to DTI_TELEMETRY_INDEX_MAX
+    uint8_t type;   // dti_value_type_t
+    union
+    {
+        int32_t i32;
+        int64_t i64;
+        float   f32;
+        double  f64;
+        bool    b;
+        struct
+        {
+            const uint8_t* ptr;  // points into the frame, not terminated
+            uint16_t       length;
+        } string;
+    } as;
+} dti_value_t;
+
+typedef struct
+{
+    const uint8_t* next;
+    const uint8_t* end;
+    uint8_t        index;  // index of a single value frame, 0 for a batch
+} dti_frame_reader_t;
+
+/**********************************************
+* CRC-16/CCITT of data, continuing from crc.
+* Start with 0xFFFF.
+**********************************************/
+uint16_t dti_crc16(
+    uint16_t       crc,
+    const uint8_t* data,
+    uint32_t       length);
+
+/**********************************************
+* Total length of the binary frame starting with
+* header (DTI_HEADER_NUMBYTES bytes), 0 if the
+* command is not a binary one or it is too long.
+**********************************************/
+uint32_t dti_frame_length(const uint8_t* header);
+
+/**********************************************
+* Check the CRC and the layout of every value of
+* a complete frame, then position the reader on
+* its first value. Nothing is read from a frame
+* that fails.
+**********************************************/
+bool dti_frame_open(
+    dti_frame_reader_t* reader,
+    const uint8_t*      frame,
+    uint32_t            length);
+
+/**********************************************
+* Decode the next value of an opened frame,
+* false after the last one.
+**********************************************/
+bool dti_frame_next(
+    dti_frame_reader_t* reader,
+    dti_value_t*        value);
+
+#endif // _DTI_FRAME_H
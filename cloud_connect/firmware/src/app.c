@@ -55,6 +55,7 @@
 #include "wdrv_winc_client_api.h"
 #include "stdarg.h"
 #include "heartrate9_example.h"
+#include "heartrate9.h"
 #include "../../azutil.h"
 
 #define WORLDWIDE_NTP_POOL_HOSTNAME "*.pool.ntp.org"
@@ -68,6 +69,7 @@
 
 void APP_ExampleInitialize(DRV_HANDLE handle);
 void APP_ExampleTasks(DRV_HANDLE handle);
+void cloud_wifi_telemetry_due(void);
 char   deviceIpAddress[16] = "0.0.0.0";
 
 #define APP_PRINT_BUFFER_SIZ    2048
@@ -288,12 +290,18 @@ static void APP_DataTask(void)
         // How many seconds since the last time this loop ran?
         int32_t delta = difftime(timeNow, previousTransmissionTime);
 
+        // The cloud state machine never waits on the network, it takes one step per call
+        APP_ExampleTasks(wdrvHandle);
+
+        // Parse the heart rate bytes received since the last pass
+        heartrate9_task();
+
         if (delta >= telemetryInterval)
         {
             previousTransmissionTime = timeNow;
 
             // send telemetry
-             APP_ExampleTasks(wdrvHandle);
+            cloud_wifi_telemetry_due();
             heartrate9_example();
         }
 
@@ -57,9 +57,11 @@ enum cloud_iot_state
     CLOUD_STATE_CLOUD_CONNECT               = 10,
     CLOUD_STATE_CLOUD_CONNECTING            = 11,
     CLOUD_STATE_CLOUD_CONNECTED             = 12,
-    CLOUD_STATE_CLOUD_SUBSCRIPTION          = 13,
-    CLOUD_STATE_CLOUD_REPORTING             = 14,
-    CLOUD_STATE_CLOUD_DISCONNECT            = 15
+    CLOUD_STATE_CLOUD_MQTT_CONNECTING       = 13,
+    CLOUD_STATE_CLOUD_SUBSCRIPTION          = 14,
+    CLOUD_STATE_CLOUD_SUBSCRIBING           = 15,
+    CLOUD_STATE_CLOUD_REPORTING             = 16,
+    CLOUD_STATE_CLOUD_DISCONNECT            = 17
 };
 
 /**
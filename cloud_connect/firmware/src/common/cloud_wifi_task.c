@@ -27,6 +27,7 @@
 #include "MQTTClient.h"
 #include "parson.h"
 #include "hex_dump.h"
+#include "winc_receive.h"
 #include "cloud_status.h"
 #include "cloud_wifi_task.h"
 #include "network_interface.h"
@@ -36,15 +37,22 @@
 #include <limits.h>
 #include <stdint.h>
 #include "ecc_types.h"
+#include "azutil.h"
 
 
 
 #define MQTT_BUFFER_SIZE            (1024)
 #define MQTT_COMMAND_TIMEOUT_MS     (4000)
-#define MQTT_YEILD_TIMEOUT_MS       (500)
 #define MQTT_KEEP_ALIVE_INTERVAL_S  (900)
 
-#define WIFI_PACKET_TIMEOUT 5000
+// QoS1 publishes waiting for a PUBACK are kept here to be resent, one slot of
+// this size each. Bigger ones are sent once only.
+#define MQTT_INFLIGHT_SLOT_SIZE     (640)
+
+// Receive ring size, must be a power of two and hold at least one full
+// WINC socket message (SOCKET_BUFFER_MAX_LENGTH)
+#define WIFI_RX_RING_SIZE           (2048)
+#define WIFI_RX_CHUNK_SIZE          (256)
 
 static struct socket_connection g_socket_connection;
 static uint8_t g_host_ip_address[4];
@@ -53,16 +61,17 @@ static bool g_is_connected = false;
 static MQTTClient g_mqtt_client;
 static Network g_mqtt_network;
 
-extern volatile uint32_t g_timer_val;
 static uint32_t g_tx_size = 0;
 
 
-static uint8_t g_rx_buffer[MQTT_BUFFER_SIZE];
-static int32_t g_rx_buffer_length = 0;
-static uint32_t g_rx_buffer_location = 0;
+// WINC landing buffer for SOCKET_MSG_RECV chunks and the ring they are queued in
+static uint8_t g_rx_chunk[WIFI_RX_CHUNK_SIZE];
+static uint8_t g_rx_ring_buffer[WIFI_RX_RING_SIZE];
+static winc_receive_t g_rx;
 
 static uint8_t g_mqtt_rx_buffer[MQTT_BUFFER_SIZE];
 static uint8_t g_mqtt_tx_buffer[MQTT_BUFFER_SIZE];
+static uint8_t g_mqtt_inflight_buffer[MAX_INFLIGHT_PUBLISHES * MQTT_INFLIGHT_SLOT_SIZE];
 
 static enum cloud_iot_state g_cloud_wifi_state = CLOUD_STATE_WINC1500_INIT;
 static enum wifi_status g_wifi_status = WIFI_STATUS_UNKNOWN;
@@ -71,6 +80,30 @@ static bool g_demo_led_state;
 static char g_mqtt_update_topic_name[257];
 static char g_mqtt_update_delta_topic_name[257];
 
+static void cloud_subscribe_callback(MessageData *data);
+#if defined(CLOUD_CONFIG_AZURE)
+static void cloud_twin_chunk_callback(MessageData *data, size_t offset, size_t totallen);
+#endif
+
+// Subscribed to in turn after the MQTT connect, one suback at a time
+typedef struct cloud_subscription
+{
+    const char *topic_filter;
+    messageHandler handler;
+    messageChunkHandler chunk_handler;
+} cloud_subscription_t;
+
+static const cloud_subscription_t g_subscriptions[] =
+{
+    { g_mqtt_update_delta_topic_name, &cloud_subscribe_callback, NULL },
+#if defined(CLOUD_CONFIG_AZURE)
+    // Twin documents can be bigger than the MQTT read buffer, they are taken in pieces
+    { AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_SUBSCRIBE_TOPIC, NULL, &cloud_twin_chunk_callback },
+    { AZ_IOT_HUB_CLIENT_TWIN_PATCH_SUBSCRIBE_TOPIC, NULL, &cloud_twin_chunk_callback },
+#endif
+};
+static uint8_t g_subscription_index = 0;
+
 static WDRV_WINC_AUTH_CONTEXT authCtx;
 static WDRV_WINC_BSS_CONTEXT bssCtx;
 extern SYSTEM_OBJECTS sysObj;
@@ -135,7 +168,6 @@ static const char* get_socket_error_name(int error_code)
 void TC5_Callback_InterruptHandler(TC_TIMER_STATUS status, uintptr_t context)
 {
 
-    g_timer_val += 100;
     client_timer_update();
 
 }
@@ -179,17 +211,22 @@ static void socket_callback_handler(SOCKET socket, uint8_t messageType, void *pM
         {
             if (socket_receive_message->s16BufferSize >= 0)
             {
-                g_rx_buffer_length += socket_receive_message->s16BufferSize;
-
-                // The message was received
-                if (socket_receive_message->u16RemainingSize == 0)
+                if (!winc_receive_chunk(&g_rx, socket_receive_message))
                 {
-                    g_wifi_status = WIFI_STATUS_MESSAGE_RECEIVED;
+                    // The ring was sized for a whole socket message, losing data here breaks the stream
+                    APP_DebugPrintf("%s: receive ring overflow\r\n", __FUNCTION__);
+                    g_wifi_status = WIFI_STATUS_ERROR;
+                    g_cloud_wifi_state = CLOUD_STATE_WIFI_DISCONNECT;
+                    break;
                 }
-                //printf("%s: SOCKET_MSG_RECV %d\r\n", __FUNCTION__, (int)socket_receive_message->s16BufferSize);
+
+                // g_wifi_status is left alone as a send may be waiting on it,
+                // readers go by the ring fill level instead
             }
             else
             {
+                winc_receive_failed(&g_rx);
+
                 if (socket_receive_message->s16BufferSize == SOCK_ERR_TIMEOUT)
                 {
                     // A timeout has occurred
@@ -380,73 +417,51 @@ static void wifi_callback_handler(DRV_HANDLE handle, WDRV_WINC_ASSOC_HANDLE asso
 
 int cloud_wifi_read_data(uint8_t *read_buffer, uint32_t read_length, uint32_t timeout_ms)
 {
-    int status = SUCCESS;
+    Timer timer;
 
     if (g_is_connected == false || g_cloud_wifi_state <= CLOUD_STATE_WIFI_DISCONNECT)
     {
         return FAILURE;
     }
 
-    if (g_rx_buffer_length >= read_length)
+    if (read_length > WIFI_RX_RING_SIZE)
     {
-        status = SUCCESS;
-
-        // Get the data from the existing received buffer
-        memcpy(&read_buffer[0], &g_rx_buffer[g_rx_buffer_location], read_length);
-
-        g_rx_buffer_location += read_length;
-        g_rx_buffer_length -= read_length;
-
-
+        return FAILURE;
     }
-    else
-    {
-        // Reset the message buffer information
-        g_wifi_status = WIFI_STATUS_UNKNOWN;
-        g_rx_buffer_location = 0;
-        g_rx_buffer_length = 0;
 
-        memset(&g_rx_buffer[0], 0, sizeof(g_rx_buffer));
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, timeout_ms);
 
-        // Receive the incoming message
-        g_wifi_status = recv(g_socket_connection.socket, g_rx_buffer, sizeof(g_rx_buffer), timeout_ms);
-        atca_delay_ms(5);
-        do
+    // A part of the bytes stays in the ring, the caller resumes the packet on
+    // a later pass instead of this read waiting for the rest of it
+    while (winc_receive_read(&g_rx, read_buffer, read_length) == 0)
+    {
+        if (g_wifi_status == WIFI_STATUS_ERROR || g_is_connected == false)
         {
-            // Wait until the incoming message or error was received
-            m2m_wifi_handle_events();
-
-            if (g_wifi_status == WIFI_STATUS_TIMEOUT)
-            {
-                status = FAILURE;
-                // Break the do/while loop
-                break;
-            }
-            else if (g_wifi_status == WIFI_STATUS_ERROR)
-            {
-                status = FAILURE;
-
-                // Break the do/while loop
-                break;
-            }
-
-            if (g_wifi_status == WIFI_STATUS_MESSAGE_RECEIVED)
-            {
-                status = SUCCESS;
-
-                memcpy(&read_buffer[0], &g_rx_buffer[0], read_length);
+            return FAILURE;
+        }
 
-                g_rx_buffer_location += read_length;
-                g_rx_buffer_length -= read_length;
+        if (TimerIsExpired(&timer))
+        {
+            return CLOUD_WIFI_WOULD_BLOCK;
+        }
+    }
 
-            }
+    return (int)read_length;
+}
 
+int cloud_wifi_read_available(uint8_t *read_buffer, uint32_t max_length)
+{
+    uint32_t read_length;
 
-        }
-        while ((g_wifi_status != WIFI_STATUS_MESSAGE_RECEIVED));  // && (--timeout > 0));
+    if (g_is_connected == false || g_cloud_wifi_state <= CLOUD_STATE_WIFI_DISCONNECT)
+    {
+        return FAILURE;
     }
 
-    return (status == SUCCESS) ? (int)read_length : status;
+    read_length = winc_receive_read_available(&g_rx, read_buffer, max_length);
+
+    return (int)read_length;
 }
 
 int cloud_wifi_send_data(uint8_t *send_buffer, uint32_t send_length, uint32_t timeout_ms)
@@ -523,6 +538,23 @@ static uint16_t cloud_get_message_id(void)
     return message_id;
 }
 
+#if defined(CLOUD_CONFIG_AZURE)
+static void cloud_twin_chunk_callback(MessageData *data, size_t offset, size_t totallen)
+{
+    receive_device_twin_chunk((const uint8_t*)data->topicName->lenstring.data,
+                              data->topicName->lenstring.len,
+                              (const uint8_t*)data->message->payload,
+                              (int32_t)data->message->payloadlen,
+                              (uint32_t)offset,
+                              (uint32_t)totallen);
+}
+#endif
+
+static void cloud_publish_complete_callback(unsigned short packet_id, int rc)
+{
+    process_publish_complete(packet_id, rc);
+}
+
 static void cloud_subscribe_callback(MessageData *data)
 {
     JSON_Value *delta_message_value = NULL;
@@ -660,6 +692,7 @@ int cloud_wifi_init(DRV_HANDLE handle)
     /* Register callback function for TC5 period interrupt */
     TC5_TimerCallbackRegister(TC5_Callback_InterruptHandler, (uintptr_t)NULL);
     memset(&g_socket_connection, 0, sizeof(g_socket_connection));
+    winc_receive_init(&g_rx, g_rx_ring_buffer, sizeof(g_rx_ring_buffer), g_rx_chunk, sizeof(g_rx_chunk));
     extern ATCAIfaceCfg atecc608_0_init_data;
     /* Start the timer*/
     TC5_TimerStart();
@@ -755,10 +788,13 @@ int cloud_wifi_init(DRV_HANDLE handle)
         // Initialize the MQTT library
         g_mqtt_network.mqttread  = &mqtt_packet_read;
         g_mqtt_network.mqttwrite = &mqtt_packet_write;
+        g_mqtt_network.mqttreadavailable = &mqtt_packet_read_available;
 
         MQTTClientInit(&g_mqtt_client, &g_mqtt_network, MQTT_COMMAND_TIMEOUT_MS,
                        g_mqtt_tx_buffer, sizeof(g_mqtt_tx_buffer),
                        g_mqtt_rx_buffer, sizeof(g_mqtt_rx_buffer));
+        MQTTSetInflightBuffer(&g_mqtt_client, g_mqtt_inflight_buffer, sizeof(g_mqtt_inflight_buffer));
+        MQTTSetPublishCompleteHandler(&g_mqtt_client, &cloud_publish_complete_callback);
 
     }
     while (0);
@@ -767,6 +803,68 @@ int cloud_wifi_init(DRV_HANDLE handle)
     return status;
 }
 
+static bool g_telemetry_due = false;
+
+void cloud_wifi_telemetry_due(void)
+{
+    g_telemetry_due = true;
+}
+
+/* Telemetry goes out once both the telemetry and the publish interval have passed */
+static bool telemetry_ready(void)
+{
+    if (!g_telemetry_due || !client_counter_finished())
+    {
+        return false;
+    }
+
+    g_telemetry_due = false;
+    client_counter_set(PUBLISH_INTERVAL);
+    return true;
+}
+
+/* Advance the MQTT client by one step and return the state of the pending
+ * connect or subscribe: PENDING, SUCCESS or FAILURE */
+static int cloud_mqtt_poll_pending(void)
+{
+    if (MQTTPoll(&g_mqtt_client) != SUCCESS)
+    {
+        return FAILURE;
+    }
+
+    return MQTTPendingResult(&g_mqtt_client);
+}
+
+static void cloud_mqtt_connect_failed(void)
+{
+    // The MQTT CONNECT was refused, or no CONNACK arrived in time
+    cloud_iot_set_status(CLOUD_STATE_CLOUD_SUBSCRIPTION, CLOUD_STATUS_CLOUD_SUBSCRIPTION_FAILURE,
+                         "The cloud IoT Demo failed to connect with the MQTT connect message.");
+    console_print_error_message("The cloud IoT Demo failed to connect with the MQTT connect message.");
+
+    // Set the state to start the cloud WIFI Disconnect process
+    if (g_cloud_wifi_state > CLOUD_STATE_WIFI_DISCONNECT)
+    {
+        g_cloud_wifi_state = CLOUD_STATE_CLOUD_DISCONNECT;
+    }
+}
+
+static void cloud_mqtt_subscribe_failed(void)
+{
+    // A topic SUBSCRIBE was refused, or no SUBACK arrived in time
+    cloud_iot_set_status(CLOUD_STATE_CLOUD_SUBSCRIPTION, CLOUD_STATUS_CLOUD_SUBSCRIPTION_FAILURE,
+                         "The cloud IoT Demo failed to subscribe to the MQTT update topic subscription.");
+
+    console_print_message("\r\n");
+    console_print_error_message("The cloud IoT Demo failed to subscribe to the MQTT update topic subscription.");
+
+    // Set the state to start the cloud WIFI Disconnect process
+    if (g_cloud_wifi_state > CLOUD_STATE_WIFI_DISCONNECT)
+    {
+        g_cloud_wifi_state = CLOUD_STATE_CLOUD_DISCONNECT;
+    }
+}
+
 void APP_ExampleTasks(DRV_HANDLE handle)
 {
     MQTTPacket_connectData mqtt_options = MQTTPacket_connectData_initializer;
@@ -774,6 +872,14 @@ void APP_ExampleTasks(DRV_HANDLE handle)
     int wifi_status = M2M_SUCCESS;
     ATCA_STATUS status = !ATCA_SUCCESS;
     static bool publish = true;
+    static bool telemetry_started = false;
+
+    // Keep sampling through outages, the telemetry log holds it until reconnected
+    if (telemetry_started && g_cloud_wifi_state != CLOUD_STATE_CLOUD_REPORTING && telemetry_ready())
+    {
+        send_telemetry_message();
+        check_telemetry_batch();
+    }
 
     switch (g_cloud_wifi_state)
     {
@@ -829,6 +935,7 @@ void APP_ExampleTasks(DRV_HANDLE handle)
     case CLOUD_STATE_CLOUD_CONNECTED:
         // The cloud Demo is connect to cloud IoT
         console_print_success_message("cloud Demo: Connected to cloud IoT.");
+        winc_receive_start(&g_rx, g_socket_connection.socket);
         g_is_connected = true;
         uint8_t buf[1024];
         size_t buf_bytes_remaining = 1024;
@@ -879,67 +986,105 @@ void APP_ExampleTasks(DRV_HANDLE handle)
                 break;
             }
 
-            mqtt_status = MQTTConnect(&g_mqtt_client, &mqtt_options);
+            // Only sends the connect message, the connack is waited for in the next state
+            mqtt_status = MQTTConnectAsync(&g_mqtt_client, &mqtt_options);
             if (mqtt_status != SUCCESS)
             {
-                // The cloud IoT Demo failed to retrieve the device serial number
-                cloud_iot_set_status(CLOUD_STATE_CLOUD_SUBSCRIPTION, CLOUD_STATUS_CLOUD_SUBSCRIPTION_FAILURE,
-                                     "The cloud IoT Demo failed to connect with the MQTT connect message.");
-                console_print_error_message("The cloud IoT Demo failed to connect with the MQTT connect message.");
-
-                // Set the state to start the cloud WIFI Disconnect process
-                if (g_cloud_wifi_state > CLOUD_STATE_WIFI_DISCONNECT)
-                {
-                    g_cloud_wifi_state = CLOUD_STATE_CLOUD_DISCONNECT;
-                }
+                cloud_mqtt_connect_failed();
 
                 // Break the do/while loop
                 break;
             }
-            console_print_success_message("MQTT Connection");
-            // Set the state to cloud WIFI Reporting process
-            g_cloud_wifi_state = CLOUD_STATE_CLOUD_SUBSCRIPTION;
+            g_cloud_wifi_state = CLOUD_STATE_CLOUD_MQTT_CONNECTING;
         }
         while (false);
         break;
 
-    case CLOUD_STATE_CLOUD_SUBSCRIPTION:
-        config_get_client_sub_topic(g_mqtt_update_delta_topic_name, sizeof(g_mqtt_update_delta_topic_name));
-        // Subscribe to the cloud IoT update delta topic message
-        mqtt_status = MQTTSubscribe(&g_mqtt_client, g_mqtt_update_delta_topic_name, QOS0, &cloud_subscribe_callback);
+    case CLOUD_STATE_CLOUD_MQTT_CONNECTING:
+        // Waiting for the connack, each call only handles what has already arrived
+        mqtt_status = cloud_mqtt_poll_pending();
+        if (mqtt_status == PENDING)
+        {
+            break;
+        }
         if (mqtt_status != SUCCESS)
         {
-            // The cloud IoT Demo failed to retrieve the device serial number
-            cloud_iot_set_status(CLOUD_STATE_CLOUD_SUBSCRIPTION, CLOUD_STATUS_CLOUD_SUBSCRIPTION_FAILURE,
-                                 "The cloud IoT Demo failed to subscribe to the MQTT update topic subscription.");
-
-            console_print_message("\r\n");
-            console_print_error_message("The cloud IoT Demo failed to subscribe to the MQTT update topic subscription.");
+            cloud_mqtt_connect_failed();
+            break;
+        }
+        console_print_success_message("MQTT Connection");
+        // Set the state to cloud WIFI Subscription process
+        config_get_client_sub_topic(g_mqtt_update_delta_topic_name, sizeof(g_mqtt_update_delta_topic_name));
+        g_subscription_index = 0;
+#if defined(CLOUD_CONFIG_AZURE)
+        // A new session, the twin responses are not subscribed until the SUBACK
+        set_twin_responses_subscribed(false);
+#endif
+        g_cloud_wifi_state = CLOUD_STATE_CLOUD_SUBSCRIPTION;
+        break;
 
-            // Set the state to start the cloud WIFI Disconnect process
-            if (g_cloud_wifi_state > CLOUD_STATE_WIFI_DISCONNECT)
-            {
-                g_cloud_wifi_state = CLOUD_STATE_CLOUD_DISCONNECT;
-            }
+    case CLOUD_STATE_CLOUD_SUBSCRIPTION:
+        // Subscribe to the next topic, the suback is waited for in the next state
+        if (g_subscriptions[g_subscription_index].chunk_handler != NULL)
+        {
+            mqtt_status = MQTTSubscribeChunkedAsync(&g_mqtt_client,
+                                                    g_subscriptions[g_subscription_index].topic_filter,
+                                                    QOS0,
+                                                    g_subscriptions[g_subscription_index].chunk_handler);
+        }
+        else
+        {
+            mqtt_status = MQTTSubscribeAsync(&g_mqtt_client,
+                                             g_subscriptions[g_subscription_index].topic_filter,
+                                             QOS0,
+                                             g_subscriptions[g_subscription_index].handler);
+        }
+        if (mqtt_status == SUCCESS)
+        {
+            g_cloud_wifi_state = CLOUD_STATE_CLOUD_SUBSCRIBING;
+            break;
+        }
+        cloud_mqtt_subscribe_failed();
+        break;
 
-            // Break the do/while loop
+    case CLOUD_STATE_CLOUD_SUBSCRIBING:
+        mqtt_status = cloud_mqtt_poll_pending();
+        if (mqtt_status == PENDING)
+        {
+            break;
+        }
+        if (mqtt_status != SUCCESS)
+        {
+            cloud_mqtt_subscribe_failed();
             break;
         }
 
         console_print_message("\r\n");
         console_print_success_message("Subscribed to the MQTT update topic subscription:");
-        console_print_success_message(g_mqtt_update_delta_topic_name);
+        console_print_success_message(g_subscriptions[g_subscription_index].topic_filter);
         console_print_message("\r\n");
+#if defined(CLOUD_CONFIG_AZURE)
+        if (strcmp(g_subscriptions[g_subscription_index].topic_filter, AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_SUBSCRIBE_TOPIC) == 0)
+        {
+            set_twin_responses_subscribed(true);
+        }
+#endif
+
+        if (++g_subscription_index < sizeof(g_subscriptions) / sizeof(g_subscriptions[0]))
+        {
+            g_cloud_wifi_state = CLOUD_STATE_CLOUD_SUBSCRIPTION;
+            break;
+        }
         g_cloud_wifi_state = CLOUD_STATE_CLOUD_REPORTING;
+        telemetry_started = true;
 
         break;
 
     case CLOUD_STATE_CLOUD_REPORTING:
         // Sending/receiving topic update messages to/from cloud IoT
 
-        if (client_counter_finished())
+        if (telemetry_ready())
         {
-            client_counter_set(PUBLISH_INTERVAL);
             // Publish the button update message
             publish = true;
         }
@@ -951,8 +1096,21 @@ void APP_ExampleTasks(DRV_HANDLE handle)
         }
         else
         {
-            // Wait for incoming update messages
-            mqtt_status = MQTTYield(&g_mqtt_client, MQTT_YEILD_TIMEOUT_MS);
+            // Send the telemetry batch once its window has passed
+            check_telemetry_batch();
+
+            // Drain telemetry stored while offline
+            check_telemetry_replay();
+
+            // Send the reported properties changed since the last acknowledged PATCH
+            check_reported_properties();
+
+            // Run a deferred direct method whose time has come
+            check_direct_methods();
+
+            // Handle incoming update messages already queued by the socket callback,
+            // returns straight away when there are none
+            mqtt_status = MQTTPoll(&g_mqtt_client);
             if (mqtt_status != SUCCESS)
             {
                 // The cloud IoT Demo failed to retrieve the device serial number
@@ -966,6 +1124,7 @@ void APP_ExampleTasks(DRV_HANDLE handle)
             if (g_wifi_status == WIFI_STATUS_ERROR)
             {
                 g_is_connected = false;
+                winc_receive_stop(&g_rx);
             }
         }
         break;
@@ -974,8 +1133,7 @@ void APP_ExampleTasks(DRV_HANDLE handle)
         // The cloud Demo is disconnected from access point
         g_is_connected = false;
 
-        g_rx_buffer_length = 0;
-        g_rx_buffer_location = 0;
+        winc_receive_stop(&g_rx);
 
         // Disconnect from the WINC1500 WIFI
         m2m_wifi_disconnect();
@@ -1029,71 +1187,92 @@ void APP_ExampleTasks(DRV_HANDLE handle)
     }
     atca_delay_us(500);
 }
-void CLOUD_publishData(uint8_t* topic, uint8_t* payload, uint16_t payload_len, int qos)
+/* The message being built in place in g_mqtt_tx_buffer, between
+ * CLOUD_publishReserve() and CLOUD_publishCommit() */
+static MQTTMessage g_publish_message;
+
+uint8_t* CLOUD_publishReserve(uint8_t* topic, int qos, uint16_t* max_payload_len)
+{
+    unsigned char *payload = NULL;
+    int payload_space = 0;
+
+    // Only publish message when in the reporting state
+    if (g_mqtt_client.isconnected != 1)
+    {
+        return NULL;
+    }
+
+    g_publish_message.qos      = qos;
+    g_publish_message.retained = 0;
+    g_publish_message.dup      = 0;
+
+    if (MQTTPublishReserve(&g_mqtt_client, (const char*)topic, &g_publish_message,
+                           &payload, &payload_space) != SUCCESS)
+    {
+        return NULL;
+    }
+
+    *max_payload_len = (uint16_t)min(payload_space, UINT16_MAX);
+
+    return payload;
+}
+
+int CLOUD_publishCommit(uint16_t payload_len)
 {
-    MQTTClient c;
     int mqtt_status = FAILURE;
-    MQTTMessage message;
-    char json_message[256];
-    JSON_Value *update_message_value = NULL;
-    JSON_Object *update_message_object = NULL;
-    char sTemp[256];
-    extern volatile int8_t last_heart_rate;
-    sprintf(sTemp, "Heart rate = %d",last_heart_rate);
-    memset(json_message, 0x00, sizeof(json_message));
 
-    // Create the update message
-    update_message_value   = json_value_init_object();
-    update_message_object  = json_value_get_object(update_message_value);
+    STATUS_LED_Toggle();
 
-    do
+    mqtt_status = MQTTPublishCommit(&g_mqtt_client, &g_publish_message, payload_len);
+    if (mqtt_status != SUCCESS)
     {
-        // Only publish message when in the reporting state
-        if (g_mqtt_client.isconnected != 1)
-        {
-           
-            break;
-        }
-        
-        STATUS_LED_Toggle();                
-#if defined(CLOUD_CONFIG_GCP)
-        uint32_t ts = RTC_Timer32CounterGet();
-        json_object_dotset_number(update_message_object, "timestamp", ts);
-        json_object_dotset_string(update_message_object, "Led_Status", ((STATUS_LED_Get()) ? "off" : "on"));
-#else
-        //json_object_dotset_string(update_message_object, "state.reported.led1", ((STATUS_LED_Get()) ? "off" : "on"));
-        json_object_dotset_string(update_message_object, "state.reported.led1", sTemp);
-#endif
+        // The cloud IoT Demo failed to publish the MQTT update message
+        cloud_iot_set_status(CLOUD_STATE_CLOUD_REPORTING,
+                             CLOUD_STATUS_CLOUD_REPORT_FAILURE,
+                             "The cloud IoT Demo failed to publish the MQTT shadow update message.");
 
-        json_serialize_to_buffer(update_message_value, json_message, sizeof(json_message));
-        message.qos      = qos;
-        message.retained = 0;
-        message.dup      = 0;
-        message.id       = cloud_get_message_id();
+        console_print_message("\r\n");
+        console_print_error_message("The cloud IoT Demo failed to publish the MQTT shadow update message.");
+    }
 
-        message.payload = (void*)payload;
-        message.payloadlen = payload_len;
+    return mqtt_status;
+}
 
-        console_print_message("Publishing MQTT Shadow Update Message:");
-        console_print_hex_dump(message.payload, message.payloadlen);
+uint16_t CLOUD_publishId(void)
+{
+    return g_publish_message.id;
+}
 
-        config_get_client_pub_topic(g_mqtt_update_topic_name, sizeof(g_mqtt_update_topic_name));
-        mqtt_status = MQTTPublish(&g_mqtt_client, g_mqtt_update_topic_name, &message);
-        if (mqtt_status != SUCCESS)
-        {
-            // The cloud IoT Demo failed to publish the MQTT LED update message
-            cloud_iot_set_status(CLOUD_STATE_CLOUD_REPORTING,
-                                 CLOUD_STATUS_CLOUD_REPORT_FAILURE,
-                                 "The cloud IoT Demo failed to publish the MQTT shadow update message.");
+bool CLOUD_isConnected(void)
+{
+    return g_mqtt_client.isconnected == 1;
+}
 
-            console_print_message("\r\n");
-            console_print_error_message("The cloud IoT Demo failed to publish the MQTT shadow update message.");
-        }
+void CLOUD_publishData(uint8_t* topic, uint8_t* payload, uint16_t payload_len, int qos)
+{
+    MQTTMessage message;
+    int mqtt_status = FAILURE;
+
+    // Only publish message when in the reporting state
+    if (g_mqtt_client.isconnected != 1)
+    {
+        return;
     }
-    while (false);
 
-    // Free allocated memory
-    json_value_free(update_message_value);
-    
+    message.qos        = qos;
+    message.retained   = 0;
+    message.dup        = 0;
+    message.payload    = payload;
+    message.payloadlen = payload_len;
+
+    STATUS_LED_Toggle();
 
-}
\ No newline at end of file
+    // The PUBACK is read by MQTTPoll() and the client resends the publish
+    // from its in-flight buffer until it comes
+    mqtt_status = MQTTPublishAsync(&g_mqtt_client, (const char*)topic, &message);
+    if (mqtt_status != SUCCESS)
+    {
+        console_print_message("\r\n");
+        console_print_error_message("The cloud IoT Demo failed to publish the MQTT shadow update message.");
+    }
+}
@@ -35,6 +35,10 @@
 
 #define min(x, y) ((x) > (y) ? (y) : (x))
 
+/* Returned by cloud_wifi_read_data() when the requested bytes have not been
+ * received within the timeout. Nothing is consumed, the caller retries later. */
+#define CLOUD_WIFI_WOULD_BLOCK (0)
+
 enum wifi_status
 {
     WIFI_STATUS_UNKNOWN          = 0,
@@ -57,6 +61,11 @@ enum cloud_iot_state cloud_wifi_get_state(void);
 
 int cloud_wifi_read_data(uint8_t *read_buffer, uint32_t read_length,
                          uint32_t timeout_ms);
+
+/* Partial reads: hand out whatever has been received so far without waiting
+ * for a full packet. */
+int cloud_wifi_read_available(uint8_t *read_buffer, uint32_t max_length);
+
 int cloud_wifi_send_data(uint8_t *send_buffer, uint32_t send_length,
                          uint32_t timeout_ms);
 
@@ -64,6 +73,23 @@ void cloud_publish_message(void);
 
 void client_timer_update(void);
 
+/* Called every telemetry interval, the next telemetry goes out once the
+ * publish interval has passed as well. */
+void cloud_wifi_telemetry_due(void);
+
+/* In-place publish: CLOUD_publishReserve() returns where the payload goes in
+ * the MQTT send buffer, just after the PUBLISH header, or NULL when the client
+ * is not connected or, for QoS1, every in-flight slot is taken. Write the
+ * payload there and send it with CLOUD_publishCommit() before making any other
+ * MQTT call. Commit returns the MQTTPublishCommit() status without waiting for
+ * the PUBACK; process_publish_complete() gets it with the CLOUD_publishId() of
+ * the publish. CLOUD_isConnected() tells the two NULL cases apart: a full
+ * in-flight window frees up as PUBACKs arrive, so hold on to the payload. */
+uint8_t* CLOUD_publishReserve(uint8_t* topic, int qos, uint16_t* max_payload_len);
+int CLOUD_publishCommit(uint16_t payload_len);
+uint16_t CLOUD_publishId(void);
+bool CLOUD_isConnected(void);
+
  void CLOUD_publishData (uint8_t* topic, uint8_t* payload, uint16_t payload_len, int qos);
 
 #endif // CLOUD_WIFI_TASK_H
\ No newline at end of file
@@ -20,6 +20,8 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #pragma GCC diagnostic ignored "-Wcast-align"
 
+#include <string.h>
+
 #include "MQTTClient.h"
 
 static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessage) {
@@ -33,18 +35,20 @@ static int getNextPacketId(MQTTClient *c) {
 }
 
 
-static int sendPacket(MQTTClient* c, int length, Timer* timer)
+static int sendBuffer(MQTTClient* c, unsigned char* buf, int length, Timer* timer)
 {
     int rc = FAILURE, 
         sent = 0;
     
-    while (sent < length && !TimerIsExpired(timer))
+    /* always try once, cycle() may send acks and resends on a timer that already ran out */
+    do
     {
-        rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length, TimerLeftMS(timer));
+        rc = c->ipstack->mqttwrite(c->ipstack, &buf[sent], length - sent, TimerLeftMS(timer));
         if (rc < 0)  // there was an error writing the data
             break;
         sent += rc;
     }
+    while (sent < length && !TimerIsExpired(timer));
     if (sent == length)
     {
         TimerCountdown(&c->ping_timer, c->keepAliveInterval); // record the fact that we have successfully sent the packet
@@ -56,6 +60,12 @@ static int sendPacket(MQTTClient* c, int length, Timer* timer)
 }
 
 
+static int sendPacket(MQTTClient* c, int length, Timer* timer)
+{
+    return sendBuffer(c, c->buf, length, timer);
+}
+
+
 void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeout_ms,
 		unsigned char* sendbuf, size_t sendbuf_size, unsigned char* readbuf, size_t readbuf_size)
 {
@@ -64,6 +74,7 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     
     for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
         c->messageHandlers[i].topicFilter = 0;
+    MQTTTopicIndexReset(&c->topicIndex);
     c->command_timeout_ms = command_timeout_ms;
     c->buf = sendbuf;
     c->buf_size = sendbuf_size;
@@ -73,6 +84,20 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->ping_outstanding = 0;
     c->defaultMessageHandler = NULL;
 	c->next_packetid = 1;
+    c->publish_varheader = 0;
+    c->publish_payload = 0;
+    c->publish_chunked = 0;
+    c->rx_len = 0;
+    c->rx_total = 0;
+    c->rx_header_len = 0;
+    c->rx_offset = 0;
+    c->pending.type = 0;
+    c->pending.rc = SUCCESS;
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+        c->inflight[i].id = 0;
+    c->inflight_buf = NULL;
+    c->inflight_slot_size = 0;
+    c->publishComplete = NULL;
     TimerInit(&c->ping_timer);
 #if defined(MQTT_TASK)
 	MutexInit(&c->mutex);
@@ -80,110 +105,220 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
 }
 
 
-static int decodePacket(MQTTClient* c, int* value, int timeout)
+static int readSome(MQTTClient* c, unsigned char* buf, int len, Timer* timer, int wait)
 {
-    unsigned char i;
-    int multiplier = 1;
-    int len = 0;
-    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+    if (wait || c->ipstack->mqttreadavailable == NULL)
+        return c->ipstack->mqttread(c->ipstack, buf, len, TimerLeftMS(timer));
+    return c->ipstack->mqttreadavailable(c->ipstack, buf, len);
+}
 
-    *value = 0;
-    do
+
+/* Pass a publish too big for readbuf to the chunk handlers as it arrives. The topic and packet id are
+ * collected in readbuf after the fixed header, each read of the payload goes into the space left after
+ * them and straight out to the handlers. Like assemblePacket, a read that runs out of data leaves its
+ * place in the client (rx_len, rx_offset) and the next call carries on from there.
+ * wait - block in mqttread, otherwise take at most one readbuf of payload from what has been received
+ * returns PUBLISH once all of the payload has been handed out, 0 while more data is needed, or FAILURE */
+static int readPublishChunks(MQTTClient* c, Timer* timer, int wait)
+{
+    MQTTHeader header = {0};
+    MQTTString topicName = MQTTString_initializer;
+    MQTTMessage msg;
+    unsigned char handlers[MAX_MESSAGE_HANDLERS];
+    unsigned char* chunk;
+    int hdrlen = c->rx_header_len,
+      rem_len = c->rx_total - c->rx_header_len;
+    int count, i, len;
+    int topiclen = 0, varlen, space;
+    size_t totallen;
+
+    header.byte = c->readbuf[0];
+
+    /* the topic and packet id have to fit, the payload is read into whatever space is left after them */
+    for (;;)
     {
-        int rc = MQTTPACKET_READ_ERROR;
+        int known = (c->rx_len - hdrlen >= 2);
 
-        if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+        varlen = 2;
+        if (known)
         {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
+            topiclen = (c->readbuf[hdrlen] << 8) + c->readbuf[hdrlen + 1];
+            varlen = 2 + topiclen + ((header.bits.qos > 0) ? 2 : 0);
         }
-        rc = c->ipstack->mqttread(c->ipstack, &i, 1, timeout);
-        if (rc != 1)
-            goto exit;
-        *value += (i & 127) * multiplier;
-        multiplier *= 128;
-    } while ((i & 128) != 0);
-exit:
-    return len;
+        if (varlen > rem_len || (int)c->readbuf_size - hdrlen - varlen <= 0)
+            return FAILURE;
+        if (known && c->rx_len == hdrlen + varlen)
+            break;
+        if ((len = readSome(c, c->readbuf + c->rx_len, hdrlen + varlen - c->rx_len, timer, wait)) <= 0)
+            return (len < 0) ? FAILURE : 0;
+        c->rx_len += len;
+    }
+
+    topicName.lenstring.data = (char*)c->readbuf + hdrlen + 2;
+    topicName.lenstring.len = topiclen;
+    msg.qos = (enum QoS)header.bits.qos;
+    msg.retained = header.bits.retain;
+    msg.dup = header.bits.dup;
+    msg.id = (header.bits.qos > 0) ? (c->readbuf[hdrlen + varlen - 2] << 8) + c->readbuf[hdrlen + varlen - 1] : 0;
+
+    chunk = c->readbuf + hdrlen + varlen;
+    space = c->readbuf_size - hdrlen - varlen;
+    totallen = rem_len - varlen;
+    do
+    {
+        int chunklen = (totallen - c->rx_offset < (size_t)space) ? (int)(totallen - c->rx_offset) : space;
+
+        // keep reading with no one to hand the payload to, so the stream stays in step
+        if (chunklen > 0 && (chunklen = readSome(c, chunk, chunklen, timer, wait)) <= 0)
+            return (chunklen < 0) ? FAILURE : 0;
+        msg.payload = chunk;
+        msg.payloadlen = chunklen;
+        count = MQTTTopicIndexMatch(&c->topicIndex, &topicName, handlers);
+        for (i = 0; i < count; ++i)
+        {
+            if (c->messageHandlers[handlers[i]].chunkfp != NULL)
+            {
+                MessageData md;
+                NewMessageData(&md, &topicName, &msg);
+                c->messageHandlers[handlers[i]].chunkfp(&md, c->rx_offset, totallen);
+            }
+        }
+        c->rx_offset += chunklen;
+    }
+    while (c->rx_offset < totallen && wait);
+
+    if (c->rx_offset < totallen)
+        return 0;
+    c->publish_chunked = 1;
+    return PUBLISH;
 }
 
 
-static int readPacket(MQTTClient* c, Timer* timer)
+/* Collect the next packet in readbuf. A read that runs out of data leaves what it has in
+ * readbuf and the next call carries on from there, so the stream never loses its place.
+ * wait - block in mqttread, otherwise take only what mqttreadavailable has already received
+ * returns the packet type once it is complete, 0 while more data is needed, or FAILURE */
+static int assemblePacket(MQTTClient* c, Timer* timer, int wait)
 {
-    int rc = FAILURE;
+    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
     MQTTHeader header = {0};
-    int len = 0;
-    int rem_len = 0;
+    int rc = 0;
 
-    /* 1. read the header byte.  This has the packet type in it */
-    if (c->ipstack->mqttread(c->ipstack, c->readbuf, 1, TimerLeftMS(timer)) != 1)
-        goto exit;
+    if (c->rx_len == 0)
+        c->publish_chunked = 0;
 
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, TimerLeftMS(timer));
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
+    for (;;)
+    {
+        /* the header byte and the remaining length are read a byte at a time, then the rest at once */
+        int need = (c->rx_total > 0) ? c->rx_total - c->rx_len : 1;
+        int len;
 
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, TimerLeftMS(timer)) != rem_len))
-        goto exit;
+        if (c->rx_header_len > 0)
+        {
+            rc = readPublishChunks(c, timer, wait);
+            break;
+        }
 
-    header.byte = c->readbuf[0];
-    rc = header.bits.type;
-exit:
+        len = readSome(c, c->readbuf + c->rx_len, need, timer, wait);
+        if (len < 0)
+        {
+            rc = FAILURE;
+            break;
+        }
+        if (len == 0)
+            break;
+        c->rx_len += len;
+
+        if (c->rx_total == 0 && c->rx_len > 1)
+        {
+            if ((c->readbuf[c->rx_len - 1] & 128) == 0)
+            {
+                int rem_len = 0;
+                MQTTPacket_decodeBuf(c->readbuf + 1, &rem_len);
+                c->rx_total = c->rx_len + rem_len;
+            }
+            else if (c->rx_len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+            {
+                rc = FAILURE; /* bad data */
+                break;
+            }
+        }
+
+        header.byte = c->readbuf[0];
+        /* a publish too big for readbuf is passed to the handlers as it is read, anything else that big is bad data */
+        if (c->rx_total > (int)c->readbuf_size)
+        {
+            if (header.bits.type != PUBLISH)
+            {
+                rc = FAILURE;
+                break;
+            }
+            c->rx_header_len = c->rx_len;
+            c->rx_offset = 0;
+            continue;
+        }
+        if (c->rx_total > 0 && c->rx_len == c->rx_total)
+        {
+            rc = header.bits.type;
+            break;
+        }
+    }
+
+    if (rc != 0) /* done with this packet, the next call starts a new one */
+    {
+        c->rx_len = 0;
+        c->rx_total = 0;
+        c->rx_header_len = 0;
+        c->rx_offset = 0;
+    }
     return rc;
 }
 
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-static char isTopicMatched(char* topicFilter, MQTTString* topicName)
+static int readPacket(MQTTClient* c, Timer* timer)
 {
-    char* curf = topicFilter;
-    char* curn = topicName->lenstring.data;
-    char* curn_end = curn + topicName->lenstring.len;
-    
-    while (*curf && curn < curn_end)
+    int rc = assemblePacket(c, timer, 1);
+
+    return (rc == 0) ? FAILURE : rc;
+}
+
+
+static void rebuildTopicIndex(MQTTClient* c)
+{
+    int i;
+
+    MQTTTopicIndexReset(&c->topicIndex);
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
     {
-        if (*curn == '/' && *curf != '/')
-            break;
-        if (*curf != '+' && *curf != '#' && *curf != *curn)
-            break;
-        if (*curf == '+')
-        {   // skip until we meet the next separator, or end of string
-            char* nextpos = curn + 1;
-            while (nextpos < curn_end && *nextpos != '/')
-                nextpos = ++curn + 1;
-        }
-        else if (*curf == '#')
-            curn = curn_end - 1;    // skip until end of string
-        curf++;
-        curn++;
-    };
-    
-    return (curn == curn_end) && (*curf == '\0');
+        if (c->messageHandlers[i].topicFilter != 0)
+            MQTTTopicIndexAdd(&c->topicIndex, i, c->messageHandlers[i].topicFilter);
+    }
 }
 
 
 int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 {
-    int i;
+    unsigned char handlers[MAX_MESSAGE_HANDLERS];
+    int i, count;
     int rc = FAILURE;
 
     // we have to find the right message handler - indexed by topic
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    count = MQTTTopicIndexMatch(&c->topicIndex, topicName, handlers);
+    for (i = 0; i < count; ++i)
     {
-        if (c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(topicName, (char*)c->messageHandlers[i].topicFilter) ||
-                isTopicMatched((char*)c->messageHandlers[i].topicFilter, topicName)))
+        if (c->messageHandlers[handlers[i]].fp != NULL)
         {
-            if (c->messageHandlers[i].fp != NULL)
-            {
-                MessageData md;
-                NewMessageData(&md, topicName, message);
-                c->messageHandlers[i].fp(&md);
-                rc = SUCCESS;
-            }
+            MessageData md;
+            NewMessageData(&md, topicName, message);
+            c->messageHandlers[handlers[i]].fp(&md);
+            rc = SUCCESS;
+        }
+        else if (c->messageHandlers[handlers[i]].chunkfp != NULL)
+        {   // it all fitted in readbuf, so it is a single piece
+            MessageData md;
+            NewMessageData(&md, topicName, message);
+            c->messageHandlers[handlers[i]].chunkfp(&md, 0, message->payloadlen);
+            rc = SUCCESS;
         }
     }
     
@@ -227,30 +362,138 @@ exit:
 }
 
 
-int cycle(MQTTClient* c, Timer* timer)
+static void completeInflight(MQTTClient* c, int i, int rc)
+{
+    unsigned short id = c->inflight[i].id;
+
+    c->inflight[i].id = 0;
+    if (c->publishComplete != NULL)
+        c->publishComplete(id, rc);
+}
+
+
+static void failInflight(MQTTClient* c)
+{
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+    {
+        if (c->inflight[i].id != 0)
+            completeInflight(c, i, FAILURE);
+    }
+}
+
+
+static unsigned char* inflightPacket(MQTTClient* c, int i)
+{
+    return &c->inflight_buf[i * c->inflight_slot_size];
+}
+
+
+/* Takes a free in-flight slot for the QoS1 publish serialized in packet, keeps a copy of it
+ * for resends when it fits the slot, and sends it. */
+static int startInflight(MQTTClient* c, unsigned short id, unsigned char* packet, int len, Timer* timer)
+{
+    int rc = FAILURE;
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES && c->inflight[i].id != 0; ++i)
+        ;
+    if (i == MAX_INFLIGHT_PUBLISHES)
+        return INFLIGHT_FULL;
+
+    c->inflight[i].retries = 0;
+    c->inflight[i].packetlen = 0;
+    if (c->inflight_buf != NULL && len <= c->inflight_slot_size)
+    {
+        memcpy(inflightPacket(c, i), packet, len);
+        c->inflight[i].packetlen = len;
+    }
+
+    if ((rc = sendBuffer(c, packet, len, timer)) == SUCCESS)
+    {
+        c->inflight[i].id = id;
+        TimerInit(&c->inflight[i].timer);
+        TimerCountdownMS(&c->inflight[i].timer, c->command_timeout_ms);
+    }
+    return rc;
+}
+
+
+static void ackInflight(MQTTClient* c)
+{
+    unsigned short mypacketid;
+    unsigned char dup, type;
+    int i;
+
+    if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+        return;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+    {
+        if (c->inflight[i].id == mypacketid)
+        {
+            completeInflight(c, i, SUCCESS);
+            break;
+        }
+    }
+}
+
+
+static int retryInflight(MQTTClient* c, Timer* timer)
+{
+    int rc = SUCCESS;
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES && rc == SUCCESS; ++i)
+    {
+        if (c->inflight[i].id == 0 || !TimerIsExpired(&c->inflight[i].timer))
+            continue;
+
+        if (c->inflight[i].packetlen == 0 || c->inflight[i].retries++ >= MAX_PUBLISH_RETRIES)
+            completeInflight(c, i, FAILURE);
+        else
+        {
+            unsigned char* packet = inflightPacket(c, i);
+            MQTTHeader header = {0};
+
+            header.byte = packet[0];
+            header.bits.dup = 1;
+            packet[0] = header.byte;
+            rc = sendBuffer(c, packet, c->inflight[i].packetlen, timer);
+            TimerCountdownMS(&c->inflight[i].timer, c->command_timeout_ms);
+        }
+    }
+
+    return rc;
+}
+
+
+static int handlePacket(MQTTClient* c, unsigned short packet_type, Timer* timer)
 {
-    // read the socket, see what work is due
-    unsigned short packet_type = readPacket(c, timer);
-    
     int len = 0,
         rc = SUCCESS;
 
     switch (packet_type)
     {
         case CONNACK:
-        case PUBACK:
         case SUBACK:
             break;
+        case PUBACK:
+            ackInflight(c);
+            break;
         case PUBLISH:
         {
             MQTTString topicName;
             MQTTMessage msg;
-            int intQoS;
+            int intQoS, intPayloadlen;
             if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
-               (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1)
+               (unsigned char**)&msg.payload, &intPayloadlen, c->readbuf, c->readbuf_size) != 1)
                 goto exit;
             msg.qos = (enum QoS)intQoS;
-            deliverMessage(c, &topicName, &msg);
+            msg.payloadlen = intPayloadlen; // size_t may be wider than int
+            if (!c->publish_chunked) // the payload of a chunked publish has already been handed out
+                deliverMessage(c, &topicName, &msg);
             if (msg.qos != QOS0)
             {
                 if (msg.qos == QOS1)
@@ -286,8 +529,19 @@ int cycle(MQTTClient* c, Timer* timer)
             c->ping_outstanding = 0;
             break;
     }
-    keepalive(c);
 exit:
+    return rc;
+}
+
+
+int cycle(MQTTClient* c, Timer* timer)
+{
+    // read the socket, see what work is due
+    unsigned short packet_type = readPacket(c, timer);
+    int rc = handlePacket(c, packet_type, timer);
+
+    if (rc == SUCCESS && (rc = retryInflight(c, timer)) == SUCCESS)
+        keepalive(c);
     if (rc == SUCCESS)
         rc = packet_type;
     return rc;
@@ -371,6 +625,12 @@ int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
 #endif
 	if (c->isconnected) /* don't send connect packet again if we are already connected */
 		goto exit;
+
+    failInflight(c); /* a new session, nothing from the last one will be acknowledged */
+    c->rx_len = 0;
+    c->rx_total = 0;
+    c->rx_header_len = 0;
+    c->rx_offset = 0;
     
     TimerInit(&connect_timer);
     TimerCountdownMS(&connect_timer, c->command_timeout_ms);
@@ -410,7 +670,32 @@ exit:
 }
 
 
-int MQTTSubscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler)
+static int addMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler,
+        messageChunkHandler chunkHandler)
+{
+    int i;
+
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    {
+        if (c->messageHandlers[i].topicFilter == 0)
+        {
+            c->messageHandlers[i].topicFilter = topicFilter;
+            c->messageHandlers[i].fp = messageHandler;
+            c->messageHandlers[i].chunkfp = chunkHandler;
+            if (MQTTTopicIndexAdd(&c->topicIndex, i, topicFilter) == 0)
+                return SUCCESS;
+            // no room left to compile the filter, drop the handler again
+            c->messageHandlers[i].topicFilter = 0;
+            rebuildTopicIndex(c);
+            break;
+        }
+    }
+    return FAILURE;
+}
+
+
+static int subscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler,
+        messageChunkHandler chunkHandler)
 { 
     int rc = FAILURE;  
     Timer timer;
@@ -439,21 +724,9 @@ int MQTTSubscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageH
         int count = 0, grantedQoS = -1;
         unsigned short mypacketid;
         if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) == 1)
-            rc = grantedQoS; // 0, 1, 2 or 0x80 
+            rc = (unsigned char)grantedQoS; // 0, 1, 2 or 0x80, read back as a signed char
         if (rc != 0x80)
-        {
-            int i;
-            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-            {
-                if (c->messageHandlers[i].topicFilter == 0)
-                {
-                    c->messageHandlers[i].topicFilter = topicFilter;
-                    c->messageHandlers[i].fp = messageHandler;
-                    rc = 0;
-                    break;
-                }
-            }
-        }
+            rc = addMessageHandler(c, topicFilter, messageHandler, chunkHandler);
     }
     else 
         rc = FAILURE;
@@ -466,6 +739,18 @@ exit:
 }
 
 
+int MQTTSubscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler)
+{
+    return subscribe(c, topicFilter, qos, messageHandler, NULL);
+}
+
+
+int MQTTSubscribeChunked(MQTTClient* c, const char* topicFilter, enum QoS qos, messageChunkHandler chunkHandler)
+{
+    return subscribe(c, topicFilter, qos, NULL, chunkHandler);
+}
+
+
 int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
 {   
     int rc = FAILURE;
@@ -492,7 +777,16 @@ int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
     {
         unsigned short mypacketid;  // should be the same as the packetid above
         if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) == 1)
-            rc = 0; 
+        {
+            int i;
+            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+            {
+                if (c->messageHandlers[i].topicFilter != 0 && strcmp(c->messageHandlers[i].topicFilter, topicFilter) == 0)
+                    c->messageHandlers[i].topicFilter = 0;
+            }
+            rebuildTopicIndex(c);
+            rc = 0;
+        }
     }
     else
         rc = FAILURE;
@@ -505,6 +799,33 @@ exit:
 }
 
 
+static int waitforPublishAck(MQTTClient* c, int qos, unsigned short id, Timer* timer)
+{
+    int rc = SUCCESS;
+    int packet_type = (qos == QOS1) ? PUBACK : PUBCOMP;
+
+    if (qos == QOS0)
+        return rc;
+
+    /* acks for async publishes may arrive first, keep going until ours does */
+    do
+    {
+        unsigned short mypacketid = 0;
+        unsigned char dup, type;
+
+        rc = FAILURE;
+        if (waitfor(c, packet_type, timer) != packet_type)
+            break;
+        if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+            break;
+        if (mypacketid == id)
+            rc = SUCCESS;
+    } while (rc != SUCCESS);
+
+    return rc;
+}
+
+
 int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
 {
     int rc = FAILURE;
@@ -532,31 +853,315 @@ int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
     if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
         goto exit; // there was a problem
     
+    rc = waitforPublishAck(c, message->qos, message->id, &timer);
+    
+exit:
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
+int MQTTPublishAsync(MQTTClient* c, const char* topicName, MQTTMessage* message)
+{
+    int rc = FAILURE;
+    Timer timer;
+    MQTTString topic = MQTTString_initializer;
+    topic.cstring = (char *)topicName;
+    int len = 0;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+	if (!c->isconnected)
+		goto exit;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    if (message->qos == QOS0)
+    {
+        len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
+                  topic, (unsigned char*)message->payload, message->payloadlen);
+        if (len > 0)
+            rc = sendPacket(c, len, &timer);
+        goto exit;
+    }
+
+    if (message->qos != QOS1)
+        goto exit;
+
+    if (MQTTPublishInflight(c) == MAX_INFLIGHT_PUBLISHES)
+    {
+        rc = INFLIGHT_FULL;
+        goto exit;
+    }
+
+    message->id = getNextPacketId(c);
+    len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
+              topic, (unsigned char*)message->payload, message->payloadlen);
+    if (len > 0)
+        rc = startInflight(c, message->id, c->buf, len, &timer);
+
+exit:
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
+void MQTTSetInflightBuffer(MQTTClient* c, unsigned char* buf, size_t size)
+{
+    c->inflight_buf = buf;
+    c->inflight_slot_size = (buf == NULL) ? 0 : (int)(size / MAX_INFLIGHT_PUBLISHES);
+}
+
+
+void MQTTSetPublishCompleteHandler(MQTTClient* c, publishCompleteHandler handler)
+{
+    c->publishComplete = handler;
+}
+
+
+int MQTTPublishInflight(MQTTClient* c)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+    {
+        if (c->inflight[i].id != 0)
+            ++count;
+    }
+
+    return count;
+}
+
+
+/* MQTTPacket_len() rounds up at the 127/128 boundary, which is fine for sizing a
+ * buffer but not for placing the fixed header right in front of the variable header */
+static int remainingLengthBytes(int rem_len)
+{
+    int len = 1;
+
+    while (rem_len >= 128 && len < 4)
+    {
+        rem_len /= 128;
+        ++len;
+    }
+    return len;
+}
+
+
+/* The fixed header is written last, right in front of the variable header, so
+ * room is kept for the longest remaining length the send buffer can hold. */
+int MQTTPublishReserve(MQTTClient* c, const char* topicName, MQTTMessage* message,
+        unsigned char** payload, int* max_payloadlen)
+{
+    int rc = FAILURE;
+    MQTTString topic = MQTTString_initializer;
+    topic.cstring = (char *)topicName;
+    unsigned char* ptr = NULL;
+    int header_len = MQTTPacket_len((int)c->buf_size) - (int)c->buf_size;
+
+	if (!c->isconnected)
+		goto exit;
+
+    /* QoS1 publishes go into the in-flight window, QoS2 is not supported on this path */
+    if (message->qos == QOS2)
+        goto exit;
+    if (message->qos == QOS1 && MQTTPublishInflight(c) == MAX_INFLIGHT_PUBLISHES)
+    {
+        rc = INFLIGHT_FULL;
+        goto exit;
+    }
+
+    c->publish_varheader = header_len;
+    c->publish_payload = header_len + MQTTSerialize_publishLength(message->qos, topic, 0);
+    if (c->publish_payload >= (int)c->buf_size)
+        goto exit;
+
     if (message->qos == QOS1)
+        message->id = getNextPacketId(c);
+
+    ptr = &c->buf[c->publish_varheader];
+    writeMQTTString(&ptr, topic);
+    if (message->qos > 0)
+        writeInt(&ptr, message->id);
+
+    *payload = &c->buf[c->publish_payload];
+    *max_payloadlen = c->buf_size - c->publish_payload;
+    rc = SUCCESS;
+
+exit:
+    return rc;
+}
+
+
+int MQTTPublishCommit(MQTTClient* c, MQTTMessage* message, int payloadlen)
+{
+    int rc = FAILURE;
+    Timer timer;
+    MQTTHeader header = {0};
+    unsigned char* ptr = NULL;
+    int rem_len = 0;
+    int start = 0;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+	if (!c->isconnected || c->publish_payload == 0)
+		goto exit;
+    if (payloadlen < 0 || payloadlen > (int)c->buf_size - c->publish_payload)
+        goto exit;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    rem_len = c->publish_payload - c->publish_varheader + payloadlen;
+    start = c->publish_varheader - 1 - remainingLengthBytes(rem_len);
+
+    header.bits.type = PUBLISH;
+    header.bits.dup = 0;
+    header.bits.qos = message->qos;
+    header.bits.retain = message->retained;
+    ptr = &c->buf[start];
+    writeChar(&ptr, header.byte);
+    MQTTPacket_encode(ptr, rem_len);
+
+    message->payload = &c->buf[c->publish_payload];
+    message->payloadlen = payloadlen;
+    c->publish_payload = 0;
+
+    if (message->qos == QOS0)
+        rc = sendBuffer(c, &c->buf[start], c->publish_varheader - start + rem_len, &timer);
+    else
+        rc = startInflight(c, message->id, &c->buf[start], c->publish_varheader - start + rem_len, &timer);
+
+exit:
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
+static void startPending(MQTTClient* c, unsigned char type, unsigned short id)
+{
+    c->pending.type = type;
+    c->pending.id = id;
+    c->pending.rc = PENDING;
+    TimerInit(&c->pending.timer);
+    TimerCountdownMS(&c->pending.timer, c->command_timeout_ms);
+}
+
+
+static void completePending(MQTTClient* c)
+{
+    int rc = FAILURE;
+
+    if (c->pending.type == CONNACK)
     {
-        if (waitfor(c, PUBACK, &timer) == PUBACK)
+        unsigned char connack_rc = 255;
+        unsigned char sessionPresent = 0;
+        if (MQTTDeserialize_connack(&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) == 1 && connack_rc == 0)
         {
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
+            c->isconnected = 1;
+            c->ping_outstanding = 0;
+            rc = SUCCESS;
         }
-        else
-            rc = FAILURE;
     }
-    else if (message->qos == QOS2)
+    else if (c->pending.type == SUBACK)
     {
-        if (waitfor(c, PUBCOMP, &timer) == PUBCOMP)
+        int count = 0, grantedQoS = -1;
+        unsigned short mypacketid;
+        if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, c->readbuf, c->readbuf_size) == 1)
         {
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
+            if (mypacketid != c->pending.id)
+                return; // not the one we are waiting for
+            if ((unsigned char)grantedQoS != 0x80) // read back as a signed char
+                rc = addMessageHandler(c, c->pending.topicFilter, c->pending.fp, c->pending.chunkfp);
         }
-        else
-            rc = FAILURE;
     }
-    
+    c->pending.type = 0;
+    c->pending.rc = rc;
+}
+
+
+int MQTTConnectAsync(MQTTClient* c, MQTTPacket_connectData* options)
+{
+    Timer timer;
+    int rc = FAILURE;
+    MQTTPacket_connectData default_options = MQTTPacket_connectData_initializer;
+    int len = 0;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+	if (c->isconnected || c->pending.type != 0)
+		goto exit;
+
+    failInflight(c); /* a new session, nothing from the last one will be acknowledged */
+    c->rx_len = 0;
+    c->rx_total = 0;
+    c->rx_header_len = 0;
+    c->rx_offset = 0;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    if (options == 0)
+        options = &default_options; /* set default options if none were supplied */
+
+    c->keepAliveInterval = options->keepAliveInterval;
+    TimerCountdown(&c->ping_timer, c->keepAliveInterval);
+    if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
+        goto exit;
+    if ((rc = sendPacket(c, len, &timer)) != SUCCESS)  // send the connect packet
+        goto exit; // there was a problem
+
+    startPending(c, CONNACK, 0); // MQTTPoll picks up the connack
+exit:
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
+static int subscribeAsync(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler,
+        messageChunkHandler chunkHandler)
+{
+    int rc = FAILURE;
+    Timer timer;
+    int len = 0;
+    unsigned short id;
+    MQTTString topic = MQTTString_initializer;
+    topic.cstring = (char *)topicFilter;
+	int requested_qos[1]={qos};
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+	if (!c->isconnected || c->pending.type != 0)
+		goto exit;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    id = getNextPacketId(c);
+    len = MQTTSerialize_subscribe(c->buf, c->buf_size, 0, id, 1, &topic, requested_qos);
+    if (len <= 0)
+        goto exit;
+    if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
+        goto exit;             // there was a problem
+
+    startPending(c, SUBACK, id); // MQTTPoll picks up the suback
+    c->pending.topicFilter = topicFilter;
+    c->pending.fp = messageHandler;
+    c->pending.chunkfp = chunkHandler;
 exit:
 #if defined(MQTT_TASK)
 	MutexUnlock(&c->mutex);
@@ -565,6 +1170,63 @@ exit:
 }
 
 
+int MQTTSubscribeAsync(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler)
+{
+    return subscribeAsync(c, topicFilter, qos, messageHandler, NULL);
+}
+
+
+int MQTTSubscribeChunkedAsync(MQTTClient* c, const char* topicFilter, enum QoS qos, messageChunkHandler chunkHandler)
+{
+    return subscribeAsync(c, topicFilter, qos, NULL, chunkHandler);
+}
+
+
+int MQTTPendingResult(MQTTClient* c)
+{
+    return (c->pending.type != 0) ? PENDING : c->pending.rc;
+}
+
+
+int MQTTPoll(MQTTClient* c)
+{
+    int rc = SUCCESS;
+    int packet_type;
+    Timer timer;
+
+#if defined(MQTT_TASK)
+	MutexLock(&c->mutex);
+#endif
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    // take whatever has arrived, at most one whole packet is handled per call
+    packet_type = assemblePacket(c, &timer, 0);
+    if (packet_type < 0)
+        rc = FAILURE;
+    else if (packet_type > 0)
+    {
+        rc = handlePacket(c, packet_type, &timer);
+        if (packet_type == c->pending.type)
+            completePending(c);
+    }
+
+    if (c->pending.type != 0 && TimerIsExpired(&c->pending.timer))
+    {
+        c->pending.type = 0;
+        c->pending.rc = FAILURE;
+    }
+
+    if (rc == SUCCESS && c->isconnected && (rc = retryInflight(c, &timer)) == SUCCESS)
+        keepalive(c);
+
+#if defined(MQTT_TASK)
+	MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
 int MQTTDisconnect(MQTTClient* c)
 {  
     int rc = FAILURE;
@@ -582,6 +1244,8 @@ int MQTTDisconnect(MQTTClient* c)
         rc = sendPacket(c, len, &timer);            // send the disconnect packet
         
     c->isconnected = 0;
+    failInflight(c);
+    c->pending.type = 0;
 
 #if defined(MQTT_TASK)
 	MutexUnlock(&c->mutex);
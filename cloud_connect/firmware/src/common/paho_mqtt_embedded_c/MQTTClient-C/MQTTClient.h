@@ -56,10 +56,21 @@
 #define MAX_MESSAGE_HANDLERS 5 /* redefinable - how many subscriptions do you want? */
 #endif
 
+#if !defined(MAX_INFLIGHT_PUBLISHES)
+#define MAX_INFLIGHT_PUBLISHES 4 /* redefinable - how many QoS1 publishes can wait for a PUBACK at once? */
+#endif
+
+#if !defined(MAX_PUBLISH_RETRIES)
+#define MAX_PUBLISH_RETRIES 3 /* redefinable - resends with DUP before an async publish fails */
+#endif
+
+/* Needs MAX_MESSAGE_HANDLERS */
+#include "MQTTTopicIndex.h"
+
 enum QoS { QOS0, QOS1, QOS2 };
 
 /* all failure return codes must be negative */
-enum returnCode { BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESS = 0 };
+enum returnCode { INFLIGHT_FULL = -3, BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESS = 0, PENDING = 1 };
 
 /* The Platform specific header must define the Network and Timer structures and functions
  * which operate on them.
@@ -97,6 +108,13 @@ typedef struct MessageData
 
 typedef void (*messageHandler)(MessageData*);
 
+/* Gets a publish payload in consecutive pieces: message->payload and message->payloadlen hold
+ * one piece, offset is where it starts in the payload and totallen is the whole payload length.
+ * The last piece ends at totallen, a payload of zero length is a single empty piece. */
+typedef void (*messageChunkHandler)(MessageData*, size_t offset, size_t totallen);
+
+typedef void (*publishCompleteHandler)(unsigned short packetid, int rc);
+
 typedef struct MQTTClient
 {
     unsigned int next_packetid,
@@ -113,10 +131,46 @@ typedef struct MQTTClient
     {
         const char* topicFilter;
         void (*fp) (MessageData*);
+        void (*chunkfp) (MessageData*, size_t, size_t);
     } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription topic */
 
+    MQTTTopicIndex topicIndex;      /* finds the messageHandlers for a received topic */
+
     void (*defaultMessageHandler) (MessageData*);
 
+    int publish_varheader,
+      publish_payload;
+    char publish_chunked;      /* the publish in readbuf was too big for it and went to the handlers in pieces */
+
+    struct InflightPublishes
+    {
+        unsigned short id;      /* 0 when the slot is free */
+        unsigned char retries;
+        int packetlen;          /* bytes of the packet kept in the slot for resends, 0 if it did not fit */
+        Timer timer;
+    } inflight[MAX_INFLIGHT_PUBLISHES];       /* QoS1 publishes sent by MQTTPublishAsync, waiting for a PUBACK */
+
+    unsigned char* inflight_buf;    /* MAX_INFLIGHT_PUBLISHES slots of inflight_slot_size bytes */
+    int inflight_slot_size;
+
+    publishCompleteHandler publishComplete;
+
+    int rx_len,                 /* bytes of the next packet collected in readbuf so far */
+      rx_total,                 /* its full length, 0 until the remaining length is known */
+      rx_header_len;            /* for a publish too big for readbuf, where its fixed header ends, 0 otherwise */
+    size_t rx_offset;           /* bytes of that publish's payload already handed to the chunk handlers */
+
+    struct PendingOperation
+    {
+        unsigned char type;     /* CONNACK or SUBACK waited for by MQTTPoll, 0 when nothing is pending */
+        unsigned short id;
+        const char* topicFilter;
+        messageHandler fp;
+        messageChunkHandler chunkfp;
+        int rc;                 /* result of the last operation once it has completed */
+        Timer timer;
+    } pending;
+
     Network* ipstack;
     Timer ping_timer;
 #if defined(MQTT_TASK)
@@ -153,6 +207,65 @@ DLLExport int MQTTConnect(MQTTClient* client, MQTTPacket_connectData* options);
  */
 DLLExport int MQTTPublish(MQTTClient* client, const char*, MQTTMessage*);
 
+/** MQTT Publish Reserve - serialize the PUBLISH variable header into the send buffer and
+ *  hand back the space after it, so the payload can be written in place.
+ *  No other call may use the client until MQTTPublishCommit has been called.
+ *  Only QoS0 and QoS1 are supported.
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to
+ *  @param message - the message qos and retained flags, the id is assigned here
+ *  @param payload - set to where the payload is to be written
+ *  @param max_payloadlen - set to the space available for the payload
+ *  @return success code, INFLIGHT_FULL for QoS1 when every in-flight slot is taken
+ */
+DLLExport int MQTTPublishReserve(MQTTClient* client, const char*, MQTTMessage*,
+        unsigned char** payload, int* max_payloadlen);
+
+/** MQTT Publish Commit - finish the packet started by MQTTPublishReserve and send it
+ *  without waiting. A QoS1 publish is put in the in-flight window like one from
+ *  MQTTPublishAsync, its PUBACK is read by MQTTPoll or MQTTYield and reported to the
+ *  publish complete handler with message->id.
+ *  @param client - the client object to use
+ *  @param message - the message passed to MQTTPublishReserve
+ *  @param payloadlen - the number of payload bytes written
+ *  @return success code of sending the packet
+ */
+DLLExport int MQTTPublishCommit(MQTTClient* client, MQTTMessage*, int payloadlen);
+
+/** MQTT Publish Async - send a QoS0 or QoS1 publish packet without waiting for the PUBACK.
+ *  QoS1 publishes stay in the in-flight table until their PUBACK is read by MQTTPoll or
+ *  MQTTYield, and are sent again with DUP set when it does not come within the command
+ *  timeout. The packet is copied into the in-flight buffer for that, so the topic and payload
+ *  can be reused as soon as this returns. A packet bigger than an in-flight slot is sent once
+ *  and fails if its PUBACK does not come.
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to
+ *  @param message - the message to send, the id is assigned here
+ *  @return success code, INFLIGHT_FULL when every in-flight slot is taken
+ */
+DLLExport int MQTTPublishAsync(MQTTClient* client, const char*, MQTTMessage*);
+
+/** MQTT Set Inflight Buffer - give the client the memory QoS1 publishes are kept in until
+ *  their PUBACK comes. It is split into MAX_INFLIGHT_PUBLISHES equal slots.
+ *  @param client - the client object to use
+ *  @param buf - the buffer, NULL to keep no copies and not resend
+ *  @param size - the buffer size
+ */
+DLLExport void MQTTSetInflightBuffer(MQTTClient* client, unsigned char* buf, size_t size);
+
+/** MQTT Set Publish Complete Handler - set the function called when an async QoS1 publish
+ *  is acknowledged (SUCCESS) or given up on (FAILURE)
+ *  @param client - the client object to use
+ *  @param handler - the function to call, may be NULL
+ */
+DLLExport void MQTTSetPublishCompleteHandler(MQTTClient* client, publishCompleteHandler);
+
+/** MQTT Publish Inflight - number of async publishes still waiting for a PUBACK
+ *  @param client - the client object to use
+ *  @return the number of in-flight publishes
+ */
+DLLExport int MQTTPublishInflight(MQTTClient* client);
+
 /** MQTT Subscribe - send an MQTT subscribe packet and wait for suback before returning.
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter to subscribe to
@@ -161,6 +274,18 @@ DLLExport int MQTTPublish(MQTTClient* client, const char*, MQTTMessage*);
  */
 DLLExport int MQTTSubscribe(MQTTClient* client, const char* topicFilter, enum QoS, messageHandler);
 
+/** MQTT Subscribe Chunked - subscribe like MQTTSubscribe, but have the payloads of matching
+ *  publishes handed over in pieces. Publishes bigger than the read buffer can only be received
+ *  this way, the topic is decoded first and the payload is read into the space left after it.
+ *  Plain handlers never see such publishes.
+ *  @param client - the client object to use
+ *  @param topicFilter - the topic filter to subscribe to
+ *  @param qos - the requested QoS
+ *  @param handler - called with each piece of the payload
+ *  @return success code
+ */
+DLLExport int MQTTSubscribeChunked(MQTTClient* client, const char* topicFilter, enum QoS, messageChunkHandler);
+
 /** MQTT Subscribe - send an MQTT unsubscribe packet and wait for unsuback before returning.
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter to unsubscribe from
@@ -168,6 +293,49 @@ DLLExport int MQTTSubscribe(MQTTClient* client, const char* topicFilter, enum Qo
  */
 DLLExport int MQTTUnsubscribe(MQTTClient* client, const char* topicFilter);
 
+/** MQTT Connect Async - send an MQTT connect packet and return without waiting for the Connack.
+ *  MQTTPoll completes the connect, MQTTPendingResult tells when it is done.
+ *  @param client - the client object to use
+ *  @param options - connect options
+ *  @return success code of sending the packet
+ */
+DLLExport int MQTTConnectAsync(MQTTClient* client, MQTTPacket_connectData* options);
+
+/** MQTT Subscribe Async - send an MQTT subscribe packet and return without waiting for the suback.
+ *  MQTTPoll installs the handler when the suback comes, MQTTPendingResult tells when it is done.
+ *  @param client - the client object to use
+ *  @param topicFilter - the topic filter to subscribe to
+ *  @param qos - the requested QoS
+ *  @param handler - the message handler
+ *  @return success code of sending the packet
+ */
+DLLExport int MQTTSubscribeAsync(MQTTClient* client, const char* topicFilter, enum QoS, messageHandler);
+
+/** MQTT Subscribe Chunked Async - MQTTSubscribeAsync for a chunk handler, see MQTTSubscribeChunked.
+ *  @param client - the client object to use
+ *  @param topicFilter - the topic filter to subscribe to
+ *  @param qos - the requested QoS
+ *  @param handler - called with each piece of the payload
+ *  @return success code of sending the packet
+ */
+DLLExport int MQTTSubscribeChunkedAsync(MQTTClient* client, const char* topicFilter, enum QoS, messageChunkHandler);
+
+/** MQTT Pending Result - state of the last MQTTConnectAsync or MQTTSubscribeAsync.
+ *  Only one of them can be pending at a time.
+ *  @param client - the client object to use
+ *  @return PENDING while waiting for the ack, then SUCCESS or FAILURE
+ */
+DLLExport int MQTTPendingResult(MQTTClient* client);
+
+/** MQTT Poll - non-blocking MQTT background. Reads only what the network already received
+ *  (mqttreadavailable), handles at most one packet, completes or times out the pending
+ *  operation, and sends resends and keepalives that are due. Meant to be called on every
+ *  pass of the application loop instead of MQTTYield.
+ *  @param client - the client object to use
+ *  @return success code
+ */
+DLLExport int MQTTPoll(MQTTClient* client);
+
 /** MQTT Disconnect - send an MQTT disconnect packet and close the connection
  *  @param client - the client object to use
  *  @return success code
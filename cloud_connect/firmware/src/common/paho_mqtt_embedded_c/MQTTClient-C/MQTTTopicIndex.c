@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * Copyright (c) 2021 Microchip Technology Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Subscription index for the embedded C client
+ *******************************************************************************/
+
+#include <string.h>
+
+#include "MQTTClient.h"
+#include "MQTTTopicIndex.h"
+
+
+// FNV-1a, 32 bits
+static unsigned long hashTopic(const char* data, int len)
+{
+    unsigned long hash = 2166136261UL;
+    int i;
+
+    for (i = 0; i < len; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+
+void MQTTTopicIndexReset(MQTTTopicIndex* index)
+{
+    memset(index->exact, TOPIC_INDEX_NONE, sizeof(index->exact));
+    index->node_count = 0;
+    index->root = TOPIC_INDEX_NONE;
+}
+
+
+static int addExact(MQTTTopicIndex* index, int handler, const char* topicFilter)
+{
+    int len = strlen(topicFilter);
+    unsigned long hash = hashTopic(topicFilter, len);
+    int slot = hash & (MAX_TOPIC_INDEX_HASH - 1);
+
+    while (index->exact[slot] != TOPIC_INDEX_NONE)
+    {
+        int first = index->exact[slot];
+        if (index->hash[first] == hash && strcmp(index->filter[first], topicFilter) == 0)
+        {   // same filter subscribed again, chain it behind the first one
+            index->next[handler] = index->next[first];
+            index->next[first] = handler;
+            return 0;
+        }
+        slot = (slot + 1) & (MAX_TOPIC_INDEX_HASH - 1);
+    }
+    // MAX_TOPIC_INDEX_HASH is at least twice the number of handlers, so there is always a free slot
+    index->hash[handler] = hash;
+    index->filter[handler] = topicFilter;
+    index->exact[slot] = handler;
+    return 0;
+}
+
+
+static int addWildcard(MQTTTopicIndex* index, int handler, const char* topicFilter)
+{
+    unsigned char* link = &index->root;
+    unsigned char node = TOPIC_INDEX_NONE;
+    const char* level = topicFilter;
+
+    for (;;)
+    {
+        const char* end = strchr(level, '/');
+        int len = (end != NULL) ? end - level : (int)strlen(level);
+
+        // look for this level among the ones already compiled
+        for (node = *link; node != TOPIC_INDEX_NONE; node = index->nodes[node].sibling)
+        {
+            if (index->nodes[node].len == len && memcmp(index->nodes[node].level, level, len) == 0)
+                break;
+        }
+        if (node == TOPIC_INDEX_NONE)
+        {
+            MQTTTopicIndexNode* n;
+            if (index->node_count >= MAX_TOPIC_INDEX_NODES)
+                return -1;
+            node = index->node_count++;
+            n = &index->nodes[node];
+            n->level = level;
+            n->len = len;
+            n->child = TOPIC_INDEX_NONE;
+            n->handler = TOPIC_INDEX_NONE;
+            n->sibling = *link;
+            *link = node;
+        }
+        if (end == NULL)
+            break;
+        link = &index->nodes[node].child;
+        level = end + 1;
+    }
+
+    index->next[handler] = index->nodes[node].handler;
+    index->nodes[node].handler = handler;
+    return 0;
+}
+
+
+int MQTTTopicIndexAdd(MQTTTopicIndex* index, int handler, const char* topicFilter)
+{
+    index->next[handler] = TOPIC_INDEX_NONE;
+    if (strpbrk(topicFilter, "+#") == NULL)
+        return addExact(index, handler, topicFilter);
+    return addWildcard(index, handler, topicFilter);
+}
+
+
+static int addMatches(MQTTTopicIndex* index, unsigned char first, unsigned char* handlers, int count)
+{
+    unsigned char h;
+
+    // keep the slots in ascending order, handlers are called in subscription slot order
+    for (h = first; h != TOPIC_INDEX_NONE && count < MAX_MESSAGE_HANDLERS; h = index->next[h])
+    {
+        int i = count++;
+        while (i > 0 && handlers[i - 1] > h)
+        {
+            handlers[i] = handlers[i - 1];
+            --i;
+        }
+        handlers[i] = h;
+    }
+    return count;
+}
+
+
+// match the topic from level onwards against the nodes on one trie level
+static int matchLevel(MQTTTopicIndex* index, unsigned char node, const char* level, const char* end,
+        unsigned char* handlers, int count)
+{
+    const char* next = memchr(level, '/', end - level);
+    int len = (next != NULL) ? next - level : end - level;
+
+    for (; node != TOPIC_INDEX_NONE; node = index->nodes[node].sibling)
+    {
+        MQTTTopicIndexNode* n = &index->nodes[node];
+
+        if (n->len == 1 && n->level[0] == '#')
+            count = addMatches(index, n->handler, handlers, count);     // the rest of the topic, any number of levels
+        else if ((n->len == 1 && n->level[0] == '+') || (n->len == len && memcmp(n->level, level, len) == 0))
+        {
+            if (next != NULL)
+                count = matchLevel(index, n->child, next + 1, end, handlers, count);
+            else
+            {
+                unsigned char child;
+                count = addMatches(index, n->handler, handlers, count);
+                // "a/#" also matches "a"
+                for (child = n->child; child != TOPIC_INDEX_NONE; child = index->nodes[child].sibling)
+                {
+                    if (index->nodes[child].len == 1 && index->nodes[child].level[0] == '#')
+                        count = addMatches(index, index->nodes[child].handler, handlers, count);
+                }
+            }
+        }
+    }
+    return count;
+}
+
+
+int MQTTTopicIndexMatch(MQTTTopicIndex* index, MQTTString* topicName, unsigned char* handlers)
+{
+    const char* data = topicName->cstring;
+    int len = 0;
+    int count = 0;
+
+    if (data != NULL)
+        len = strlen(data);
+    else
+    {
+        data = topicName->lenstring.data;
+        len = topicName->lenstring.len;
+    }
+
+    {
+        unsigned long hash = hashTopic(data, len);
+        int slot = hash & (MAX_TOPIC_INDEX_HASH - 1);
+
+        while (index->exact[slot] != TOPIC_INDEX_NONE)
+        {
+            int first = index->exact[slot];
+            const char* filter = index->filter[first];
+            if (index->hash[first] == hash && strncmp(filter, data, len) == 0 && filter[len] == '\0')
+            {
+                count = addMatches(index, first, handlers, count);
+                break;
+            }
+            slot = (slot + 1) & (MAX_TOPIC_INDEX_HASH - 1);
+        }
+    }
+
+    if (index->root != TOPIC_INDEX_NONE)
+        count = matchLevel(index, index->root, data, data + len, handlers, count);
+
+    return count;
+}
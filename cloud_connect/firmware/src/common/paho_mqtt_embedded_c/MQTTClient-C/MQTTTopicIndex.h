@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * Copyright (c) 2021 Microchip Technology Inc.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Subscription index for the embedded C client
+ *******************************************************************************/
+
+#if !defined(__MQTT_TOPIC_INDEX_H_)
+#define __MQTT_TOPIC_INDEX_H_
+
+#if defined(__cplusplus)
+ extern "C" {
+#endif
+
+#if !defined(DLLImport)
+  #define DLLImport
+#endif
+#if !defined(DLLExport)
+  #define DLLExport
+#endif
+
+#include "MQTTPacket.h"
+
+/* The index refers to subscriptions by their slot in MQTTClient.messageHandlers,
+ * so MAX_MESSAGE_HANDLERS must be defined before this header is included. */
+#if !defined(MAX_MESSAGE_HANDLERS)
+#error "MAX_MESSAGE_HANDLERS must be defined before including MQTTTopicIndex.h"
+#endif
+
+#if MAX_MESSAGE_HANDLERS >= 255
+#error "MAX_MESSAGE_HANDLERS must be below 255"
+#endif
+
+#if !defined(MAX_TOPIC_INDEX_HASH)
+#define MAX_TOPIC_INDEX_HASH 16 /* redefinable - power of two, at least twice MAX_MESSAGE_HANDLERS */
+#endif
+
+#if (MAX_TOPIC_INDEX_HASH & (MAX_TOPIC_INDEX_HASH - 1)) != 0 || MAX_TOPIC_INDEX_HASH < 2 * MAX_MESSAGE_HANDLERS
+#error "MAX_TOPIC_INDEX_HASH must be a power of two of at least twice MAX_MESSAGE_HANDLERS"
+#endif
+
+#if !defined(MAX_TOPIC_INDEX_NODES)
+#define MAX_TOPIC_INDEX_NODES (MAX_MESSAGE_HANDLERS * 6) /* redefinable - topic levels of all wildcard filters */
+#endif
+
+#if MAX_TOPIC_INDEX_NODES >= 255
+#error "MAX_TOPIC_INDEX_NODES must be below 255"
+#endif
+
+#define TOPIC_INDEX_NONE 0xFF
+
+/* Filters without wildcards are kept in an open addressed hash table keyed on the
+ * whole filter. Filters with '+' or '#' are compiled into a trie with one node per
+ * topic level, levels that several filters share are stored once. Node levels and
+ * hash keys point into the filter strings, which must stay valid while subscribed,
+ * as the client already requires. */
+typedef struct MQTTTopicIndexNode
+{
+    const char* level;          /* not terminated, len bytes */
+    unsigned short len;
+    unsigned char child,        /* first node of the next level */
+      sibling,                  /* next node on the same level */
+      handler;                  /* first filter ending here */
+} MQTTTopicIndexNode;
+
+typedef struct MQTTTopicIndex
+{
+    unsigned char exact[MAX_TOPIC_INDEX_HASH];      /* handler of the first filter in each hash slot */
+    unsigned long hash[MAX_MESSAGE_HANDLERS];       /* hash of each exact filter */
+    const char* filter[MAX_MESSAGE_HANDLERS];
+    unsigned char next[MAX_MESSAGE_HANDLERS];       /* further handlers for the same filter */
+    MQTTTopicIndexNode nodes[MAX_TOPIC_INDEX_NODES];
+    unsigned char node_count,
+      root;
+} MQTTTopicIndex;
+
+
+/** Empty the index
+ *  @param index - the index to clear
+ */
+DLLExport void MQTTTopicIndexReset(MQTTTopicIndex* index);
+
+/** Add a subscription to the index
+ *  @param index - the index to add to
+ *  @param handler - the messageHandlers slot of the subscription
+ *  @param topicFilter - the filter subscribed to
+ *  @return 0 on success, -1 when the index is full
+ */
+DLLExport int MQTTTopicIndexAdd(MQTTTopicIndex* index, int handler, const char* topicFilter);
+
+/** Find every subscription matching a topic name
+ *  @param index - the index to search
+ *  @param topicName - the topic of a received publish
+ *  @param handlers - set to the messageHandlers slots that match, MAX_MESSAGE_HANDLERS entries
+ *  @return the number of matching slots
+ */
+DLLExport int MQTTTopicIndexMatch(MQTTTopicIndex* index, MQTTString* topicName, unsigned char* handlers);
+
+#if defined(__cplusplus)
+     }
+#endif
+
+#endif
@@ -61,6 +61,20 @@ int mqtt_packet_read(Network *network, unsigned char *read_buffer, int length, i
     return cloud_wifi_read_data(read_buffer, length, timeout_ms);
  }
 
+/**
+ * \brief Reads the data already received from the WINC1500 module, without waiting.
+ *
+ * \param network[in]               The Eclipse Paho MQTT network information
+ * \param read_buffer[in]           The buffer
+ * \param length[in]                The most bytes to read
+ *
+ * \return    The number of bytes read, 0 when nothing has arrived, or the MQTT status
+ */
+int mqtt_packet_read_available(Network *network, unsigned char *read_buffer, int length)
+{
+    return cloud_wifi_read_available(read_buffer, length);
+}
+
 /**
  * \brief Writes data to the WINC1500 module.
  *
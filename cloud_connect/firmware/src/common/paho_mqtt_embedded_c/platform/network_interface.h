@@ -50,9 +50,11 @@
 typedef struct mqtt_network {
 	int (*mqttread)(struct mqtt_network *network, unsigned char *read_buffer, int length, int timeout_ms);
 	int (*mqttwrite)(struct mqtt_network *network, unsigned char *send_buffer, int length, int timeout_ms);
+	int (*mqttreadavailable)(struct mqtt_network *network, unsigned char *read_buffer, int length);
 } Network;
 
 int mqtt_packet_read(Network *network, unsigned char *read_buffer, int length, int timeout_ms);
 int mqtt_packet_write(Network *network, unsigned char *send_buffer, int length, int timeout_ms);
+int mqtt_packet_read_available(Network *network, unsigned char *read_buffer, int length);
 
 #endif // MQTT_NETWORK_INTERFACE_H
\ No newline at end of file
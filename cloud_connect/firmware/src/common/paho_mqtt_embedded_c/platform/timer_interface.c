@@ -43,12 +43,27 @@
  */
 
 
+#include <limits.h>
+
 #include "timer_interface.h"
+#include "definitions.h"
+
+/* Timers are kept in SYS_TIME counter ticks. The 64 bit counter does not wrap in the
+ * life of the device, comparisons go through a signed difference regardless so a
+ * deadline is still ordered correctly across a wrap. */
+
+static int64_t timer_ticks_left(Timer *timer)
+{
+	return (int64_t)(timer->end_count - SYS_TIME_Counter64Get());
+}
 
-volatile uint32_t g_timer_val;
+static uint64_t timer_ms_to_ticks(uint64_t ms)
+{
+	return (ms * SYS_TIME_FrequencyGet()) / 1000;
+}
 
 /**
- * \brief Get current value of RTT timer
+ * \brief Get the time elapsed since the system timer started
  *
  * \param[out] time          Set time values in seconds and microseconds
  
@@ -58,16 +73,18 @@ volatile uint32_t g_timer_val;
  */
 int get_time_of_day(struct timeval *time)
 {
-	uint32_t tick_ms = 0;
+	uint64_t ticks;
+	uint32_t frequency;
 
 	if (time == NULL)
     {
         return -1;
     }
-        
-	tick_ms = g_timer_val;
-	time->tv_sec =  (tick_ms / 1000);
-	time->tv_usec = ((tick_ms % 1000) * 1000);
+
+	ticks = SYS_TIME_Counter64Get();
+	frequency = SYS_TIME_FrequencyGet();
+	time->tv_sec =  (time_t)(ticks / frequency);
+	time->tv_usec = (suseconds_t)(((ticks % frequency) * 1000000) / frequency);
 
 	return 0;
 }
@@ -84,8 +101,7 @@ void TimerInit(Timer *timer)
         return;
     }
     
-	timer->end_time.tv_sec  = 0;
-	timer->end_time.tv_usec = 0;
+	timer->end_count = 0;
 }
 
 /**
@@ -99,19 +115,12 @@ void TimerInit(Timer *timer)
  */
 char TimerIsExpired(Timer *timer)
 {
-	struct timeval time_now;
-	struct timeval time_result;
-
     if (timer == NULL)
     {
         return 1;
     }
 
-	get_time_of_day(&time_now);
-    
-	timer_subtract(&timer->end_time, &time_now, &time_result);
-
-	return (time_result.tv_sec < 0 || (time_result.tv_sec == 0 && time_result.tv_usec <= 0));
+	return (timer_ticks_left(timer) <= 0);
 }
 
 /**
@@ -124,17 +133,12 @@ char TimerIsExpired(Timer *timer)
  */
 void TimerCountdownMS(Timer *timer, unsigned int timeout_ms)
 {
-	struct timeval time_now;
-    struct timeval time_interval = {timeout_ms / 1000, (int)((timeout_ms % 1000) * 1000)};
-
     if (timer == NULL)
     {
         return;
     }
 
-	get_time_of_day(&time_now);
-    
-	timer_add(&time_now, &time_interval, &timer->end_time);
+	timer->end_count = SYS_TIME_Counter64Get() + timer_ms_to_ticks(timeout_ms);
 }
 
 /**
@@ -146,17 +150,12 @@ void TimerCountdownMS(Timer *timer, unsigned int timeout_ms)
  */
 void TimerCountdown(Timer *timer, unsigned int timeout)
 {
-	struct timeval time_now;
-	struct timeval time_interval = {timeout, 0};
-
     if (timer == NULL)
     {
         return;
     }
 
-	get_time_of_day(&time_now);
-
-	timer_add(&time_now, &time_interval, &timer->end_time);
+	timer->end_count = SYS_TIME_Counter64Get() + timer_ms_to_ticks((uint64_t)timeout * 1000);
 }
 
 /**
@@ -164,26 +163,32 @@ void TimerCountdown(Timer *timer, unsigned int timeout)
  *
  * \param[out] timer       The timer to be set to checked
  *
- * \return  The number of milliseconds left on the countdown timer
+ * \return  The number of milliseconds left on the countdown timer, rounded up
+ *          so that it is only 0 once the timer has expired
  */
 int TimerLeftMS(Timer *timer)
 {
-	int result_ms = 0;
-	struct timeval time_now;
-    struct timeval time_result;
+	int64_t ticks_left;
+	uint32_t frequency;
+	uint64_t result_ms;
 
     if (timer == NULL)
     {
         return 0;
     }
 
-	get_time_of_day(&time_now);
-    
-	timer_subtract(&timer->end_time, &time_now, &time_result);
-	if(time_result.tv_sec >= 0)
+	ticks_left = timer_ticks_left(timer);
+	if (ticks_left <= 0)
+    {
+		return 0;
+	}
+
+	frequency = SYS_TIME_FrequencyGet();
+	result_ms = (((uint64_t)ticks_left * 1000) + frequency - 1) / frequency;
+	if (result_ms > INT_MAX)
     {
-		result_ms = (int)((time_result.tv_sec * 1000) + (time_result.tv_usec / 1000));
+		result_ms = INT_MAX;
 	}
 
-	return result_ms;
+	return (int)result_ms;
 }
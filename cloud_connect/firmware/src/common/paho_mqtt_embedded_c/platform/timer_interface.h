@@ -47,6 +47,7 @@
 
 #include <sys/types.h>
 #include <sys/time.h>
+#include <stdint.h>
 
 
 /**
@@ -55,33 +56,8 @@
  * @{
  */
  
-#define	timer_add(tvp, uvp, vvp)	                        \
-	do                                                      \
-    {                                                       \
-		(vvp)->tv_sec = (tvp)->tv_sec + (uvp)->tv_sec;      \
-		(vvp)->tv_usec = (tvp)->tv_usec + (uvp)->tv_usec;   \
-		if ((vvp)->tv_usec >= 1000000)                      \
-        {                                                   \
-			(vvp)->tv_sec++;								\
-			(vvp)->tv_usec -= 1000000;						\
-		}													\
-	} while (0)
-    
-#define	timer_subtract(tvp, uvp, vvp)                       \
-	do                                                      \
-    {                                                       \
-		(vvp)->tv_sec = (tvp)->tv_sec - (uvp)->tv_sec;      \
-		(vvp)->tv_usec = (tvp)->tv_usec - (uvp)->tv_usec;   \
-		if ((vvp)->tv_usec < 0)                             \
-        {                                                   \
-			(vvp)->tv_sec--;                                \
-			(vvp)->tv_usec += 1000000;                      \
-		}                                                   \
-	} while (0)
-
-
 typedef struct mqtt_timer {
-	struct timeval end_time;
+	uint64_t end_count;     /* SYS_TIME counter value at expiry */
 } Timer;
 
 
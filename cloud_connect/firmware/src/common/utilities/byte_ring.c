@@ -0,0 +1,163 @@
+/**
+ * \file
+ * \brief Byte ring buffer for stream reception
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "byte_ring.h"
+
+#define RING_MIN(x, y) ((x) > (y) ? (y) : (x))
+
+/**
+ * \brief Initializes an empty ring on top of the supplied storage.
+ *
+ * \param[in] ring               The ring to initialize
+ * \param[in] buffer             The ring storage
+ * \param[in] size               The storage size, in bytes. Must be a power of two.
+ */
+void byte_ring_init(byte_ring_t *ring, uint8_t *buffer, uint32_t size)
+{
+    ring->buffer = buffer;
+    ring->size = size;
+    byte_ring_reset(ring);
+}
+
+/**
+ * \brief Discards everything held in the ring.
+ *
+ * \param[in] ring               The ring to empty
+ */
+void byte_ring_reset(byte_ring_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+/**
+ * \brief Returns the number of bytes waiting to be read.
+ */
+uint32_t byte_ring_count(const byte_ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+/**
+ * \brief Returns the number of bytes that can still be written.
+ */
+uint32_t byte_ring_space(const byte_ring_t *ring)
+{
+    return ring->size - byte_ring_count(ring);
+}
+
+/**
+ * \brief Appends data at the head of the ring, splitting it across the end of
+ *        the storage when needed.
+ *
+ * \param[in] ring               The ring to write to
+ * \param[in] data               The data to append
+ * \param[in] length             The data length, in bytes
+ *
+ * \return  Whether the data was written
+ *            TRUE  - All of the data was written
+ *            FALSE - Not enough space, nothing was written
+ */
+bool byte_ring_write(byte_ring_t *ring, const uint8_t *data, uint32_t length)
+{
+    uint32_t offset = ring->head & (ring->size - 1);
+    uint32_t first = RING_MIN(length, ring->size - offset);
+
+    if (length > byte_ring_space(ring))
+    {
+        return false;
+    }
+
+    memcpy(&ring->buffer[offset], data, first);
+    memcpy(&ring->buffer[0], &data[first], length - first);
+
+    ring->head += length;
+
+    return true;
+}
+
+/**
+ * \brief Reads up to length bytes from the tail of the ring.
+ *
+ * \param[in]  ring              The ring to read from
+ * \param[out] data              The buffer receiving the data
+ * \param[in]  length            The maximum number of bytes to read
+ *
+ * \return  The number of bytes read, which may be less than requested
+ */
+uint32_t byte_ring_read(byte_ring_t *ring, uint8_t *data, uint32_t length)
+{
+    uint32_t total = RING_MIN(length, byte_ring_count(ring));
+    uint32_t copied = 0;
+    const uint8_t *segment = NULL;
+
+    while (copied < total)
+    {
+        uint32_t segment_length = RING_MIN(byte_ring_peek(ring, &segment), total - copied);
+
+        memcpy(&data[copied], segment, segment_length);
+        byte_ring_consume(ring, segment_length);
+        copied += segment_length;
+    }
+
+    return copied;
+}
+
+/**
+ * \brief Gives direct access to the oldest contiguous run of unread bytes.
+ *
+ * The data stays in the ring until released with byte_ring_consume(). When
+ * the unread data wraps around the end of the storage, a second call after
+ * consuming the first segment returns the rest.
+ *
+ * \param[in]  ring              The ring to look into
+ * \param[out] segment           Set to the start of the contiguous run
+ *
+ * \return  The length of the contiguous run, 0 if the ring is empty
+ */
+uint32_t byte_ring_peek(const byte_ring_t *ring, const uint8_t **segment)
+{
+    uint32_t offset = ring->tail & (ring->size - 1);
+
+    *segment = &ring->buffer[offset];
+
+    return RING_MIN(byte_ring_count(ring), ring->size - offset);
+}
+
+/**
+ * \brief Releases bytes previously returned by byte_ring_peek().
+ *
+ * \param[in] ring               The ring to release bytes from
+ * \param[in] length             The number of bytes to release
+ */
+void byte_ring_consume(byte_ring_t *ring, uint32_t length)
+{
+    ring->tail += RING_MIN(length, byte_ring_count(ring));
+}
@@ -0,0 +1,61 @@
+/**
+ * \file
+ * \brief Byte ring buffer for stream reception
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \brief Single producer, single consumer byte ring.
+ *
+ * The head and tail indices run freely and are only masked on access, so the
+ * ring size must be a power of two. The producer only moves the head and the
+ * consumer only moves the tail, which lets one side run from a callback.
+ */
+typedef struct byte_ring
+{
+    uint8_t *buffer;
+    uint32_t size;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} byte_ring_t;
+
+void byte_ring_init(byte_ring_t *ring, uint8_t *buffer, uint32_t size);
+void byte_ring_reset(byte_ring_t *ring);
+
+uint32_t byte_ring_count(const byte_ring_t *ring);
+uint32_t byte_ring_space(const byte_ring_t *ring);
+
+bool byte_ring_write(byte_ring_t *ring, const uint8_t *data, uint32_t length);
+uint32_t byte_ring_read(byte_ring_t *ring, uint8_t *data, uint32_t length);
+
+uint32_t byte_ring_peek(const byte_ring_t *ring, const uint8_t **segment);
+void byte_ring_consume(byte_ring_t *ring, uint32_t length);
+
+#endif // BYTE_RING_H
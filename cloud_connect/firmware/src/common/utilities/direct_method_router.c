@@ -0,0 +1,203 @@
+/**
+ * \file
+ * \brief Direct method table and the slots of deferred direct method calls
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <stddef.h>
+#include <string.h>
+
+#include "direct_method_router.h"
+
+static uint32_t direct_method_hash(az_span name)
+{
+    uint32_t hash = 2166136261UL;
+    int32_t i;
+
+    for (i = 0; i < az_span_size(name); i++)
+    {
+        hash = (hash ^ az_span_ptr(name)[i]) * 16777619UL;
+    }
+
+    return hash;
+}
+
+// Returns the entry of the method, or the free entry it would go in
+static direct_method_t *direct_method_entry(const direct_method_router_t *router, az_span name, uint32_t hash)
+{
+    uint32_t index = hash;
+
+    // The table is never full, so the probe ends at a free entry
+    for (;;)
+    {
+        const direct_method_t *method = &router->methods[index & (DIRECT_METHOD_TABLE_SIZE - 1)];
+
+        if (method->handler == NULL || (method->hash == hash && az_span_is_content_equal(method->name, name)))
+        {
+            return (direct_method_t *)method;
+        }
+
+        index++;
+    }
+}
+
+/**
+ * \brief Empties the router. payload_buffer holds DIRECT_METHOD_SLOTS payloads
+ *        of payload_size bytes.
+ */
+void direct_method_router_init(direct_method_router_t *router, uint8_t *payload_buffer, int32_t payload_size)
+{
+    uint32_t i;
+
+    memset(router, 0, sizeof(*router));
+
+    for (i = 0; i < DIRECT_METHOD_SLOTS; i++)
+    {
+        router->slots[i].state = DIRECT_METHOD_SLOT_FREE;
+        router->slots[i].payload = payload_buffer + i * (uint32_t)payload_size;
+    }
+
+    router->payload_size = payload_size;
+}
+
+/**
+ * \brief Adds a method, or replaces the handler of one with the same name. The
+ *        name span must stay valid, e.g. a literal.
+ *
+ * \return false when the table already holds DIRECT_METHOD_TABLE_SIZE / 2
+ *         methods.
+ */
+bool direct_method_register(direct_method_router_t *router, az_span name, direct_method_handler_t handler,
+                            int32_t defer_ms)
+{
+    uint32_t hash = direct_method_hash(name);
+    direct_method_t *method = direct_method_entry(router, name, hash);
+
+    if (method->handler == NULL)
+    {
+        if (router->count == DIRECT_METHOD_TABLE_SIZE / 2)
+        {
+            return false;
+        }
+
+        router->count++;
+    }
+
+    method->name = name;
+    method->hash = hash;
+    method->handler = handler;
+    method->defer_ms = defer_ms;
+
+    return true;
+}
+
+/**
+ * \return the method registered under name, NULL when there is none.
+ */
+const direct_method_t *direct_method_find(const direct_method_router_t *router, az_span name)
+{
+    const direct_method_t *method = direct_method_entry(router, name, direct_method_hash(name));
+
+    return method->handler != NULL ? method : NULL;
+}
+
+/**
+ * \brief Copies a request into a free slot. A method with defer_ms 0 is ready
+ *        straight away, otherwise the slot waits for direct_method_slot_ready().
+ *
+ * \return AZ_ERROR_OUT_OF_MEMORY when every slot is taken,
+ *         AZ_ERROR_NOT_ENOUGH_SPACE when the payload or the request id does not
+ *         fit a slot.
+ */
+az_result direct_method_defer(direct_method_router_t *router, const direct_method_t *method, az_span payload,
+                              az_span request_id, uint32_t *out_slot)
+{
+    direct_method_slot_t *slot = NULL;
+    uint32_t i;
+
+    for (i = 0; i < DIRECT_METHOD_SLOTS; i++)
+    {
+        if (router->slots[i].state == DIRECT_METHOD_SLOT_FREE)
+        {
+            slot = &router->slots[i];
+            break;
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return AZ_ERROR_OUT_OF_MEMORY;
+    }
+
+    if (az_span_size(payload) > router->payload_size || az_span_size(request_id) > DIRECT_METHOD_REQUEST_ID_SIZE)
+    {
+        return AZ_ERROR_NOT_ENOUGH_SPACE;
+    }
+
+    slot->method = method;
+    slot->payload_length = az_span_size(payload);
+    slot->request_id_length = az_span_size(request_id);
+    memcpy(slot->payload, az_span_ptr(payload), (size_t)slot->payload_length);
+    memcpy(slot->request_id, az_span_ptr(request_id), (size_t)slot->request_id_length);
+    slot->state = method->defer_ms == 0 ? DIRECT_METHOD_SLOT_READY : DIRECT_METHOD_SLOT_WAITING;
+
+    *out_slot = i;
+    return AZ_OK;
+}
+
+/**
+ * \brief Marks a waiting slot ready to run. Safe to call from an interrupt.
+ */
+void direct_method_slot_ready(direct_method_router_t *router, uint32_t slot)
+{
+    if (slot < DIRECT_METHOD_SLOTS && router->slots[slot].state == DIRECT_METHOD_SLOT_WAITING)
+    {
+        router->slots[slot].state = DIRECT_METHOD_SLOT_READY;
+    }
+}
+
+/**
+ * \return a slot ready to run, NULL when there is none. It stays taken until
+ *         direct_method_slot_free().
+ */
+direct_method_slot_t *direct_method_next_ready(direct_method_router_t *router)
+{
+    uint32_t i;
+
+    for (i = 0; i < DIRECT_METHOD_SLOTS; i++)
+    {
+        if (router->slots[i].state == DIRECT_METHOD_SLOT_READY)
+        {
+            return &router->slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+void direct_method_slot_free(direct_method_slot_t *slot)
+{
+    slot->state = DIRECT_METHOD_SLOT_FREE;
+}
@@ -0,0 +1,105 @@
+/**
+ * \file
+ * \brief Direct method table and the slots of deferred direct method calls
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#ifndef DIRECT_METHOD_ROUTER_H
+#define DIRECT_METHOD_ROUTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure/core/az_result.h"
+#include "azure/core/az_span.h"
+
+#define DIRECT_METHOD_TABLE_SIZE      (16)    // power of two, at most half of it is used
+#define DIRECT_METHOD_SLOTS           (2)
+#define DIRECT_METHOD_REQUEST_ID_SIZE (16)
+
+// defer_ms of a direct method that runs as soon as its request is received
+#define DIRECT_METHOD_INLINE (-1)
+
+typedef az_result (*direct_method_handler_t)(
+    az_span   payload_span,
+    az_span   response_span,
+    az_span*  out_response_span,
+    uint16_t* out_response_status);
+
+typedef struct direct_method
+{
+    az_span name;
+    uint32_t hash;
+    direct_method_handler_t handler;
+    int32_t defer_ms;
+} direct_method_t;
+
+typedef enum
+{
+    DIRECT_METHOD_SLOT_FREE,
+    DIRECT_METHOD_SLOT_WAITING,   // for direct_method_slot_ready()
+    DIRECT_METHOD_SLOT_READY
+} direct_method_slot_state_t;
+
+/**
+ * \brief A deferred call. It keeps its own copy of the request, as the buffer
+ *        it was received in is reused.
+ */
+typedef struct direct_method_slot
+{
+    volatile uint8_t state;
+    const direct_method_t *method;
+    uint8_t *payload;
+    int32_t payload_length;
+    int32_t request_id_length;
+    uint8_t request_id[DIRECT_METHOD_REQUEST_ID_SIZE];
+} direct_method_slot_t;
+
+/**
+ * \brief Methods found by the FNV-1a hash of their name in an open addressed
+ *        table, and the slots of the calls waiting to run. Nothing is
+ *        allocated, the payloads are kept in a buffer given by the caller.
+ */
+typedef struct direct_method_router
+{
+    direct_method_t methods[DIRECT_METHOD_TABLE_SIZE];
+    uint32_t count;
+    direct_method_slot_t slots[DIRECT_METHOD_SLOTS];
+    int32_t payload_size;
+} direct_method_router_t;
+
+void direct_method_router_init(direct_method_router_t *router, uint8_t *payload_buffer, int32_t payload_size);
+
+bool direct_method_register(direct_method_router_t *router, az_span name, direct_method_handler_t handler,
+                            int32_t defer_ms);
+const direct_method_t *direct_method_find(const direct_method_router_t *router, az_span name);
+
+az_result direct_method_defer(direct_method_router_t *router, const direct_method_t *method, az_span payload,
+                              az_span request_id, uint32_t *out_slot);
+void direct_method_slot_ready(direct_method_router_t *router, uint32_t slot);
+direct_method_slot_t *direct_method_next_ready(direct_method_router_t *router);
+void direct_method_slot_free(direct_method_slot_t *slot);
+
+#endif // DIRECT_METHOD_ROUTER_H
@@ -0,0 +1,224 @@
+/**
+ * \file
+ * \brief Reported twin properties waiting to be sent, merged into one PATCH
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "reported_cache.h"
+
+static bool cache_value_is_acked(const reported_cache_t *cache, uint32_t id)
+{
+    const reported_cache_value_t *reported = &cache->values[id];
+
+    return (cache->known & REPORTED_CACHE_BIT(id)) != 0 &&
+           reported->version == reported->acked_version &&
+           reported->value == reported->acked;
+}
+
+static void cache_debounce(reported_cache_t *cache, uint32_t now_ms)
+{
+    cache->debounce_end_ms = now_ms + REPORTED_CACHE_DEBOUNCE_MS;
+    cache->debouncing = true;
+}
+
+static bool cache_debounce_expired(reported_cache_t *cache, uint32_t now_ms)
+{
+    if (cache->debouncing && (int32_t)(now_ms - cache->debounce_end_ms) >= 0)
+    {
+        cache->debouncing = false;
+    }
+
+    return !cache->debouncing;
+}
+
+void reported_cache_init(reported_cache_t *cache)
+{
+    uint32_t id;
+
+    for (id = 0; id < REPORTED_CACHE_MAX_PROPERTIES; id++)
+    {
+        cache->values[id].value = 0;
+        cache->values[id].version = 0;
+    }
+
+    cache->known = 0;
+    cache->dirty = 0;
+    cache->in_flight = 0;
+    cache->request_id = 0;
+    cache->debouncing = false;
+}
+
+/**
+ * \brief Forgets what IoT Hub acknowledged, e.g. after a full twin GET: the
+ *        twin may have changed meanwhile, so every value set again is sent.
+ */
+void reported_cache_forget(reported_cache_t *cache)
+{
+    cache->known = 0;
+}
+
+/**
+ * \brief Sets the value to report for one property.
+ *
+ * It is marked dirty only when it differs from the value IoT Hub last
+ * acknowledged, so a value flapping back before the PATCH goes out sends
+ * nothing. The first change starts the debounce window that merges later
+ * changes into the same PATCH.
+ */
+void reported_cache_set(reported_cache_t *cache, uint32_t id, int32_t value, int32_t version, uint32_t now_ms)
+{
+    cache->values[id].value = value;
+    cache->values[id].version = version;
+
+    if (cache_value_is_acked(cache, id))
+    {
+        cache->dirty &= ~REPORTED_CACHE_BIT(id);
+    }
+    else if ((cache->dirty & REPORTED_CACHE_BIT(id)) == 0)
+    {
+        // A window already running is kept, so flapping cannot hold the PATCH back
+        if (cache->dirty == 0 && cache_debounce_expired(cache, now_ms))
+        {
+            cache_debounce(cache, now_ms);
+        }
+
+        cache->dirty |= REPORTED_CACHE_BIT(id);
+    }
+}
+
+/**
+ * \brief Tells whether the dirty properties are to be sent now: their
+ *        debounce window has passed and no PATCH is waiting for its response.
+ */
+bool reported_cache_due(reported_cache_t *cache, uint32_t now_ms)
+{
+    // Checked on every call so a window that ended cannot look like one ahead once the clock wraps
+    bool expired = cache_debounce_expired(cache, now_ms);
+
+    return cache->in_flight == 0 && cache->dirty != 0 && expired;
+}
+
+/**
+ * \brief Records the value a PATCH being built carries for one property,
+ *        which for a string may be newer than the one set.
+ */
+void reported_cache_sent(reported_cache_t *cache, uint32_t id, int32_t value, int32_t version)
+{
+    cache->values[id].sent = value;
+    cache->values[id].sent_version = version;
+}
+
+/**
+ * \brief Marks the dirty properties as sent in the PATCH with request_id.
+ */
+void reported_cache_in_flight(reported_cache_t *cache, uint32_t request_id)
+{
+    cache->in_flight = cache->dirty;
+    cache->request_id = request_id;
+}
+
+/**
+ * \brief Waits another debounce window after a PATCH could not be sent.
+ */
+void reported_cache_retry(reported_cache_t *cache, uint32_t now_ms)
+{
+    cache_debounce(cache, now_ms);
+}
+
+/**
+ * \brief Takes the response to the PATCH in flight. On success the values it
+ *        carried become the acknowledged ones and stop being dirty, unless
+ *        they changed again while it was in flight.
+ *
+ * \return false when no PATCH with that request id is in flight, e.g. the
+ *         response came after it was given up on.
+ */
+bool reported_cache_ack(reported_cache_t *cache, uint32_t request_id, bool succeeded, uint32_t now_ms)
+{
+    uint32_t id;
+
+    if (cache->in_flight == 0 || request_id != cache->request_id)
+    {
+        return false;
+    }
+
+    if (succeeded)
+    {
+        for (id = 0; id < REPORTED_CACHE_MAX_PROPERTIES; id++)
+        {
+            reported_cache_value_t *reported = &cache->values[id];
+
+            if ((cache->in_flight & REPORTED_CACHE_BIT(id)) == 0)
+            {
+                continue;
+            }
+
+            reported->acked = reported->sent;
+            reported->acked_version = reported->sent_version;
+            cache->known |= REPORTED_CACHE_BIT(id);
+
+            if (cache_value_is_acked(cache, id))
+            {
+                cache->dirty &= ~REPORTED_CACHE_BIT(id);
+            }
+            else
+            {
+                cache->dirty |= REPORTED_CACHE_BIT(id);
+            }
+        }
+    }
+
+    cache->in_flight = 0;
+
+    if (cache->dirty != 0)
+    {
+        cache_debounce(cache, now_ms);
+    }
+    else
+    {
+        cache->debouncing = false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Gives up on the PATCH with request_id when it got no response. Its
+ *        values are still dirty and go out again.
+ *
+ * \return false when that PATCH is not the one in flight
+ */
+bool reported_cache_lost(reported_cache_t *cache, uint32_t request_id)
+{
+    if (cache->in_flight == 0 || request_id != cache->request_id)
+    {
+        return false;
+    }
+
+    cache->in_flight = 0;
+
+    return true;
+}
@@ -0,0 +1,89 @@
+/**
+ * \file
+ * \brief Reported twin properties waiting to be sent, merged into one PATCH
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef REPORTED_CACHE_H
+#define REPORTED_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Properties are numbered by the caller, one bit each in the masks below
+#define REPORTED_CACHE_MAX_PROPERTIES   (16)
+
+/* A change waits this long for more changes to go out in the same PATCH */
+#define REPORTED_CACHE_DEBOUNCE_MS      (500)
+
+/**
+ * \brief One property: the value to report, the one in the PATCH waiting for
+ *        its response and the one IoT Hub last acknowledged.
+ *
+ * String properties are kept as a hash of the string. The version is that of
+ * the desired property a writable property answers, 0 for the others.
+ */
+typedef struct reported_cache_value
+{
+    int32_t value;
+    int32_t version;
+    int32_t sent;
+    int32_t sent_version;
+    int32_t acked;
+    int32_t acked_version;
+} reported_cache_value_t;
+
+/**
+ * \brief Reported properties and the one PATCH that may be in flight.
+ *
+ * Times are in milliseconds from any free running clock, differences are taken
+ * modulo 2^32.
+ */
+typedef struct reported_cache
+{
+    reported_cache_value_t values[REPORTED_CACHE_MAX_PROPERTIES];
+    uint16_t known;         // acked is valid
+    uint16_t dirty;         // value differs from acked
+    uint16_t in_flight;     // sent with request_id, no response yet
+    uint32_t request_id;
+    uint32_t debounce_end_ms;
+    bool debouncing;
+} reported_cache_t;
+
+#define REPORTED_CACHE_BIT(id)  ((uint16_t)(1u << (id)))
+
+void reported_cache_init(reported_cache_t *cache);
+void reported_cache_forget(reported_cache_t *cache);
+
+void reported_cache_set(reported_cache_t *cache, uint32_t id, int32_t value, int32_t version, uint32_t now_ms);
+
+bool reported_cache_due(reported_cache_t *cache, uint32_t now_ms);
+void reported_cache_sent(reported_cache_t *cache, uint32_t id, int32_t value, int32_t version);
+void reported_cache_in_flight(reported_cache_t *cache, uint32_t request_id);
+void reported_cache_retry(reported_cache_t *cache, uint32_t now_ms);
+
+bool reported_cache_ack(reported_cache_t *cache, uint32_t request_id, bool succeeded, uint32_t now_ms);
+bool reported_cache_lost(reported_cache_t *cache, uint32_t request_id);
+
+#endif // REPORTED_CACHE_H
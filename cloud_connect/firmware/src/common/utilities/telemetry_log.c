@@ -0,0 +1,464 @@
+/**
+ * \file
+ * \brief Append-only telemetry log on sector-erased flash
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "telemetry_log.h"
+
+/* Every sector starts with a segment header holding a magic value and the
+ * sequence number it was started with, so the newest and oldest sectors can be
+ * found after a reset. Records follow back to back:
+ *
+ *   length (2) | crc16 (2) | state (1) | reserved (1) | payload (length)
+ *
+ * The state byte is cleared to LOG_RECORD_SENT once the record was delivered,
+ * which flash allows without an erase. Sectors are reused in turn, so erases
+ * are spread evenly over the region. */
+#define LOG_SEGMENT_MAGIC           (0x544C4731UL)
+#define LOG_SEGMENT_HEADER_SIZE     (8)
+#define LOG_RECORD_HEADER_SIZE      (6)
+#define LOG_RECORD_ERASED           (0xFFFF)
+#define LOG_RECORD_PENDING          (0xFF)
+#define LOG_RECORD_SENT             (0x00)
+
+static uint16_t log_crc16(const uint8_t *data, uint32_t length)
+{
+    uint16_t crc = 0xFFFF;
+    uint32_t i;
+    uint8_t bit;
+
+    for (i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static uint32_t log_address(const telemetry_log_t *log, uint32_t sector, uint32_t offset)
+{
+    return sector * log->flash->sector_size + offset;
+}
+
+static bool log_record_fits(const telemetry_log_t *log, uint32_t offset, uint32_t length)
+{
+    return offset + LOG_RECORD_HEADER_SIZE + length <= log->flash->sector_size;
+}
+
+/* Reads the record header at offset. A header that does not fit in the sector
+ * reads as erased, meaning the end of the records in that sector. */
+static bool log_read_record_header(const telemetry_log_t *log, uint32_t sector, uint32_t offset,
+                                   uint16_t *length, uint16_t *crc, uint8_t *state)
+{
+    uint8_t header[LOG_RECORD_HEADER_SIZE];
+
+    *length = LOG_RECORD_ERASED;
+
+    if (!log_record_fits(log, offset, 0))
+    {
+        return true;
+    }
+
+    if (!log->flash->read(log_address(log, sector, offset), header, sizeof(header)))
+    {
+        return false;
+    }
+
+    *length = (uint16_t)(header[0] | (header[1] << 8));
+    *crc = (uint16_t)(header[2] | (header[3] << 8));
+    *state = header[4];
+
+    // A torn or corrupt length also ends the sector
+    if (*length != LOG_RECORD_ERASED && !log_record_fits(log, offset, *length))
+    {
+        *length = LOG_RECORD_ERASED;
+    }
+
+    return true;
+}
+
+static bool log_start_segment(telemetry_log_t *log, uint32_t sector)
+{
+    uint32_t sequence = log->sequence + 1;
+    uint8_t header[LOG_SEGMENT_HEADER_SIZE] = {
+        (uint8_t)LOG_SEGMENT_MAGIC, (uint8_t)(LOG_SEGMENT_MAGIC >> 8),
+        (uint8_t)(LOG_SEGMENT_MAGIC >> 16), (uint8_t)(LOG_SEGMENT_MAGIC >> 24),
+        (uint8_t)sequence, (uint8_t)(sequence >> 8),
+        (uint8_t)(sequence >> 16), (uint8_t)(sequence >> 24)
+    };
+
+    if (!log->flash->erase(log_address(log, sector, 0)) ||
+        !log->flash->write(log_address(log, sector, 0), header, sizeof(header)))
+    {
+        return false;
+    }
+
+    log->sequence = sequence;
+    log->head_sector = sector;
+    log->head_offset = LOG_SEGMENT_HEADER_SIZE;
+
+    return true;
+}
+
+/* Moves the writer to the next sector. When the log is full that is the
+ * oldest one, and whatever it still held is dropped. */
+static bool log_next_segment(telemetry_log_t *log)
+{
+    uint32_t next = (log->head_sector + 1) % log->flash->sector_count;
+
+    if (log->tail_sector == next)
+    {
+        log->tail_sector = (next + 1) % log->flash->sector_count;
+        log->tail_offset = LOG_SEGMENT_HEADER_SIZE;
+        log->tail_length = 0;
+    }
+
+    return log_start_segment(log, next);
+}
+
+static bool log_mark_sent(telemetry_log_t *log)
+{
+    uint8_t state = LOG_RECORD_SENT;
+
+    return log->flash->write(log_address(log, log->tail_sector, log->tail_offset + 4), &state, 1);
+}
+
+/**
+ * \brief Finds the end of the log and the oldest undelivered record, and
+ *        formats the region if it holds no log yet.
+ *
+ * \param[out] log               The log state to set up
+ * \param[in]  flash             The flash region holding the log
+ *
+ * \return  Whether the log can be used
+ */
+bool telemetry_log_mount(telemetry_log_t *log, const telemetry_log_flash_t *flash)
+{
+    uint8_t header[LOG_SEGMENT_HEADER_SIZE];
+    uint32_t oldest_sequence = UINT32_MAX;
+    uint32_t oldest_sector = 0;
+    uint32_t sector;
+    uint32_t offset;
+    uint16_t length;
+    uint16_t crc;
+    uint8_t state = LOG_RECORD_PENDING;
+    bool found = false;
+
+    log->flash = flash;
+    log->sequence = 0;
+    log->tail_length = 0;
+
+    if (flash->sector_count < 2)
+    {
+        return false;
+    }
+
+    for (sector = 0; sector < flash->sector_count; sector++)
+    {
+        uint32_t magic;
+        uint32_t sequence;
+
+        if (!flash->read(log_address(log, sector, 0), header, sizeof(header)))
+        {
+            return false;
+        }
+
+        magic = header[0] | (header[1] << 8) | ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+        sequence = header[4] | (header[5] << 8) | ((uint32_t)header[6] << 16) | ((uint32_t)header[7] << 24);
+
+        if (magic != LOG_SEGMENT_MAGIC || sequence == UINT32_MAX)
+        {
+            continue;
+        }
+
+        if (!found || sequence > log->sequence)
+        {
+            log->sequence = sequence;
+            log->head_sector = sector;
+        }
+
+        if (sequence < oldest_sequence)
+        {
+            oldest_sequence = sequence;
+            oldest_sector = sector;
+        }
+
+        found = true;
+    }
+
+    if (!found)
+    {
+        if (!log_start_segment(log, 0))
+        {
+            return false;
+        }
+
+        log->tail_sector = log->head_sector;
+        log->tail_offset = log->head_offset;
+        return true;
+    }
+
+    // The writer continues after the last record of the newest sector
+    offset = LOG_SEGMENT_HEADER_SIZE;
+    do
+    {
+        if (!log_read_record_header(log, log->head_sector, offset, &length, &crc, &state))
+        {
+            return false;
+        }
+
+        if (length != LOG_RECORD_ERASED)
+        {
+            offset += LOG_RECORD_HEADER_SIZE + length;
+        }
+    } while (length != LOG_RECORD_ERASED);
+
+    log->head_offset = offset;
+
+    // Replay resumes at the first undelivered record, oldest sector first
+    log->tail_sector = oldest_sector;
+    log->tail_offset = LOG_SEGMENT_HEADER_SIZE;
+
+    while (log->tail_sector != log->head_sector || log->tail_offset < log->head_offset)
+    {
+        if (!log_read_record_header(log, log->tail_sector, log->tail_offset, &length, &crc, &state))
+        {
+            return false;
+        }
+
+        if (length == LOG_RECORD_ERASED)
+        {
+            log->tail_sector = (log->tail_sector + 1) % flash->sector_count;
+            log->tail_offset = LOG_SEGMENT_HEADER_SIZE;
+        }
+        else if (state == LOG_RECORD_PENDING)
+        {
+            break;
+        }
+        else
+        {
+            log->tail_offset += LOG_RECORD_HEADER_SIZE + length;
+        }
+    }
+
+    // A reset in the middle of a record header leaves bytes that are neither
+    // erased nor a valid length. Programming the next header over them would
+    // corrupt it, so the writer moves on to the next sector.
+    if (log_record_fits(log, log->head_offset, 0))
+    {
+        uint8_t record_header[LOG_RECORD_HEADER_SIZE];
+        uint32_t i;
+
+        if (!flash->read(log_address(log, log->head_sector, log->head_offset), record_header, sizeof(record_header)))
+        {
+            return false;
+        }
+
+        for (i = 0; i < sizeof(record_header); i++)
+        {
+            if (record_header[i] != 0xFF)
+            {
+                return log_next_segment(log);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Appends one record to the log. When the log is full the oldest
+ *        sector is reused, dropping whatever it still held.
+ *
+ * \param[in] log                The log to append to
+ * \param[in] data               The record payload
+ * \param[in] length             The payload length, in bytes
+ *
+ * \return  Whether the record was stored
+ */
+bool telemetry_log_append(telemetry_log_t *log, const uint8_t *data, uint16_t length)
+{
+    uint8_t header[LOG_RECORD_HEADER_SIZE];
+    uint16_t crc;
+    uint32_t address;
+
+    if (length == 0 || length == LOG_RECORD_ERASED ||
+        !log_record_fits(log, LOG_SEGMENT_HEADER_SIZE, length))
+    {
+        return false;
+    }
+
+    if (!log_record_fits(log, log->head_offset, length) && !log_next_segment(log))
+    {
+        return false;
+    }
+
+    crc = log_crc16(data, length);
+    header[0] = (uint8_t)length;
+    header[1] = (uint8_t)(length >> 8);
+    header[2] = (uint8_t)crc;
+    header[3] = (uint8_t)(crc >> 8);
+    header[4] = LOG_RECORD_PENDING;
+    header[5] = 0xFF;
+
+    address = log_address(log, log->head_sector, log->head_offset);
+    log->head_offset += LOG_RECORD_HEADER_SIZE + length;
+
+    return log->flash->write(address, header, sizeof(header)) &&
+           log->flash->write(address + LOG_RECORD_HEADER_SIZE, data, length);
+}
+
+/* Moves the replay cursor over erased sector ends and delivered records to the
+ * oldest pending one, reading only record headers. Returns 1 with its header,
+ * 0 if every record was delivered, -1 on a flash error. */
+static int log_find_pending(telemetry_log_t *log, uint16_t *length, uint16_t *crc)
+{
+    uint8_t state;
+
+    while (log->tail_sector != log->head_sector || log->tail_offset < log->head_offset)
+    {
+        if (!log_read_record_header(log, log->tail_sector, log->tail_offset, length, crc, &state))
+        {
+            return -1;
+        }
+
+        if (*length == LOG_RECORD_ERASED)
+        {
+            log->tail_sector = (log->tail_sector + 1) % log->flash->sector_count;
+            log->tail_offset = LOG_SEGMENT_HEADER_SIZE;
+            continue;
+        }
+
+        if (state == LOG_RECORD_PENDING)
+        {
+            return 1;
+        }
+
+        log->tail_offset += LOG_RECORD_HEADER_SIZE + *length;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Gives the length of the oldest undelivered record without reading
+ *        its payload, so a buffer only needs to be found when there is one.
+ *
+ * The payload CRC is not checked here, telemetry_log_peek() may still skip
+ * the record.
+ *
+ * \param[in]  log               The log to look at
+ *
+ * \return  The payload length, 0 if every record was delivered, -1 on a
+ *          flash error
+ */
+int32_t telemetry_log_pending(telemetry_log_t *log)
+{
+    uint16_t length;
+    uint16_t crc;
+    int found = log_find_pending(log, &length, &crc);
+
+    return (found > 0) ? length : found;
+}
+
+/**
+ * \brief Reads the oldest undelivered record without releasing it.
+ *
+ * Records that fail their CRC check or do not fit in the buffer are skipped.
+ *
+ * \param[in]  log               The log to read from
+ * \param[out] data              The buffer receiving the payload
+ * \param[in]  max_length        The buffer size, in bytes
+ *
+ * \return  The payload length, 0 if every record was delivered, -1 on a
+ *          flash error
+ */
+int32_t telemetry_log_peek(telemetry_log_t *log, uint8_t *data, uint32_t max_length)
+{
+    uint16_t length;
+    uint16_t crc;
+    int found;
+
+    while ((found = log_find_pending(log, &length, &crc)) > 0)
+    {
+        if (length <= max_length)
+        {
+            if (!log->flash->read(log_address(log, log->tail_sector, log->tail_offset + LOG_RECORD_HEADER_SIZE),
+                                  data, length))
+            {
+                return -1;
+            }
+
+            if (log_crc16(data, length) == crc)
+            {
+                log->tail_length = length;
+                return length;
+            }
+        }
+
+        if (!log_mark_sent(log))
+        {
+            return -1;
+        }
+
+        log->tail_offset += LOG_RECORD_HEADER_SIZE + length;
+    }
+
+    log->tail_length = 0;
+
+    return found;
+}
+
+/**
+ * \brief Marks the record returned by the last telemetry_log_peek() as
+ *        delivered and moves the replay cursor past it.
+ *
+ * \param[in] log                The log to update
+ *
+ * \return  Whether the record was marked
+ */
+bool telemetry_log_consume(telemetry_log_t *log)
+{
+    if (log->tail_length == 0)
+    {
+        return false;
+    }
+
+    if (!log_mark_sent(log))
+    {
+        return false;
+    }
+
+    log->tail_offset += LOG_RECORD_HEADER_SIZE + log->tail_length;
+    log->tail_length = 0;
+
+    return true;
+}
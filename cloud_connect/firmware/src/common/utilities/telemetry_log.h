@@ -0,0 +1,72 @@
+/**
+ * \file
+ * \brief Append-only telemetry log on sector-erased flash
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \brief Flash access used by the telemetry log.
+ *
+ * Offsets are relative to the start of the log region. Writes may only clear
+ * bits, erase sets a whole sector back to 0xFF. The log needs at least two
+ * sectors.
+ */
+typedef struct telemetry_log_flash
+{
+    bool (*read)(uint32_t offset, uint8_t *data, uint32_t length);
+    bool (*write)(uint32_t offset, const uint8_t *data, uint32_t length);
+    bool (*erase)(uint32_t offset);
+    uint32_t sector_size;
+    uint32_t sector_count;
+} telemetry_log_flash_t;
+
+/**
+ * \brief Position of the writer and of the replay cursor in the log.
+ */
+typedef struct telemetry_log
+{
+    const telemetry_log_flash_t *flash;
+    uint32_t sequence;
+    uint32_t head_sector;
+    uint32_t head_offset;
+    uint32_t tail_sector;
+    uint32_t tail_offset;
+    uint32_t tail_length;
+} telemetry_log_t;
+
+bool telemetry_log_mount(telemetry_log_t *log, const telemetry_log_flash_t *flash);
+
+bool telemetry_log_append(telemetry_log_t *log, const uint8_t *data, uint16_t length);
+
+int32_t telemetry_log_pending(telemetry_log_t *log);
+int32_t telemetry_log_peek(telemetry_log_t *log, uint8_t *data, uint32_t max_length);
+bool telemetry_log_consume(telemetry_log_t *log);
+
+#endif // TELEMETRY_LOG_H
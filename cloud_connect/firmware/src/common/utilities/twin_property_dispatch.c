@@ -0,0 +1,156 @@
+/**
+ * \file
+ * \brief Desired twin properties handed to their handlers in one pass
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include "twin_property_dispatch.h"
+
+#define DISPATCH_RETURN_IF_FAILED(exp)  \
+    do                                  \
+    {                                   \
+        az_result result = (exp);       \
+        if (az_result_failed(result))   \
+        {                               \
+            return result;              \
+        }                               \
+    } while (0)
+
+static const az_span twin_property_desired = AZ_SPAN_LITERAL_FROM_STR("desired");
+
+/**
+ * \brief Looks a property name up in the table.
+ *
+ * The name is unescaped and may be split over payload chunks. A name too long
+ * for TWIN_PROPERTY_NAME_SIZE is not in the table.
+ *
+ * \return The property, NULL when the name is not in the table
+ */
+const twin_property_t *twin_property_find(const twin_property_table_t *table, az_json_token *name)
+{
+    char buffer[TWIN_PROPERTY_NAME_SIZE];
+    int32_t length;
+    int32_t index;
+    uint32_t hash = table->seed;
+    const twin_property_t *property;
+
+    if (az_result_failed(az_json_token_get_string(name, buffer, sizeof(buffer), &length)))
+    {
+        return NULL;
+    }
+
+    // FNV-1a, as in device_model/twin_property_hash.py
+    for (index = 0; index < length; index++)
+    {
+        hash = (hash ^ (uint8_t)buffer[index]) * 16777619u;
+    }
+
+    property = &table->properties[hash & (table->size - 1)];
+
+    if (property->handler == NULL || !az_span_is_content_equal(property->name, az_span_create((uint8_t *)buffer, length)))
+    {
+        return NULL;
+    }
+
+    return property;
+}
+
+/**
+ * \brief Walks the desired properties once and hands each value to the handler
+ *        of its name, with context.
+ *
+ * The reader is at the start of a desired property update or, with
+ * is_full_twin, of a full twin document (GET), whose other sections are
+ * skipped. Properties, $version among them, may come in any order. The whole
+ * value of an unknown property is skipped.
+ *
+ * \return AZ_OK, or the first error of the reader or of a handler
+ */
+az_result twin_property_dispatch(const twin_property_table_t *table, az_json_reader *jr, bool is_full_twin,
+                                 void *context)
+{
+    DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+
+    if (jr->token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)
+    {
+        return AZ_ERROR_UNEXPECTED_CHAR;
+    }
+
+    DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+
+    if (is_full_twin)
+    {
+        while (jr->token.kind == AZ_JSON_TOKEN_PROPERTY_NAME &&
+               !az_json_token_is_text_equal(&jr->token, twin_property_desired))
+        {
+            DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+            DISPATCH_RETURN_IF_FAILED(az_json_reader_skip_children(jr));
+            DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+        }
+
+        if (jr->token.kind != AZ_JSON_TOKEN_PROPERTY_NAME)
+        {
+            return AZ_ERROR_ITEM_NOT_FOUND;
+        }
+
+        DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+
+        if (jr->token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)
+        {
+            return AZ_ERROR_UNEXPECTED_CHAR;
+        }
+
+        DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+    }
+
+    while (jr->token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
+    {
+        const twin_property_t *property = twin_property_find(table, &jr->token);
+
+        if (property == NULL)
+        {
+            if (table->unknown != NULL)
+            {
+                table->unknown(&jr->token);
+            }
+
+            DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+            DISPATCH_RETURN_IF_FAILED(az_json_reader_skip_children(jr));
+        }
+        else
+        {
+            DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+            DISPATCH_RETURN_IF_FAILED(property->handler(&jr->token, context));
+        }
+
+        DISPATCH_RETURN_IF_FAILED(az_json_reader_next_token(jr));
+    }
+
+    if (jr->token.kind != AZ_JSON_TOKEN_END_OBJECT)
+    {
+        return AZ_ERROR_UNEXPECTED_CHAR;
+    }
+
+    return AZ_OK;
+}
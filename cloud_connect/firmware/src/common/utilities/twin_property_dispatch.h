@@ -0,0 +1,67 @@
+/**
+ * \file
+ * \brief Desired twin properties handed to their handlers in one pass
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef TWIN_PROPERTY_DISPATCH_H
+#define TWIN_PROPERTY_DISPATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure/core/az_json.h"
+#include "azure/core/az_result.h"
+#include "azure/core/az_span.h"
+
+// Longest property name a table may hold, plus one
+#define TWIN_PROPERTY_NAME_SIZE (32)
+
+typedef az_result (*twin_property_handler_t)(az_json_token *value, void *context);
+
+typedef struct twin_property
+{
+    az_span name;
+    twin_property_handler_t handler;    // NULL in an empty slot
+} twin_property_t;
+
+/**
+ * \brief Properties found by the seeded FNV-1a hash of their name. The table
+ *        is a perfect hash, every name has a slot of its own, see
+ *        device_model/twin_property_hash.py.
+ */
+typedef struct twin_property_table
+{
+    const twin_property_t *properties;
+    uint32_t size;                          // power of two
+    uint32_t seed;
+    void (*unknown)(az_json_token *name);   // called for names not in the table, may be NULL
+} twin_property_table_t;
+
+const twin_property_t *twin_property_find(const twin_property_table_t *table, az_json_token *name);
+
+az_result twin_property_dispatch(const twin_property_table_t *table, az_json_reader *jr, bool is_full_twin,
+                                 void *context);
+
+#endif // TWIN_PROPERTY_DISPATCH_H
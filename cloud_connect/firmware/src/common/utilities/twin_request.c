@@ -0,0 +1,192 @@
+/**
+ * \file
+ * \brief Correlation of twin requests with their responses by request id
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "twin_request.h"
+
+static uint32_t request_rtt_bucket(uint32_t rtt_ms)
+{
+    uint32_t bucket = 0;
+
+    while (bucket < TWIN_REQUEST_RTT_BUCKETS - 1 && rtt_ms >= ((uint32_t)TWIN_REQUEST_RTT_BUCKET_MS << bucket))
+    {
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void request_count(uint16_t *counter)
+{
+    // Saturate rather than wrap, the counts are only reported
+    if (*counter != UINT16_MAX)
+    {
+        (*counter)++;
+    }
+}
+
+void twin_request_init(twin_request_table_t *table)
+{
+    uint32_t i;
+    uint32_t bucket;
+
+    for (i = 0; i < TWIN_REQUEST_TABLE_SIZE; i++)
+    {
+        table->entries[i].in_use = false;
+    }
+
+    for (i = 0; i < TWIN_REQUEST_KIND_COUNT; i++)
+    {
+        for (bucket = 0; bucket < TWIN_REQUEST_RTT_BUCKETS; bucket++)
+        {
+            table->rtt_histogram[i][bucket] = 0;
+        }
+    }
+
+    table->timeouts = 0;
+    table->unmatched = 0;
+}
+
+/**
+ * \brief FNV-1a hash of a request payload, to tell resent payloads apart in
+ *        the log.
+ */
+uint32_t twin_request_hash(const uint8_t *data, int32_t length)
+{
+    uint32_t hash = 2166136261UL;
+    int32_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619UL;
+    }
+
+    return hash;
+}
+
+/**
+ * \brief Records a request just sent. When the table is full the oldest
+ *        request is given up on and counted as timed out.
+ */
+void twin_request_add(twin_request_table_t *table, uint32_t request_id, twin_request_kind_t kind,
+                      uint32_t payload_hash, uint32_t now_ms)
+{
+    twin_request_t *slot = NULL;
+    uint32_t i;
+
+    for (i = 0; i < TWIN_REQUEST_TABLE_SIZE; i++)
+    {
+        twin_request_t *entry = &table->entries[i];
+
+        if (!entry->in_use)
+        {
+            slot = entry;
+            break;
+        }
+
+        if (slot == NULL || (int32_t)(entry->sent_ms - slot->sent_ms) < 0)
+        {
+            slot = entry;
+        }
+    }
+
+    if (slot->in_use)
+    {
+        request_count(&table->timeouts);
+    }
+
+    slot->request_id = request_id;
+    slot->sent_ms = now_ms;
+    slot->payload_hash = payload_hash;
+    slot->kind = (uint8_t)kind;
+    slot->in_use = true;
+}
+
+/**
+ * \brief Matches a response to its request and counts the round trip time.
+ *
+ * \return false when no request with that id is outstanding, e.g. the response
+ *         came after the request timed out.
+ */
+bool twin_request_resolve(twin_request_table_t *table, uint32_t request_id, uint32_t now_ms,
+                          twin_request_t *request)
+{
+    uint32_t i;
+
+    for (i = 0; i < TWIN_REQUEST_TABLE_SIZE; i++)
+    {
+        twin_request_t *entry = &table->entries[i];
+
+        if (entry->in_use && entry->request_id == request_id)
+        {
+            entry->in_use = false;
+            request_count(&table->rtt_histogram[entry->kind][request_rtt_bucket(now_ms - entry->sent_ms)]);
+
+            if (request != NULL)
+            {
+                *request = *entry;
+            }
+
+            return true;
+        }
+    }
+
+    request_count(&table->unmatched);
+
+    return false;
+}
+
+/**
+ * \brief Removes one request that has waited timeout_ms or longer for its
+ *        response. Call until it returns false to collect all of them.
+ */
+bool twin_request_expire(twin_request_table_t *table, uint32_t now_ms, uint32_t timeout_ms,
+                         twin_request_t *request)
+{
+    uint32_t i;
+
+    for (i = 0; i < TWIN_REQUEST_TABLE_SIZE; i++)
+    {
+        twin_request_t *entry = &table->entries[i];
+
+        if (entry->in_use && now_ms - entry->sent_ms >= timeout_ms)
+        {
+            entry->in_use = false;
+            request_count(&table->timeouts);
+
+            if (request != NULL)
+            {
+                *request = *entry;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,85 @@
+/**
+ * \file
+ * \brief Correlation of twin requests with their responses by request id
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef TWIN_REQUEST_H
+#define TWIN_REQUEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TWIN_REQUEST_TABLE_SIZE     (4)
+
+/* Round trip times are counted in buckets doubling from 64 ms: bucket 0 holds
+ * up to 63 ms, bucket 1 up to 127 ms, ... and the last bucket 4096 ms and up */
+#define TWIN_REQUEST_RTT_BUCKET_MS  (64)
+#define TWIN_REQUEST_RTT_BUCKETS    (8)
+
+typedef enum
+{
+    TWIN_REQUEST_GET,
+    TWIN_REQUEST_PATCH,
+    TWIN_REQUEST_KIND_COUNT
+} twin_request_kind_t;
+
+/**
+ * \brief A request waiting for the response carrying its request id.
+ */
+typedef struct twin_request
+{
+    uint32_t request_id;
+    uint32_t sent_ms;
+    uint32_t payload_hash;
+    uint8_t kind;
+    bool in_use;
+} twin_request_t;
+
+/**
+ * \brief Outstanding requests and the round trip statistics of resolved ones.
+ *
+ * Times are in milliseconds from any free running clock, differences are taken
+ * modulo 2^32.
+ */
+typedef struct twin_request_table
+{
+    twin_request_t entries[TWIN_REQUEST_TABLE_SIZE];
+    uint16_t rtt_histogram[TWIN_REQUEST_KIND_COUNT][TWIN_REQUEST_RTT_BUCKETS];
+    uint16_t timeouts;
+    uint16_t unmatched;
+} twin_request_table_t;
+
+void twin_request_init(twin_request_table_t *table);
+
+uint32_t twin_request_hash(const uint8_t *data, int32_t length);
+
+void twin_request_add(twin_request_table_t *table, uint32_t request_id, twin_request_kind_t kind,
+                      uint32_t payload_hash, uint32_t now_ms);
+bool twin_request_resolve(twin_request_table_t *table, uint32_t request_id, uint32_t now_ms,
+                          twin_request_t *request);
+bool twin_request_expire(twin_request_table_t *table, uint32_t now_ms, uint32_t timeout_ms,
+                         twin_request_t *request);
+
+#endif // TWIN_REQUEST_H
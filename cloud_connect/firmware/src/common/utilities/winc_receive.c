@@ -0,0 +1,203 @@
+/**
+ * \file
+ * \brief WINC socket receive path queued in a byte ring
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "winc_receive.h"
+
+/**
+ * \brief Sets up a stopped receive path on top of the supplied storage.
+ *
+ * \param[in] rx                 The receive path to initialize
+ * \param[in] ring_buffer        The ring storage, a power of two of at least
+ *                               SOCKET_BUFFER_MAX_LENGTH bytes
+ * \param[in] ring_size          The ring storage size, in bytes
+ * \param[in] chunk              The buffer the WINC writes received chunks to
+ * \param[in] chunk_size         The chunk buffer size, in bytes
+ */
+void winc_receive_init(winc_receive_t *rx, uint8_t *ring_buffer, uint32_t ring_size,
+                       uint8_t *chunk, uint16_t chunk_size)
+{
+    byte_ring_init(&rx->ring, ring_buffer, ring_size);
+    rx->chunk = chunk;
+    rx->chunk_size = chunk_size;
+    rx->socket = -1;
+    rx->connected = false;
+    rx->recv_pending = false;
+}
+
+/**
+ * \brief Starts receiving on a newly connected socket, with an empty ring.
+ *
+ * \param[in] rx                 The receive path
+ * \param[in] socket             The connected socket
+ */
+void winc_receive_start(winc_receive_t *rx, SOCKET socket)
+{
+    byte_ring_reset(&rx->ring);
+    rx->socket = socket;
+    rx->connected = true;
+    rx->recv_pending = false;
+
+    winc_receive_arm(rx);
+}
+
+/**
+ * \brief Stops receiving and drops what the ring holds, when the socket is
+ *        closed.
+ *
+ * \param[in] rx                 The receive path
+ */
+void winc_receive_stop(winc_receive_t *rx)
+{
+    byte_ring_reset(&rx->ring);
+    rx->connected = false;
+    rx->recv_pending = false;
+}
+
+/**
+ * \brief Queues a receive on the socket if none is outstanding and the ring
+ *        can take a whole socket message.
+ *
+ * Completions are delivered to the socket callback from the WINC event
+ * handler, so nobody has to wait for them. When the ring is too full, the
+ * next read that drains it queues the receive.
+ *
+ * \param[in] rx                 The receive path
+ */
+void winc_receive_arm(winc_receive_t *rx)
+{
+    if (!rx->connected || rx->recv_pending)
+    {
+        return;
+    }
+
+    if (byte_ring_space(&rx->ring) < SOCKET_BUFFER_MAX_LENGTH)
+    {
+        return;
+    }
+
+    if (recv(rx->socket, rx->chunk, rx->chunk_size, 0) == SOCK_ERR_NO_ERROR)
+    {
+        rx->recv_pending = true;
+    }
+}
+
+/**
+ * \brief Queues a SOCKET_MSG_RECV chunk with data, called from the socket
+ *        callback. The next receive is queued once the last chunk of the
+ *        socket message is in.
+ *
+ * \param[in] rx                 The receive path
+ * \param[in] message            The message from the callback, with a
+ *                               s16BufferSize of 0 or more
+ *
+ * \return    false if the ring had no room for the chunk. The stream has lost
+ *            data then and the connection has to be dropped.
+ */
+bool winc_receive_chunk(winc_receive_t *rx, const tstrSocketRecvMsg *message)
+{
+    if (!byte_ring_write(&rx->ring, message->pu8Buffer, (uint32_t)message->s16BufferSize))
+    {
+        return false;
+    }
+
+    if (message->u16RemainingSize == 0)
+    {
+        rx->recv_pending = false;
+        winc_receive_arm(rx);
+    }
+
+    return true;
+}
+
+/**
+ * \brief Ends a receive the WINC completed with an error or a timeout, so the
+ *        next read can queue another one.
+ *
+ * \param[in] rx                 The receive path
+ */
+void winc_receive_failed(winc_receive_t *rx)
+{
+    rx->recv_pending = false;
+}
+
+/**
+ * \brief Takes exactly length bytes if they have been received, without
+ *        waiting for them.
+ *
+ * The WINC events are handled once first, so completed receives are in the
+ * ring. A part of the bytes is left where it is, for a later read to take
+ * with the rest.
+ *
+ * \param[in] rx                 The receive path
+ * \param[out] data              Where to copy the bytes to
+ * \param[in] length             The number of bytes wanted
+ *
+ * \return    length, or 0 if fewer bytes have been received so far
+ */
+uint32_t winc_receive_read(winc_receive_t *rx, uint8_t *data, uint32_t length)
+{
+    winc_receive_arm(rx);
+    m2m_wifi_handle_events();
+
+    if (byte_ring_count(&rx->ring) < length)
+    {
+        return 0;
+    }
+
+    byte_ring_read(&rx->ring, data, length);
+
+    // Reading may have made room for the next socket message
+    winc_receive_arm(rx);
+
+    return length;
+}
+
+/**
+ * \brief Takes whatever has been received, up to max_length bytes, without
+ *        waiting.
+ *
+ * \param[in] rx                 The receive path
+ * \param[out] data              Where to copy the bytes to
+ * \param[in] max_length         The most bytes to take
+ *
+ * \return    The number of bytes taken, 0 when nothing has arrived
+ */
+uint32_t winc_receive_read_available(winc_receive_t *rx, uint8_t *data, uint32_t max_length)
+{
+    uint32_t length;
+
+    winc_receive_arm(rx);
+    m2m_wifi_handle_events();
+
+    length = byte_ring_read(&rx->ring, data, max_length);
+
+    winc_receive_arm(rx);
+
+    return length;
+}
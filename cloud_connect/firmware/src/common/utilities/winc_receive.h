@@ -0,0 +1,69 @@
+/**
+ * \file
+ * \brief WINC socket receive path queued in a byte ring
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef WINC_RECEIVE_H
+#define WINC_RECEIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "wdrv_winc_client_api.h"
+#include "byte_ring.h"
+
+/**
+ * \brief Receive side of one WINC TCP socket.
+ *
+ * A receive is kept queued on the socket while the ring can take a whole
+ * socket message (SOCKET_BUFFER_MAX_LENGTH). Its SOCKET_MSG_RECV chunks land
+ * in the chunk buffer and are copied into the ring from the socket callback,
+ * so readers take bytes from the ring and never wait on a receive.
+ */
+typedef struct winc_receive
+{
+    byte_ring_t ring;
+    uint8_t *chunk;
+    uint16_t chunk_size;
+    SOCKET socket;
+    bool connected;
+    volatile bool recv_pending;
+} winc_receive_t;
+
+void winc_receive_init(winc_receive_t *rx, uint8_t *ring_buffer, uint32_t ring_size,
+                       uint8_t *chunk, uint16_t chunk_size);
+
+void winc_receive_start(winc_receive_t *rx, SOCKET socket);
+void winc_receive_stop(winc_receive_t *rx);
+
+void winc_receive_arm(winc_receive_t *rx);
+
+bool winc_receive_chunk(winc_receive_t *rx, const tstrSocketRecvMsg *message);
+void winc_receive_failed(winc_receive_t *rx);
+
+uint32_t winc_receive_read(winc_receive_t *rx, uint8_t *data, uint32_t length);
+uint32_t winc_receive_read_available(winc_receive_t *rx, uint8_t *data, uint32_t max_length);
+
+#endif // WINC_RECEIVE_H
@@ -0,0 +1,242 @@
+// Generated by device_model/dtdl_codegen.py from cryptoauthtrustplatform_hr9-2.json, do not edit
+
+#include <string.h>
+#include "hr9_model.h"
+
+#define RETURN_ERR_IF_FAILED(expression)       \
+    do                                         \
+    {                                          \
+        az_result const result = (expression); \
+        if (az_result_failed(result))          \
+        {                                      \
+            return result;                     \
+        }                                      \
+    } while (0)
+
+#define WRITE_LITERAL(out, literal)                    \
+    do                                                 \
+    {                                                  \
+        memcpy((out), (literal), sizeof(literal) - 1); \
+        (out) += sizeof(literal) - 1;                  \
+    } while (0)
+
+static uint8_t* write_int32(uint8_t* out, int32_t value)
+{
+    uint8_t  digits[10];
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    int32_t  count     = 0;
+
+    if (value < 0)
+    {
+        *out++ = '-';
+    }
+
+    do
+    {
+        digits[count++] = (uint8_t)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    while (count > 0)
+    {
+        *out++ = digits[--count];
+    }
+
+    return out;
+}
+
+int32_t hr9_telemetry_max_size(uint32_t mask)
+{
+    int32_t size = 2;   // braces, each field below also counts a separator
+
+    if (mask & HR9_TELEMETRY_HEART_RATE)
+    {
+        size += 24;
+    }
+    if (mask & HR9_TELEMETRY_HEART_RATE_MIN)
+    {
+        size += 27;
+    }
+    if (mask & HR9_TELEMETRY_HEART_RATE_MAX)
+    {
+        size += 27;
+    }
+    if (mask & HR9_TELEMETRY_HEART_RATE_SAMPLES)
+    {
+        size += 31;
+    }
+    if (mask & HR9_TELEMETRY_HEART_RATE_CONFIDENCE)
+    {
+        size += 34;
+    }
+
+    // The first field has no separator
+    return mask != 0 ? size - 1 : size;
+}
+
+az_result hr9_telemetry_encode(
+    hr9_telemetry_t const* telemetry,
+    uint32_t               mask,
+    az_span                destination,
+    az_span*               out_payload)
+{
+    uint8_t* start = az_span_ptr(destination);
+    uint8_t* out   = start;
+
+    if (az_span_size(destination) < hr9_telemetry_max_size(mask))
+    {
+        return AZ_ERROR_NOT_ENOUGH_SPACE;
+    }
+
+    *out++ = '{';
+
+    if (mask & HR9_TELEMETRY_HEART_RATE)
+    {
+        if (out != start + 1)
+        {
+            *out++ = ',';
+        }
+        WRITE_LITERAL(out, "\"heartRate\":");
+        out = write_int32(out, telemetry->heart_rate);
+    }
+
+    if (mask & HR9_TELEMETRY_HEART_RATE_MIN)
+    {
+        if (out != start + 1)
+        {
+            *out++ = ',';
+        }
+        WRITE_LITERAL(out, "\"heartRateMin\":");
+        out = write_int32(out, telemetry->heart_rate_min);
+    }
+
+    if (mask & HR9_TELEMETRY_HEART_RATE_MAX)
+    {
+        if (out != start + 1)
+        {
+            *out++ = ',';
+        }
+        WRITE_LITERAL(out, "\"heartRateMax\":");
+        out = write_int32(out, telemetry->heart_rate_max);
+    }
+
+    if (mask & HR9_TELEMETRY_HEART_RATE_SAMPLES)
+    {
+        if (out != start + 1)
+        {
+            *out++ = ',';
+        }
+        WRITE_LITERAL(out, "\"heartRateSamples\":");
+        out = write_int32(out, telemetry->heart_rate_samples);
+    }
+
+    if (mask & HR9_TELEMETRY_HEART_RATE_CONFIDENCE)
+    {
+        if (out != start + 1)
+        {
+            *out++ = ',';
+        }
+        WRITE_LITERAL(out, "\"heartRateConfidence\":");
+        out = write_int32(out, telemetry->heart_rate_confidence);
+    }
+    *out++ = '}';
+
+    *out_payload = az_span_slice(destination, 0, (int32_t)(out - start));
+    return AZ_OK;
+}
+
+static const az_span hr9_telemetry_names[] = {
+    AZ_SPAN_LITERAL_FROM_STR("heartRate"),
+    AZ_SPAN_LITERAL_FROM_STR("heartRateMin"),
+    AZ_SPAN_LITERAL_FROM_STR("heartRateMax"),
+    AZ_SPAN_LITERAL_FROM_STR("heartRateSamples"),
+    AZ_SPAN_LITERAL_FROM_STR("heartRateConfidence"),
+};
+
+az_result hr9_telemetry_decode(
+    az_json_reader*  jr,
+    hr9_telemetry_t* telemetry,
+    uint32_t*        out_mask)
+{
+    uint32_t mask = 0;
+
+    RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+
+    if (jr->token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)
+    {
+        return AZ_ERROR_UNEXPECTED_CHAR;
+    }
+
+    RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+
+    while (jr->token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
+    {
+        switch (az_json_token_find_text(&jr->token, hr9_telemetry_names, 5))
+        {
+            case 0:    // heartRate
+                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+                RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr->token, &telemetry->heart_rate));
+                if (telemetry->heart_rate < 0 || telemetry->heart_rate > 300)
+                {
+                    return AZ_ERROR_ARG;
+                }
+                mask |= HR9_TELEMETRY_HEART_RATE;
+                break;
+
+            case 1:    // heartRateMin
+                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+                RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr->token, &telemetry->heart_rate_min));
+                if (telemetry->heart_rate_min < 0 || telemetry->heart_rate_min > 300)
+                {
+                    return AZ_ERROR_ARG;
+                }
+                mask |= HR9_TELEMETRY_HEART_RATE_MIN;
+                break;
+
+            case 2:    // heartRateMax
+                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+                RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr->token, &telemetry->heart_rate_max));
+                if (telemetry->heart_rate_max < 0 || telemetry->heart_rate_max > 300)
+                {
+                    return AZ_ERROR_ARG;
+                }
+                mask |= HR9_TELEMETRY_HEART_RATE_MAX;
+                break;
+
+            case 3:    // heartRateSamples
+                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+                RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr->token, &telemetry->heart_rate_samples));
+                if (telemetry->heart_rate_samples < 0 || telemetry->heart_rate_samples > 65535)
+                {
+                    return AZ_ERROR_ARG;
+                }
+                mask |= HR9_TELEMETRY_HEART_RATE_SAMPLES;
+                break;
+
+            case 4:    // heartRateConfidence
+                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+                RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr->token, &telemetry->heart_rate_confidence));
+                if (telemetry->heart_rate_confidence < 0 || telemetry->heart_rate_confidence > 100)
+                {
+                    return AZ_ERROR_ARG;
+                }
+                mask |= HR9_TELEMETRY_HEART_RATE_CONFIDENCE;
+                break;
+
+            default:
+                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+                RETURN_ERR_IF_FAILED(az_json_reader_skip_children(jr));
+                break;
+        }
+
+        RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));
+    }
+
+    if (jr->token.kind != AZ_JSON_TOKEN_END_OBJECT)
+    {
+        return AZ_ERROR_UNEXPECTED_CHAR;
+    }
+
+    *out_mask = mask;
+    return AZ_OK;
+}
@@ -0,0 +1,74 @@
+// Generated by device_model/dtdl_codegen.py from cryptoauthtrustplatform_hr9-2.json, do not edit
+// Model: dtmi:com:Microchip:CryptoAuthTrustPlatform_HR9;2
+
+#ifndef _HR9_MODEL_H
+#define _HR9_MODEL_H
+
+#include <stdint.h>
+#include "azure/core/az_span.h"
+#include "azure/core/az_json.h"
+
+typedef enum
+{
+    HR9_LED_STATE_OFF = 0,
+    HR9_LED_STATE_ON = 1,
+    HR9_LED_STATE_BLINK = 2,
+} hr9_led_state_t;
+
+typedef enum
+{
+    HR9_DEBUG_LEVEL_SEVERITY_NONE = 0,
+    HR9_DEBUG_LEVEL_SEVERITY_ERROR = 1,
+    HR9_DEBUG_LEVEL_SEVERITY_WARN = 2,
+    HR9_DEBUG_LEVEL_SEVERITY_DEBUG = 3,
+    HR9_DEBUG_LEVEL_SEVERITY_INFO = 4,
+    HR9_DEBUG_LEVEL_SEVERITY_TRACE = 5,
+} hr9_debug_level_t;
+
+#define HR9_TELEMETRY_HEART_RATE (1u << 0)
+#define HR9_TELEMETRY_HEART_RATE_MIN (1u << 1)
+#define HR9_TELEMETRY_HEART_RATE_MAX (1u << 2)
+#define HR9_TELEMETRY_HEART_RATE_SAMPLES (1u << 3)
+#define HR9_TELEMETRY_HEART_RATE_CONFIDENCE (1u << 4)
+#define HR9_TELEMETRY_ALL (0x1fu)
+
+// Worst case size of a document with every telemetry
+#define HR9_TELEMETRY_MAX_SIZE 144
+
+typedef struct
+{
+    int32_t heart_rate;
+    int32_t heart_rate_min;
+    int32_t heart_rate_max;
+    int32_t heart_rate_samples;
+    int32_t heart_rate_confidence;
+} hr9_telemetry_t;
+
+/**********************************************
+* Worst case size of a telemetry document holding the
+* fields selected by mask (HR9_TELEMETRY_*)
+**********************************************/
+int32_t hr9_telemetry_max_size(uint32_t mask);
+
+/**********************************************
+* Write the fields selected by mask as a JSON object.
+* Fails with AZ_ERROR_NOT_ENOUGH_SPACE when destination
+* is smaller than hr9_telemetry_max_size(mask).
+**********************************************/
+az_result hr9_telemetry_encode(
+    hr9_telemetry_t const* telemetry,
+    uint32_t               mask,
+    az_span                destination,
+    az_span*               out_payload);
+
+/**********************************************
+* Read a JSON object of telemetry, the reader is
+* positioned before the object. out_mask is set to the
+* fields found, unknown names are skipped.
+**********************************************/
+az_result hr9_telemetry_decode(
+    az_json_reader*  jr,
+    hr9_telemetry_t* telemetry,
+    uint32_t*        out_mask);
+
+#endif // _HR9_MODEL_H
@@ -0,0 +1,69 @@
+/**
+ * \file
+ * \brief Harmony definitions.h for host builds: the SYS_TIME counter and the
+ *        SERCOM0 USART the Heart Rate 9 click is on
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef DEFINITIONS_H
+#define DEFINITIONS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* SYS_TIME runs from a counter the test moves on by hand. It counts at the
+ * 48 MHz the SAMD21 TC runs at unless a test sets another frequency. */
+#define SYS_TIME_DOUBLE_FREQUENCY   48000000UL
+
+uint64_t SYS_TIME_Counter64Get(void);
+uint32_t SYS_TIME_FrequencyGet(void);
+
+void sys_time_double_set(uint64_t count, uint32_t frequency);
+void sys_time_double_advance(uint64_t ticks);
+void sys_time_double_advance_ms(uint32_t ms);
+
+/* The SERCOM0 USART ring buffer PLIB, from sercom0_usart_double.c */
+typedef enum
+{
+    SERCOM_USART_EVENT_READ_THRESHOLD_REACHED = 0,
+    SERCOM_USART_EVENT_READ_BUFFER_FULL,
+    SERCOM_USART_EVENT_READ_ERROR,
+    SERCOM_USART_EVENT_WRITE_THRESHOLD_REACHED,
+    SERCOM_USART_EVENT_BREAK_SIGNAL_DETECTED,
+} SERCOM_USART_EVENT;
+
+typedef void (*SERCOM_USART_RING_BUFFER_CALLBACK)(SERCOM_USART_EVENT event, uintptr_t context);
+
+size_t SERCOM0_USART_Read(uint8_t *pRdBuffer, const size_t size);
+size_t SERCOM0_USART_ReadCountGet(void);
+void SERCOM0_USART_ReadCallbackRegister(SERCOM_USART_RING_BUFFER_CALLBACK callback, uintptr_t context);
+
+void SYSTICK_TimerStart(void);
+void SYSTICK_DelayMs(uint32_t delay_ms);
+
+void WDRV_WINC_RESETN_Set(void);
+void WDRV_WINC_RESETN_Clear(void);
+
+#endif // DEFINITIONS_H
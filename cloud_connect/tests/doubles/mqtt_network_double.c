@@ -0,0 +1,129 @@
+/**
+ * \file
+ * \brief MQTT network double that receives in fragments
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "mqtt_network_double.h"
+#include "definitions.h"
+
+static unsigned char queued[MQTT_NETWORK_DOUBLE_SIZE];
+static int queued_length;
+static int arrived_length;
+static int read_offset;
+
+static unsigned char sent[MQTT_NETWORK_DOUBLE_SIZE];
+static int sent_length;
+
+static int take(unsigned char *buffer, int length)
+{
+    int available = arrived_length - read_offset;
+
+    if (length > available)
+    {
+        length = available;
+    }
+
+    memcpy(buffer, &queued[read_offset], length);
+    read_offset += length;
+    return length;
+}
+
+static int double_read(Network *network, unsigned char *buffer, int length, int timeout_ms)
+{
+    if (arrived_length - read_offset < length)
+    {
+        mqtt_network_double_arrive(length - (arrived_length - read_offset));
+    }
+
+    // nothing more is coming, the read waits out its timeout
+    if (arrived_length - read_offset < length)
+    {
+        sys_time_double_advance_ms(timeout_ms);
+    }
+
+    return take(buffer, length);
+}
+
+static int double_read_available(Network *network, unsigned char *buffer, int length)
+{
+    return take(buffer, length);
+}
+
+static int double_write(Network *network, unsigned char *buffer, int length, int timeout_ms)
+{
+    if (length > MQTT_NETWORK_DOUBLE_SIZE - sent_length)
+    {
+        return -1;
+    }
+
+    memcpy(&sent[sent_length], buffer, length);
+    sent_length += length;
+    return length;
+}
+
+void mqtt_network_double_init(Network *network)
+{
+    queued_length = 0;
+    arrived_length = 0;
+    read_offset = 0;
+    sent_length = 0;
+
+    network->mqttread = double_read;
+    network->mqttwrite = double_write;
+    network->mqttreadavailable = double_read_available;
+}
+
+void mqtt_network_double_queue(const unsigned char *data, int length)
+{
+    memcpy(&queued[queued_length], data, length);
+    queued_length += length;
+}
+
+void mqtt_network_double_arrive(int length)
+{
+    arrived_length += length;
+    if (arrived_length > queued_length)
+    {
+        arrived_length = queued_length;
+    }
+}
+
+int mqtt_network_double_queued(void)
+{
+    return queued_length - arrived_length;
+}
+
+const unsigned char *mqtt_network_double_sent(int *length)
+{
+    *length = sent_length;
+    return sent;
+}
+
+void mqtt_network_double_clear_sent(void)
+{
+    sent_length = 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * \file
+ * \brief MQTT network double that receives in fragments
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef MQTT_NETWORK_DOUBLE_H
+#define MQTT_NETWORK_DOUBLE_H
+
+#include <stdint.h>
+
+#include "network_interface.h"
+
+#define MQTT_NETWORK_DOUBLE_SIZE    (16 * 1024)
+
+/**
+ * \brief A Network for the Paho client backed by two byte queues.
+ *
+ * Bytes given to mqtt_network_double_queue() are sent by the "broker" but
+ * only received once mqtt_network_double_arrive() lets them through, so a
+ * packet can be made to come in any fragments. mqttreadavailable() only
+ * returns what has arrived. mqttread() stands for a blocking read that
+ * waits for the rest, so it lets queued bytes arrive as it needs them, and
+ * when there are not enough it waits out its timeout on the SYS_TIME double.
+ * Everything the client writes is kept for the test to look at.
+ */
+void mqtt_network_double_init(Network *network);
+
+void mqtt_network_double_queue(const unsigned char *data, int length);
+void mqtt_network_double_arrive(int length);
+int mqtt_network_double_queued(void);
+
+const unsigned char *mqtt_network_double_sent(int *length);
+void mqtt_network_double_clear_sent(void);
+
+#endif // MQTT_NETWORK_DOUBLE_H
@@ -0,0 +1,122 @@
+/**
+ * \file
+ * \brief Sector-erased flash simulated in RAM
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "ram_flash.h"
+
+static ram_flash_t ram_flash;
+static uint32_t ram_flash_sector_size;
+static uint32_t ram_flash_size;
+
+static bool ram_flash_in_range(uint32_t offset, uint32_t length)
+{
+    return offset <= ram_flash_size && length <= ram_flash_size - offset;
+}
+
+static bool ram_flash_read(uint32_t offset, uint8_t *data, uint32_t length)
+{
+    if (ram_flash.powered_down || !ram_flash_in_range(offset, length))
+    {
+        return false;
+    }
+
+    memcpy(data, &ram_flash.memory[offset], length);
+    ram_flash.bytes_read += length;
+    return true;
+}
+
+static bool ram_flash_write(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+
+    if (ram_flash.powered_down || !ram_flash_in_range(offset, length))
+    {
+        return false;
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        if (ram_flash.power_cut_after != 0 && ++ram_flash.bytes_written >= ram_flash.power_cut_after)
+        {
+            ram_flash.powered_down = true;
+            return false;
+        }
+
+        if ((data[i] & ~ram_flash.memory[offset + i]) != 0)
+        {
+            ram_flash.bits_set_without_erase++;
+        }
+
+        ram_flash.memory[offset + i] &= data[i];
+    }
+
+    return true;
+}
+
+static bool ram_flash_erase(uint32_t offset)
+{
+    if (ram_flash.powered_down || offset % ram_flash_sector_size != 0 ||
+        !ram_flash_in_range(offset, ram_flash_sector_size))
+    {
+        return false;
+    }
+
+    memset(&ram_flash.memory[offset], 0xFF, ram_flash_sector_size);
+    ram_flash.erase_count[offset / ram_flash_sector_size]++;
+    return true;
+}
+
+/**
+ * \brief Sets up flash callbacks over a fresh simulated part, holding zeros
+ *        like a region nobody formatted yet.
+ */
+void ram_flash_init(telemetry_log_flash_t *flash, uint32_t sector_size, uint32_t sector_count)
+{
+    memset(&ram_flash, 0, sizeof(ram_flash));
+
+    ram_flash_sector_size = sector_size;
+    ram_flash_size = sector_size * sector_count;
+
+    flash->read = ram_flash_read;
+    flash->write = ram_flash_write;
+    flash->erase = ram_flash_erase;
+    flash->sector_size = sector_size;
+    flash->sector_count = sector_count;
+}
+
+void ram_flash_power_up(void)
+{
+    ram_flash.powered_down = false;
+    ram_flash.power_cut_after = 0;
+    ram_flash.bytes_written = 0;
+}
+
+ram_flash_t *ram_flash_get(void)
+{
+    return &ram_flash;
+}
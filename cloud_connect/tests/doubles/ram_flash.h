@@ -0,0 +1,63 @@
+/**
+ * \file
+ * \brief Sector-erased flash simulated in RAM
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef RAM_FLASH_H
+#define RAM_FLASH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telemetry_log.h"
+
+#define RAM_FLASH_MAX_SIZE      (16 * 1024)
+#define RAM_FLASH_MAX_SECTORS   (32)
+
+/**
+ * \brief Flash the way telemetry_log_flash_t describes it: a write can only
+ *        clear bits, an erase sets a whole sector back to 0xFF.
+ *
+ * A write that would set a bit is counted and leaves the bit cleared, as real
+ * flash does. Setting power_cut_after makes the write that many bytes later
+ * stop halfway and every later access fail, until ram_flash_power_up().
+ */
+typedef struct ram_flash
+{
+    uint8_t memory[RAM_FLASH_MAX_SIZE];
+    uint32_t erase_count[RAM_FLASH_MAX_SECTORS];
+    uint32_t bits_set_without_erase;
+    uint32_t bytes_written;
+    uint32_t bytes_read;
+    uint32_t power_cut_after;
+    bool powered_down;
+} ram_flash_t;
+
+void ram_flash_init(telemetry_log_flash_t *flash, uint32_t sector_size, uint32_t sector_count);
+void ram_flash_power_up(void);
+
+ram_flash_t *ram_flash_get(void);
+
+#endif // RAM_FLASH_H
@@ -0,0 +1,220 @@
+/**
+ * \file
+ * \brief Register model of the Avnet board sensors behind Sensor_IO_Read/Write
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "sensors.h"
+#include "sensor_io_double.h"
+
+#define LSM6DSL_FIFO_CTRL1      0x06
+#define LSM6DSL_FIFO_CTRL2      0x07
+#define LSM6DSL_FIFO_CTRL4      0x09
+#define LSM6DSL_CTRL3_C         0x12
+#define LSM6DSL_FIFO_STATUS1    0x3A
+#define LSM6DSL_FIFO_STATUS2    0x3B
+#define LSM6DSL_FIFO_STATUS3    0x3C
+#define LSM6DSL_FIFO_STATUS4    0x3D
+#define LSM6DSL_FIFO_DATA_OUT_L 0x3E
+#define LSM6DSL_FIFO_DATA_OUT_H 0x3F
+#define LPS22HB_CTRL_REG2       0x11
+
+#define FIFO_DEPTH              4096        // words, as on the part
+#define FIFO_PATTERN_WORDS      6
+
+static uint8_t  registers[128][256];
+static uint32_t reads;
+static uint32_t writes;
+
+/* The FIFO counts words in and out, both only grow */
+static uint16_t fifo[FIFO_DEPTH];
+static uint32_t fifo_head;
+static uint32_t fifo_tail;
+static uint32_t fifo_popped;
+static bool     fifo_low_byte_read;
+
+static uint32_t fifo_count(void)
+{
+    return fifo_tail - fifo_head;
+}
+
+static uint32_t fifo_limit(void)
+{
+    uint8_t *lsm6dsl = registers[SENSOR_IO_DOUBLE_LSM6DSL];
+
+    if ((lsm6dsl[LSM6DSL_FIFO_CTRL4] & 0x80) == 0)
+    {
+        return FIFO_DEPTH;
+    }
+
+    return lsm6dsl[LSM6DSL_FIFO_CTRL1] | ((lsm6dsl[LSM6DSL_FIFO_CTRL2] & 0x07) << 8);
+}
+
+static uint8_t lsm6dsl_get(uint8_t reg)
+{
+    uint32_t count = fifo_count();
+    uint16_t word = count != 0 ? fifo[fifo_head % FIFO_DEPTH] : 0;
+
+    switch (reg)
+    {
+        case LSM6DSL_FIFO_STATUS1:
+            return (uint8_t)count;
+        case LSM6DSL_FIFO_STATUS2:
+            return (uint8_t)(((count >> 8) & 0x0F) | (count == 0 ? 0x10 : 0));
+        case LSM6DSL_FIFO_STATUS3:
+            return (uint8_t)(fifo_popped % FIFO_PATTERN_WORDS);
+        case LSM6DSL_FIFO_STATUS4:
+            return 0;
+        case LSM6DSL_FIFO_DATA_OUT_L:
+            fifo_low_byte_read = count != 0;
+            return (uint8_t)word;
+        case LSM6DSL_FIFO_DATA_OUT_H:
+            if (fifo_low_byte_read)
+            {
+                fifo_head++;
+                fifo_popped++;
+                fifo_low_byte_read = false;
+            }
+            return (uint8_t)(word >> 8);
+        default:
+            return registers[SENSOR_IO_DOUBLE_LSM6DSL][reg];
+    }
+}
+
+/* Register address of the next byte in a multi-byte transfer */
+static uint8_t next_register(uint8_t address, uint8_t reg, bool multi)
+{
+    switch (address)
+    {
+        case SENSOR_IO_DOUBLE_LSM6DSL:
+            if ((registers[address][LSM6DSL_CTRL3_C] & 0x04) == 0)
+            {
+                return reg;
+            }
+            // The FIFO output wraps back to its low byte
+            return reg == LSM6DSL_FIFO_DATA_OUT_H ? LSM6DSL_FIFO_DATA_OUT_L : (uint8_t)(reg + 1);
+        case SENSOR_IO_DOUBLE_LPS22HB:
+            return (registers[address][LPS22HB_CTRL_REG2] & 0x10) != 0 ? (uint8_t)(reg + 1) : reg;
+        case SENSOR_IO_DOUBLE_HTS221:
+            return multi ? (uint8_t)(reg + 1) : reg;
+        default:
+            return (uint8_t)(reg + 1);
+    }
+}
+
+static uint8_t device_address(void *handle, uint8_t *reg, bool *multi)
+{
+    uint8_t address = ((DrvContextTypeDef *)handle)->address >> 1;
+
+    *multi = false;
+    if (address == SENSOR_IO_DOUBLE_HTS221 || address == SENSOR_IO_DOUBLE_LIS2MDL)
+    {
+        *multi = (*reg & 0x80) != 0;
+        *reg &= 0x7F;
+    }
+
+    return address;
+}
+
+uint8_t Sensor_IO_Write(void *handle, uint8_t WriteAddr, uint8_t *pBuffer, uint16_t nBytesToWrite)
+{
+    bool     multi;
+    uint8_t  address = device_address(handle, &WriteAddr, &multi);
+    uint16_t i;
+
+    writes++;
+    for (i = 0; i < nBytesToWrite; i++)
+    {
+        registers[address][WriteAddr] = pBuffer[i];
+        WriteAddr = next_register(address, WriteAddr, multi);
+    }
+
+    return 0;
+}
+
+uint8_t Sensor_IO_Read(void *handle, uint8_t ReadAddr, uint8_t *pBuffer, uint16_t nBytesToRead)
+{
+    bool     multi;
+    uint8_t  address = device_address(handle, &ReadAddr, &multi);
+    uint16_t i;
+
+    reads++;
+    for (i = 0; i < nBytesToRead; i++)
+    {
+        pBuffer[i] = address == SENSOR_IO_DOUBLE_LSM6DSL ? lsm6dsl_get(ReadAddr) : registers[address][ReadAddr];
+        ReadAddr = next_register(address, ReadAddr, multi);
+    }
+
+    return 0;
+}
+
+void sensor_io_double_init(void)
+{
+    memset(registers, 0, sizeof(registers));
+    reads = 0;
+    writes = 0;
+    sensor_io_double_fifo_clear();
+    fifo_popped = 0;
+}
+
+uint8_t *sensor_io_double_registers(uint8_t address)
+{
+    return registers[address];
+}
+
+uint32_t sensor_io_double_reads(void)
+{
+    return reads;
+}
+
+uint32_t sensor_io_double_writes(void)
+{
+    return writes;
+}
+
+void sensor_io_double_fifo_push(uint16_t word)
+{
+    fifo[fifo_tail++ % FIFO_DEPTH] = word;
+
+    while (fifo_count() > fifo_limit())
+    {
+        fifo_head++;
+        fifo_popped++;
+    }
+}
+
+void sensor_io_double_fifo_clear(void)
+{
+    fifo_head = fifo_tail;
+    fifo_low_byte_read = false;
+}
+
+void sensor_io_double_fifo_set_pattern(uint32_t position)
+{
+    fifo_popped = position;
+}
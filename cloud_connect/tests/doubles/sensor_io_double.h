@@ -0,0 +1,63 @@
+/**
+ * \file
+ * \brief Register model of the Avnet board sensors behind Sensor_IO_Read/Write
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#ifndef SENSOR_IO_DOUBLE_H
+#define SENSOR_IO_DOUBLE_H
+
+#include <stdint.h>
+
+/* 7-bit I2C addresses of the four devices on the board */
+#define SENSOR_IO_DOUBLE_LSM6DSL    0x6B
+#define SENSOR_IO_DOUBLE_LIS2MDL    0x1E
+#define SENSOR_IO_DOUBLE_LPS22HB    0x5D
+#define SENSOR_IO_DOUBLE_HTS221     0x5F
+
+/**
+ * \brief Replaces sensor_io.c with a register file per device.
+ *
+ * Every Sensor_IO_Read() and Sensor_IO_Write() call is one transaction and
+ * is counted. Multi-byte transfers step the register address the way each
+ * device does: LSM6DSL with IF_INC, LPS22HB with IF_ADD_INC, HTS221 and
+ * LIS2MDL with the MSB of the sub-address. The LSM6DSL FIFO is a queue of
+ * 16-bit words behind FIFO_STATUS1..4 and FIFO_DATA_OUT_L/H, which keeps only
+ * the newest words once the FTH threshold is reached with STOP_ON_FTH set.
+ */
+void sensor_io_double_init(void);
+
+uint8_t *sensor_io_double_registers(uint8_t address);
+
+uint32_t sensor_io_double_reads(void);
+uint32_t sensor_io_double_writes(void);
+
+void sensor_io_double_fifo_push(uint16_t word);
+void sensor_io_double_fifo_clear(void);
+
+/* Pattern position of the next word in the FIFO, 0 to 5 */
+void sensor_io_double_fifo_set_pattern(uint32_t position);
+
+#endif // SENSOR_IO_DOUBLE_H
@@ -0,0 +1,158 @@
+/**
+ * \file
+ * \brief SERCOM0 USART ring buffer PLIB test double
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "sercom0_usart_double.h"
+
+static uint8_t read_buffer[SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE];
+static volatile uint32_t rd_in_index;
+static volatile uint32_t rd_out_index;
+static SERCOM_USART_RING_BUFFER_CALLBACK rd_callback;
+static uintptr_t rd_context;
+static void (*rx_interrupt)(void);
+
+void sercom0_usart_double_init(void)
+{
+    rd_in_index = 0;
+    rd_out_index = 0;
+    rd_callback = NULL;
+    rd_context = 0;
+    rx_interrupt = NULL;
+}
+
+void sercom0_usart_double_set_interrupt(void (*interrupt)(void))
+{
+    rx_interrupt = interrupt;
+}
+
+static void interrupt_point(void)
+{
+    void (*interrupt)(void) = rx_interrupt;
+
+    // An interrupt does not nest in itself
+    if (interrupt != NULL)
+    {
+        rx_interrupt = NULL;
+        interrupt();
+        rx_interrupt = interrupt;
+    }
+}
+
+/* SERCOM0_USART_RxPushByte(), 8-bit */
+bool sercom0_usart_double_receive(uint8_t byte)
+{
+    uint32_t temp_in_index = rd_in_index + 1;
+
+    if (temp_in_index >= SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE)
+    {
+        temp_in_index = 0;
+    }
+
+    if (temp_in_index == rd_out_index)
+    {
+        if (rd_callback != NULL)
+        {
+            rd_callback(SERCOM_USART_EVENT_READ_BUFFER_FULL, rd_context);
+
+            temp_in_index = rd_in_index + 1;
+            if (temp_in_index >= SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE)
+            {
+                temp_in_index = 0;
+            }
+        }
+    }
+
+    if (temp_in_index == rd_out_index)
+    {
+        return false;
+    }
+
+    read_buffer[rd_in_index] = byte;
+    rd_in_index = temp_in_index;
+    return true;
+}
+
+size_t SERCOM0_USART_Read(uint8_t *pRdBuffer, const size_t size)
+{
+    size_t n_bytes_read = 0;
+    uint32_t out_index = rd_out_index;
+    uint32_t in_index = rd_in_index;
+
+    interrupt_point();
+
+    while (n_bytes_read < size && out_index != in_index)
+    {
+        pRdBuffer[n_bytes_read++] = read_buffer[out_index++];
+        if (out_index >= SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE)
+        {
+            out_index = 0;
+        }
+
+        interrupt_point();
+    }
+
+    rd_out_index = out_index;
+
+    return n_bytes_read;
+}
+
+size_t SERCOM0_USART_ReadCountGet(void)
+{
+    uint32_t out_index = rd_out_index;
+    uint32_t in_index = rd_in_index;
+
+    if (in_index >= out_index)
+    {
+        return in_index - out_index;
+    }
+    return (SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE - out_index) + in_index;
+}
+
+void SERCOM0_USART_ReadCallbackRegister(SERCOM_USART_RING_BUFFER_CALLBACK callback, uintptr_t context)
+{
+    rd_callback = callback;
+    rd_context = context;
+}
+
+/* The rest of the board the Heart Rate 9 click routine touches */
+void SYSTICK_TimerStart(void)
+{
+}
+
+void SYSTICK_DelayMs(uint32_t delay_ms)
+{
+    sys_time_double_advance_ms(delay_ms);
+}
+
+void WDRV_WINC_RESETN_Set(void)
+{
+}
+
+void WDRV_WINC_RESETN_Clear(void)
+{
+}
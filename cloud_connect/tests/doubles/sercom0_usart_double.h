@@ -0,0 +1,54 @@
+/**
+ * \file
+ * \brief SERCOM0 USART ring buffer PLIB test double
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef SERCOM0_USART_DOUBLE_H
+#define SERCOM0_USART_DOUBLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "definitions.h"
+
+/* As sized in plib_sercom0_usart.c, the ring holds one byte less */
+#define SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE   512
+
+/**
+ * \brief Behaves like the receive side of the Harmony ring buffer PLIB.
+ *
+ * sercom0_usart_double_receive() is the RX interrupt pushing a byte, with
+ * the PLIB's index handling and READ_BUFFER_FULL callback. SERCOM0_USART_Read()
+ * is the PLIB's, working from a snapshot of the indices. The interrupt set
+ * with sercom0_usart_double_set_interrupt() fires at every point in it where
+ * the hardware could interrupt the read: after the snapshot and after each
+ * byte copied out.
+ */
+void sercom0_usart_double_init(void);
+void sercom0_usart_double_set_interrupt(void (*interrupt)(void));
+
+bool sercom0_usart_double_receive(uint8_t byte);
+
+#endif // SERCOM0_USART_DOUBLE_H
@@ -0,0 +1,58 @@
+/**
+ * \file
+ * \brief Harmony SYS_TIME counter moved on by the test
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include "definitions.h"
+
+static uint64_t sys_time_count;
+static uint32_t sys_time_frequency = SYS_TIME_DOUBLE_FREQUENCY;
+
+uint64_t SYS_TIME_Counter64Get(void)
+{
+    return sys_time_count;
+}
+
+uint32_t SYS_TIME_FrequencyGet(void)
+{
+    return sys_time_frequency;
+}
+
+void sys_time_double_set(uint64_t count, uint32_t frequency)
+{
+    sys_time_count = count;
+    sys_time_frequency = frequency;
+}
+
+void sys_time_double_advance(uint64_t ticks)
+{
+    sys_time_count += ticks;
+}
+
+/* Rounded up to a whole tick, as a wait of that long on target would be */
+void sys_time_double_advance_ms(uint32_t ms)
+{
+    sys_time_count += ((uint64_t)ms * sys_time_frequency + 999) / 1000;
+}
@@ -0,0 +1,230 @@
+/**
+ * \file
+ * \brief WINC socket test double
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "winc_socket_double.h"
+#include "definitions.h"
+
+#define WINC_DOUBLE_STREAM_SIZE     (64 * 1024)
+#define WINC_DOUBLE_SCHEDULE_SIZE   (512)
+
+static tpfAppSocketCb winc_callback;
+static uint32_t winc_event_cost_us;
+
+// Bytes received from the network and not yet handed to the host
+static uint8_t winc_stream[WINC_DOUBLE_STREAM_SIZE];
+static uint32_t winc_stream_length;
+static uint32_t winc_stream_arrived;
+static uint32_t winc_stream_offset;
+
+// Where the stream ends at each point in time, oldest first
+static struct
+{
+    uint64_t count;
+    uint32_t end;
+} winc_schedule[WINC_DOUBLE_SCHEDULE_SIZE];
+static uint32_t winc_schedule_length;
+static uint32_t winc_schedule_next;
+
+// The receive queued by recv() and what is left of the message it is delivering
+static uint8_t *winc_recv_buffer;
+static uint16_t winc_recv_length;
+static uint64_t winc_recv_deadline;
+static uint32_t winc_message_remaining;
+static uint32_t winc_recv_calls;
+
+static void winc_double_update(void)
+{
+    while (winc_schedule_next < winc_schedule_length &&
+           winc_schedule[winc_schedule_next].count <= SYS_TIME_Counter64Get())
+    {
+        winc_stream_arrived = winc_schedule[winc_schedule_next].end;
+        winc_schedule_next++;
+    }
+}
+
+void winc_double_init(tpfAppSocketCb callback)
+{
+    winc_callback = callback;
+    winc_event_cost_us = 0;
+    winc_stream_length = 0;
+    winc_stream_arrived = 0;
+    winc_stream_offset = 0;
+    winc_schedule_length = 0;
+    winc_schedule_next = 0;
+    winc_recv_buffer = NULL;
+    winc_recv_length = 0;
+    winc_recv_deadline = 0;
+    winc_message_remaining = 0;
+    winc_recv_calls = 0;
+}
+
+void winc_double_set_event_cost_us(uint32_t cost_us)
+{
+    winc_event_cost_us = cost_us;
+}
+
+void winc_double_arrive(const uint8_t *data, uint32_t length)
+{
+    winc_double_arrive_at(SYS_TIME_Counter64Get(), data, length);
+}
+
+/* Arrivals are scheduled in time order */
+void winc_double_arrive_at(uint64_t count, const uint8_t *data, uint32_t length)
+{
+    if (winc_stream_offset == winc_stream_length)
+    {
+        winc_stream_offset = 0;
+        winc_stream_arrived = 0;
+        winc_stream_length = 0;
+        winc_schedule_length = 0;
+        winc_schedule_next = 0;
+    }
+
+    if (winc_stream_length + length > sizeof(winc_stream) ||
+        winc_schedule_length == WINC_DOUBLE_SCHEDULE_SIZE)
+    {
+        return;
+    }
+
+    memcpy(&winc_stream[winc_stream_length], data, length);
+    winc_stream_length += length;
+
+    winc_schedule[winc_schedule_length].count = count;
+    winc_schedule[winc_schedule_length].end = winc_stream_length;
+    winc_schedule_length++;
+
+    winc_double_update();
+}
+
+uint32_t winc_double_pending(void)
+{
+    winc_double_update();
+    return winc_stream_arrived - winc_stream_offset;
+}
+
+uint32_t winc_double_queued(void)
+{
+    return winc_stream_length - winc_stream_offset;
+}
+
+bool winc_double_recv_armed(void)
+{
+    return winc_recv_buffer != NULL;
+}
+
+uint32_t winc_double_recv_calls(void)
+{
+    return winc_recv_calls;
+}
+
+int16_t recv(SOCKET sock, void *pvRecvBuf, uint16_t u16BufLen, uint32_t u32Timeoutmsec)
+{
+    (void)sock;
+
+    // The WINC takes one outstanding receive per socket
+    if (pvRecvBuf == NULL || u16BufLen == 0 || winc_recv_buffer != NULL)
+    {
+        return SOCK_ERR_INVALID_ARG;
+    }
+
+    winc_recv_buffer = pvRecvBuf;
+    winc_recv_length = u16BufLen;
+    winc_recv_deadline = 0;
+    winc_recv_calls++;
+
+    if (u32Timeoutmsec != 0)
+    {
+        winc_recv_deadline = SYS_TIME_Counter64Get() +
+                             ((uint64_t)u32Timeoutmsec * SYS_TIME_FrequencyGet()) / 1000;
+    }
+
+    return SOCK_ERR_NO_ERROR;
+}
+
+/* Delivers one chunk of the current socket message. The host driver reads a
+ * message bigger than the recv() buffer in several SOCKET_MSG_RECV callbacks
+ * into the same buffer. */
+int8_t m2m_wifi_handle_events(void)
+{
+    tstrSocketRecvMsg message;
+    uint32_t chunk;
+
+    sys_time_double_advance(((uint64_t)winc_event_cost_us * SYS_TIME_FrequencyGet()) / 1000000);
+
+    if (winc_recv_buffer == NULL)
+    {
+        return 0;
+    }
+
+    if (winc_message_remaining == 0 && winc_double_pending() == 0)
+    {
+        if (winc_recv_deadline != 0 && SYS_TIME_Counter64Get() >= winc_recv_deadline)
+        {
+            message.pu8Buffer = winc_recv_buffer;
+            message.s16BufferSize = SOCK_ERR_TIMEOUT;
+            message.u16RemainingSize = 0;
+
+            winc_recv_buffer = NULL;
+            winc_callback(0, SOCKET_MSG_RECV, &message);
+        }
+
+        return 0;
+    }
+
+    if (winc_message_remaining == 0)
+    {
+        winc_message_remaining = winc_double_pending();
+
+        if (winc_message_remaining > SOCKET_BUFFER_MAX_LENGTH)
+        {
+            winc_message_remaining = SOCKET_BUFFER_MAX_LENGTH;
+        }
+    }
+
+    chunk = winc_message_remaining < winc_recv_length ? winc_message_remaining : winc_recv_length;
+
+    memcpy(winc_recv_buffer, &winc_stream[winc_stream_offset], chunk);
+    winc_stream_offset += chunk;
+    winc_message_remaining -= chunk;
+
+    message.pu8Buffer = winc_recv_buffer;
+    message.s16BufferSize = (int16_t)chunk;
+    message.u16RemainingSize = (uint16_t)winc_message_remaining;
+
+    // The receive is complete once the last chunk is out, the callback may queue the next one
+    if (winc_message_remaining == 0)
+    {
+        winc_recv_buffer = NULL;
+    }
+
+    winc_callback(0, SOCKET_MSG_RECV, &message);
+
+    return 0;
+}
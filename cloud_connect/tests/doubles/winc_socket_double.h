@@ -0,0 +1,83 @@
+/**
+ * \file
+ * \brief WINC socket test double
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef WINC_SOCKET_DOUBLE_H
+#define WINC_SOCKET_DOUBLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The subset of drv/socket/socket.h the receive path uses, with the same
+ * names and values */
+#define SOCKET_BUFFER_MAX_LENGTH    1400
+#define SOCK_ERR_NO_ERROR           0
+#define SOCK_ERR_INVALID_ARG        -2
+#define SOCK_ERR_TIMEOUT            -13
+
+#define SOCKET_MSG_RECV             6
+
+typedef int8_t SOCKET;
+
+typedef struct
+{
+    uint8_t *pu8Buffer;
+    int16_t s16BufferSize;
+    uint16_t u16RemainingSize;
+} tstrSocketRecvMsg;
+
+typedef void (*tpfAppSocketCb)(SOCKET sock, uint8_t u8Msg, void *pvMsg);
+
+/**
+ * \brief Behaves like the WINC firmware and host driver for one TCP socket.
+ *
+ * Data queued with winc_double_arrive() is held by the "WINC" until recv() is
+ * called. m2m_wifi_handle_events() then delivers the oldest socket message,
+ * at most SOCKET_BUFFER_MAX_LENGTH bytes, to the socket callback in chunks no
+ * bigger than the recv() buffer, counting u16RemainingSize down to 0 on the
+ * last chunk. A new recv() is needed for the next message.
+ *
+ * Time is the SYS_TIME double's. winc_double_arrive_at() holds data back until
+ * the counter reaches a point in time, each m2m_wifi_handle_events() call moves
+ * the counter on by the cost set with winc_double_set_event_cost_us(), and a
+ * recv() with a timeout completes with SOCK_ERR_TIMEOUT once it has passed
+ * without data.
+ */
+void winc_double_init(tpfAppSocketCb callback);
+void winc_double_set_event_cost_us(uint32_t cost_us);
+
+void winc_double_arrive(const uint8_t *data, uint32_t length);
+void winc_double_arrive_at(uint64_t count, const uint8_t *data, uint32_t length);
+uint32_t winc_double_pending(void);
+uint32_t winc_double_queued(void);
+
+bool winc_double_recv_armed(void);
+uint32_t winc_double_recv_calls(void);
+
+int16_t recv(SOCKET sock, void *pvRecvBuf, uint16_t u16BufLen, uint32_t u32Timeoutmsec);
+int8_t m2m_wifi_handle_events(void);
+
+#endif // WINC_SOCKET_DOUBLE_H
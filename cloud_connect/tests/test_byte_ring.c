@@ -0,0 +1,138 @@
+/**
+ * \file
+ * \brief Host tests for the byte ring and the WINC receive path built on it
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "byte_ring.h"
+#include "test_common.h"
+
+static void test_write_read_wraps(void)
+{
+    uint8_t storage[16];
+    uint8_t data[12];
+    uint8_t out[12];
+    byte_ring_t ring;
+    uint32_t i;
+
+    byte_ring_init(&ring, storage, sizeof(storage));
+
+    for (i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)(i + 1);
+    }
+
+    // Move the indices close to the end of the storage first
+    TEST_CHECK(byte_ring_write(&ring, data, 10));
+    TEST_CHECK_EQUAL(10, byte_ring_read(&ring, out, 10));
+
+    TEST_CHECK(byte_ring_write(&ring, data, sizeof(data)));
+    TEST_CHECK_EQUAL(sizeof(data), byte_ring_count(&ring));
+    TEST_CHECK_EQUAL(sizeof(storage) - sizeof(data), byte_ring_space(&ring));
+
+    TEST_CHECK_EQUAL(sizeof(out), byte_ring_read(&ring, out, sizeof(out)));
+    TEST_CHECK(memcmp(data, out, sizeof(data)) == 0);
+    TEST_CHECK_EQUAL(0, byte_ring_count(&ring));
+}
+
+static void test_write_all_or_nothing(void)
+{
+    uint8_t storage[8];
+    uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t out[8];
+    byte_ring_t ring;
+
+    byte_ring_init(&ring, storage, sizeof(storage));
+
+    TEST_CHECK(byte_ring_write(&ring, data, 5));
+    TEST_CHECK(!byte_ring_write(&ring, data, 4));
+    TEST_CHECK_EQUAL(5, byte_ring_count(&ring));
+    TEST_CHECK(byte_ring_write(&ring, data, 3));
+    TEST_CHECK_EQUAL(0, byte_ring_space(&ring));
+
+    // A short read hands out what is there
+    TEST_CHECK_EQUAL(8, byte_ring_read(&ring, out, sizeof(out)));
+    TEST_CHECK_EQUAL(0, byte_ring_read(&ring, out, sizeof(out)));
+}
+
+static void test_peek_returns_contiguous_segments(void)
+{
+    uint8_t storage[8];
+    uint8_t data[6] = { 10, 11, 12, 13, 14, 15 };
+    uint8_t out[6];
+    const uint8_t *segment;
+    byte_ring_t ring;
+
+    byte_ring_init(&ring, storage, sizeof(storage));
+
+    TEST_CHECK_EQUAL(0, byte_ring_peek(&ring, &segment));
+
+    TEST_CHECK(byte_ring_write(&ring, data, 5));
+    TEST_CHECK_EQUAL(5, byte_ring_read(&ring, out, 5));
+
+    // The six bytes start at offset 5: three before the end of the storage, three after
+    TEST_CHECK(byte_ring_write(&ring, data, sizeof(data)));
+    TEST_CHECK_EQUAL(3, byte_ring_peek(&ring, &segment));
+    TEST_CHECK(segment == &storage[5]);
+    TEST_CHECK(memcmp(segment, data, 3) == 0);
+
+    byte_ring_consume(&ring, 3);
+    TEST_CHECK_EQUAL(3, byte_ring_peek(&ring, &segment));
+    TEST_CHECK(segment == &storage[0]);
+    TEST_CHECK(memcmp(segment, &data[3], 3) == 0);
+
+    // Consuming more than is there only empties the ring
+    byte_ring_consume(&ring, 100);
+    TEST_CHECK_EQUAL(0, byte_ring_count(&ring));
+    TEST_CHECK_EQUAL(sizeof(storage), byte_ring_space(&ring));
+}
+
+static void test_indices_wrap_around_32_bits(void)
+{
+    uint8_t storage[4];
+    uint8_t data[3] = { 1, 2, 3 };
+    uint8_t out[3];
+    byte_ring_t ring;
+
+    byte_ring_init(&ring, storage, sizeof(storage));
+    ring.head = UINT32_MAX - 1;
+    ring.tail = UINT32_MAX - 1;
+
+    TEST_CHECK(byte_ring_write(&ring, data, sizeof(data)));
+    TEST_CHECK_EQUAL(3, byte_ring_count(&ring));
+    TEST_CHECK_EQUAL(3, byte_ring_read(&ring, out, sizeof(out)));
+    TEST_CHECK(memcmp(data, out, sizeof(data)) == 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_write_read_wraps);
+    TEST_RUN(test_write_all_or_nothing);
+    TEST_RUN(test_peek_returns_contiguous_segments);
+    TEST_RUN(test_indices_wrap_around_32_bits);
+
+    return TEST_REPORT("byte_ring");
+}
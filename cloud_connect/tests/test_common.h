@@ -0,0 +1,93 @@
+/**
+ * \file
+ * \brief Minimal assertion harness for the host unit tests
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Each test file builds into its own executable, so the counters can be
+ * file local. A failed check ends the current test, the others still run. */
+static int test_failures = 0;
+static int test_count = 0;
+
+#define TEST_CHECK(condition)                                                   \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                    \
+            return;                                                             \
+        }                                                                       \
+    } while (0)
+
+#define TEST_CHECK_EQUAL(expected, actual)                                      \
+    do                                                                          \
+    {                                                                           \
+        long long test_expected_ = (long long)(expected);                       \
+        long long test_actual_ = (long long)(actual);                           \
+        if (test_expected_ != test_actual_)                                     \
+        {                                                                       \
+            printf("%s:%d: %s is %lld, expected %lld\n",                        \
+                   __FILE__, __LINE__, #actual, test_actual_, test_expected_);  \
+            test_failures++;                                                    \
+            return;                                                             \
+        }                                                                       \
+    } while (0)
+
+#define TEST_RUN(test)    \
+    do                    \
+    {                     \
+        test_count++;     \
+        test();           \
+    } while (0)
+
+/* Prints the summary and gives the exit status of the test executable */
+#define TEST_REPORT(name)                                                       \
+    (printf("%s: %d tests, %d failed\n", (name), test_count, test_failures),    \
+     test_failures == 0 ? 0 : 1)
+
+/* Deterministic xorshift generator, so a failing random run can be replayed */
+static uint32_t test_random_state = 2463534242UL;
+
+static inline uint32_t test_random(void)
+{
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+    return test_random_state;
+}
+
+/* A value from low to high, both included */
+static inline uint32_t test_random_range(uint32_t low, uint32_t high)
+{
+    return low + test_random() % (high - low + 1);
+}
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,307 @@
+/**
+ * \file
+ * \brief Host tests for the direct method router
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "direct_method_router.h"
+#include "test_common.h"
+
+// sendMsg sized payloads, as azutil.c gives the router
+#define PAYLOAD_SIZE (128 + 32)
+
+/* The test links with --wrap for the allocator, so a call from the router
+ * is counted before it is passed on */
+static volatile uint32_t allocations = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+static direct_method_router_t router;
+static uint8_t payloads[DIRECT_METHOD_SLOTS][PAYLOAD_SIZE];
+
+static az_result handler_a(az_span payload_span, az_span response_span, az_span* out_response_span,
+                           uint16_t* out_response_status)
+{
+    return AZ_OK;
+}
+
+static az_result handler_b(az_span payload_span, az_span response_span, az_span* out_response_span,
+                           uint16_t* out_response_status)
+{
+    return AZ_ERROR_ARG;
+}
+
+static uint32_t fnv1a(const char* name)
+{
+    uint32_t hash = 2166136261UL;
+
+    while (*name != '\0')
+    {
+        hash = (hash ^ (uint8_t)*name++) * 16777619UL;
+    }
+
+    return hash;
+}
+
+static void test_names_route_to_their_handlers(void)
+{
+    static const char* const names[] = { "reboot", "sendMsg", "getMaxMinReport", "setLed", "blink", "ping", "a", "" };
+    uint32_t i;
+
+    direct_method_router_init(&router, &payloads[0][0], PAYLOAD_SIZE);
+
+    for (i = 0; i < 8; i++)
+    {
+        TEST_CHECK(direct_method_register(&router, az_span_create_from_str((char*)names[i]),
+                                          (i & 1) ? handler_b : handler_a, (int32_t)i));
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        const direct_method_t* method = direct_method_find(&router, az_span_create_from_str((char*)names[i]));
+
+        TEST_CHECK(method != NULL);
+        TEST_CHECK(method->handler == ((i & 1) ? handler_b : handler_a));
+        TEST_CHECK_EQUAL(i, method->defer_ms);
+    }
+
+    // Names are matched in full, case included
+    TEST_CHECK(direct_method_find(&router, AZ_SPAN_FROM_STR("Reboot")) == NULL);
+    TEST_CHECK(direct_method_find(&router, AZ_SPAN_FROM_STR("rebootx")) == NULL);
+    TEST_CHECK(direct_method_find(&router, AZ_SPAN_FROM_STR("sendMs")) == NULL);
+}
+
+static void test_table_is_at_most_half_full(void)
+{
+    char names[DIRECT_METHOD_TABLE_SIZE][8];
+    uint32_t i;
+
+    direct_method_router_init(&router, &payloads[0][0], PAYLOAD_SIZE);
+
+    for (i = 0; i < DIRECT_METHOD_TABLE_SIZE / 2; i++)
+    {
+        sprintf(names[i], "m%u", (unsigned)i);
+        TEST_CHECK(direct_method_register(&router, az_span_create_from_str(names[i]), handler_a, 0));
+    }
+
+    sprintf(names[i], "m%u", (unsigned)i);
+    TEST_CHECK(!direct_method_register(&router, az_span_create_from_str(names[i]), handler_a, 0));
+    TEST_CHECK(direct_method_find(&router, az_span_create_from_str(names[i])) == NULL);
+
+    // Registering a name again replaces its handler and takes no more room
+    TEST_CHECK(direct_method_register(&router, AZ_SPAN_FROM_STR("m3"), handler_b, DIRECT_METHOD_INLINE));
+    TEST_CHECK_EQUAL(DIRECT_METHOD_TABLE_SIZE / 2, router.count);
+    TEST_CHECK(direct_method_find(&router, AZ_SPAN_FROM_STR("m3"))->handler == handler_b);
+    TEST_CHECK_EQUAL(DIRECT_METHOD_INLINE, direct_method_find(&router, AZ_SPAN_FROM_STR("m3"))->defer_ms);
+}
+
+/* Names that land on the same entry are found by probing past each other,
+ * including across the end of the table */
+static void test_colliding_names_are_probed(void)
+{
+    char names[4][8];
+    uint32_t found = 0;
+    uint32_t i;
+
+    direct_method_router_init(&router, &payloads[0][0], PAYLOAD_SIZE);
+
+    for (i = 0; found < 4 && i < 10000; i++)
+    {
+        sprintf(names[found], "c%u", (unsigned)i);
+        if ((fnv1a(names[found]) & (DIRECT_METHOD_TABLE_SIZE - 1)) == DIRECT_METHOD_TABLE_SIZE - 1)
+        {
+            found++;
+        }
+    }
+    TEST_CHECK_EQUAL(4, found);
+
+    for (i = 0; i < 4; i++)
+    {
+        TEST_CHECK(direct_method_register(&router, az_span_create_from_str(names[i]), handler_a, (int32_t)i));
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        const direct_method_t* method = direct_method_find(&router, az_span_create_from_str(names[i]));
+
+        TEST_CHECK(method != NULL);
+        TEST_CHECK_EQUAL(i, method->defer_ms);
+    }
+}
+
+static void test_deferred_call_keeps_a_copy_of_its_request(void)
+{
+    char payload[] = "{\"sendMsg\":\"hello\"}";
+    char request_id[] = "42";
+    const direct_method_t* method;
+    direct_method_slot_t* slot;
+    uint32_t index;
+
+    direct_method_router_init(&router, &payloads[0][0], PAYLOAD_SIZE);
+    TEST_CHECK(direct_method_register(&router, AZ_SPAN_FROM_STR("sendMsg"), handler_a, 0));
+    TEST_CHECK(direct_method_register(&router, AZ_SPAN_FROM_STR("later"), handler_b, 500));
+    TEST_CHECK(direct_method_next_ready(&router) == NULL);
+
+    method = direct_method_find(&router, AZ_SPAN_FROM_STR("sendMsg"));
+    TEST_CHECK_EQUAL(AZ_OK, direct_method_defer(&router, method, az_span_create_from_str(payload),
+                                                az_span_create_from_str(request_id), &index));
+
+    // The MQTT read buffer is reused for the next message
+    memset(payload, 'x', sizeof(payload) - 1);
+    memset(request_id, 'y', sizeof(request_id) - 1);
+
+    slot = direct_method_next_ready(&router);
+    TEST_CHECK(slot == &router.slots[index]);
+    TEST_CHECK(slot->method == method);
+    TEST_CHECK(az_span_is_content_equal(az_span_create(slot->payload, slot->payload_length),
+                                        AZ_SPAN_FROM_STR("{\"sendMsg\":\"hello\"}")));
+    TEST_CHECK(az_span_is_content_equal(az_span_create(slot->request_id, slot->request_id_length),
+                                        AZ_SPAN_FROM_STR("42")));
+    direct_method_slot_free(slot);
+    TEST_CHECK(direct_method_next_ready(&router) == NULL);
+
+    // A method with a delay waits for its timer
+    method = direct_method_find(&router, AZ_SPAN_FROM_STR("later"));
+    TEST_CHECK_EQUAL(AZ_OK, direct_method_defer(&router, method, AZ_SPAN_FROM_STR("{}"), AZ_SPAN_FROM_STR("43"),
+                                                &index));
+    TEST_CHECK(direct_method_next_ready(&router) == NULL);
+    direct_method_slot_ready(&router, index);
+    slot = direct_method_next_ready(&router);
+    TEST_CHECK(slot != NULL && slot->method == method);
+    direct_method_slot_free(slot);
+}
+
+static void test_busy_and_oversized_requests_are_refused(void)
+{
+    uint8_t payload[PAYLOAD_SIZE + 1];
+    const direct_method_t* method;
+    uint32_t index;
+    uint32_t i;
+
+    memset(payload, ' ', sizeof(payload));
+    direct_method_router_init(&router, &payloads[0][0], PAYLOAD_SIZE);
+    TEST_CHECK(direct_method_register(&router, AZ_SPAN_FROM_STR("sendMsg"), handler_a, 1000));
+    method = direct_method_find(&router, AZ_SPAN_FROM_STR("sendMsg"));
+
+    TEST_CHECK_EQUAL(AZ_ERROR_NOT_ENOUGH_SPACE,
+                     direct_method_defer(&router, method, az_span_create(payload, PAYLOAD_SIZE + 1),
+                                         AZ_SPAN_FROM_STR("1"), &index));
+    TEST_CHECK_EQUAL(AZ_ERROR_NOT_ENOUGH_SPACE,
+                     direct_method_defer(&router, method, AZ_SPAN_FROM_STR("{}"),
+                                         AZ_SPAN_FROM_STR("12345678901234567"), &index));
+
+    // Each slot takes a payload of the full size, without touching the others
+    for (i = 0; i < DIRECT_METHOD_SLOTS; i++)
+    {
+        memset(payload, 'a' + (int)i, sizeof(payload));
+        TEST_CHECK_EQUAL(AZ_OK, direct_method_defer(&router, method, az_span_create(payload, PAYLOAD_SIZE),
+                                                    AZ_SPAN_FROM_STR("1234567890123456"), &index));
+        TEST_CHECK_EQUAL(i, index);
+    }
+    for (i = 0; i < DIRECT_METHOD_SLOTS; i++)
+    {
+        TEST_CHECK_EQUAL('a' + i, router.slots[i].payload[0]);
+        TEST_CHECK_EQUAL('a' + i, router.slots[i].payload[PAYLOAD_SIZE - 1]);
+    }
+
+    TEST_CHECK_EQUAL(AZ_ERROR_OUT_OF_MEMORY, direct_method_defer(&router, method, AZ_SPAN_FROM_STR("{}"),
+                                                                 AZ_SPAN_FROM_STR("2"), &index));
+
+    // A free slot is taken again
+    direct_method_slot_ready(&router, 1);
+    direct_method_slot_free(direct_method_next_ready(&router));
+    TEST_CHECK_EQUAL(AZ_OK, direct_method_defer(&router, method, AZ_SPAN_FROM_STR("{}"), AZ_SPAN_FROM_STR("3"),
+                                                &index));
+    TEST_CHECK_EQUAL(1, index);
+}
+
+/* A run of registrations, lookups and deferred calls allocates nothing */
+static void test_nothing_is_allocated(void)
+{
+    void* volatile pointer;
+    uint32_t run;
+
+    allocations = 0;
+    direct_method_router_init(&router, &payloads[0][0], PAYLOAD_SIZE);
+    TEST_CHECK(direct_method_register(&router, AZ_SPAN_FROM_STR("reboot"), handler_a, DIRECT_METHOD_INLINE));
+    TEST_CHECK(direct_method_register(&router, AZ_SPAN_FROM_STR("sendMsg"), handler_b, 0));
+
+    for (run = 0; run < 1000; run++)
+    {
+        const direct_method_t* method = direct_method_find(&router, AZ_SPAN_FROM_STR("sendMsg"));
+        direct_method_slot_t* slot;
+        uint32_t index;
+
+        TEST_CHECK(direct_method_find(&router, AZ_SPAN_FROM_STR("unknown")) == NULL);
+        TEST_CHECK_EQUAL(AZ_OK, direct_method_defer(&router, method, AZ_SPAN_FROM_STR("{\"sendMsg\":\"hi\"}"),
+                                                    AZ_SPAN_FROM_STR("7"), &index));
+        slot = direct_method_next_ready(&router);
+        TEST_CHECK(slot != NULL);
+        direct_method_slot_free(slot);
+    }
+
+    TEST_CHECK_EQUAL(0, allocations);
+
+    // The wrapping itself works, so the count above means something
+    pointer = malloc(1);
+    free(pointer);
+    TEST_CHECK_EQUAL(1, allocations);
+}
+
+int main(void)
+{
+    TEST_RUN(test_names_route_to_their_handlers);
+    TEST_RUN(test_table_is_at_most_half_full);
+    TEST_RUN(test_colliding_names_are_probed);
+    TEST_RUN(test_deferred_call_keeps_a_copy_of_its_request);
+    TEST_RUN(test_busy_and_oversized_requests_are_refused);
+    TEST_RUN(test_nothing_is_allocated);
+
+    return TEST_REPORT("direct_method_router");
+}
@@ -0,0 +1,378 @@
+/**
+ * \file
+ * \brief Host round trip and fuzz tests for the binary DTI telemetry frames
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "dti_frame.h"
+#include "test_common.h"
+
+#define VALUES_MAX (20)
+
+static uint8_t frame[DTI_HEADER_NUMBYTES + DTI_PAYLOADDATA_NUMBYTES + DTI_CRC_NUMBYTES];
+
+static uint8_t index_type(uint8_t index)
+{
+    return index <= 4 ? DTI_VALUE_INT32 : index <= 6 ? DTI_VALUE_DOUBLE : index <= 8 ? DTI_VALUE_FLOAT :
+           index == 9 ? DTI_VALUE_INT64 : index == 10 ? DTI_VALUE_BOOL : DTI_VALUE_STRING;
+}
+
+static uint8_t* put_le(uint8_t* out, uint64_t bits, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        *out++ = (uint8_t)(bits >> (8 * i));
+    }
+
+    return out;
+}
+
+/* A random value of the given index. Doubles and floats are random bit
+ * patterns, so NaN payloads, denormals and signed zeros all come up. */
+static void random_value(uint8_t index, dti_value_t* value, uint8_t* text)
+{
+    uint64_t bits = ((uint64_t)test_random() << 32) | test_random();
+    uint32_t bits32 = test_random();
+    uint32_t i;
+
+    value->index = index;
+    value->type = index_type(index);
+
+    switch (value->type)
+    {
+        case DTI_VALUE_INT32:
+            value->as.i32 = (int32_t)bits32;
+            break;
+        case DTI_VALUE_DOUBLE:
+            memcpy(&value->as.f64, &bits, sizeof(bits));
+            break;
+        case DTI_VALUE_FLOAT:
+            memcpy(&value->as.f32, &bits32, sizeof(bits32));
+            break;
+        case DTI_VALUE_INT64:
+            value->as.i64 = (int64_t)bits;
+            break;
+        case DTI_VALUE_BOOL:
+            value->as.b = (bits32 & 1) != 0;
+            break;
+        default:
+            value->as.string.length = (uint16_t)test_random_range(0, 40);
+            for (i = 0; i < value->as.string.length; i++)
+            {
+                text[i] = (uint8_t)test_random();
+            }
+            value->as.string.ptr = text;
+            break;
+    }
+}
+
+static uint8_t* put_value(uint8_t* out, const dti_value_t* value)
+{
+    uint64_t bits;
+    uint32_t bits32;
+
+    switch (value->type)
+    {
+        case DTI_VALUE_INT32:
+            return put_le(out, (uint32_t)value->as.i32, 4);
+        case DTI_VALUE_DOUBLE:
+            memcpy(&bits, &value->as.f64, sizeof(bits));
+            return put_le(out, bits, 8);
+        case DTI_VALUE_FLOAT:
+            memcpy(&bits32, &value->as.f32, sizeof(bits32));
+            return put_le(out, bits32, 4);
+        case DTI_VALUE_INT64:
+            return put_le(out, (uint64_t)value->as.i64, 8);
+        case DTI_VALUE_BOOL:
+            *out++ = value->as.b ? 1 : 0;
+            return out;
+        default:
+            *out++ = (uint8_t)value->as.string.length;
+            memcpy(out, value->as.string.ptr, value->as.string.length);
+            return out + value->as.string.length;
+    }
+}
+
+/* Header, payload length and CRC around a payload already in frame */
+static uint32_t seal(uint8_t command, uint8_t parameter1, uint32_t payload_length)
+{
+    uint32_t length = DTI_HEADER_NUMBYTES + payload_length;
+    uint16_t crc;
+
+    frame[DTI_pIDX_CMDCHAR] = command;
+    frame[DTI_pIDX_PARAM1] = parameter1;
+    frame[DTI_pIDX_PAYLENMSB] = (uint8_t)(payload_length >> 8);
+    frame[DTI_pIDX_PAYLENLSB] = (uint8_t)payload_length;
+
+    crc = dti_crc16(0xFFFF, frame, length);
+    frame[length] = (uint8_t)crc;
+    frame[length + 1] = (uint8_t)(crc >> 8);
+
+    return length + DTI_CRC_NUMBYTES;
+}
+
+static uint32_t build_batch(const dti_value_t* values, uint32_t count)
+{
+    uint8_t* out = frame + DTI_HEADER_NUMBYTES;
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        *out++ = values[i].index;
+        out = put_value(out, &values[i]);
+    }
+
+    return seal(DTI_CMDCHAR_TELEMETRY_BATCH, (uint8_t)count, (uint32_t)(out - frame) - DTI_HEADER_NUMBYTES);
+}
+
+static uint32_t build_single(const dti_value_t* value)
+{
+    uint8_t* out = put_value(frame + DTI_HEADER_NUMBYTES, value);
+
+    return seal(DTI_CMDCHAR_TELEMETRY_BINARY, value->index, (uint32_t)(out - frame) - DTI_HEADER_NUMBYTES);
+}
+
+static bool same_value(const dti_value_t* expected, const dti_value_t* actual)
+{
+    if (expected->index != actual->index || expected->type != actual->type)
+    {
+        return false;
+    }
+
+    switch (expected->type)
+    {
+        case DTI_VALUE_INT32:
+            return expected->as.i32 == actual->as.i32;
+        case DTI_VALUE_DOUBLE:
+            // bit exact, NaN included
+            return memcmp(&expected->as.f64, &actual->as.f64, sizeof(double)) == 0;
+        case DTI_VALUE_FLOAT:
+            return memcmp(&expected->as.f32, &actual->as.f32, sizeof(float)) == 0;
+        case DTI_VALUE_INT64:
+            return expected->as.i64 == actual->as.i64;
+        case DTI_VALUE_BOOL:
+            return expected->as.b == actual->as.b;
+        default:
+            return expected->as.string.length == actual->as.string.length &&
+                   memcmp(expected->as.string.ptr, actual->as.string.ptr, expected->as.string.length) == 0;
+    }
+}
+
+static void test_crc_is_ccitt(void)
+{
+    // CRC-16/CCITT-FALSE check value
+    TEST_CHECK_EQUAL(0x29B1, dti_crc16(0xFFFF, (const uint8_t*)"123456789", 9));
+    TEST_CHECK_EQUAL(0x29B1, dti_crc16(dti_crc16(0xFFFF, (const uint8_t*)"1234", 4), (const uint8_t*)"56789", 5));
+    TEST_CHECK_EQUAL(0xFFFF, dti_crc16(0xFFFF, frame, 0));
+}
+
+static void test_frame_length_comes_from_the_header(void)
+{
+    uint8_t header[DTI_HEADER_NUMBYTES] = { DTI_CMDCHAR_TELEMETRY_BATCH, 3, 0x01, 0x02 };
+
+    TEST_CHECK_EQUAL(DTI_HEADER_NUMBYTES + 0x102 + DTI_CRC_NUMBYTES, dti_frame_length(header));
+
+    header[DTI_pIDX_PAYLENMSB] = DTI_PAYLOADDATA_NUMBYTES >> 8;
+    header[DTI_pIDX_PAYLENLSB] = DTI_PAYLOADDATA_NUMBYTES & 0xFF;
+    TEST_CHECK_EQUAL(DTI_HEADER_NUMBYTES + DTI_PAYLOADDATA_NUMBYTES + DTI_CRC_NUMBYTES, dti_frame_length(header));
+
+    header[DTI_pIDX_PAYLENLSB]++;
+    TEST_CHECK_EQUAL(0, dti_frame_length(header));
+
+    // The hex commands are not binary frames
+    header[DTI_pIDX_CMDCHAR] = DTI_CMDCHAR_TELEMETRY_1;
+    header[DTI_pIDX_PAYLENLSB] = 4;
+    TEST_CHECK_EQUAL(0, dti_frame_length(header));
+}
+
+static void test_random_frames_round_trip(void)
+{
+    uint8_t text[VALUES_MAX][40];
+    dti_value_t values[VALUES_MAX];
+    dti_value_t value;
+    dti_frame_reader_t reader;
+    uint32_t run;
+
+    for (run = 0; run < 20000; run++)
+    {
+        uint32_t count = test_random_range(1, VALUES_MAX);
+        uint32_t length;
+        uint32_t i;
+
+        for (i = 0; i < count; i++)
+        {
+            random_value((uint8_t)test_random_range(1, DTI_TELEMETRY_INDEX_MAX), &values[i], text[i]);
+        }
+
+        length = (run & 1) ? build_batch(values, count) : build_single(&values[0]);
+        if (!(run & 1))
+        {
+            count = 1;
+        }
+
+        TEST_CHECK_EQUAL(length, dti_frame_length(frame));
+        TEST_CHECK(dti_frame_open(&reader, frame, length));
+
+        for (i = 0; i < count; i++)
+        {
+            TEST_CHECK(dti_frame_next(&reader, &value));
+            TEST_CHECK(same_value(&values[i], &value));
+        }
+        TEST_CHECK(!dti_frame_next(&reader, &value));
+    }
+}
+
+static void test_every_single_bit_flip_is_rejected(void)
+{
+    uint8_t text[VALUES_MAX][40];
+    dti_value_t values[VALUES_MAX];
+    dti_frame_reader_t reader;
+    uint32_t run;
+
+    for (run = 0; run < 20; run++)
+    {
+        uint32_t count = test_random_range(1, VALUES_MAX);
+        uint32_t length;
+        uint32_t bit;
+        uint32_t i;
+
+        for (i = 0; i < count; i++)
+        {
+            random_value((uint8_t)test_random_range(1, DTI_TELEMETRY_INDEX_MAX), &values[i], text[i]);
+        }
+        length = build_batch(values, count);
+
+        for (bit = 0; bit < length * 8; bit++)
+        {
+            frame[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            TEST_CHECK(!dti_frame_open(&reader, frame, length));
+            frame[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        }
+
+        TEST_CHECK(dti_frame_open(&reader, frame, length));
+    }
+}
+
+static void test_bad_layouts_with_good_crcs_are_rejected(void)
+{
+    dti_frame_reader_t reader;
+    uint8_t* payload = frame + DTI_HEADER_NUMBYTES;
+
+    // A bool is 0 or 1
+    payload[0] = 2;
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 10, 1)));
+    payload[0] = 1;
+    TEST_CHECK(dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 10, 1)));
+
+    // Index 0 and indices past the table
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 0, 1)));
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, DTI_TELEMETRY_INDEX_MAX + 1, 1)));
+
+    // A single value frame holds exactly one value
+    memset(payload, 0, 8);
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 1, 3)));
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 1, 5)));
+    TEST_CHECK(dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 1, 4)));
+
+    // A string longer than what is left
+    payload[0] = 5;
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 11, 5)));
+    TEST_CHECK(dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BINARY, 11, 6)));
+
+    // A batch must hold exactly its count of values
+    payload[0] = 10;
+    payload[1] = 1;
+    TEST_CHECK(dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BATCH, 1, 2)));
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BATCH, 2, 2)));
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BATCH, 1, 3)));
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BATCH, 0, 2)));
+    TEST_CHECK(dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BATCH, 0, 0)));
+
+    // The length given must be the one of the header
+    TEST_CHECK(!dti_frame_open(&reader, frame, seal(DTI_CMDCHAR_TELEMETRY_BATCH, 1, 2) - 1));
+    TEST_CHECK(!dti_frame_open(&reader, frame, 3));
+}
+
+/* Random payloads and truncated lengths with valid CRCs. Whatever opens may
+ * only be read within the frame; ASan and UBSan catch the rest. */
+static void test_fuzzed_frames_stay_in_bounds(void)
+{
+    dti_frame_reader_t reader;
+    dti_value_t value;
+    uint32_t run;
+    uint32_t opened = 0;
+
+    for (run = 0; run < 200000; run++)
+    {
+        uint32_t payload_length = test_random_range(0, 64);
+        uint8_t command = (test_random() & 1) ? DTI_CMDCHAR_TELEMETRY_BATCH : DTI_CMDCHAR_TELEMETRY_BINARY;
+        uint32_t length;
+        uint32_t i;
+        uint32_t values = 0;
+
+        for (i = 0; i < payload_length; i++)
+        {
+            // Small bytes, so indices, bools and string lengths are often valid
+            frame[DTI_HEADER_NUMBYTES + i] = (uint8_t)((test_random() & 3) ? test_random_range(0, 15) : test_random());
+        }
+        length = seal(command, (uint8_t)test_random_range(0, 15), payload_length);
+
+        if (!dti_frame_open(&reader, frame, length))
+        {
+            continue;
+        }
+        opened++;
+
+        while (dti_frame_next(&reader, &value))
+        {
+            TEST_CHECK(value.index >= 1 && value.index <= DTI_TELEMETRY_INDEX_MAX);
+            if (value.type == DTI_VALUE_STRING)
+            {
+                TEST_CHECK(value.as.string.ptr >= frame + DTI_HEADER_NUMBYTES);
+                TEST_CHECK(value.as.string.ptr + value.as.string.length <= frame + length - DTI_CRC_NUMBYTES);
+            }
+            TEST_CHECK(++values <= payload_length);
+        }
+    }
+
+    // The fuzzing reached the value decoding, not only the layout checks
+    TEST_CHECK(opened > 1000);
+}
+
+int main(void)
+{
+    TEST_RUN(test_crc_is_ccitt);
+    TEST_RUN(test_frame_length_comes_from_the_header);
+    TEST_RUN(test_random_frames_round_trip);
+    TEST_RUN(test_every_single_bit_flip_is_rejected);
+    TEST_RUN(test_bad_layouts_with_good_crcs_are_rejected);
+    TEST_RUN(test_fuzzed_frames_stay_in_bounds);
+
+    return TEST_REPORT("dti_frame");
+}
@@ -0,0 +1,170 @@
+/**
+ * \file
+ * \brief Host tests for the Heart Rate 9 click routine reading the SERCOM0 ring
+ *        while the RX interrupt fills it
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "heartrate9.h"
+#include "sercom0_usart_double.h"
+#include "test_common.h"
+
+#define RECORDS     (400)
+
+static char stream[RECORDS * 32];
+static uint32_t stream_length;
+static uint32_t stream_offset;
+static uint8_t expected[RECORDS];
+
+static uint8_t readings[RECORDS];
+static uint32_t reading_count;
+
+static void make_stream(void)
+{
+    uint32_t i;
+
+    stream_length = 0;
+    stream_offset = 0;
+
+    for (i = 0; i < RECORDS; i++)
+    {
+        expected[i] = (uint8_t)test_random_range(40, 200);
+        stream_length += (uint32_t)snprintf(&stream[stream_length], sizeof(stream) - stream_length,
+                                            "15;%u;48213;50122;%u;97;\r\n", (unsigned)i, (unsigned)expected[i]);
+    }
+}
+
+/* The RX interrupt, delivering the next byte of the stream now and then */
+static void rx_interrupt(void)
+{
+    if (stream_offset < stream_length && (test_random() & 3) == 0)
+    {
+        sercom0_usart_double_receive((uint8_t)stream[stream_offset++]);
+    }
+}
+
+static void receive(uint32_t count)
+{
+    while (count-- > 0 && stream_offset < stream_length)
+    {
+        sercom0_usart_double_receive((uint8_t)stream[stream_offset++]);
+    }
+}
+
+/* One pass of the app loop, taking the readings out as the telemetry does */
+static void task(void)
+{
+    heartrate9_sample_t sample;
+
+    heartrate9_task();
+    while (heartrate9_sample_get(&sample))
+    {
+        if (reading_count < RECORDS)
+        {
+            readings[reading_count] = sample.bpm;
+        }
+        reading_count++;
+    }
+}
+
+static void start(void)
+{
+    sys_time_double_set(0, SYS_TIME_DOUBLE_FREQUENCY);
+    sercom0_usart_double_init();
+    heartrate9_initialize();
+    reading_count = 0;
+    make_stream();
+}
+
+/* Bytes come in while the task reads them out of the ring, at every point the
+ * interrupt can hit SERCOM0_USART_Read(), and the ring wraps many times over */
+static void test_readings_with_the_interrupt_interleaved(void)
+{
+    uint32_t dropped;
+
+    start();
+    dropped = heartrate9_bytes_dropped();
+    sercom0_usart_double_set_interrupt(rx_interrupt);
+
+    while (stream_offset < stream_length || SERCOM0_USART_ReadCountGet() > 0)
+    {
+        receive(test_random_range(0, 40));
+        task();
+    }
+
+    TEST_CHECK_EQUAL(0, heartrate9_bytes_dropped() - dropped);
+    TEST_CHECK_EQUAL(0, heartrate9_samples_dropped());
+    TEST_CHECK_EQUAL(RECORDS, reading_count);
+    TEST_CHECK(memcmp(expected, readings, RECORDS) == 0);
+}
+
+/* A task that falls behind: the bytes that find the ring full are counted,
+ * the readings that survive come out in order and the parse carries on */
+static void test_full_ring_drops_bytes_and_resynchronizes(void)
+{
+    uint32_t dropped;
+    uint32_t found;
+    uint32_t i;
+
+    start();
+    dropped = heartrate9_bytes_dropped();
+
+    receive(SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE + 200);
+    TEST_CHECK_EQUAL(201, heartrate9_bytes_dropped() - dropped);
+    task();
+
+    // What was parsed is the stream with a gap in it
+    for (i = 0, found = 0; i < RECORDS && found < reading_count; i++)
+    {
+        if (expected[i] == readings[found])
+        {
+            found++;
+        }
+    }
+    TEST_CHECK_EQUAL(reading_count, found);
+    TEST_CHECK(reading_count < (SERCOM0_USART_DOUBLE_READ_BUFFER_SIZE + 200) / 24);
+
+    // Keeping up again, every record after the gap is read
+    found = reading_count;
+    sercom0_usart_double_set_interrupt(rx_interrupt);
+    while (stream_offset < stream_length || SERCOM0_USART_ReadCountGet() > 0)
+    {
+        receive(test_random_range(0, 40));
+        task();
+    }
+
+    TEST_CHECK_EQUAL(201, heartrate9_bytes_dropped() - dropped);
+    TEST_CHECK(reading_count > RECORDS - 30);
+    TEST_CHECK(memcmp(&expected[RECORDS - 10], &readings[reading_count - 10], 10) == 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_readings_with_the_interrupt_interleaved);
+    TEST_RUN(test_full_ring_drops_bytes_and_resynchronizes);
+
+    return TEST_REPORT("heartrate9");
+}
@@ -0,0 +1,201 @@
+/**
+ * \file
+ * \brief Host tests for the Heart Rate 9 click stream parser on a UART trace
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "heartrate9_parser.h"
+#include "test_common.h"
+
+/* A UART trace in the record layout of heartrate9_parser.h: the click banner,
+ * readings of 0 before a finger is on, and the damage seen on the line. */
+static const char trace[] =
+    "HR9 click FW 1.2\r\n"
+    "Ready\r\n"
+    "15;0;48213;50122;0;0;\r\n"
+    "15;1;48190;50101;0;0;\r\n"
+    "15;2;48377;50233;71;97;\r\n"
+    "15;3;48402;50260;72;97;\r\n"
+    "15;4;48391;50247;72;98;\r\n"
+    "15;5;484\r\n"                                  // cut short by a reset of the click
+    "15;6;48420;50281;73;98;\r\n"
+    "15;7;48415;50270;---;98;\r\n"                  // no value yet
+    "15;8;48433;50296;74;98;\r\n"
+    "115;9;48440;50301;74;98;\r\n"                  // a stray '1' before the header
+    "15;10;48452;50312;;98;\r\n"                    // empty heart rate field
+    "15;11;48460;50320;300;98;\r\n"                 // out of range
+    "15;12;48471;50334;75;99;\r\n"
+    "15;13;48480;50341;76;99;15;14;48488;50350;76;99;\r\n"   // a line break lost
+    "15;15;48495;50362;255;99;\n"                   // bare line feed
+    "15;16;48502;50371;77;99;\r\n";
+
+static const uint8_t expected[] = { 0, 0, 71, 72, 72, 73, 74, 74, 75, 76, 76, 255, 77 };
+
+#define TRACE_LENGTH (sizeof(trace) - 1)
+#define READINGS     (sizeof(expected) / sizeof(expected[0]))
+
+static heartrate9_parser_t parser;
+
+/* Feeds the trace in pieces of piece_min to piece_max bytes and checks every
+ * reading comes out, in order, wherever the pieces are cut */
+static uint32_t feed_trace(uint32_t piece_min, uint32_t piece_max, uint8_t *readings)
+{
+    const uint8_t *stream = (const uint8_t *)trace;
+    uint32_t offset = 0;
+    uint32_t count = 0;
+
+    heartrate9_parser_init(&parser);
+
+    while (offset < TRACE_LENGTH)
+    {
+        uint32_t piece = test_random_range(piece_min, piece_max);
+        const uint8_t *next = stream + offset;
+        const uint8_t *end;
+        uint8_t bpm;
+
+        if (piece > TRACE_LENGTH - offset)
+        {
+            piece = TRACE_LENGTH - offset;
+        }
+        end = next + piece;
+
+        while (heartrate9_parser_feed(&parser, &next, end, &bpm))
+        {
+            if (count < READINGS + 1)
+            {
+                readings[count] = bpm;
+            }
+            count++;
+        }
+
+        if (next != end)
+        {
+            return UINT32_MAX;
+        }
+        offset += piece;
+    }
+
+    return count;
+}
+
+static void test_whole_trace(void)
+{
+    uint8_t readings[READINGS + 1];
+
+    TEST_CHECK_EQUAL(READINGS, feed_trace(TRACE_LENGTH, TRACE_LENGTH, readings));
+    TEST_CHECK(memcmp(expected, readings, READINGS) == 0);
+}
+
+static void test_trace_a_byte_at_a_time(void)
+{
+    uint8_t readings[READINGS + 1];
+
+    TEST_CHECK_EQUAL(READINGS, feed_trace(1, 1, readings));
+    TEST_CHECK(memcmp(expected, readings, READINGS) == 0);
+}
+
+static void test_trace_in_random_pieces(void)
+{
+    uint8_t readings[READINGS + 1];
+    uint32_t run;
+
+    for (run = 0; run < 5000; run++)
+    {
+        memset(readings, 0xEE, sizeof(readings));
+        TEST_CHECK_EQUAL(READINGS, feed_trace(1, 40, readings));
+        TEST_CHECK(memcmp(expected, readings, READINGS) == 0);
+    }
+}
+
+/* A reading stops the parse right after its ';', the bytes after it are
+ * left for the next call */
+static void test_parse_stops_after_each_reading(void)
+{
+    static const char two[] = "15;1;2;3;60;15;1;2;3;61;";
+    const uint8_t *next = (const uint8_t *)two;
+    const uint8_t *end = next + sizeof(two) - 1;
+    uint8_t bpm = 0;
+
+    heartrate9_parser_init(&parser);
+
+    TEST_CHECK(heartrate9_parser_feed(&parser, &next, end, &bpm));
+    TEST_CHECK_EQUAL(60, bpm);
+    TEST_CHECK_EQUAL(12, next - (const uint8_t *)two);
+
+    TEST_CHECK(heartrate9_parser_feed(&parser, &next, end, &bpm));
+    TEST_CHECK_EQUAL(61, bpm);
+    TEST_CHECK(next == end);
+
+    TEST_CHECK(!heartrate9_parser_feed(&parser, &next, end, &bpm));
+    TEST_CHECK(next == end);
+}
+
+/* Random bytes never make the parser read outside what it is given, and a
+ * clean record after them is still found */
+static void test_resynchronizes_after_noise(void)
+{
+    uint8_t noise[256];
+    uint32_t run;
+
+    for (run = 0; run < 2000; run++)
+    {
+        static const char record[] = "\r\n15;7;8;9;88;";
+        const uint8_t *next = noise;
+        uint8_t bpm;
+        uint32_t i;
+        bool found = false;
+
+        for (i = 0; i < sizeof(noise); i++)
+        {
+            noise[i] = (test_random() & 1) ? (uint8_t)test_random() : (uint8_t)"15;0123456789\r\n"[test_random() % 15];
+        }
+
+        heartrate9_parser_init(&parser);
+        while (heartrate9_parser_feed(&parser, &next, noise + sizeof(noise), &bpm))
+        {
+        }
+        TEST_CHECK(next == noise + sizeof(noise));
+
+        next = (const uint8_t *)record;
+        while (heartrate9_parser_feed(&parser, &next, (const uint8_t *)record + sizeof(record) - 1, &bpm))
+        {
+            found = bpm == 88;
+        }
+        TEST_CHECK(found);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_whole_trace);
+    TEST_RUN(test_trace_a_byte_at_a_time);
+    TEST_RUN(test_trace_in_random_pieces);
+    TEST_RUN(test_parse_stops_after_each_reading);
+    TEST_RUN(test_resynchronizes_after_noise);
+
+    return TEST_REPORT("heartrate9_parser");
+}
@@ -0,0 +1,179 @@
+/**
+ * \file
+ * \brief Host tests for the Heart Rate 9 reading statistics on reading traces
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "heartrate9_stats.h"
+#include "test_common.h"
+
+typedef struct
+{
+    const char *name;
+    const uint8_t *readings;
+    uint32_t count;
+    heartrate9_aggregate_t expected;   // samples, rejected, mean, min, max, confidence
+} trace_t;
+
+/* Readings as the parser gives them, one telemetry interval each */
+static const uint8_t rest[] = { 72, 73, 72, 71, 72, 74, 73, 72, 71, 72, 73, 72 };
+static const uint8_t motion[] = { 75, 76, 75, 140, 76, 0, 0, 77, 38, 76, 75, 77 };   // spikes and a dropout
+static const uint8_t no_finger[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t step[] = { 70, 70, 70, 70, 70, 70, 110, 110, 110, 110, 110, 110, 110, 110 };
+static const uint8_t short_interval[] = { 72, 73, 74 };
+
+#define TRACE(readings, samples, rejected, mean, min, max, confidence) \
+    { #readings, readings, sizeof(readings), { samples, rejected, mean, min, max, confidence } }
+
+static const trace_t traces[] = {
+    TRACE(rest,           12, 0, 72, 72,  73,  100),
+    // 140 and 38 are too far from the median, 0 is out of range
+    TRACE(motion,          8, 4, 76, 75,  76,  52),
+    TRACE(no_finger,       0, 8, 0,  0,   0,   0),
+    // The median takes the new rate once it holds half the window
+    TRACE(step,           11, 3, 88, 70,  110, 78),
+    // Too few readings to be fully trusted
+    TRACE(short_interval,  3, 0, 73, 72,  73,  30),
+};
+
+static void test_traces(void)
+{
+    heartrate9_stats_t stats;
+    heartrate9_aggregate_t aggregate;
+    uint32_t trace;
+    uint32_t i;
+
+    for (trace = 0; trace < sizeof(traces) / sizeof(traces[0]); trace++)
+    {
+        const trace_t *t = &traces[trace];
+
+        heartrate9_stats_init(&stats);
+        for (i = 0; i < t->count; i++)
+        {
+            heartrate9_stats_add(&stats, t->readings[i]);
+        }
+        heartrate9_stats_take(&stats, &aggregate);
+
+        printf("%s: ", t->name);
+        TEST_CHECK_EQUAL(t->expected.samples, aggregate.samples);
+        TEST_CHECK_EQUAL(t->expected.rejected, aggregate.rejected);
+        TEST_CHECK_EQUAL(t->expected.mean, aggregate.mean);
+        TEST_CHECK_EQUAL(t->expected.min, aggregate.min);
+        TEST_CHECK_EQUAL(t->expected.max, aggregate.max);
+        TEST_CHECK_EQUAL(t->expected.confidence, aggregate.confidence);
+        printf("ok\n");
+    }
+}
+
+/* The median window carries over from one interval to the next, the counts
+ * do not */
+static void test_window_carries_over_intervals(void)
+{
+    heartrate9_stats_t stats;
+    heartrate9_aggregate_t aggregate;
+    uint32_t i;
+
+    heartrate9_stats_init(&stats);
+    for (i = 0; i < 6; i++)
+    {
+        TEST_CHECK(heartrate9_stats_add(&stats, 70));
+    }
+    heartrate9_stats_take(&stats, &aggregate);
+    TEST_CHECK_EQUAL(6, aggregate.samples);
+    TEST_CHECK_EQUAL(60, aggregate.confidence);
+
+    // The first readings of a new rate are still judged by the old median
+    TEST_CHECK(!heartrate9_stats_add(&stats, 110));
+    TEST_CHECK(!heartrate9_stats_add(&stats, 110));
+    TEST_CHECK(!heartrate9_stats_add(&stats, 110));
+    for (i = 0; i < 5; i++)
+    {
+        TEST_CHECK(heartrate9_stats_add(&stats, 110));
+    }
+    heartrate9_stats_take(&stats, &aggregate);
+    TEST_CHECK_EQUAL(5, aggregate.samples);
+    TEST_CHECK_EQUAL(3, aggregate.rejected);
+    TEST_CHECK_EQUAL(110, aggregate.mean);
+    TEST_CHECK_EQUAL(110, aggregate.min);
+    TEST_CHECK_EQUAL(31, aggregate.confidence);
+
+    // An interval without readings
+    heartrate9_stats_take(&stats, &aggregate);
+    TEST_CHECK_EQUAL(0, aggregate.samples);
+    TEST_CHECK_EQUAL(0, aggregate.rejected);
+    TEST_CHECK_EQUAL(0, aggregate.confidence);
+}
+
+static int compare_bpm(const void *a, const void *b)
+{
+    return (int)*(const uint8_t *)a - (int)*(const uint8_t *)b;
+}
+
+/* The sorted copy kept by insertion matches a sort of the window after every
+ * reading, and the aggregate stays within the medians it summed */
+static void test_random_readings_against_a_sorted_window(void)
+{
+    heartrate9_stats_t stats;
+    heartrate9_aggregate_t aggregate;
+    uint8_t reference[HEARTRATE9_MEDIAN_WINDOW];
+    uint32_t run;
+
+    heartrate9_stats_init(&stats);
+
+    for (run = 0; run < 200000; run++)
+    {
+        uint8_t bpm = (test_random() & 7) ? (uint8_t)test_random_range(60, 90) : (uint8_t)test_random();
+
+        heartrate9_stats_add(&stats, bpm);
+
+        memcpy(reference, stats.window, stats.window_count);
+        qsort(reference, stats.window_count, 1, compare_bpm);
+        TEST_CHECK(memcmp(reference, stats.sorted, stats.window_count) == 0);
+
+        if (run % 37 == 36)
+        {
+            heartrate9_stats_take(&stats, &aggregate);
+            TEST_CHECK_EQUAL(37, aggregate.samples + aggregate.rejected);
+            if (aggregate.samples != 0)
+            {
+                TEST_CHECK(aggregate.min <= aggregate.mean && aggregate.mean <= aggregate.max);
+                TEST_CHECK(aggregate.min >= HEARTRATE9_BPM_MIN && aggregate.max <= HEARTRATE9_BPM_MAX);
+                TEST_CHECK(aggregate.confidence <= 100);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_traces);
+    TEST_RUN(test_window_carries_over_intervals);
+    TEST_RUN(test_random_readings_against_a_sorted_window);
+
+    return TEST_REPORT("heartrate9_stats");
+}
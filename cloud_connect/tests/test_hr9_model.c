@@ -0,0 +1,183 @@
+/**
+ * \file
+ * \brief Host tests for the generated telemetry codec against az_json_reader
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hr9_model.h"
+#include "test_common.h"
+
+static const char* const names[] = {
+    "heartRate", "heartRateMin", "heartRateMax", "heartRateSamples", "heartRateConfidence"
+};
+
+static const int32_t maximum[] = { 300, 300, 300, 65535, 100 };
+
+static int32_t* field(hr9_telemetry_t* telemetry, int index)
+{
+    int32_t* fields[] = {
+        &telemetry->heart_rate, &telemetry->heart_rate_min, &telemetry->heart_rate_max,
+        &telemetry->heart_rate_samples, &telemetry->heart_rate_confidence
+    };
+
+    return fields[index];
+}
+
+static az_result decode(az_span payload, hr9_telemetry_t* telemetry, uint32_t* mask)
+{
+    az_json_reader jr;
+    az_result result = az_json_reader_init(&jr, payload, NULL);
+
+    return az_result_failed(result) ? result : hr9_telemetry_decode(&jr, telemetry, mask);
+}
+
+static void test_every_field_round_trips(void)
+{
+    uint8_t buffer[HR9_TELEMETRY_MAX_SIZE];
+    hr9_telemetry_t sent = { 72, 0, 300, 65535, 100 };
+    hr9_telemetry_t received;
+    uint32_t mask = 0;
+    az_span payload;
+
+    TEST_CHECK_EQUAL(HR9_TELEMETRY_MAX_SIZE, hr9_telemetry_max_size(HR9_TELEMETRY_ALL));
+    TEST_CHECK_EQUAL(AZ_OK, hr9_telemetry_encode(&sent, HR9_TELEMETRY_ALL, AZ_SPAN_FROM_BUFFER(buffer), &payload));
+    TEST_CHECK(az_span_is_content_equal(payload, AZ_SPAN_FROM_STR(
+        "{\"heartRate\":72,\"heartRateMin\":0,\"heartRateMax\":300,"
+        "\"heartRateSamples\":65535,\"heartRateConfidence\":100}")));
+
+    memset(&received, 0xA5, sizeof(received));
+    TEST_CHECK_EQUAL(AZ_OK, decode(payload, &received, &mask));
+    TEST_CHECK_EQUAL(HR9_TELEMETRY_ALL, mask);
+    TEST_CHECK(memcmp(&sent, &received, sizeof(sent)) == 0);
+}
+
+/* Random values and masks: whatever the encoder writes az_json_reader reads
+ * back, field by field, and the decoder gives the same values and mask. */
+static void test_random_documents_round_trip(void)
+{
+    int run;
+
+    for (run = 0; run < 2000; run++)
+    {
+        uint8_t buffer[HR9_TELEMETRY_MAX_SIZE];
+        hr9_telemetry_t sent;
+        hr9_telemetry_t received;
+        uint32_t mask = test_random() & HR9_TELEMETRY_ALL;
+        uint32_t decoded = 0;
+        az_json_reader jr;
+        az_span payload;
+        int index;
+
+        for (index = 0; index < 5; index++)
+        {
+            *field(&sent, index) = (int32_t)test_random_range(0, (uint32_t)maximum[index]);
+        }
+
+        TEST_CHECK_EQUAL(AZ_OK, hr9_telemetry_encode(&sent, mask, AZ_SPAN_FROM_BUFFER(buffer), &payload));
+        TEST_CHECK(az_span_size(payload) <= hr9_telemetry_max_size(mask));
+
+        TEST_CHECK_EQUAL(AZ_OK, az_json_reader_init(&jr, payload, NULL));
+        TEST_CHECK_EQUAL(AZ_OK, az_json_reader_next_token(&jr));
+        TEST_CHECK_EQUAL(AZ_JSON_TOKEN_BEGIN_OBJECT, jr.token.kind);
+        for (index = 0; index < 5; index++)
+        {
+            int32_t value;
+
+            if ((mask & (1u << index)) == 0)
+            {
+                continue;
+            }
+            TEST_CHECK_EQUAL(AZ_OK, az_json_reader_next_token(&jr));
+            TEST_CHECK(az_json_token_is_text_equal(&jr.token, az_span_create_from_str((char*)names[index])));
+            TEST_CHECK_EQUAL(AZ_OK, az_json_reader_next_token(&jr));
+            TEST_CHECK_EQUAL(AZ_OK, az_json_token_get_int32(&jr.token, &value));
+            TEST_CHECK_EQUAL(*field(&sent, index), value);
+        }
+        TEST_CHECK_EQUAL(AZ_OK, az_json_reader_next_token(&jr));
+        TEST_CHECK_EQUAL(AZ_JSON_TOKEN_END_OBJECT, jr.token.kind);
+
+        memset(&received, 0, sizeof(received));
+        TEST_CHECK_EQUAL(AZ_OK, decode(payload, &received, &decoded));
+        TEST_CHECK_EQUAL(mask, decoded);
+        for (index = 0; index < 5; index++)
+        {
+            if (mask & (1u << index))
+            {
+                TEST_CHECK_EQUAL(*field(&sent, index), *field(&received, index));
+            }
+        }
+    }
+}
+
+static void test_unknown_names_are_skipped(void)
+{
+    hr9_telemetry_t received;
+    uint32_t mask = 0;
+
+    TEST_CHECK_EQUAL(AZ_OK, decode(AZ_SPAN_FROM_STR(
+        "{ \"temperature\": { \"value\": [1, 2] }, \"heartRate\": 61, \"$version\": 4 }"), &received, &mask));
+    TEST_CHECK_EQUAL(HR9_TELEMETRY_HEART_RATE, mask);
+    TEST_CHECK_EQUAL(61, received.heart_rate);
+}
+
+static void test_values_outside_the_model_are_refused(void)
+{
+    hr9_telemetry_t received;
+    uint32_t mask = 0;
+
+    TEST_CHECK_EQUAL(AZ_ERROR_ARG, decode(AZ_SPAN_FROM_STR("{\"heartRate\":301}"), &received, &mask));
+    TEST_CHECK_EQUAL(AZ_ERROR_ARG, decode(AZ_SPAN_FROM_STR("{\"heartRateConfidence\":-1}"), &received, &mask));
+    TEST_CHECK(az_result_failed(decode(AZ_SPAN_FROM_STR("{\"heartRate\":\"72\"}"), &received, &mask)));
+    TEST_CHECK(az_result_failed(decode(AZ_SPAN_FROM_STR("[72]"), &received, &mask)));
+}
+
+static void test_small_destination_is_refused(void)
+{
+    uint8_t buffer[HR9_TELEMETRY_MAX_SIZE];
+    hr9_telemetry_t sent = { 1, 1, 1, 1, 1 };
+    az_span payload;
+    uint32_t mask = HR9_TELEMETRY_HEART_RATE | HR9_TELEMETRY_HEART_RATE_SAMPLES;
+    int32_t size = hr9_telemetry_max_size(mask);
+
+    // The check is against the worst case, not the document actually written
+    TEST_CHECK_EQUAL(AZ_ERROR_NOT_ENOUGH_SPACE,
+                     hr9_telemetry_encode(&sent, mask, az_span_create(buffer, size - 1), &payload));
+    TEST_CHECK_EQUAL(AZ_OK, hr9_telemetry_encode(&sent, mask, az_span_create(buffer, size), &payload));
+    TEST_CHECK(az_span_is_content_equal(payload, AZ_SPAN_FROM_STR("{\"heartRate\":1,\"heartRateSamples\":1}")));
+}
+
+int main(void)
+{
+    TEST_RUN(test_every_field_round_trips);
+    TEST_RUN(test_random_documents_round_trip);
+    TEST_RUN(test_unknown_names_are_skipped);
+    TEST_RUN(test_values_outside_the_model_are_refused);
+    TEST_RUN(test_small_destination_is_refused);
+
+    return TEST_REPORT("hr9_model");
+}
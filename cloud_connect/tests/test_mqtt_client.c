@@ -0,0 +1,959 @@
+/**
+ * \file
+ * \brief Host tests for the Paho client receiving packets in fragments
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "MQTTClient.h"
+#include "parson.h"
+#include "mqtt_network_double.h"
+#include "definitions.h"
+#include "test_common.h"
+
+#define COMMAND_TIMEOUT_MS  4000
+#define TX_BUFFER_SIZE      512
+#define RX_BUFFER_SIZE      128     // small, so publishes bigger than it are easy to make
+#define INFLIGHT_SLOT_SIZE  640     // as in cloud_wifi_task.c
+
+static MQTTClient client;
+static Network network;
+static unsigned char tx_buffer[TX_BUFFER_SIZE];
+static unsigned char rx_buffer[RX_BUFFER_SIZE];
+static unsigned char inflight_buffer[MAX_INFLIGHT_PUBLISHES * INFLIGHT_SLOT_SIZE];
+
+// What the handlers were given
+static unsigned char received[8 * 1024];
+static size_t received_length;
+static int messages;
+static int chunks;
+static size_t chunk_total;
+static bool chunk_out_of_order;
+static char last_topic[64];
+
+// Bytes memcpy() wrote into the send and in-flight buffers, see __wrap_memcpy()
+static size_t copied_to_tx;
+static size_t copied_to_inflight;
+
+// What the publish complete handler was given
+static unsigned short completed_id;
+static int completed_rc;
+static int completions;
+
+static void queue_packet(const unsigned char *packet, int length)
+{
+    TEST_CHECK(length > 0);
+    mqtt_network_double_queue(packet, length);
+}
+
+static void queue_publish(const char *topic, const unsigned char *payload, int length)
+{
+    unsigned char packet[2048 + 64];
+    MQTTString topic_string = MQTTString_initializer;
+
+    topic_string.cstring = (char *)topic;
+    queue_packet(packet, MQTTSerialize_publish(packet, sizeof(packet), 0, 0, 0, 0, topic_string,
+                                               (unsigned char *)payload, length));
+}
+
+static void keep_topic(MessageData *data)
+{
+    int length = data->topicName->lenstring.len;
+
+    if (length >= (int)sizeof(last_topic))
+    {
+        length = sizeof(last_topic) - 1;
+    }
+    memcpy(last_topic, data->topicName->lenstring.data, length);
+    last_topic[length] = '\0';
+}
+
+static void message_handler(MessageData *data)
+{
+    keep_topic(data);
+    memcpy(&received[received_length], data->message->payload, data->message->payloadlen);
+    received_length += data->message->payloadlen;
+    messages++;
+}
+
+static void chunk_handler(MessageData *data, size_t offset, size_t totallen)
+{
+    keep_topic(data);
+    if (offset != received_length)
+    {
+        chunk_out_of_order = true;
+    }
+    memcpy(&received[offset], data->message->payload, data->message->payloadlen);
+    received_length = offset + data->message->payloadlen;
+    chunk_total = totallen;
+    chunks++;
+}
+
+static void publish_complete(unsigned short packetid, int rc)
+{
+    completed_id = packetid;
+    completed_rc = rc;
+    completions++;
+}
+
+static void reset_received(void)
+{
+    received_length = 0;
+    messages = 0;
+    chunks = 0;
+    chunk_total = 0;
+    chunk_out_of_order = false;
+    last_topic[0] = '\0';
+}
+
+/* Polls until nothing is left to arrive and the client has taken it all */
+static void poll_all(void)
+{
+    int i;
+
+    for (i = 0; i < 4096; i++)
+    {
+        mqtt_network_double_arrive(1);
+        MQTTPoll(&client);
+    }
+}
+
+static bool connect_client(void)
+{
+    unsigned char packet[8];
+    MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
+    int i;
+
+    sys_time_double_set(0, SYS_TIME_DOUBLE_FREQUENCY);
+    mqtt_network_double_init(&network);
+    MQTTClientInit(&client, &network, COMMAND_TIMEOUT_MS, tx_buffer, sizeof(tx_buffer),
+                   rx_buffer, sizeof(rx_buffer));
+    MQTTSetInflightBuffer(&client, inflight_buffer, sizeof(inflight_buffer));
+    MQTTSetPublishCompleteHandler(&client, publish_complete);
+    reset_received();
+    completions = 0;
+
+    if (MQTTConnectAsync(&client, &options) != SUCCESS)
+    {
+        return false;
+    }
+
+    mqtt_network_double_queue(packet, MQTTSerialize_connack(packet, sizeof(packet), 0, 0));
+    for (i = 0; i < 8 && MQTTPendingResult(&client) == PENDING; i++)
+    {
+        mqtt_network_double_arrive(1);
+        MQTTPoll(&client);
+    }
+
+    mqtt_network_double_clear_sent();
+    return MQTTPendingResult(&client) == SUCCESS && client.isconnected;
+}
+
+static bool subscribe(const char *filter, messageHandler handler, messageChunkHandler chunk, int granted)
+{
+    unsigned char packet[8];
+    int rc = (chunk != NULL) ? MQTTSubscribeChunkedAsync(&client, filter, QOS0, chunk) :
+                               MQTTSubscribeAsync(&client, filter, QOS0, handler);
+
+    if (rc != SUCCESS)
+    {
+        return false;
+    }
+
+    mqtt_network_double_queue(packet, MQTTSerialize_suback(packet, sizeof(packet), client.next_packetid, 1, &granted));
+    while (MQTTPendingResult(&client) == PENDING && mqtt_network_double_queued() > 0)
+    {
+        mqtt_network_double_arrive(1);
+        MQTTPoll(&client);
+    }
+
+    return MQTTPendingResult(&client) == SUCCESS;
+}
+
+static void make_payload(unsigned char *payload, int length, uint32_t seed)
+{
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        payload[i] = (unsigned char)('a' + (seed + i * 7) % 26);
+    }
+}
+
+static void test_publish_arriving_a_byte_at_a_time(void)
+{
+    unsigned char payload[] = "{\"led\":\"blink\"}";
+    int length = (int)sizeof(payload) - 1;
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("devices/sn1/messages/devicebound/#", message_handler, NULL, 0));
+
+    queue_publish("devices/sn1/messages/devicebound/x", payload, length);
+
+    // Nothing is handed out until the last byte is in
+    while (mqtt_network_double_queued() > 1)
+    {
+        mqtt_network_double_arrive(1);
+        TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+        TEST_CHECK_EQUAL(0, messages);
+    }
+
+    mqtt_network_double_arrive(1);
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+    TEST_CHECK_EQUAL(1, messages);
+    TEST_CHECK_EQUAL(length, received_length);
+    TEST_CHECK(memcmp(received, payload, length) == 0);
+    TEST_CHECK(strcmp(last_topic, "devices/sn1/messages/devicebound/x") == 0);
+}
+
+static void test_back_to_back_packets_in_one_read(void)
+{
+    unsigned char first[] = "first";
+    unsigned char second[] = "second";
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("hr9/#", message_handler, NULL, 0));
+
+    queue_publish("hr9/a", first, 5);
+    queue_publish("hr9/b", second, 6);
+    mqtt_network_double_arrive(mqtt_network_double_queued());
+
+    // One packet per poll, the second one is not lost behind the first
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+    TEST_CHECK_EQUAL(1, messages);
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+    TEST_CHECK_EQUAL(2, messages);
+    TEST_CHECK(memcmp(received, "firstsecond", 11) == 0);
+}
+
+static void test_random_fragments_keep_the_stream_in_step(void)
+{
+    unsigned char payload[RX_BUFFER_SIZE];
+    unsigned char expected[48 * RX_BUFFER_SIZE];
+    size_t expected_length = 0;
+    int message;
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("hr9/+", message_handler, NULL, 0));
+
+    for (message = 0; message < 48; message++)
+    {
+        int length = (int)test_random_range(0, RX_BUFFER_SIZE - 16);
+
+        make_payload(payload, length, message);
+        memcpy(&expected[expected_length], payload, length);
+        expected_length += length;
+        queue_publish("hr9/t", payload, length);
+    }
+
+    while (mqtt_network_double_queued() > 0)
+    {
+        mqtt_network_double_arrive((int)test_random_range(1, 40));
+        TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+    }
+    // anything already in but not handled yet
+    while (messages < 48)
+    {
+        int before = messages;
+        TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+        TEST_CHECK(messages > before);
+    }
+
+    TEST_CHECK_EQUAL(expected_length, received_length);
+    TEST_CHECK(memcmp(received, expected, expected_length) == 0);
+}
+
+static void test_publish_bigger_than_readbuf_goes_to_the_chunk_handler(void)
+{
+    unsigned char payload[600];
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("$iothub/twin/res/#", NULL, chunk_handler, 0));
+    TEST_CHECK(subscribe("hr9/#", message_handler, NULL, 0));
+
+    make_payload(payload, sizeof(payload), 3);
+    queue_publish("$iothub/twin/res/200/?$rid=7", payload, sizeof(payload));
+    poll_all();
+
+    TEST_CHECK(chunks > 1);
+    TEST_CHECK(!chunk_out_of_order);
+    TEST_CHECK_EQUAL(sizeof(payload), chunk_total);
+    TEST_CHECK_EQUAL(sizeof(payload), received_length);
+    TEST_CHECK(memcmp(received, payload, sizeof(payload)) == 0);
+    TEST_CHECK(strcmp(last_topic, "$iothub/twin/res/200/?$rid=7") == 0);
+    TEST_CHECK_EQUAL(0, messages);
+
+    // The stream is still in step after it
+    reset_received();
+    queue_publish("hr9/a", payload, 10);
+    poll_all();
+    TEST_CHECK_EQUAL(1, messages);
+    TEST_CHECK(memcmp(received, payload, 10) == 0);
+}
+
+/* What a poll took from the network, through the double */
+static int (*double_read_available)(Network *, unsigned char *, int);
+static int poll_blocking_reads;
+static int poll_read_bytes;
+static bool poll_out_of_bounds;
+
+static int counting_read(Network *n, unsigned char *buffer, int length, int timeout_ms)
+{
+    poll_blocking_reads++;
+    return 0;
+}
+
+static int counting_read_available(Network *n, unsigned char *buffer, int length)
+{
+    int read = double_read_available(n, buffer, length);
+
+    if (read > 0)
+    {
+        poll_read_bytes += read;
+    }
+    return read;
+}
+
+/* One poll, which should take no more than readbuf holds and never wait for the network */
+static int bounded_poll(void)
+{
+    uint64_t start = SYS_TIME_Counter64Get();
+
+    poll_read_bytes = 0;
+    if (MQTTPoll(&client) != SUCCESS || poll_read_bytes > RX_BUFFER_SIZE || SYS_TIME_Counter64Get() != start)
+    {
+        poll_out_of_bounds = true;
+    }
+    return poll_read_bytes;
+}
+
+static void test_chunked_publish_is_read_a_readbuf_per_poll(void)
+{
+    unsigned char payload[2000];
+    int polls = 0;
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("$iothub/twin/res/#", NULL, chunk_handler, 0));
+    TEST_CHECK(subscribe("hr9/#", message_handler, NULL, 0));
+
+    double_read_available = network.mqttreadavailable;
+    network.mqttread = counting_read;
+    network.mqttreadavailable = counting_read_available;
+    poll_blocking_reads = 0;
+    poll_out_of_bounds = false;
+
+    make_payload(payload, sizeof(payload), 5);
+    queue_publish("$iothub/twin/res/200/?$rid=9", payload, sizeof(payload));
+
+    // Part of it is in, the polls hand that out and then come back empty handed
+    mqtt_network_double_arrive(700);
+    while (bounded_poll() > 0)
+    {
+        polls++;
+    }
+    TEST_CHECK(polls >= 700 / RX_BUFFER_SIZE);
+    TEST_CHECK(received_length > 0 && received_length < sizeof(payload));
+    TEST_CHECK(chunks > 0);
+
+    // The rest resumes the payload where the last poll left it
+    mqtt_network_double_arrive((int)sizeof(payload));
+    while (bounded_poll() > 0)
+    {
+        polls++;
+    }
+    TEST_CHECK(polls >= (int)sizeof(payload) / RX_BUFFER_SIZE);
+    TEST_CHECK_EQUAL(0, poll_blocking_reads);
+    TEST_CHECK(!poll_out_of_bounds);
+    TEST_CHECK(!chunk_out_of_order);
+    TEST_CHECK_EQUAL(sizeof(payload), chunk_total);
+    TEST_CHECK_EQUAL(sizeof(payload), received_length);
+    TEST_CHECK(memcmp(received, payload, sizeof(payload)) == 0);
+    TEST_CHECK_EQUAL(0, messages);
+
+    // and the stream is in step after it
+    reset_received();
+    queue_publish("hr9/a", payload, 10);
+    mqtt_network_double_arrive(64);
+    while (bounded_poll() > 0)
+    {
+    }
+    TEST_CHECK(!poll_out_of_bounds);
+    TEST_CHECK_EQUAL(1, messages);
+    TEST_CHECK(memcmp(received, payload, 10) == 0);
+}
+
+static void test_chunk_handler_gets_a_small_publish_whole(void)
+{
+    unsigned char payload[] = "{\"desired\":{}}";
+    int length = (int)sizeof(payload) - 1;
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("$iothub/twin/PATCH/properties/desired/#", NULL, chunk_handler, 0));
+
+    queue_publish("$iothub/twin/PATCH/properties/desired/?$version=2", payload, length);
+    poll_all();
+
+    TEST_CHECK_EQUAL(1, chunks);
+    TEST_CHECK_EQUAL(length, chunk_total);
+    TEST_CHECK(memcmp(received, payload, length) == 0);
+}
+
+static void test_refused_subscription_installs_no_handler(void)
+{
+    unsigned char payload[] = "x";
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK(!subscribe("$iothub/twin/res/#", NULL, chunk_handler, 0x80));
+    TEST_CHECK_EQUAL(FAILURE, MQTTPendingResult(&client));
+
+    queue_publish("$iothub/twin/res/200/?$rid=1", payload, 1);
+    poll_all();
+    TEST_CHECK_EQUAL(0, chunks);
+}
+
+static int reserve_and_commit(const char *topic, const char *text, MQTTMessage *message)
+{
+    unsigned char *payload;
+    int space;
+    int rc;
+
+    message->qos = QOS1;
+    message->retained = 0;
+    message->dup = 0;
+
+    if ((rc = MQTTPublishReserve(&client, topic, message, &payload, &space)) != SUCCESS)
+    {
+        return rc;
+    }
+
+    memcpy(payload, text, strlen(text));
+    return MQTTPublishCommit(&client, message, (int)strlen(text));
+}
+
+static void queue_puback(unsigned short id)
+{
+    unsigned char packet[8];
+
+    queue_packet(packet, MQTTSerialize_puback(packet, sizeof(packet), id));
+}
+
+static void test_commit_returns_before_the_puback(void)
+{
+    MQTTMessage message;
+    int sent_length;
+
+    TEST_CHECK(connect_client());
+
+    TEST_CHECK_EQUAL(SUCCESS, reserve_and_commit("hr9/telemetry", "{\"hr\":71}", &message));
+    mqtt_network_double_sent(&sent_length);
+    TEST_CHECK(sent_length > 0);
+    TEST_CHECK_EQUAL(1, MQTTPublishInflight(&client));
+    TEST_CHECK_EQUAL(0, completions);
+
+    // The PUBACK comes in two fragments and is handled by the poll
+    queue_puback(message.id);
+    mqtt_network_double_arrive(2);
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+    TEST_CHECK_EQUAL(0, completions);
+    mqtt_network_double_arrive(2);
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+
+    TEST_CHECK_EQUAL(1, completions);
+    TEST_CHECK_EQUAL(message.id, completed_id);
+    TEST_CHECK_EQUAL(SUCCESS, completed_rc);
+    TEST_CHECK_EQUAL(0, MQTTPublishInflight(&client));
+}
+
+static void test_full_window_refuses_the_reserve(void)
+{
+    MQTTMessage message;
+    unsigned short first_id = 0;
+    unsigned char *payload;
+    int space;
+    int i;
+
+    TEST_CHECK(connect_client());
+
+    for (i = 0; i < MAX_INFLIGHT_PUBLISHES; i++)
+    {
+        TEST_CHECK_EQUAL(SUCCESS, reserve_and_commit("hr9/telemetry", "{}", &message));
+        if (i == 0)
+        {
+            first_id = message.id;
+        }
+    }
+
+    message.qos = QOS1;
+    TEST_CHECK_EQUAL(INFLIGHT_FULL, MQTTPublishReserve(&client, "hr9/telemetry", &message, &payload, &space));
+
+    // QoS0 does not need a slot
+    message.qos = QOS0;
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPublishReserve(&client, "hr9/telemetry", &message, &payload, &space));
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPublishCommit(&client, &message, 0));
+
+    // An acknowledged slot can be used again
+    queue_puback(first_id);
+    poll_all();
+    TEST_CHECK_EQUAL(1, completions);
+    TEST_CHECK_EQUAL(first_id, completed_id);
+    TEST_CHECK_EQUAL(SUCCESS, reserve_and_commit("hr9/telemetry", "{}", &message));
+}
+
+static void test_unacknowledged_publish_is_resent_with_dup(void)
+{
+    MQTTMessage message;
+    unsigned char first[64];
+    const unsigned char *sent;
+    int first_length;
+    int sent_length;
+    int retry;
+
+    TEST_CHECK(connect_client());
+
+    message.qos = QOS1;
+    message.retained = 0;
+    message.dup = 0;
+    message.payload = "{\"cmd\":\"reboot\"}";
+    message.payloadlen = strlen((const char *)message.payload);
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPublishAsync(&client, "$iothub/methods/res/200/?$rid=1", &message));
+
+    sent = mqtt_network_double_sent(&first_length);
+    TEST_CHECK(first_length > 0 && first_length <= (int)sizeof(first));
+    memcpy(first, sent, first_length);
+
+    for (retry = 0; retry < MAX_PUBLISH_RETRIES; retry++)
+    {
+        mqtt_network_double_clear_sent();
+        sys_time_double_advance_ms(COMMAND_TIMEOUT_MS - 1);
+        TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+        mqtt_network_double_sent(&sent_length);
+        TEST_CHECK_EQUAL(0, sent_length);
+
+        sys_time_double_advance_ms(1);
+        TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+
+        // The same packet with DUP set
+        sent = mqtt_network_double_sent(&sent_length);
+        TEST_CHECK_EQUAL(first_length, sent_length);
+        TEST_CHECK_EQUAL(first[0] | 0x08, sent[0]);
+        TEST_CHECK(memcmp(&first[1], &sent[1], first_length - 1) == 0);
+        TEST_CHECK_EQUAL(0, completions);
+    }
+
+    // Out of retries
+    sys_time_double_advance_ms(COMMAND_TIMEOUT_MS);
+    TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+    TEST_CHECK_EQUAL(1, completions);
+    TEST_CHECK_EQUAL(message.id, completed_id);
+    TEST_CHECK_EQUAL(FAILURE, completed_rc);
+}
+
+static void test_disconnect_fails_what_is_in_flight(void)
+{
+    MQTTMessage message;
+
+    TEST_CHECK(connect_client());
+    TEST_CHECK_EQUAL(SUCCESS, reserve_and_commit("hr9/telemetry", "{}", &message));
+
+    MQTTDisconnect(&client);
+    TEST_CHECK_EQUAL(1, completions);
+    TEST_CHECK_EQUAL(message.id, completed_id);
+    TEST_CHECK_EQUAL(FAILURE, completed_rc);
+    TEST_CHECK_EQUAL(0, MQTTPublishInflight(&client));
+}
+
+static void test_reserve_commit_matches_serialize_publish(void)
+{
+    static const char *topics[] = { "t", "hr9/telemetry",
+                                    "devices/cloud-connect-dm320118/messages/events/" };
+    unsigned char expected[TX_BUFFER_SIZE];
+    MQTTString topic = MQTTString_initializer;
+    size_t t;
+    int qos, retained, length;
+
+    for (t = 0; t < sizeof(topics) / sizeof(topics[0]); t++)
+    {
+        for (qos = QOS0; qos <= QOS1; qos++)
+        {
+            for (retained = 0; retained <= 1; retained++)
+            {
+                // Across the one and two byte remaining lengths, up to a full send buffer
+                for (length = 0; ; length++)
+                {
+                    MQTTMessage message;
+                    const unsigned char *sent;
+                    unsigned char *payload;
+                    int expected_length;
+                    int sent_length;
+                    int space;
+
+                    TEST_CHECK(connect_client());
+                    message.qos = qos;
+                    message.retained = retained;
+                    message.dup = 0;
+                    TEST_CHECK_EQUAL(SUCCESS, MQTTPublishReserve(&client, topics[t], &message, &payload, &space));
+                    if (length > space)
+                    {
+                        break;
+                    }
+                    make_payload(payload, length, length);
+                    TEST_CHECK_EQUAL(SUCCESS, MQTTPublishCommit(&client, &message, length));
+
+                    topic.cstring = (char *)topics[t];
+                    expected_length = MQTTSerialize_publish(expected, sizeof(expected), 0, qos, retained,
+                                                            message.id, topic, message.payload, length);
+                    sent = mqtt_network_double_sent(&sent_length);
+                    TEST_CHECK_EQUAL(expected_length, sent_length);
+                    TEST_CHECK(memcmp(expected, sent, sent_length) == 0);
+                }
+                // The space left for the payload is all of it
+                TEST_CHECK(length > 400);
+            }
+        }
+    }
+}
+
+/* Counts what memcpy() writes into the client buffers. The Paho sources copy
+ * payloads and topics with memcpy(), the test binary is linked with
+ * --wrap=memcpy so every call comes through here. */
+void *__real_memcpy(void *destination, const void *source, size_t length);
+
+void *__wrap_memcpy(void *destination, const void *source, size_t length)
+{
+    const unsigned char *d = destination;
+
+    if (d >= tx_buffer && d < tx_buffer + sizeof(tx_buffer))
+    {
+        copied_to_tx += length;
+    }
+    else if (d >= inflight_buffer && d < inflight_buffer + sizeof(inflight_buffer))
+    {
+        copied_to_inflight += length;
+    }
+    return __real_memcpy(destination, source, length);
+}
+
+/* Telemetry as the firmware sent it before the payload was written in place:
+ * the builder wrote into its own buffer, CLOUD_publishData() serialized a
+ * parson tree it never sent into a stack buffer, and MQTTPublish() copied the
+ * payload into the send buffer. Returns the bytes parson wrote. */
+static size_t publish_staged(const char *topic, int heart_rate, const char *json)
+{
+    char payload_buffer[128 + 64];
+    char json_message[256];
+    char heart_rate_text[32];
+    JSON_Value *value = json_value_init_object();
+    MQTTMessage message;
+    int length = snprintf(payload_buffer, sizeof(payload_buffer), "%s", json);
+
+    snprintf(heart_rate_text, sizeof(heart_rate_text), "Heart rate = %d", heart_rate);
+    memset(json_message, 0x00, sizeof(json_message));
+    json_object_dotset_string(json_value_get_object(value), "state.reported.led1", heart_rate_text);
+    json_serialize_to_buffer(value, json_message, sizeof(json_message));
+    json_value_free(value);
+
+    message.qos = QOS1;
+    message.retained = 0;
+    message.dup = 0;
+    message.payload = payload_buffer;
+    message.payloadlen = length;
+    queue_puback(client.next_packetid + 1);
+    if (MQTTPublish(&client, topic, &message) != SUCCESS)
+    {
+        return 0;
+    }
+    return strlen(json_message);
+}
+
+/* And now: the builder writes straight into the reserved span */
+static int publish_in_place(const char *topic, const char *json)
+{
+    MQTTMessage message;
+    unsigned char *payload;
+    int length = (int)strlen(json);
+    int space;
+    int rc;
+
+    message.qos = QOS1;
+    message.retained = 0;
+    message.dup = 0;
+    if ((rc = MQTTPublishReserve(&client, topic, &message, &payload, &space)) != SUCCESS)
+    {
+        return rc;
+    }
+    snprintf((char *)payload, space, "%s", json);
+    if ((rc = MQTTPublishCommit(&client, &message, length)) != SUCCESS)
+    {
+        return rc;
+    }
+
+    queue_puback(message.id);
+    poll_all();
+    return completions == 1 && completed_rc == SUCCESS ? SUCCESS : FAILURE;
+}
+
+static void test_bytes_copied_per_publish(void)
+{
+    // The payloads of the sensor telemetry, button event and UART telemetry builders
+    static const char *payloads[] = {
+        "{\"temperature\":23,\"light\":512}",
+        "{\"button_event\":{\"button_name\":\"SW0\",\"press_count\":3,\"flash_count\":12}}",
+        "{\"telemetry_UART\":\"0A1B2C3D4E5F60718293A4B5C6D7E8F90A1B2C3D4E5F60718293A4B5C6D7E8F9"
+        "0A1B2C3D4E5F60718293A4B5C6D7E8F90A1B2C3D4E5F\"}",
+    };
+    static const char topic[] = "devices/cloud-connect-dm320118/messages/events/";
+    size_t p;
+
+    for (p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++)
+    {
+        size_t length = strlen(payloads[p]);
+        size_t staged_tx, staged_parson, in_place_tx, in_place_inflight;
+
+        TEST_CHECK(connect_client());
+        // MQTTPublish() kept no copy to resend
+        MQTTSetInflightBuffer(&client, NULL, 0);
+        copied_to_tx = 0;
+        staged_parson = publish_staged(topic, 71, payloads[p]);
+        staged_tx = copied_to_tx;
+        TEST_CHECK(staged_parson > 0);
+
+        TEST_CHECK(connect_client());
+        copied_to_tx = 0;
+        copied_to_inflight = 0;
+        TEST_CHECK_EQUAL(SUCCESS, publish_in_place(topic, payloads[p]));
+        in_place_tx = copied_to_tx;
+        in_place_inflight = copied_to_inflight;
+
+        printf("publish %3u byte payload: staged %3u B into the send buffer + %3u B parson, "
+               "in place %2u B into the send buffer + %3u B kept for resend\n",
+               (unsigned)length, (unsigned)staged_tx, (unsigned)staged_parson, (unsigned)in_place_tx,
+               (unsigned)in_place_inflight);
+
+        // Only the topic is copied now, and the payload was copied before. The
+        // in-flight window keeps the whole packet, with its headers.
+        TEST_CHECK_EQUAL(strlen(topic), in_place_tx);
+        TEST_CHECK_EQUAL(strlen(topic) + length, staged_tx);
+        TEST_CHECK(in_place_inflight > strlen(topic) + length);
+    }
+}
+
+/* A broker stand-in at the end of a link with a fixed round trip: it answers
+ * every QoS1 PUBLISH written to it with a PUBACK that can only be read once
+ * the round trip has passed on the SYS_TIME double */
+#define LOOPBACK_ACKS   64
+
+static struct
+{
+    uint32_t rtt_ms;
+    uint64_t due_ms[LOOPBACK_ACKS];
+    unsigned char packet[LOOPBACK_ACKS][4];
+    unsigned head;
+    unsigned tail;
+    unsigned char stream[LOOPBACK_ACKS * 4];
+    int stream_length;
+    int read_offset;
+    int published;
+} loopback;
+
+static uint64_t now_ms(void)
+{
+    return SYS_TIME_Counter64Get() / (SYS_TIME_DOUBLE_FREQUENCY / 1000);
+}
+
+static void loopback_arrive(void)
+{
+    while (loopback.tail != loopback.head && loopback.due_ms[loopback.tail % LOOPBACK_ACKS] <= now_ms())
+    {
+        memcpy(&loopback.stream[loopback.stream_length], loopback.packet[loopback.tail % LOOPBACK_ACKS], 4);
+        loopback.stream_length += 4;
+        loopback.tail++;
+    }
+}
+
+static int loopback_take(unsigned char *buffer, int length)
+{
+    int available = loopback.stream_length - loopback.read_offset;
+
+    if (length > available)
+    {
+        length = available;
+    }
+    memcpy(buffer, &loopback.stream[loopback.read_offset], length);
+    loopback.read_offset += length;
+    if (loopback.read_offset == loopback.stream_length)
+    {
+        loopback.read_offset = 0;
+        loopback.stream_length = 0;
+    }
+    return length;
+}
+
+static int loopback_read_available(Network *network, unsigned char *buffer, int length)
+{
+    loopback_arrive();
+    return loopback_take(buffer, length);
+}
+
+/* A blocking read waits for the next PUBACK to come, up to its timeout */
+static int loopback_read(Network *network, unsigned char *buffer, int length, int timeout_ms)
+{
+    uint64_t end_ms = now_ms() + timeout_ms;
+
+    loopback_arrive();
+    while (loopback.stream_length - loopback.read_offset < length && loopback.tail != loopback.head &&
+           loopback.due_ms[loopback.tail % LOOPBACK_ACKS] <= end_ms)
+    {
+        sys_time_double_advance_ms((uint32_t)(loopback.due_ms[loopback.tail % LOOPBACK_ACKS] - now_ms()));
+        loopback_arrive();
+    }
+    if (loopback.stream_length - loopback.read_offset < length)
+    {
+        sys_time_double_advance_ms((uint32_t)(end_ms - now_ms()));
+    }
+    return loopback_take(buffer, length);
+}
+
+static int loopback_write(Network *network, unsigned char *buffer, int length, int timeout_ms)
+{
+    unsigned char dup, retained, *payload;
+    unsigned short id;
+    int qos, payload_length;
+    MQTTString topic;
+
+    if (MQTTDeserialize_publish(&dup, &qos, &retained, &id, &topic, &payload, &payload_length, buffer, length) == 1)
+    {
+        loopback.published++;
+        if (qos == QOS1 && loopback.head - loopback.tail < LOOPBACK_ACKS)
+        {
+            loopback.due_ms[loopback.head % LOOPBACK_ACKS] = now_ms() + loopback.rtt_ms;
+            MQTTSerialize_puback(loopback.packet[loopback.head % LOOPBACK_ACKS], 4, id);
+            loopback.head++;
+        }
+    }
+    return length;
+}
+
+static bool connect_loopback(uint32_t rtt_ms)
+{
+    bool connected = connect_client();
+
+    memset(&loopback, 0, sizeof(loopback));
+    loopback.rtt_ms = rtt_ms;
+    network.mqttread = loopback_read;
+    network.mqttwrite = loopback_write;
+    network.mqttreadavailable = loopback_read_available;
+    return connected;
+}
+
+static void telemetry_message(MQTTMessage *message)
+{
+    message->qos = QOS1;
+    message->retained = 0;
+    message->dup = 0;
+    message->payload = "{\"temperature\":23,\"light\":512}";
+    message->payloadlen = strlen((const char *)message->payload);
+}
+
+/* QoS1 telemetry through the loopback broker: MQTTPublish() waits out a round
+ * trip per message, MQTTPublishAsync() keeps the in-flight window full and a
+ * 1 ms task loop polls for the PUBACKs */
+static void test_loopback_broker_throughput(void)
+{
+    static const uint32_t rtts_ms[] = { 20, 100, 300, 800 };
+    static const char topic[] = "devices/cloud-connect-dm320118/messages/events/";
+    const int count = 200;
+    size_t r;
+
+    for (r = 0; r < sizeof(rtts_ms) / sizeof(rtts_ms[0]); r++)
+    {
+        MQTTMessage message;
+        uint64_t start_ms, blocking_ms, async_ms;
+        int sent, i;
+
+        TEST_CHECK(connect_loopback(rtts_ms[r]));
+        start_ms = now_ms();
+        for (i = 0; i < count; i++)
+        {
+            telemetry_message(&message);
+            TEST_CHECK_EQUAL(SUCCESS, MQTTPublish(&client, topic, &message));
+        }
+        blocking_ms = now_ms() - start_ms;
+
+        TEST_CHECK(connect_loopback(rtts_ms[r]));
+        start_ms = now_ms();
+        for (sent = 0; sent < count || MQTTPublishInflight(&client) > 0;)
+        {
+            int rc = INFLIGHT_FULL;
+
+            if (sent < count)
+            {
+                telemetry_message(&message);
+                rc = MQTTPublishAsync(&client, topic, &message);
+            }
+            if (rc == SUCCESS)
+            {
+                sent++;
+            }
+            else
+            {
+                TEST_CHECK_EQUAL(INFLIGHT_FULL, rc);
+                sys_time_double_advance_ms(1);
+            }
+            TEST_CHECK_EQUAL(SUCCESS, MQTTPoll(&client));
+        }
+        async_ms = now_ms() - start_ms;
+
+        printf("loopback rtt %3lu ms: blocking %6.1f msg/s, async %6.1f msg/s with %d in flight\n",
+               (unsigned long)rtts_ms[r], count * 1000.0 / blocking_ms, count * 1000.0 / async_ms,
+               MAX_INFLIGHT_PUBLISHES);
+
+        // Every message went out once and was acknowledged
+        TEST_CHECK_EQUAL(count, loopback.published);
+        TEST_CHECK_EQUAL(count, completions);
+        TEST_CHECK_EQUAL(SUCCESS, completed_rc);
+        TEST_CHECK(blocking_ms >= (uint64_t)count * rtts_ms[r]);
+        TEST_CHECK(async_ms * (MAX_INFLIGHT_PUBLISHES - 1) < blocking_ms);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_publish_arriving_a_byte_at_a_time);
+    TEST_RUN(test_back_to_back_packets_in_one_read);
+    TEST_RUN(test_random_fragments_keep_the_stream_in_step);
+    TEST_RUN(test_publish_bigger_than_readbuf_goes_to_the_chunk_handler);
+    TEST_RUN(test_chunked_publish_is_read_a_readbuf_per_poll);
+    TEST_RUN(test_chunk_handler_gets_a_small_publish_whole);
+    TEST_RUN(test_refused_subscription_installs_no_handler);
+    TEST_RUN(test_commit_returns_before_the_puback);
+    TEST_RUN(test_full_window_refuses_the_reserve);
+    TEST_RUN(test_unacknowledged_publish_is_resent_with_dup);
+    TEST_RUN(test_disconnect_fails_what_is_in_flight);
+    TEST_RUN(test_reserve_commit_matches_serialize_publish);
+    TEST_RUN(test_bytes_copied_per_publish);
+    TEST_RUN(test_loopback_broker_throughput);
+
+    return TEST_REPORT("mqtt_client");
+}
@@ -0,0 +1,260 @@
+/**
+ * \file
+ * \brief Host tests for the reported property cache
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include "reported_cache.h"
+#include "test_common.h"
+
+#define DEBOUNCE_MS     REPORTED_CACHE_DEBOUNCE_MS
+
+enum { INTERVAL, LED, IP_ADDRESS };
+
+static reported_cache_t cache;
+
+/* Sends the due properties the way check_reported_properties() does, each
+ * with the value it was set to */
+static uint16_t send_patch(uint32_t request_id)
+{
+    uint32_t id;
+
+    for (id = 0; id < REPORTED_CACHE_MAX_PROPERTIES; id++)
+    {
+        if (cache.dirty & REPORTED_CACHE_BIT(id))
+        {
+            reported_cache_sent(&cache, id, cache.values[id].value, cache.values[id].version);
+        }
+    }
+
+    reported_cache_in_flight(&cache, request_id);
+    return cache.in_flight;
+}
+
+/* A cache whose INTERVAL and LED IoT Hub has acknowledged as 10 and 1 */
+static void acked_cache(uint32_t now_ms)
+{
+    reported_cache_init(&cache);
+    reported_cache_set(&cache, INTERVAL, 10, 0, now_ms);
+    reported_cache_set(&cache, LED, 1, 0, now_ms);
+    send_patch(1);
+    reported_cache_ack(&cache, 1, true, now_ms);
+}
+
+static void test_changes_in_the_window_merge(void)
+{
+    reported_cache_init(&cache);
+    TEST_CHECK(!reported_cache_due(&cache, 0));
+
+    reported_cache_set(&cache, INTERVAL, 10, 0, 1000);
+    reported_cache_set(&cache, LED, 1, 0, 1000 + DEBOUNCE_MS - 100);
+    reported_cache_set(&cache, INTERVAL, 20, 0, 1000 + DEBOUNCE_MS - 50);
+
+    // The window started with the first change and is not pushed back
+    TEST_CHECK(!reported_cache_due(&cache, 1000 + DEBOUNCE_MS - 1));
+    TEST_CHECK(reported_cache_due(&cache, 1000 + DEBOUNCE_MS));
+
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(INTERVAL) | REPORTED_CACHE_BIT(LED), send_patch(7));
+    TEST_CHECK_EQUAL(20, cache.values[INTERVAL].sent);
+    TEST_CHECK(!reported_cache_due(&cache, 1000 + DEBOUNCE_MS));
+
+    TEST_CHECK(reported_cache_ack(&cache, 7, true, 1600));
+    TEST_CHECK_EQUAL(0, cache.dirty);
+    TEST_CHECK_EQUAL(0, cache.in_flight);
+    TEST_CHECK_EQUAL(20, cache.values[INTERVAL].acked);
+    TEST_CHECK(!reported_cache_due(&cache, 100000));
+}
+
+static void test_value_flapping_back_sends_nothing(void)
+{
+    acked_cache(0);
+
+    reported_cache_set(&cache, LED, 0, 0, 5000);
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(LED), cache.dirty);
+    reported_cache_set(&cache, LED, 1, 0, 5100);
+    TEST_CHECK_EQUAL(0, cache.dirty);
+    TEST_CHECK(!reported_cache_due(&cache, 5000 + DEBOUNCE_MS));
+
+    // Setting the acknowledged value again is no change either
+    reported_cache_set(&cache, INTERVAL, 10, 0, 6000);
+    TEST_CHECK(!reported_cache_due(&cache, 6000 + DEBOUNCE_MS));
+
+    // Flapping inside a running window cannot hold the PATCH back
+    reported_cache_set(&cache, LED, 0, 0, 7000);
+    reported_cache_set(&cache, LED, 1, 0, 7100);
+    reported_cache_set(&cache, LED, 0, 0, 7200);
+    TEST_CHECK(reported_cache_due(&cache, 7000 + DEBOUNCE_MS));
+}
+
+static void test_new_desired_version_is_a_change(void)
+{
+    acked_cache(0);
+
+    // The same value answering a newer desired property still has to go out
+    reported_cache_set(&cache, INTERVAL, 10, 4, 1000);
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(INTERVAL), cache.dirty);
+    TEST_CHECK(reported_cache_due(&cache, 1000 + DEBOUNCE_MS));
+    send_patch(2);
+    TEST_CHECK(reported_cache_ack(&cache, 2, true, 1600));
+    TEST_CHECK_EQUAL(4, cache.values[INTERVAL].acked_version);
+
+    reported_cache_set(&cache, INTERVAL, 10, 4, 2000);
+    TEST_CHECK_EQUAL(0, cache.dirty);
+}
+
+static void test_stale_request_id_is_ignored(void)
+{
+    acked_cache(0);
+    reported_cache_set(&cache, LED, 0, 0, 1000);
+    TEST_CHECK(reported_cache_due(&cache, 1000 + DEBOUNCE_MS));
+    send_patch(8);
+
+    // A response to an earlier PATCH, e.g. one given up on
+    TEST_CHECK(!reported_cache_ack(&cache, 7, true, 1600));
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(LED), cache.in_flight);
+    TEST_CHECK_EQUAL(1, cache.values[LED].acked);
+    TEST_CHECK(!reported_cache_due(&cache, 5000));
+    TEST_CHECK(!reported_cache_lost(&cache, 7));
+
+    TEST_CHECK(reported_cache_ack(&cache, 8, true, 1700));
+    TEST_CHECK_EQUAL(0, cache.values[LED].acked);
+
+    // and a second response to the same one
+    TEST_CHECK(!reported_cache_ack(&cache, 8, true, 1800));
+}
+
+static void test_lost_patch_is_sent_again(void)
+{
+    acked_cache(0);
+    reported_cache_set(&cache, INTERVAL, 30, 0, 1000);
+    reported_cache_set(&cache, LED, 0, 0, 1000);
+    send_patch(9);
+    TEST_CHECK(!reported_cache_due(&cache, 20000));
+
+    // No response within the twin request timeout
+    TEST_CHECK(reported_cache_lost(&cache, 9));
+    TEST_CHECK(reported_cache_due(&cache, 20000));
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(INTERVAL) | REPORTED_CACHE_BIT(LED), send_patch(10));
+
+    // The response to the lost one turning up late acknowledges nothing
+    TEST_CHECK(!reported_cache_ack(&cache, 9, true, 20100));
+    TEST_CHECK_EQUAL(10, cache.values[INTERVAL].acked);
+
+    TEST_CHECK(reported_cache_ack(&cache, 10, true, 20200));
+    TEST_CHECK_EQUAL(30, cache.values[INTERVAL].acked);
+    TEST_CHECK_EQUAL(0, cache.dirty);
+}
+
+static void test_change_while_in_flight(void)
+{
+    acked_cache(0);
+    reported_cache_set(&cache, INTERVAL, 30, 0, 1000);
+    send_patch(11);
+
+    reported_cache_set(&cache, INTERVAL, 40, 0, 1200);
+    TEST_CHECK(!reported_cache_due(&cache, 1200 + DEBOUNCE_MS));
+
+    // The PATCH carried 30, 40 still has to go out after another window
+    TEST_CHECK(reported_cache_ack(&cache, 11, true, 2000));
+    TEST_CHECK_EQUAL(30, cache.values[INTERVAL].acked);
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(INTERVAL), cache.dirty);
+    TEST_CHECK(!reported_cache_due(&cache, 2000 + DEBOUNCE_MS - 1));
+    TEST_CHECK(reported_cache_due(&cache, 2000 + DEBOUNCE_MS));
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(INTERVAL), send_patch(12));
+    TEST_CHECK_EQUAL(40, cache.values[INTERVAL].sent);
+}
+
+static void test_rejected_patch_stays_dirty(void)
+{
+    acked_cache(0);
+    reported_cache_set(&cache, LED, 0, 0, 1000);
+    send_patch(13);
+
+    TEST_CHECK(reported_cache_ack(&cache, 13, false, 1600));
+    TEST_CHECK_EQUAL(1, cache.values[LED].acked);
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(LED), cache.dirty);
+    TEST_CHECK(!reported_cache_due(&cache, 1600 + DEBOUNCE_MS - 1));
+    TEST_CHECK(reported_cache_due(&cache, 1600 + DEBOUNCE_MS));
+
+    // A PATCH that could not be sent waits another window too
+    reported_cache_retry(&cache, 3000);
+    TEST_CHECK(!reported_cache_due(&cache, 3000 + DEBOUNCE_MS - 1));
+    TEST_CHECK(reported_cache_due(&cache, 3000 + DEBOUNCE_MS));
+}
+
+static void test_string_sent_as_it_was_then(void)
+{
+    reported_cache_init(&cache);
+    reported_cache_set(&cache, IP_ADDRESS, 0x1111, 0, 0);
+
+    // The string changed between the set and the PATCH: what went out is acked
+    reported_cache_in_flight(&cache, 14);
+    reported_cache_sent(&cache, IP_ADDRESS, 0x2222, 0);
+    TEST_CHECK(reported_cache_ack(&cache, 14, true, 600));
+    TEST_CHECK_EQUAL(0x2222, cache.values[IP_ADDRESS].acked);
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(IP_ADDRESS), cache.dirty);
+
+    reported_cache_set(&cache, IP_ADDRESS, 0x2222, 0, 700);
+    TEST_CHECK_EQUAL(0, cache.dirty);
+}
+
+static void test_forget_reports_everything_again(void)
+{
+    acked_cache(0);
+
+    reported_cache_forget(&cache);
+    reported_cache_set(&cache, INTERVAL, 10, 0, 1000);
+    reported_cache_set(&cache, LED, 1, 0, 1000);
+    TEST_CHECK_EQUAL(REPORTED_CACHE_BIT(INTERVAL) | REPORTED_CACHE_BIT(LED), cache.dirty);
+}
+
+static void test_window_across_the_clock_wrap(void)
+{
+    const uint32_t start = UINT32_MAX - DEBOUNCE_MS / 2;
+
+    acked_cache(start - 100000);
+    reported_cache_set(&cache, LED, 0, 0, start);
+    TEST_CHECK(!reported_cache_due(&cache, start + DEBOUNCE_MS - 1));
+    TEST_CHECK(reported_cache_due(&cache, start + DEBOUNCE_MS));
+
+    // A window that ended long ago does not come back after the wrap
+    acked_cache(0);
+    reported_cache_set(&cache, LED, 0, 0, 0x80000000UL + 1000);
+    TEST_CHECK(reported_cache_due(&cache, 0x80000000UL + 1000 + DEBOUNCE_MS));
+}
+
+int main(void)
+{
+    TEST_RUN(test_changes_in_the_window_merge);
+    TEST_RUN(test_value_flapping_back_sends_nothing);
+    TEST_RUN(test_new_desired_version_is_a_change);
+    TEST_RUN(test_stale_request_id_is_ignored);
+    TEST_RUN(test_lost_patch_is_sent_again);
+    TEST_RUN(test_change_while_in_flight);
+    TEST_RUN(test_rejected_patch_stays_dirty);
+    TEST_RUN(test_string_sent_as_it_was_then);
+    TEST_RUN(test_forget_reports_everything_again);
+    TEST_RUN(test_window_across_the_clock_wrap);
+
+    return TEST_REPORT("reported_cache");
+}
@@ -0,0 +1,300 @@
+/**
+ * \file
+ * \brief Host tests for the scheduled sampling of the Avnet board sensors
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+
+#include <string.h>
+
+#include "sensors.h"
+#include "sensor_io_double.h"
+#include "test_common.h"
+
+#define LSM6DSL     SENSOR_IO_DOUBLE_LSM6DSL
+#define LIS2MDL     SENSOR_IO_DOUBLE_LIS2MDL
+#define LPS22HB     SENSOR_IO_DOUBLE_LPS22HB
+#define HTS221      SENSOR_IO_DOUBLE_HTS221
+
+/* Raw readings the devices return, gyro and accelero also go into the FIFO */
+static const int16_t gyro_raw[3] = { 1200, -340, 57 };
+static const int16_t accelero_raw[3] = { 150, -2200, 16400 };
+static const int16_t magneto_raw[3] = { 420, -130, -900 };
+
+/* HTS221 calibration from a real part */
+static const uint8_t hts221_calibration[16] = {
+    0x3F, 0x91, 0xA8, 0x3E, 0x00, 0xC5, 0xF3, 0xFF, 0x00, 0x00, 0x1C, 0xD4, 0xFF, 0xFF, 0xC7, 0x02
+};
+
+/* Defined by sensors.c, the ST drivers read the reference values */
+extern DrvContextTypeDef PRESSURE_Handle;
+extern DrvContextTypeDef HUMIDITY_Handle;
+extern DrvContextTypeDef TEMPERATURE_Handle;
+extern PRESSURE_Drv_t *PRESSURE_Driver;
+extern HUMIDITY_Drv_t *HUMIDITY_Driver;
+extern TEMPERATURE_Drv_t *TEMPERATURE_Driver;
+
+static uint32_t sampler_runs;
+
+static void put_int16(uint8_t *reg, int16_t value)
+{
+    reg[0] = (uint8_t)value;
+    reg[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+static uint8_t count_sampler(void)
+{
+    sampler_runs++;
+    return COMPONENT_OK;
+}
+
+/* Devices with their identity, fresh data and the readings above */
+static void sensors_power_up(void)
+{
+    uint8_t *lsm6dsl = sensor_io_double_registers(LSM6DSL);
+    uint8_t *lis2mdl = sensor_io_double_registers(LIS2MDL);
+    uint8_t *lps22hb = sensor_io_double_registers(LPS22HB);
+    uint8_t *hts221 = sensor_io_double_registers(HTS221);
+    uint32_t pressure_raw = 4150272;    // 1013.25 hPa
+    int i;
+
+    // Empties the schedule that the last test left behind
+    Sensors_DeInit();
+    sensor_io_double_init();
+
+    lsm6dsl[0x0F] = 0x6A;
+    lis2mdl[0x4F] = 0x40;
+    lps22hb[0x0F] = 0xB1;
+    hts221[0x0F] = 0xBC;
+
+    lsm6dsl[0x1E] = 0x07;
+    lis2mdl[0x67] = 0xFF;
+    lps22hb[0x27] = 0xFF;
+    hts221[0x27] = 0xFF;
+
+    for (i = 0; i < 3; i++)
+    {
+        put_int16(&lsm6dsl[0x22 + 2 * i], gyro_raw[i]);
+        put_int16(&lsm6dsl[0x28 + 2 * i], accelero_raw[i]);
+        put_int16(&lis2mdl[0x68 + 2 * i], magneto_raw[i]);
+    }
+
+    lps22hb[0x28] = (uint8_t)pressure_raw;
+    lps22hb[0x29] = (uint8_t)(pressure_raw >> 8);
+    lps22hb[0x2A] = (uint8_t)(pressure_raw >> 16);
+
+    memcpy(&hts221[0x30], hts221_calibration, sizeof(hts221_calibration));
+    put_int16(&hts221[0x28], -7000);
+    put_int16(&hts221[0x2A], 300);
+}
+
+/* Patterns of gyro X, Y, Z then accelero X, Y, Z, off by +-noise in turn */
+static void fifo_push_patterns(int patterns, int16_t noise)
+{
+    int16_t offset;
+    int k, i;
+
+    for (k = 0; k < patterns; k++)
+    {
+        offset = (k & 1) ? noise : (int16_t)-noise;
+        for (i = 0; i < 3; i++)
+        {
+            sensor_io_double_fifo_push((uint16_t)(gyro_raw[i] + offset));
+        }
+        for (i = 0; i < 3; i++)
+        {
+            sensor_io_double_fifo_push((uint16_t)(accelero_raw[i] - offset));
+        }
+    }
+}
+
+static void test_start_leaves_the_sensors_in_low_power(void)
+{
+    uint8_t *lsm6dsl = sensor_io_double_registers(LSM6DSL);
+    uint8_t *lis2mdl = sensor_io_double_registers(LIS2MDL);
+    uint8_t *lps22hb = sensor_io_double_registers(LPS22HB);
+    uint8_t *hts221 = sensor_io_double_registers(HTS221);
+
+    sensors_power_up();
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Init());
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Start());
+
+    // LSM6DSL: 13 Hz, low power, FIFO streaming at 12.5 Hz up to the burst size
+    TEST_CHECK_EQUAL(1, lsm6dsl[0x10] >> 4);
+    TEST_CHECK_EQUAL(1, lsm6dsl[0x11] >> 4);
+    TEST_CHECK(lsm6dsl[0x15] & 0x10);
+    TEST_CHECK(lsm6dsl[0x16] & 0x80);
+    TEST_CHECK_EQUAL(SENSORS_FIFO_PATTERNS * 6, lsm6dsl[0x06]);
+    TEST_CHECK(lsm6dsl[0x09] & 0x80);
+    TEST_CHECK_EQUAL(0x0A, lsm6dsl[0x0A]);
+
+    // LIS2MDL continuous at 10 Hz in low power, LPS22HB at 1 Hz with address
+    // increment, HTS221 on at 1 Hz
+    TEST_CHECK_EQUAL(0x10, lis2mdl[0x60] & 0x13);
+    TEST_CHECK_EQUAL(1, lps22hb[0x10] >> 4);
+    TEST_CHECK(lps22hb[0x11] & 0x10);
+    TEST_CHECK_EQUAL(0x81, hts221[0x20] & 0x83);
+}
+
+static void test_period_costs_five_reads_and_no_writes(void)
+{
+    uint32_t now_ms;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t periods = 0;
+
+    sensors_power_up();
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Init());
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Start());
+
+    // The FIFO starts mid pattern, its next word is accelero X
+    sensor_io_double_fifo_set_pattern(3);
+    for (int i = 0; i < 3; i++)
+    {
+        sensor_io_double_fifo_push((uint16_t)(accelero_raw[i] + 999));
+    }
+    fifo_push_patterns(24, 40);
+
+    // The main loop calls Sensors_Task() every 10 ms for 20 s
+    for (now_ms = 0; now_ms < 20000; now_ms += 10)
+    {
+        reads = sensor_io_double_reads();
+        writes = sensor_io_double_writes();
+        Sensors_Task(now_ms);
+
+        if (sensor_io_double_reads() != reads)
+        {
+            // FIFO status and burst, magneto, pressure, humidity and temperature
+            TEST_CHECK_EQUAL(5, sensor_io_double_reads() - reads);
+            TEST_CHECK_EQUAL(writes, sensor_io_double_writes());
+            periods++;
+
+            // The misaligned words are skipped and the noise averages out,
+            // 1200 * 70 mdps and 16400 * 0.061 mg
+            TEST_CHECK_EQUAL(84000, GYRO_Data.AXIS_X);
+            TEST_CHECK_EQUAL(1000, ACCELERO_Data.AXIS_Z);
+            fifo_push_patterns(24, 40);
+        }
+    }
+
+    TEST_CHECK_EQUAL(20000 / SENSORS_SAMPLE_MSEC, periods);
+}
+
+static void test_samplers_cache_every_reading(void)
+{
+    float pressure;
+    float humidity;
+    float temperature;
+
+    sensors_power_up();
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Init());
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Start());
+    fifo_push_patterns(2, 0);
+    Sensors_Task(0);
+
+    TEST_CHECK_EQUAL(-23800, GYRO_Data.AXIS_Y);
+    TEST_CHECK_EQUAL(3990, GYRO_Data.AXIS_Z);
+    TEST_CHECK_EQUAL(9, ACCELERO_Data.AXIS_X);
+    TEST_CHECK_EQUAL(-134, ACCELERO_Data.AXIS_Y);
+    // LIS2MDL_Get_Sensitivity() gives 0.66667 per LSB
+    TEST_CHECK_EQUAL(280, MAGNETO_Data.AXIS_X);
+    TEST_CHECK_EQUAL(-86, MAGNETO_Data.AXIS_Y);
+    TEST_CHECK_EQUAL(-600, MAGNETO_Data.AXIS_Z);
+    TEST_CHECK(PRESSURE_Data == 1013.25f);
+
+    // The cached values match what the driver calls would have returned
+    TEST_CHECK_EQUAL(COMPONENT_OK, PRESSURE_Driver->Get_Press(&PRESSURE_Handle, &pressure));
+    TEST_CHECK_EQUAL(COMPONENT_OK, HUMIDITY_Driver->Get_Hum(&HUMIDITY_Handle, &humidity));
+    TEST_CHECK_EQUAL(COMPONENT_OK, TEMPERATURE_Driver->Get_Temp(&TEMPERATURE_Handle, &temperature));
+    TEST_CHECK(PRESSURE_Data == pressure);
+    TEST_CHECK(HUMIDITY_Data == humidity);
+    TEST_CHECK(TEMPERATURE_Data == temperature);
+}
+
+static void test_full_fifo_keeps_the_newest_patterns(void)
+{
+    uint32_t reads;
+
+    sensors_power_up();
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Init());
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Start());
+
+    // A stalled main loop: the FIFO stops at the threshold and is no longer
+    // aligned on a pattern
+    fifo_push_patterns(200, 0);
+    sensor_io_double_fifo_push(1);
+    sensor_io_double_fifo_push(2);
+
+    reads = sensor_io_double_reads();
+    Sensors_Task(60000);
+    TEST_CHECK_EQUAL(5, sensor_io_double_reads() - reads);
+    TEST_CHECK_EQUAL(84000, GYRO_Data.AXIS_X);
+    TEST_CHECK_EQUAL(1000, ACCELERO_Data.AXIS_Z);
+
+    // An empty FIFO only costs the status read and keeps the cached values
+    sensor_io_double_fifo_clear();
+    GYRO_Data.AXIS_X = 12345;
+    reads = sensor_io_double_reads();
+    Sensors_Task(62000);
+    TEST_CHECK_EQUAL(4, sensor_io_double_reads() - reads);
+    TEST_CHECK_EQUAL(12345, GYRO_Data.AXIS_X);
+}
+
+static void test_schedule_is_bounded_and_wraps(void)
+{
+    static const uint32_t now_ms[] = { 0xFFFFFC00u, 0xFFFFFFE7u, 0xFFFFFFE8u, 0x3CFu, 0x3D0u, 0x3D1u };
+    static const uint32_t runs[] = { 1, 1, 2, 2, 3, 3 };
+    uint32_t i;
+
+    sensors_power_up();
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Init());
+    TEST_CHECK_EQUAL(COMPONENT_ERROR, Sensors_Schedule(count_sampler, 0));
+    for (i = 0; i < SENSORS_SCHEDULE_MAX; i++)
+    {
+        TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Schedule(count_sampler, 1000));
+    }
+    TEST_CHECK_EQUAL(COMPONENT_ERROR, Sensors_Schedule(count_sampler, 1000));
+
+    // next_ms runs over 2^32 between the second and third call
+    Sensors_DeInit();
+    TEST_CHECK_EQUAL(COMPONENT_OK, Sensors_Schedule(count_sampler, 1000));
+    sampler_runs = 0;
+    for (i = 0; i < sizeof(now_ms) / sizeof(now_ms[0]); i++)
+    {
+        Sensors_Task(now_ms[i]);
+        TEST_CHECK_EQUAL(runs[i], sampler_runs);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_start_leaves_the_sensors_in_low_power);
+    TEST_RUN(test_period_costs_five_reads_and_no_writes);
+    TEST_RUN(test_samplers_cache_every_reading);
+    TEST_RUN(test_full_fifo_keeps_the_newest_patterns);
+    TEST_RUN(test_schedule_is_bounded_and_wraps);
+
+    return TEST_REPORT("sensors");
+}
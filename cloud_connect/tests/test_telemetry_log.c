@@ -0,0 +1,325 @@
+/**
+ * \file
+ * \brief Host tests for the telemetry log on a RAM flash simulator
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "telemetry_log.h"
+#include "ram_flash.h"
+#include "test_common.h"
+
+// The geometry azutil.c uses on the SAMD21: 2 KB sectors of 8 rows
+#define SECTOR_SIZE     (2048)
+#define SECTOR_COUNT    (8)
+
+static telemetry_log_flash_t flash;
+static telemetry_log_t log_state;
+
+static uint16_t make_record(uint32_t number, uint8_t *record)
+{
+    return (uint16_t)sprintf((char *)record, "{\"sample\":%lu,\"heartRate\":%lu}",
+                             (unsigned long)number, (unsigned long)(60 + number % 40));
+}
+
+static bool replay_next(uint32_t *number)
+{
+    uint8_t data[128];
+    uint8_t expected[128];
+    int32_t length = telemetry_log_peek(&log_state, data, sizeof(data));
+    unsigned long value;
+
+    if (length <= 0 || sscanf((const char *)data, "{\"sample\":%lu", &value) != 1)
+    {
+        return false;
+    }
+
+    *number = (uint32_t)value;
+    return length == make_record(*number, expected) && memcmp(data, expected, (size_t)length) == 0 &&
+           telemetry_log_consume(&log_state);
+}
+
+static void test_mount_formats_a_blank_region(void)
+{
+    uint8_t data[16];
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+    TEST_CHECK_EQUAL(0, telemetry_log_peek(&log_state, data, sizeof(data)));
+    TEST_CHECK(!telemetry_log_consume(&log_state));
+    TEST_CHECK_EQUAL(1, ram_flash_get()->erase_count[0]);
+}
+
+static void test_records_replay_in_order(void)
+{
+    uint8_t record[128];
+    uint32_t number;
+    uint32_t i;
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+    for (i = 0; i < 100; i++)
+    {
+        TEST_CHECK(telemetry_log_append(&log_state, record, make_record(i, record)));
+    }
+
+    for (i = 0; i < 100; i++)
+    {
+        TEST_CHECK(replay_next(&number));
+        TEST_CHECK_EQUAL(i, number);
+    }
+
+    TEST_CHECK_EQUAL(0, telemetry_log_peek(&log_state, record, sizeof(record)));
+    TEST_CHECK_EQUAL(0, ram_flash_get()->bits_set_without_erase);
+}
+
+static void test_remount_resumes_after_delivered_records(void)
+{
+    uint8_t record[128];
+    uint32_t number;
+    uint32_t i;
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+    for (i = 0; i < 150; i++)
+    {
+        TEST_CHECK(telemetry_log_append(&log_state, record, make_record(i, record)));
+    }
+
+    for (i = 0; i < 70; i++)
+    {
+        TEST_CHECK(replay_next(&number));
+    }
+
+    // A reset: only what is on flash is left
+    memset(&log_state, 0, sizeof(log_state));
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+    TEST_CHECK(replay_next(&number));
+    TEST_CHECK_EQUAL(70, number);
+
+    // New records go after the old ones
+    TEST_CHECK(telemetry_log_append(&log_state, record, make_record(1000, record)));
+
+    for (i = 71; i < 150; i++)
+    {
+        TEST_CHECK(replay_next(&number));
+        TEST_CHECK_EQUAL(i, number);
+    }
+
+    TEST_CHECK(replay_next(&number));
+    TEST_CHECK_EQUAL(1000, number);
+    TEST_CHECK_EQUAL(0, ram_flash_get()->bits_set_without_erase);
+}
+
+static void test_full_log_drops_the_oldest_sector(void)
+{
+    uint8_t record[128];
+    uint32_t number;
+    uint32_t previous;
+    uint32_t i;
+    uint32_t sector;
+    uint32_t replayed = 0;
+    const uint32_t appended = 2000;
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+    for (i = 0; i < appended; i++)
+    {
+        TEST_CHECK(telemetry_log_append(&log_state, record, make_record(i, record)));
+    }
+
+    // What is left is the newest records, in order and without gaps
+    TEST_CHECK(replay_next(&previous));
+    replayed++;
+    while (replay_next(&number))
+    {
+        TEST_CHECK_EQUAL(previous + 1, number);
+        previous = number;
+        replayed++;
+    }
+
+    TEST_CHECK_EQUAL(appended - 1, previous);
+    TEST_CHECK(replayed > (SECTOR_COUNT - 2) * SECTOR_SIZE / 48);
+
+    // Sectors are reused in turn, so none wears faster than the others
+    for (sector = 1; sector < SECTOR_COUNT; sector++)
+    {
+        uint32_t difference = ram_flash_get()->erase_count[sector] > ram_flash_get()->erase_count[0] ?
+                              ram_flash_get()->erase_count[sector] - ram_flash_get()->erase_count[0] :
+                              ram_flash_get()->erase_count[0] - ram_flash_get()->erase_count[sector];
+        TEST_CHECK(difference <= 1);
+    }
+}
+
+static void test_corrupt_record_is_skipped(void)
+{
+    uint8_t record[128];
+    uint32_t number;
+    uint32_t i;
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+    for (i = 0; i < 3; i++)
+    {
+        TEST_CHECK(telemetry_log_append(&log_state, record, make_record(i, record)));
+    }
+
+    // Flip a payload bit of the second record, which sits after the segment
+    // header and the first record
+    ram_flash_get()->memory[8 + 6 + make_record(0, record) + 6 + 2] &= 0xFE;
+
+    TEST_CHECK(replay_next(&number));
+    TEST_CHECK_EQUAL(0, number);
+    TEST_CHECK(replay_next(&number));
+    TEST_CHECK_EQUAL(2, number);
+    TEST_CHECK(!replay_next(&number));
+}
+
+static void test_record_too_big_for_the_buffer_is_skipped(void)
+{
+    uint8_t record[200];
+    uint8_t small[32];
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+    memset(record, 'x', sizeof(record));
+    TEST_CHECK(telemetry_log_append(&log_state, record, sizeof(record)));
+    TEST_CHECK(telemetry_log_append(&log_state, record, 20));
+
+    TEST_CHECK_EQUAL(20, telemetry_log_peek(&log_state, small, sizeof(small)));
+
+    // Records that cannot fit one sector are refused
+    TEST_CHECK(!telemetry_log_append(&log_state, record, 0));
+}
+
+/* The pending length comes from the record headers alone, over delivered
+ * records and into the next sector */
+static void test_pending_reads_no_payload(void)
+{
+    uint8_t record[128];
+    uint32_t number;
+    uint32_t reads;
+    uint32_t i;
+
+    ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+    TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+    TEST_CHECK_EQUAL(0, telemetry_log_pending(&log_state));
+
+    for (i = 0; i < 60; i++)
+    {
+        TEST_CHECK(telemetry_log_append(&log_state, record, make_record(i, record)));
+    }
+
+    for (i = 0; i < 60; i++)
+    {
+        reads = ram_flash_get()->bytes_read;
+        TEST_CHECK_EQUAL(make_record(i, record), telemetry_log_pending(&log_state));
+        TEST_CHECK(ram_flash_get()->bytes_read - reads < 16);
+
+        // and asking again changes nothing
+        TEST_CHECK_EQUAL(make_record(i, record), telemetry_log_pending(&log_state));
+        TEST_CHECK(replay_next(&number));
+        TEST_CHECK_EQUAL(i, number);
+    }
+
+    TEST_CHECK_EQUAL(0, telemetry_log_pending(&log_state));
+    TEST_CHECK_EQUAL(0, telemetry_log_peek(&log_state, record, sizeof(record)));
+}
+
+/* Cut the power at every byte of a run of appends and consumes, power up and
+ * remount: nothing but the record being written may be lost, nothing
+ * delivered may come back, and flash must never need a bit set. */
+static void test_power_cut_at_every_byte(void)
+{
+    uint8_t record[128];
+    uint32_t cut;
+
+    for (cut = 1; cut < 400; cut++)
+    {
+        uint32_t number;
+        uint32_t expected = 3;
+        uint32_t appended = 0;
+        uint32_t i;
+
+        ram_flash_init(&flash, SECTOR_SIZE, SECTOR_COUNT);
+        TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+        for (i = 0; i < 3; i++)
+        {
+            TEST_CHECK(telemetry_log_append(&log_state, record, make_record(i, record)));
+        }
+        TEST_CHECK(replay_next(&number));
+        TEST_CHECK(replay_next(&number));
+        TEST_CHECK(replay_next(&number));
+
+        ram_flash_get()->power_cut_after = cut;
+
+        for (i = 3; i < 12 && telemetry_log_append(&log_state, record, make_record(i, record)); i++)
+        {
+            appended++;
+        }
+
+        ram_flash_power_up();
+        memset(&log_state, 0, sizeof(log_state));
+        TEST_CHECK(telemetry_log_mount(&log_state, &flash));
+
+        while (replay_next(&number))
+        {
+            TEST_CHECK_EQUAL(expected, number);
+            expected++;
+        }
+
+        // Every completed append is there, the torn one may or may not be
+        TEST_CHECK(expected >= 3 + appended);
+
+        // The log carries on after the torn record
+        TEST_CHECK(telemetry_log_append(&log_state, record, make_record(500, record)));
+        TEST_CHECK(replay_next(&number));
+        TEST_CHECK_EQUAL(500, number);
+        TEST_CHECK_EQUAL(0, ram_flash_get()->bits_set_without_erase);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_mount_formats_a_blank_region);
+    TEST_RUN(test_records_replay_in_order);
+    TEST_RUN(test_remount_resumes_after_delivered_records);
+    TEST_RUN(test_full_log_drops_the_oldest_sector);
+    TEST_RUN(test_corrupt_record_is_skipped);
+    TEST_RUN(test_record_too_big_for_the_buffer_is_skipped);
+    TEST_RUN(test_pending_reads_no_payload);
+    TEST_RUN(test_power_cut_at_every_byte);
+
+    return TEST_REPORT("telemetry_log");
+}
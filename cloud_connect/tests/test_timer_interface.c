@@ -0,0 +1,273 @@
+/**
+ * \file
+ * \brief Host tests for the MQTT platform timers on the SYS_TIME counter
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "timer_interface.h"
+#include "MQTTClient.h"
+#include "mqtt_network_double.h"
+#include "definitions.h"
+#include "test_common.h"
+
+// SYS_TIME frequencies the platform can be configured for
+static const uint32_t frequencies[] = { 48000000UL, 1000000UL, 32768UL };
+
+// Counter start points, including just below the 64-bit wrap
+static const uint64_t starts[] = { 0, 123456789ULL, UINT64_MAX - 1000, UINT64_MAX - 48000000ULL * 3 };
+
+static void test_countdown_expires_on_time(void)
+{
+    static const uint32_t timeouts[] = { 1, 10, 250, 4000, 900000 };
+    size_t f, s, t;
+
+    for (f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++)
+    {
+        for (s = 0; s < sizeof(starts) / sizeof(starts[0]); s++)
+        {
+            for (t = 0; t < sizeof(timeouts) / sizeof(timeouts[0]); t++)
+            {
+                uint64_t ticks = ((uint64_t)timeouts[t] * frequencies[f]) / 1000;
+                Timer timer;
+
+                sys_time_double_set(starts[s], frequencies[f]);
+                TimerInit(&timer);
+                TimerCountdownMS(&timer, timeouts[t]);
+
+                TEST_CHECK(!TimerIsExpired(&timer));
+                TEST_CHECK_EQUAL(timeouts[t], TimerLeftMS(&timer));
+
+                // One tick before the deadline, across the wrap where there is one
+                sys_time_double_advance(ticks - 1);
+                TEST_CHECK(!TimerIsExpired(&timer));
+                TEST_CHECK_EQUAL(1, TimerLeftMS(&timer));
+
+                sys_time_double_advance(1);
+                TEST_CHECK(TimerIsExpired(&timer));
+                TEST_CHECK_EQUAL(0, TimerLeftMS(&timer));
+
+                // and it stays expired
+                sys_time_double_advance(frequencies[f]);
+                TEST_CHECK(TimerIsExpired(&timer));
+                TEST_CHECK_EQUAL(0, TimerLeftMS(&timer));
+            }
+        }
+    }
+}
+
+static void test_time_left_rounds_up(void)
+{
+    size_t f;
+
+    for (f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++)
+    {
+        uint32_t elapsed;
+        Timer timer;
+
+        sys_time_double_set(UINT64_MAX - 5 * (uint64_t)frequencies[f], frequencies[f]);
+        TimerCountdownMS(&timer, 10000);
+
+        // Waiting TimerLeftMS() never stops short of the deadline
+        for (elapsed = 0; !TimerIsExpired(&timer); elapsed++)
+        {
+            int left = TimerLeftMS(&timer);
+            uint64_t ticks_left = timer.end_count - SYS_TIME_Counter64Get();
+
+            TEST_CHECK(left > 0);
+            TEST_CHECK((uint64_t)left * frequencies[f] >= ticks_left * 1000);
+            TEST_CHECK((uint64_t)(left - 1) * frequencies[f] < ticks_left * 1000);
+
+            sys_time_double_advance(test_random_range(1, frequencies[f] / 100));
+        }
+        TEST_CHECK(elapsed > 0);
+    }
+}
+
+static void test_countdown_in_seconds(void)
+{
+    Timer timer;
+
+    sys_time_double_set(UINT64_MAX - 100, SYS_TIME_DOUBLE_FREQUENCY);
+    TimerCountdown(&timer, 900);
+
+    TEST_CHECK_EQUAL(900000, TimerLeftMS(&timer));
+    sys_time_double_advance_ms(899999);
+    TEST_CHECK(!TimerIsExpired(&timer));
+    sys_time_double_advance_ms(1);
+    TEST_CHECK(TimerIsExpired(&timer));
+}
+
+static void test_time_left_is_clamped(void)
+{
+    Timer timer;
+
+    sys_time_double_set(0, 1000);
+    timer.end_count = (uint64_t)INT_MAX * 4;
+    TEST_CHECK_EQUAL(INT_MAX, TimerLeftMS(&timer));
+
+    // A deadline far in the past, not one far in the future
+    sys_time_double_set(1ULL << 62, 1000);
+    timer.end_count = 5;
+    TEST_CHECK(TimerIsExpired(&timer));
+}
+
+static void test_initialized_timer_is_expired(void)
+{
+    Timer timer;
+
+    sys_time_double_set(0, SYS_TIME_DOUBLE_FREQUENCY);
+    TimerInit(&timer);
+    TEST_CHECK(TimerIsExpired(&timer));
+    TEST_CHECK(TimerIsExpired(NULL));
+    TEST_CHECK_EQUAL(0, TimerLeftMS(NULL));
+}
+
+static void test_time_of_day(void)
+{
+    struct timeval now;
+
+    sys_time_double_set(48000000ULL * 3661 + 24000000ULL + 48, SYS_TIME_DOUBLE_FREQUENCY);
+    TEST_CHECK_EQUAL(0, get_time_of_day(&now));
+    TEST_CHECK_EQUAL(3661, now.tv_sec);
+    TEST_CHECK_EQUAL(500001, now.tv_usec);
+
+    sys_time_double_set(32768ULL * 10 + 16384, 32768);
+    TEST_CHECK_EQUAL(0, get_time_of_day(&now));
+    TEST_CHECK_EQUAL(10, now.tv_sec);
+    TEST_CHECK_EQUAL(500000, now.tv_usec);
+
+    TEST_CHECK_EQUAL(-1, get_time_of_day(NULL));
+}
+
+/* The timer the platform had before: g_timer_val counted milliseconds but was
+ * only stepped by 100 every TC5 interrupt. MQTTYield waits TimerLeftMS() in
+ * its socket read, then checks for expiry. */
+#define OLD_TICK_MS 100
+
+static uint32_t old_timer_val(uint32_t now_ms)
+{
+    return now_ms - now_ms % OLD_TICK_MS;
+}
+
+static uint32_t old_yield_return_ms(uint32_t start_ms, uint32_t timeout_ms)
+{
+    uint32_t now_ms = start_ms;
+    int32_t end_ms = (int32_t)(old_timer_val(now_ms) + timeout_ms);
+
+    do
+    {
+        int32_t left = end_ms - (int32_t)old_timer_val(now_ms);
+        now_ms += (left > 0) ? (uint32_t)left : 0;
+    } while (end_ms - (int32_t)old_timer_val(now_ms) > 0);
+
+    return now_ms;
+}
+
+static int test_read(Network *network, unsigned char *buffer, int length, int timeout_ms)
+{
+    sys_time_double_advance_ms(timeout_ms);
+    return 0;
+}
+
+static int32_t yield_overshoot_us(MQTTClient *client, uint32_t timeout_ms)
+{
+    uint64_t start = SYS_TIME_Counter64Get();
+    uint64_t elapsed;
+
+    MQTTYield(client, timeout_ms);
+    elapsed = SYS_TIME_Counter64Get() - start;
+
+    return (int32_t)((elapsed * 1000000) / SYS_TIME_FrequencyGet()) - (int32_t)timeout_ms * 1000;
+}
+
+/* MQTTYield() over an idle connection, started at random points between the
+ * old 100 ms timer ticks: how late does it return? */
+static void test_yield_overshoot(void)
+{
+    static const uint32_t timeouts[] = { 1, 10, 250 };
+    static unsigned char tx_buffer[64];
+    static unsigned char rx_buffer[64];
+    MQTTClient client;
+    Network network;
+    size_t t;
+
+    mqtt_network_double_init(&network);
+    network.mqttread = test_read;
+
+    for (t = 0; t < sizeof(timeouts) / sizeof(timeouts[0]); t++)
+    {
+        int32_t old_worst_ms = INT32_MIN;
+        int32_t new_worst_us = INT32_MIN;
+        int32_t new_best_us = INT32_MAX;
+        int run;
+
+        for (run = 0; run < 200; run++)
+        {
+            uint32_t start_ms = test_random_range(0, 100000);
+            int32_t overshoot_us;
+
+            int32_t old_ms = (int32_t)(old_yield_return_ms(start_ms, timeouts[t]) - start_ms - timeouts[t]);
+            if (old_ms > old_worst_ms)
+            {
+                old_worst_ms = old_ms;
+            }
+
+            sys_time_double_set((uint64_t)start_ms * 48000 + test_random_range(0, 47999), SYS_TIME_DOUBLE_FREQUENCY);
+            MQTTClientInit(&client, &network, 4000, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer));
+            overshoot_us = yield_overshoot_us(&client, timeouts[t]);
+            if (overshoot_us > new_worst_us)
+            {
+                new_worst_us = overshoot_us;
+            }
+            if (overshoot_us < new_best_us)
+            {
+                new_best_us = overshoot_us;
+            }
+        }
+
+        printf("yield %lu ms: overshoot up to %ld ms on the 100 ms tick, %ld..%ld us on SYS_TIME\n",
+               (unsigned long)timeouts[t], (long)old_worst_ms, (long)new_best_us, (long)new_worst_us);
+
+        // Never early, and late by less than a millisecond
+        TEST_CHECK(new_best_us >= 0);
+        TEST_CHECK(new_worst_us < 1000);
+        TEST_CHECK(old_worst_ms >= 50);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_countdown_expires_on_time);
+    TEST_RUN(test_time_left_rounds_up);
+    TEST_RUN(test_countdown_in_seconds);
+    TEST_RUN(test_time_left_is_clamped);
+    TEST_RUN(test_initialized_timer_is_expired);
+    TEST_RUN(test_time_of_day);
+    TEST_RUN(test_yield_overshoot);
+
+    return TEST_REPORT("timer_interface");
+}
@@ -0,0 +1,597 @@
+/**
+ * \file
+ * \brief Host tests for the MQTT client subscription index
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "MQTTClient.h"
+#include "mqtt_network_double.h"
+#include "definitions.h"
+#include "test_common.h"
+
+/* Built with MAX_MESSAGE_HANDLERS 32 and MAX_TOPIC_INDEX_NODES 254, the most
+ * an unsigned char node number leaves room for next to TOPIC_INDEX_NONE */
+#if MAX_TOPIC_INDEX_NODES != 254
+#error "test_topic_index is built with MAX_TOPIC_INDEX_NODES 254"
+#endif
+
+static MQTTTopicIndex index;
+
+static int match(const char *topic, unsigned char *handlers)
+{
+    MQTTString name = MQTTString_initializer;
+
+    name.cstring = (char *)topic;
+    return MQTTTopicIndexMatch(&index, &name, handlers);
+}
+
+/* Matches a topic that is not terminated, as it is in a received publish */
+static int match_received(const char *topic, unsigned char *handlers)
+{
+    static char buffer[256];
+    MQTTString name = MQTTString_initializer;
+    size_t length = strlen(topic);
+
+    memcpy(buffer, topic, length);
+    buffer[length] = '/';
+    name.lenstring.data = buffer;
+    name.lenstring.len = (int)length;
+    return MQTTTopicIndexMatch(&index, &name, handlers);
+}
+
+/* The handlers matching a topic, as a bit per slot */
+static unsigned long matched(const char *topic)
+{
+    unsigned char handlers[MAX_MESSAGE_HANDLERS];
+    unsigned long slots = 0;
+    int count = match(topic, handlers);
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        slots |= 1UL << handlers[i];
+    }
+    if (match_received(topic, handlers) != count)
+    {
+        return ~0UL;
+    }
+    return slots;
+}
+
+static void test_exact_filters(void)
+{
+    MQTTTopicIndexReset(&index);
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 0, "hr9/telemetry"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 1, "hr9/telemetry/x"));
+
+    TEST_CHECK_EQUAL(1UL << 0, matched("hr9/telemetry"));
+    TEST_CHECK_EQUAL(1UL << 1, matched("hr9/telemetry/x"));
+    TEST_CHECK_EQUAL(0, matched("hr9/telemetr"));
+    TEST_CHECK_EQUAL(0, matched("hr9/telemetry/"));
+    TEST_CHECK_EQUAL(0, matched(""));
+    TEST_CHECK_EQUAL(0, index.node_count);
+}
+
+static void test_single_level_wildcard(void)
+{
+    MQTTTopicIndexReset(&index);
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 0, "a/+/c"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 1, "+"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 2, "+/+"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 3, "devices/+/messages/devicebound/+"));
+
+    TEST_CHECK_EQUAL(1UL << 0, matched("a/b/c"));
+    TEST_CHECK_EQUAL(1UL << 0, matched("a//c"));
+    TEST_CHECK_EQUAL(1UL << 2, matched("a/c"));
+    TEST_CHECK_EQUAL(0, matched("a/b/c/d"));
+    TEST_CHECK_EQUAL(0, matched("a/b/cc"));
+    TEST_CHECK_EQUAL(1UL << 1, matched("a"));
+    TEST_CHECK_EQUAL(1UL << 1, matched(""));
+    TEST_CHECK_EQUAL(1UL << 2, matched("/"));
+    TEST_CHECK_EQUAL(1UL << 3, matched("devices/sn01/messages/devicebound/x"));
+    TEST_CHECK_EQUAL(0, matched("devices/sn01/messages/devicebound/x/y"));
+    TEST_CHECK_EQUAL(0, matched("devices/sn01/events/devicebound/x"));
+}
+
+static void test_multi_level_wildcard(void)
+{
+    MQTTTopicIndexReset(&index);
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 0, "a/#"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 1, "#"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 2, "$iothub/twin/res/#"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 3, "+/b/#"));
+
+    // "a/#" also matches "a" itself
+    TEST_CHECK_EQUAL((1UL << 0) | (1UL << 1), matched("a"));
+    TEST_CHECK_EQUAL((1UL << 0) | (1UL << 1), matched("a/"));
+    TEST_CHECK_EQUAL((1UL << 0) | (1UL << 1) | (1UL << 3), matched("a/b"));
+    TEST_CHECK_EQUAL((1UL << 0) | (1UL << 1) | (1UL << 3), matched("a/b/c/d"));
+    TEST_CHECK_EQUAL(1UL << 1, matched("ab"));
+    TEST_CHECK_EQUAL(1UL << 1, matched("b/a"));
+    TEST_CHECK_EQUAL((1UL << 1) | (1UL << 2), matched("$iothub/twin/res/200/?$rid=1"));
+    TEST_CHECK_EQUAL((1UL << 1) | (1UL << 2), matched("$iothub/twin/res"));
+    TEST_CHECK_EQUAL(1UL << 1, matched("$iothub/twin/resx"));
+}
+
+/* Levels that several filters share are compiled once */
+static void test_filters_share_levels(void)
+{
+    MQTTTopicIndexReset(&index);
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 0, "$iothub/twin/res/#"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 1, "$iothub/twin/PATCH/properties/desired/#"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 2, "$iothub/methods/POST/#"));
+    TEST_CHECK_EQUAL(11, index.node_count);
+}
+
+/* The same filter subscribed from several slots matches all of them, in
+ * slot order whatever order they were added in */
+static void test_repeated_filters(void)
+{
+    unsigned char handlers[MAX_MESSAGE_HANDLERS];
+
+    MQTTTopicIndexReset(&index);
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 7, "x/y"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 2, "x/y"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 5, "x/+"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 3, "x/+"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, 4, "x/y"));
+
+    TEST_CHECK_EQUAL(5, match("x/y", handlers));
+    TEST_CHECK_EQUAL(2, handlers[0]);
+    TEST_CHECK_EQUAL(3, handlers[1]);
+    TEST_CHECK_EQUAL(4, handlers[2]);
+    TEST_CHECK_EQUAL(5, handlers[3]);
+    TEST_CHECK_EQUAL(7, handlers[4]);
+}
+
+// FNV-1a as MQTTTopicIndex.c hashes the exact filters
+static unsigned slot_of(const char *filter)
+{
+    unsigned long hash = 2166136261UL;
+
+    while (*filter != '\0')
+    {
+        hash ^= (unsigned char)*filter++;
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return (unsigned)(hash & (MAX_TOPIC_INDEX_HASH - 1));
+}
+
+/* Filters that land in the last hash slot probe on from the start of the
+ * table, a filter hashing to the start is pushed further along */
+static void test_colliding_exact_filters(void)
+{
+    static char filters[MAX_MESSAGE_HANDLERS][16];
+    static char strangers[4][16];
+    unsigned found = 0;
+    unsigned others = 0;
+    unsigned n;
+    unsigned i;
+
+    for (n = 0; found < 6 || others < 4; n++)
+    {
+        char name[16];
+
+        snprintf(name, sizeof(name), "c/%u", n);
+        if (slot_of(name) == MAX_TOPIC_INDEX_HASH - 1 && found < 5)
+        {
+            strcpy(filters[found++], name);
+        }
+        else if (slot_of(name) == 0 && found == 5)
+        {
+            strcpy(filters[found++], name);
+        }
+        else if (slot_of(name) == MAX_TOPIC_INDEX_HASH - 1 && others < 4)
+        {
+            strcpy(strangers[others++], name);
+        }
+    }
+
+    MQTTTopicIndexReset(&index);
+    for (i = 0; i < found; i++)
+    {
+        TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, (int)i, filters[i]));
+    }
+
+    for (i = 0; i < found; i++)
+    {
+        TEST_CHECK_EQUAL(1UL << i, matched(filters[i]));
+    }
+    for (i = 0; i < others; i++)
+    {
+        TEST_CHECK_EQUAL(0, matched(strangers[i]));
+    }
+}
+
+/* Every exact slot taken: MAX_TOPIC_INDEX_HASH leaves free slots to end the
+ * probes of topics that are not subscribed */
+static void test_all_handlers_exact(void)
+{
+    static char filters[MAX_MESSAGE_HANDLERS][16];
+    int i;
+
+    MQTTTopicIndexReset(&index);
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; i++)
+    {
+        snprintf(filters[i], sizeof(filters[i]), "e/%d", i);
+        TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, i, filters[i]));
+    }
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; i++)
+    {
+        TEST_CHECK_EQUAL(1UL << i, matched(filters[i]));
+    }
+    TEST_CHECK_EQUAL(0, matched("e/32"));
+    TEST_CHECK_EQUAL(0, matched("e/"));
+}
+
+/* Node numbers run up to 253, next to TOPIC_INDEX_NONE, and a filter that
+ * does not fit any more is refused without spoiling the others */
+static void test_full_trie(void)
+{
+    static char filters[MAX_MESSAGE_HANDLERS][48];
+    int count;
+    int i;
+
+    MQTTTopicIndexReset(&index);
+
+    // "+" once, then nine nodes for each filter
+    for (count = 0; 1 + 9 * (count + 1) <= MAX_TOPIC_INDEX_NODES; count++)
+    {
+        snprintf(filters[count], sizeof(filters[count]), "+/h%d/1/2/3/4/5/6/7/8", count);
+        TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, count, filters[count]));
+    }
+    TEST_CHECK_EQUAL(1 + 9 * count, index.node_count);
+
+    // Topping it up to the last node
+    while (index.node_count < MAX_TOPIC_INDEX_NODES)
+    {
+        snprintf(filters[count], sizeof(filters[count]), "+/h0/1/2/3/4/5/6/7/x%d", count);
+        TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, count, filters[count]));
+        count++;
+    }
+    TEST_CHECK_EQUAL(254, index.node_count);
+
+    // Full: a filter needing one more node is refused, one sharing all of its levels is not
+    TEST_CHECK_EQUAL(-1, MQTTTopicIndexAdd(&index, count, "+/h0/1/2/3/4/5/6/7/y"));
+    TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, count, "+/h1/1/2/3/4/5/6/7/8"));
+    TEST_CHECK_EQUAL(254, index.node_count);
+
+    for (i = 0; i < count; i++)
+    {
+        char topic[48];
+
+        strcpy(topic, filters[i]);
+        topic[0] = 'z';
+        TEST_CHECK(matched(topic) & (1UL << i));
+    }
+    TEST_CHECK_EQUAL((1UL << 1) | (1UL << count), matched("z/h1/1/2/3/4/5/6/7/8"));
+    TEST_CHECK_EQUAL(0, matched("z/h0/1/2/3/4/5/6/7/y"));
+    TEST_CHECK_EQUAL(0, matched("z/h99/1/2/3/4/5/6/7/8"));
+}
+
+/* The subscriptions of a connected client */
+#define COMMAND_TIMEOUT_MS  4000
+
+static MQTTClient client;
+static Network network;
+static unsigned char tx_buffer[512];
+static unsigned char rx_buffer[256];
+
+static void ignore(MessageData *data)
+{
+}
+
+static bool connect_client(void)
+{
+    unsigned char packet[8];
+    MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
+    int i;
+
+    sys_time_double_set(0, SYS_TIME_DOUBLE_FREQUENCY);
+    mqtt_network_double_init(&network);
+    MQTTClientInit(&client, &network, COMMAND_TIMEOUT_MS, tx_buffer, sizeof(tx_buffer),
+                   rx_buffer, sizeof(rx_buffer));
+
+    if (MQTTConnectAsync(&client, &options) != SUCCESS)
+    {
+        return false;
+    }
+
+    mqtt_network_double_queue(packet, MQTTSerialize_connack(packet, sizeof(packet), 0, 0));
+    for (i = 0; i < 8 && MQTTPendingResult(&client) == PENDING; i++)
+    {
+        mqtt_network_double_arrive(1);
+        MQTTPoll(&client);
+    }
+
+    return MQTTPendingResult(&client) == SUCCESS && client.isconnected;
+}
+
+static bool subscribe(const char *filter)
+{
+    unsigned char packet[8];
+    int granted = 0;
+
+    if (MQTTSubscribeAsync(&client, filter, QOS0, ignore) != SUCCESS)
+    {
+        return false;
+    }
+
+    mqtt_network_double_queue(packet, MQTTSerialize_suback(packet, sizeof(packet), client.next_packetid, 1, &granted));
+    while (MQTTPendingResult(&client) == PENDING && mqtt_network_double_queued() > 0)
+    {
+        mqtt_network_double_arrive(1);
+        MQTTPoll(&client);
+    }
+
+    return MQTTPendingResult(&client) == SUCCESS;
+}
+
+static bool unsubscribe(const char *filter)
+{
+    unsigned char packet[8];
+
+    mqtt_network_double_queue(packet, MQTTSerialize_unsuback(packet, sizeof(packet), 1));
+    return MQTTUnsubscribe(&client, filter) == 0;
+}
+
+static unsigned long client_matched(const char *topic)
+{
+    unsigned char handlers[MAX_MESSAGE_HANDLERS];
+    MQTTString name = MQTTString_initializer;
+    unsigned long slots = 0;
+    int count;
+    int i;
+
+    name.cstring = (char *)topic;
+    count = MQTTTopicIndexMatch(&client.topicIndex, &name, handlers);
+    for (i = 0; i < count; i++)
+    {
+        slots |= 1UL << handlers[i];
+    }
+    return slots;
+}
+
+/* Unsubscribing compiles the index again from the handlers that are left */
+static void test_index_rebuilt_after_unsubscribe(void)
+{
+    TEST_CHECK(connect_client());
+    TEST_CHECK(subscribe("a/+/c"));
+    TEST_CHECK(subscribe("a/b/c"));
+    TEST_CHECK(subscribe("a/#"));
+    TEST_CHECK(subscribe("$iothub/twin/res/#"));
+    TEST_CHECK_EQUAL((1UL << 0) | (1UL << 1) | (1UL << 2), client_matched("a/b/c"));
+    TEST_CHECK_EQUAL(8, client.topicIndex.node_count);
+
+    TEST_CHECK(unsubscribe("a/+/c"));
+    TEST_CHECK_EQUAL((1UL << 1) | (1UL << 2), client_matched("a/b/c"));
+    TEST_CHECK_EQUAL(1UL << 2, client_matched("a/x/c"));
+    TEST_CHECK_EQUAL(1UL << 3, client_matched("$iothub/twin/res/200/?$rid=4"));
+    TEST_CHECK_EQUAL(6, client.topicIndex.node_count);
+
+    TEST_CHECK(unsubscribe("a/b/c"));
+    TEST_CHECK_EQUAL(1UL << 2, client_matched("a/b/c"));
+
+    // The freed slots are taken again
+    TEST_CHECK(subscribe("x/+"));
+    TEST_CHECK(subscribe("a/b/c"));
+    TEST_CHECK_EQUAL(1UL << 0, client_matched("x/y"));
+    TEST_CHECK_EQUAL((1UL << 1) | (1UL << 2), client_matched("a/b/c"));
+}
+
+/* A subscription the index has no room for is dropped again, and the index
+ * is left as it was */
+static void test_subscription_that_does_not_fit(void)
+{
+    static char filters[MAX_MESSAGE_HANDLERS][48];
+    int count;
+    unsigned char nodes;
+
+    TEST_CHECK(connect_client());
+    for (count = 0; 1 + 9 * (count + 1) <= MAX_TOPIC_INDEX_NODES; count++)
+    {
+        snprintf(filters[count], sizeof(filters[count]), "+/h%d/1/2/3/4/5/6/7/8", count);
+        TEST_CHECK(subscribe(filters[count]));
+    }
+    nodes = client.topicIndex.node_count;
+
+    TEST_CHECK(!subscribe("+/overflow/1/2/3/4/5/6/7/8"));
+    TEST_CHECK_EQUAL(nodes, client.topicIndex.node_count);
+    TEST_CHECK(client.messageHandlers[count].topicFilter == NULL);
+    TEST_CHECK_EQUAL(1UL << (count - 1), client_matched("z/h27/1/2/3/4/5/6/7/8"));
+    TEST_CHECK_EQUAL(0, client_matched("z/overflow/1/2/3/4/5/6/7/8"));
+
+    // Exact filters do not need nodes
+    TEST_CHECK(subscribe("hr9/telemetry"));
+    TEST_CHECK_EQUAL(1UL << count, client_matched("hr9/telemetry"));
+}
+
+/* The handler loop the client had before the index: every filter compared
+ * with every received topic */
+static char old_topic_matched(const char *filter, MQTTString *name)
+{
+    const char *curf = filter;
+    const char *curn = name->lenstring.data;
+    const char *curn_end = curn + name->lenstring.len;
+
+    while (*curf && curn < curn_end)
+    {
+        if (*curn == '/' && *curf != '/')
+            break;
+        if (*curf != '+' && *curf != '#' && *curf != *curn)
+            break;
+        if (*curf == '+')
+        {
+            const char *nextpos = curn + 1;
+            while (nextpos < curn_end && *nextpos != '/')
+                nextpos = ++curn + 1;
+        }
+        else if (*curf == '#')
+            curn = curn_end - 1;
+        curf++;
+        curn++;
+    }
+
+    return (curn == curn_end) && (*curf == '\0');
+}
+
+static int old_match(const char **filters, int count, MQTTString *name, unsigned char *handlers)
+{
+    int matches = 0;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (MQTTPacket_equals(name, (char *)filters[i]) || old_topic_matched(filters[i], name))
+        {
+            handlers[matches++] = (unsigned char)i;
+        }
+    }
+    return matches;
+}
+
+/* What an Azure IoT Hub connection receives, against the filters it has and
+ * then against a full handler table. Topics the handler loop got wrong, "a"
+ * for "a/#", are left out. */
+static void test_azure_topic_mix(void)
+{
+    static const char *azure_filters[] = {
+        "devices/sn0123EF3A9C41D207/messages/devicebound/#",
+        "$iothub/twin/res/#",
+        "$iothub/twin/PATCH/properties/desired/#",
+        "$iothub/methods/POST/#",
+        "hr9/led",
+    };
+    static const char *topics[] = {
+        "$iothub/twin/res/200/?$rid=17",
+        "$iothub/twin/res/204/?$rid=18&$version=5",
+        "$iothub/twin/PATCH/properties/desired/?$version=12",
+        "$iothub/methods/POST/reboot/?$rid=3",
+        "devices/sn0123EF3A9C41D207/messages/devicebound/%24.to=%2Fdevices%2Fsn0123EF3A9C41D207&iothub-ack=none",
+        "hr9/led",
+        "devices/sn0123EF3A9C41D208/messages/devicebound/x",
+    };
+    static char names_of_others[MAX_MESSAGE_HANDLERS][24];
+    const int azure_count = (int)(sizeof(azure_filters) / sizeof(azure_filters[0]));
+    const int topic_count = (int)(sizeof(topics) / sizeof(topics[0]));
+    const int filter_counts[] = { azure_count, MAX_MESSAGE_HANDLERS };
+    const long rounds = 100000;
+    const char *filters[MAX_MESSAGE_HANDLERS];
+    unsigned char handlers[MAX_MESSAGE_HANDLERS];
+    unsigned char old_handlers[MAX_MESSAGE_HANDLERS];
+    MQTTString names[sizeof(topics) / sizeof(topics[0])];
+    size_t run;
+    int t;
+    int i;
+
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; i++)
+    {
+        if (i < azure_count)
+        {
+            filters[i] = azure_filters[i];
+        }
+        else
+        {
+            // Application filters filling up the table, half of them wildcards
+            snprintf(names_of_others[i], sizeof(names_of_others[i]), (i % 2) ? "app/%d/+/state" : "hr9/cmd/%d", i);
+            filters[i] = names_of_others[i];
+        }
+    }
+
+    for (t = 0; t < topic_count; t++)
+    {
+        names[t].cstring = NULL;
+        names[t].lenstring.data = (char *)topics[t];
+        names[t].lenstring.len = (int)strlen(topics[t]);
+    }
+
+    for (run = 0; run < sizeof(filter_counts) / sizeof(filter_counts[0]); run++)
+    {
+        const int filter_count = filter_counts[run];
+        unsigned long checksum = 0;
+        unsigned long old_checksum = 0;
+        clock_t start;
+        double index_ns;
+        double old_ns;
+        long r;
+
+        MQTTTopicIndexReset(&index);
+        for (i = 0; i < filter_count; i++)
+        {
+            TEST_CHECK_EQUAL(0, MQTTTopicIndexAdd(&index, i, filters[i]));
+        }
+
+        // Both find the same handlers
+        for (t = 0; t < topic_count; t++)
+        {
+            int count = MQTTTopicIndexMatch(&index, &names[t], handlers);
+
+            TEST_CHECK_EQUAL(old_match(filters, filter_count, &names[t], old_handlers), count);
+            TEST_CHECK(memcmp(handlers, old_handlers, count) == 0);
+        }
+
+        start = clock();
+        for (r = 0; r < rounds; r++)
+        {
+            for (t = 0; t < topic_count; t++)
+            {
+                checksum += (unsigned long)MQTTTopicIndexMatch(&index, &names[t], handlers);
+            }
+        }
+        index_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)rounds * topic_count);
+
+        start = clock();
+        for (r = 0; r < rounds; r++)
+        {
+            for (t = 0; t < topic_count; t++)
+            {
+                old_checksum += (unsigned long)old_match(filters, filter_count, &names[t], old_handlers);
+            }
+        }
+        old_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)rounds * topic_count);
+
+        printf("topic mix, %d filters: index %.1f ns, handler loop %.1f ns per topic\n",
+               filter_count, index_ns, old_ns);
+        TEST_CHECK_EQUAL(old_checksum, checksum);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_exact_filters);
+    TEST_RUN(test_single_level_wildcard);
+    TEST_RUN(test_multi_level_wildcard);
+    TEST_RUN(test_filters_share_levels);
+    TEST_RUN(test_repeated_filters);
+    TEST_RUN(test_colliding_exact_filters);
+    TEST_RUN(test_all_handlers_exact);
+    TEST_RUN(test_full_trie);
+    TEST_RUN(test_index_rebuilt_after_unsubscribe);
+    TEST_RUN(test_subscription_that_does_not_fit);
+    TEST_RUN(test_azure_topic_mix);
+
+    return TEST_REPORT("topic_index");
+}
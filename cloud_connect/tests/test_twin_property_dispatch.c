@@ -0,0 +1,510 @@
+/**
+ * \file
+ * \brief Host tests for the desired twin property dispatcher
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "twin_property_dispatch.h"
+#include "test_common.h"
+
+#define TABLE_SIZE      (16)
+#define NAME_COUNT      (9)
+#define FIRMWARE_NAMES  (8)
+
+// The desired properties azutil.c handles, $version first, and one whose name has an escape
+static const char *names[NAME_COUNT] = {
+    "$version", "telemetryInterval", "telemetryBatchWindow", "led_y",
+    "debugLevel", "property_3", "property_4", "disableTelemetry", "min/max",
+};
+
+/* What the handlers were given, in order */
+typedef struct dispatched
+{
+    int count;
+    int order[32];
+    int32_t values[NAME_COUNT];
+    uint32_t found;
+} dispatched_t;
+
+static uint32_t unknown_count;
+
+static az_result record(int index, az_json_token *value, void *context)
+{
+    dispatched_t *dispatched = context;
+    az_result rc = az_json_token_get_int32(value, &dispatched->values[index]);
+
+    if (az_result_failed(rc))
+    {
+        return rc;
+    }
+
+    if (dispatched->count < (int)(sizeof(dispatched->order) / sizeof(dispatched->order[0])))
+    {
+        dispatched->order[dispatched->count] = index;
+    }
+    dispatched->count++;
+    dispatched->found |= 1u << index;
+    return AZ_OK;
+}
+
+#define HANDLER(index) \
+    static az_result handler_##index(az_json_token *value, void *context) { return record(index, value, context); }
+
+HANDLER(0)
+HANDLER(1)
+HANDLER(2)
+HANDLER(3)
+HANDLER(4)
+HANDLER(5)
+HANDLER(6)
+HANDLER(7)
+HANDLER(8)
+
+static const twin_property_handler_t handlers[NAME_COUNT] = {
+    handler_0, handler_1, handler_2, handler_3, handler_4, handler_5, handler_6, handler_7, handler_8,
+};
+
+static void count_unknown(az_json_token *name)
+{
+    unknown_count++;
+}
+
+static twin_property_t properties[TABLE_SIZE];
+static twin_property_table_t table = { properties, TABLE_SIZE, 0, count_unknown };
+
+static uint32_t fnv1a(const char *name, uint32_t seed)
+{
+    uint32_t hash = seed;
+
+    while (*name != '\0')
+    {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+/* The perfect hash table device_model/twin_property_hash.py would generate */
+static bool build_table(void)
+{
+    uint32_t seed;
+    int i;
+
+    for (seed = 2166136261u; seed < 2166136261u + 1000000u; seed++)
+    {
+        uint32_t slots = 0;
+
+        for (i = 0; i < NAME_COUNT; i++)
+        {
+            uint32_t slot = fnv1a(names[i], seed) & (TABLE_SIZE - 1);
+
+            if (slots & (1u << slot))
+            {
+                break;
+            }
+            slots |= 1u << slot;
+        }
+
+        if (i == NAME_COUNT)
+        {
+            memset(properties, 0, sizeof(properties));
+            for (i = 0; i < NAME_COUNT; i++)
+            {
+                twin_property_t *property = &properties[fnv1a(names[i], seed) & (TABLE_SIZE - 1)];
+
+                property->name = az_span_create((uint8_t *)names[i], (int32_t)strlen(names[i]));
+                property->handler = handlers[i];
+            }
+            table.seed = seed;
+            return true;
+        }
+    }
+    return false;
+}
+
+static az_result dispatch_chunks(az_span *chunks, int32_t count, bool is_full_twin, dispatched_t *dispatched)
+{
+    az_json_reader jr;
+    az_result rc;
+
+    memset(dispatched, 0, sizeof(*dispatched));
+    unknown_count = 0;
+
+    rc = az_json_reader_chunked_init(&jr, chunks, count, NULL);
+    if (az_result_failed(rc))
+    {
+        return rc;
+    }
+    return twin_property_dispatch(&table, &jr, is_full_twin, dispatched);
+}
+
+static az_result dispatch(const char *json, bool is_full_twin, dispatched_t *dispatched)
+{
+    az_span chunk = az_span_create((uint8_t *)json, (int32_t)strlen(json));
+
+    return dispatch_chunks(&chunk, 1, is_full_twin, dispatched);
+}
+
+static void test_desired_update(void)
+{
+    dispatched_t d;
+
+    TEST_CHECK(build_table());
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"telemetryInterval\":30,\"led_y\":2,\"$version\":7}", false, &d));
+    TEST_CHECK_EQUAL(3, d.count);
+    TEST_CHECK_EQUAL(1, d.order[0]);
+    TEST_CHECK_EQUAL(3, d.order[1]);
+    TEST_CHECK_EQUAL(0, d.order[2]);
+    TEST_CHECK_EQUAL(30, d.values[1]);
+    TEST_CHECK_EQUAL(2, d.values[3]);
+    TEST_CHECK_EQUAL(7, d.values[0]);
+    TEST_CHECK_EQUAL(0, unknown_count);
+
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{}", false, &d));
+    TEST_CHECK_EQUAL(0, d.count);
+}
+
+static void test_version_anywhere(void)
+{
+    static const char *documents[] = {
+        "{\"$version\":5,\"debugLevel\":3,\"property_4\":-1}",
+        "{\"debugLevel\":3,\"$version\":5,\"property_4\":-1}",
+        "{\"debugLevel\":3,\"property_4\":-1,\"$version\":5}",
+    };
+    dispatched_t d;
+    size_t i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(documents[0]); i++)
+    {
+        TEST_CHECK_EQUAL(AZ_OK, dispatch(documents[i], false, &d));
+        TEST_CHECK_EQUAL(3, d.count);
+        TEST_CHECK_EQUAL((int)i, d.order[i] == 0 ? (int)i : -1);
+        TEST_CHECK_EQUAL(5, d.values[0]);
+        TEST_CHECK_EQUAL(3, d.values[4]);
+        TEST_CHECK_EQUAL(-1, d.values[6]);
+    }
+
+    // In a full twin only the desired $version counts, wherever desired is
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"reported\":{\"$version\":99,\"telemetryInterval\":1},"
+                                     "\"desired\":{\"telemetryInterval\":5,\"$version\":3}}", true, &d));
+    TEST_CHECK_EQUAL(2, d.count);
+    TEST_CHECK_EQUAL(3, d.values[0]);
+    TEST_CHECK_EQUAL(5, d.values[1]);
+
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"desired\":{\"$version\":4},\"reported\":{\"$version\":99}}", true, &d));
+    TEST_CHECK_EQUAL(1, d.count);
+    TEST_CHECK_EQUAL(4, d.values[0]);
+
+    TEST_CHECK_EQUAL(AZ_ERROR_ITEM_NOT_FOUND, dispatch("{\"reported\":{\"$version\":99}}", true, &d));
+    TEST_CHECK_EQUAL(0, d.count);
+}
+
+static void test_unknown_values_are_skipped(void)
+{
+    dispatched_t d;
+
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"patientName\":{\"telemetryInterval\":1,\"x\":[{\"$version\":2},[3]]},"
+                                     "\"list\":[1,{\"led_y\":9}],"
+                                     "\"s\":\"{\\\"led_y\\\":1}\","
+                                     "\"$version\":4,"
+                                     "\"n\":null,\"b\":true,\"f\":1.5,"
+                                     "\"$metadata\":{\"$lastUpdated\":\"2021-06-01T00:00:00Z\","
+                                     "\"debugLevel\":{\"$lastUpdated\":\"2021-06-01T00:00:00Z\"}},"
+                                     "\"debugLevel\":2}", false, &d));
+    TEST_CHECK_EQUAL(2, d.count);
+    TEST_CHECK_EQUAL(0, d.order[0]);
+    TEST_CHECK_EQUAL(4, d.order[1]);
+    TEST_CHECK_EQUAL(4, d.values[0]);
+    TEST_CHECK_EQUAL(2, d.values[4]);
+    TEST_CHECK_EQUAL(7, unknown_count);
+}
+
+static void test_escaped_names(void)
+{
+    char name[64];
+    dispatched_t d;
+
+    // Names are looked up unescaped
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"min\\/max\":10,\"$version\":2,\"min/max\":11}", false, &d));
+    TEST_CHECK_EQUAL(3, d.count);
+    TEST_CHECK_EQUAL(8, d.order[0]);
+    TEST_CHECK_EQUAL(8, d.order[2]);
+    TEST_CHECK_EQUAL(11, d.values[8]);
+    TEST_CHECK_EQUAL(0, unknown_count);
+
+    // Names differing from one in the table, also after unescaping
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"telemetryinterval\":1,\"led_y \":1,\"led\\\\y\":1,\"\":1,"
+                                     "\"led_y\\\"\":1,\"telemetry\\/Interval\":1,\"$version\":3}", false, &d));
+    TEST_CHECK_EQUAL(1, d.count);
+    TEST_CHECK_EQUAL(6, unknown_count);
+
+    // The SDK reader does not decode \uXXXX, such a name is unknown but the walk goes on
+    TEST_CHECK_EQUAL(AZ_OK, dispatch("{\"\\u0024version\":1,\"note\":\"\\u0031\",\"$version\":3}", false, &d));
+    TEST_CHECK_EQUAL(1, d.count);
+    TEST_CHECK_EQUAL(2, unknown_count);
+
+    // Names longer than any in the table, up to and past the lookup buffer
+    memset(name, 'x', sizeof(name));
+    name[0] = '{';
+    name[1] = '"';
+    strcpy(&name[2 + TWIN_PROPERTY_NAME_SIZE - 1], "\":1}");
+    TEST_CHECK_EQUAL(AZ_OK, dispatch(name, false, &d));
+    strcpy(&name[2 + TWIN_PROPERTY_NAME_SIZE + 8], "\":1}");
+    TEST_CHECK_EQUAL(AZ_OK, dispatch(name, false, &d));
+    TEST_CHECK_EQUAL(0, d.count);
+    TEST_CHECK_EQUAL(1, unknown_count);
+}
+
+static bool same_dispatch(const dispatched_t *a, const dispatched_t *b)
+{
+    return a->count == b->count && memcmp(a->order, b->order, sizeof(a->order)) == 0 &&
+           memcmp(a->values, b->values, sizeof(a->values)) == 0;
+}
+
+/* Every way of splitting a document over two chunks, and one chunk a byte,
+ * gives what the whole document gives */
+static void test_names_split_across_chunks(void)
+{
+    static const char *document =
+        "{\"desired\":{\"min\\/max\":10,\"unknownName\":{\"led_y\":[1,2]},"
+        "\"telemetryBatchWindow\":60,\"$version\":12,\"disableTelemetry\":1},"
+        "\"reported\":{\"led_y\":{\"value\":1,\"ac\":200}}}";
+    static az_span bytes[512];
+    int32_t length = (int32_t)strlen(document);
+    dispatched_t whole;
+    dispatched_t split;
+    int32_t i;
+
+    TEST_CHECK_EQUAL(AZ_OK, dispatch(document, true, &whole));
+    TEST_CHECK_EQUAL(4, whole.count);
+    TEST_CHECK_EQUAL(12, whole.values[0]);
+    TEST_CHECK_EQUAL(10, whole.values[8]);
+
+    for (i = 1; i < length; i++)
+    {
+        az_span chunks[2];
+
+        chunks[0] = az_span_create((uint8_t *)document, i);
+        chunks[1] = az_span_create((uint8_t *)document + i, length - i);
+        TEST_CHECK_EQUAL(AZ_OK, dispatch_chunks(chunks, 2, true, &split));
+        TEST_CHECK(same_dispatch(&whole, &split));
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        bytes[i] = az_span_create((uint8_t *)document + i, 1);
+    }
+    TEST_CHECK_EQUAL(AZ_OK, dispatch_chunks(bytes, length, true, &split));
+    TEST_CHECK(same_dispatch(&whole, &split));
+}
+
+static void test_errors(void)
+{
+    dispatched_t d;
+
+    // A handler error stops the walk
+    TEST_CHECK(az_result_failed(dispatch("{\"$version\":\"7\",\"debugLevel\":1}", false, &d)));
+    TEST_CHECK_EQUAL(0, d.count);
+
+    TEST_CHECK_EQUAL(AZ_ERROR_UNEXPECTED_CHAR, dispatch("[1]", false, &d));
+    TEST_CHECK_EQUAL(AZ_ERROR_UNEXPECTED_CHAR, dispatch("{\"desired\":3}", true, &d));
+    TEST_CHECK(az_result_failed(dispatch("{\"debugLevel\":1", false, &d)));
+}
+
+/* Full twin GET documents as IoT Hub sends them back: the desired section,
+ * where the properties the firmware handles come with others set by the
+ * solution and with the $metadata of all of them, then the reported section */
+static int32_t build_full_twin(char *buffer, size_t size, int other_count)
+{
+    int length = 0;
+    int i;
+
+    length += snprintf(buffer + length, size - length,
+                       "{\"desired\":{\"telemetryInterval\":30,\"telemetryBatchWindow\":0,\"led_y\":2,"
+                       "\"debugLevel\":4,\"property_3\":3,\"property_4\":4,\"disableTelemetry\":0");
+    for (i = 0; i < other_count; i++)
+    {
+        length += snprintf(buffer + length, size - length, ",\"solutionSetting%d\":{\"enabled\":true,\"level\":%d}",
+                           i, i);
+    }
+    length += snprintf(buffer + length, size - length,
+                       ",\"$metadata\":{\"$lastUpdated\":\"2021-06-01T12:00:00.0000000Z\"");
+    for (i = 1; i < FIRMWARE_NAMES + other_count; i++)
+    {
+        char other[32];
+
+        snprintf(other, sizeof(other), "solutionSetting%d", i - FIRMWARE_NAMES);
+        length += snprintf(buffer + length, size - length,
+                           ",\"%s\":{\"$lastUpdated\":\"2021-06-01T12:00:00.0000000Z\",\"$lastUpdatedVersion\":%d}",
+                           i < FIRMWARE_NAMES ? names[i] : other, i + 10);
+    }
+    length += snprintf(buffer + length, size - length, "},\"$version\":17},\"reported\":{");
+    for (i = 0; i < other_count; i++)
+    {
+        length += snprintf(buffer + length, size - length,
+                           "\"reportedProperty%d\":{\"value\":%d,\"ac\":200,\"av\":%d,\"ad\":\"Success\"},",
+                           i, i * 7, i + 3);
+    }
+    length += snprintf(buffer + length, size - length, "\"$version\":%d}}", other_count + 40);
+    return length;
+}
+
+/* The walk the firmware had before: a pass to find $version, then a pass
+ * through the desired properties comparing each name with every handled one */
+static az_result move_to_name(az_json_reader *jr, const char *name)
+{
+    az_span name_span = az_span_create((uint8_t *)name, (int32_t)strlen(name));
+
+    while (jr->token.kind == AZ_JSON_TOKEN_PROPERTY_NAME && !az_json_token_is_text_equal(&jr->token, name_span))
+    {
+        if (az_result_failed(az_json_reader_next_token(jr)) || az_result_failed(az_json_reader_skip_children(jr)) ||
+            az_result_failed(az_json_reader_next_token(jr)))
+        {
+            return AZ_ERROR_UNEXPECTED_CHAR;
+        }
+    }
+    if (jr->token.kind != AZ_JSON_TOKEN_PROPERTY_NAME)
+    {
+        return AZ_ERROR_ITEM_NOT_FOUND;
+    }
+    return az_json_reader_next_token(jr);
+}
+
+static az_result start_desired(az_json_reader *jr, az_span *chunk)
+{
+    az_result rc;
+
+    if (az_result_failed(rc = az_json_reader_chunked_init(jr, chunk, 1, NULL)) ||
+        az_result_failed(rc = az_json_reader_next_token(jr)) || az_result_failed(rc = az_json_reader_next_token(jr)) ||
+        az_result_failed(rc = move_to_name(jr, "desired")))
+    {
+        return rc;
+    }
+    return az_json_reader_next_token(jr);
+}
+
+static az_result two_pass_dispatch(az_span *chunk, dispatched_t *dispatched)
+{
+    az_json_reader jr;
+    az_result rc;
+    int i;
+
+    memset(dispatched, 0, sizeof(*dispatched));
+
+    if (az_result_failed(rc = start_desired(&jr, chunk)) || az_result_failed(rc = move_to_name(&jr, "$version")) ||
+        az_result_failed(rc = record(0, &jr.token, dispatched)))
+    {
+        return rc;
+    }
+
+    if (az_result_failed(rc = start_desired(&jr, chunk)))
+    {
+        return rc;
+    }
+
+    while (jr.token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)
+    {
+        for (i = 1; i < NAME_COUNT; i++)
+        {
+            if (az_json_token_is_text_equal(&jr.token, az_span_create((uint8_t *)names[i], (int32_t)strlen(names[i]))))
+            {
+                break;
+            }
+        }
+
+        if (az_result_failed(rc = az_json_reader_next_token(&jr)))
+        {
+            return rc;
+        }
+
+        rc = (i < NAME_COUNT) ? record(i, &jr.token, dispatched) : az_json_reader_skip_children(&jr);
+        if (az_result_failed(rc) || az_result_failed(rc = az_json_reader_next_token(&jr)))
+        {
+            return rc;
+        }
+    }
+    return AZ_OK;
+}
+
+static void test_full_twin_get_benchmark(void)
+{
+    static const int other_counts[] = { 0, 8, 24, 64 };
+    static char document[16384];
+    size_t n;
+
+    for (n = 0; n < sizeof(other_counts) / sizeof(other_counts[0]); n++)
+    {
+        int32_t length = build_full_twin(document, sizeof(document), other_counts[n]);
+        az_span chunk = az_span_create((uint8_t *)document, length);
+        long rounds = 4000000L / length;
+        dispatched_t one;
+        dispatched_t two;
+        clock_t start;
+        double one_us;
+        double two_us;
+        long r;
+
+        TEST_CHECK(length < (int32_t)sizeof(document) - 1);
+
+        // Both find the same properties
+        TEST_CHECK_EQUAL(AZ_OK, dispatch_chunks(&chunk, 1, true, &one));
+        TEST_CHECK_EQUAL(AZ_OK, two_pass_dispatch(&chunk, &two));
+        TEST_CHECK_EQUAL(FIRMWARE_NAMES, one.count);
+        TEST_CHECK_EQUAL(one.found, two.found);
+        TEST_CHECK(memcmp(one.values, two.values, sizeof(one.values)) == 0);
+        TEST_CHECK_EQUAL(17, one.values[0]);
+
+        start = clock();
+        for (r = 0; r < rounds; r++)
+        {
+            dispatch_chunks(&chunk, 1, true, &one);
+        }
+        one_us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / rounds;
+
+        start = clock();
+        for (r = 0; r < rounds; r++)
+        {
+            two_pass_dispatch(&chunk, &two);
+        }
+        two_us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / rounds;
+
+        printf("full twin GET %5ld bytes: one pass %7.2f us, two passes %7.2f us\n", (long)length, one_us, two_us);
+        TEST_CHECK(one.count == FIRMWARE_NAMES && two.count == FIRMWARE_NAMES);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_desired_update);
+    TEST_RUN(test_version_anywhere);
+    TEST_RUN(test_unknown_values_are_skipped);
+    TEST_RUN(test_escaped_names);
+    TEST_RUN(test_names_split_across_chunks);
+    TEST_RUN(test_errors);
+    TEST_RUN(test_full_twin_get_benchmark);
+
+    return TEST_REPORT("twin_property_dispatch");
+}
@@ -0,0 +1,159 @@
+/**
+ * \file
+ * \brief Host tests for the twin request table
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include "twin_request.h"
+#include "test_common.h"
+
+static twin_request_table_t table;
+
+static void test_response_resolves_its_request(void)
+{
+    twin_request_t request;
+
+    twin_request_init(&table);
+    twin_request_add(&table, 7, TWIN_REQUEST_PATCH, 0x1234, 1000);
+    twin_request_add(&table, 8, TWIN_REQUEST_GET, 0x5678, 1010);
+
+    TEST_CHECK(twin_request_resolve(&table, 8, 1100, &request));
+    TEST_CHECK_EQUAL(8, request.request_id);
+    TEST_CHECK_EQUAL(TWIN_REQUEST_GET, request.kind);
+    TEST_CHECK_EQUAL(0x5678, request.payload_hash);
+    TEST_CHECK_EQUAL(1010, request.sent_ms);
+
+    // 90 ms is in the second bucket, 64..127 ms
+    TEST_CHECK_EQUAL(1, table.rtt_histogram[TWIN_REQUEST_GET][1]);
+
+    TEST_CHECK(twin_request_resolve(&table, 7, 1010, NULL));
+    TEST_CHECK_EQUAL(1, table.rtt_histogram[TWIN_REQUEST_PATCH][0]);
+
+    // A second response to the same id is not matched again
+    TEST_CHECK(!twin_request_resolve(&table, 7, 1020, &request));
+    TEST_CHECK_EQUAL(1, table.unmatched);
+    TEST_CHECK_EQUAL(0, table.timeouts);
+}
+
+static void test_round_trips_fall_in_doubling_buckets(void)
+{
+    static const uint32_t rtt_ms[] = { 0, 63, 64, 127, 128, 255, 256, 4095, 4096, 60000 };
+    static const uint32_t bucket[] = { 0, 0,  1,  1,   2,   2,   3,   6,    7,    7 };
+    uint32_t i;
+
+    twin_request_init(&table);
+    for (i = 0; i < sizeof(rtt_ms) / sizeof(rtt_ms[0]); i++)
+    {
+        uint16_t before = table.rtt_histogram[TWIN_REQUEST_PATCH][bucket[i]];
+
+        twin_request_add(&table, i, TWIN_REQUEST_PATCH, 0, 5000);
+        TEST_CHECK(twin_request_resolve(&table, i, 5000 + rtt_ms[i], NULL));
+        TEST_CHECK_EQUAL(before + 1, table.rtt_histogram[TWIN_REQUEST_PATCH][bucket[i]]);
+    }
+}
+
+static void test_full_table_gives_up_on_the_oldest(void)
+{
+    twin_request_t request;
+    uint32_t i;
+
+    twin_request_init(&table);
+
+    // Sent across the wrap of the millisecond clock, the oldest is the first
+    for (i = 0; i < TWIN_REQUEST_TABLE_SIZE; i++)
+    {
+        twin_request_add(&table, 100 + i, TWIN_REQUEST_PATCH, 0, 0xFFFFFFF0UL + i * 8);
+    }
+    twin_request_add(&table, 200, TWIN_REQUEST_GET, 0, 0x40);
+
+    TEST_CHECK_EQUAL(1, table.timeouts);
+    TEST_CHECK(!twin_request_resolve(&table, 100, 0x50, &request));
+    for (i = 1; i < TWIN_REQUEST_TABLE_SIZE; i++)
+    {
+        TEST_CHECK(twin_request_resolve(&table, 100 + i, 0x50, &request));
+    }
+    TEST_CHECK(twin_request_resolve(&table, 200, 0x50, &request));
+}
+
+static void test_requests_expire_after_the_timeout(void)
+{
+    twin_request_t request;
+
+    twin_request_init(&table);
+    twin_request_add(&table, 1, TWIN_REQUEST_PATCH, 0xAA, 0xFFFFF000UL);
+    twin_request_add(&table, 2, TWIN_REQUEST_PATCH, 0xBB, 0xFFFFF800UL);
+
+    // Nothing has waited long enough yet, including across the clock wrap
+    TEST_CHECK(!twin_request_expire(&table, 0x00000100UL, 0x2000, &request));
+
+    TEST_CHECK(twin_request_expire(&table, 0x00001000UL, 0x2000, &request));
+    TEST_CHECK_EQUAL(1, request.request_id);
+    TEST_CHECK_EQUAL(0xAA, request.payload_hash);
+    TEST_CHECK(!twin_request_expire(&table, 0x00001000UL, 0x2000, &request));
+
+    TEST_CHECK(twin_request_expire(&table, 0x00001800UL, 0x2000, NULL));
+    TEST_CHECK_EQUAL(2, table.timeouts);
+
+    // A response after its request expired is counted, not matched
+    TEST_CHECK(!twin_request_resolve(&table, 2, 0x00001900UL, &request));
+    TEST_CHECK_EQUAL(1, table.unmatched);
+}
+
+static void test_counters_saturate(void)
+{
+    uint32_t i;
+
+    twin_request_init(&table);
+    for (i = 0; i < 70000; i++)
+    {
+        TEST_CHECK(!twin_request_resolve(&table, i, 0, NULL));
+        twin_request_add(&table, i, TWIN_REQUEST_GET, 0, i);
+        TEST_CHECK(twin_request_resolve(&table, i, i, NULL));
+    }
+
+    TEST_CHECK_EQUAL(UINT16_MAX, table.unmatched);
+    TEST_CHECK_EQUAL(UINT16_MAX, table.rtt_histogram[TWIN_REQUEST_GET][0]);
+}
+
+static void test_hash_is_fnv1a(void)
+{
+    TEST_CHECK_EQUAL(2166136261UL, twin_request_hash((const uint8_t *)"", 0));
+    TEST_CHECK_EQUAL(0xE40C292CUL, twin_request_hash((const uint8_t *)"a", 1));
+    TEST_CHECK_EQUAL(0xBF9CF968UL, twin_request_hash((const uint8_t *)"foobar", 6));
+}
+
+int main(void)
+{
+    TEST_RUN(test_response_resolves_its_request);
+    TEST_RUN(test_round_trips_fall_in_doubling_buckets);
+    TEST_RUN(test_full_table_gives_up_on_the_oldest);
+    TEST_RUN(test_requests_expire_after_the_timeout);
+    TEST_RUN(test_counters_saturate);
+    TEST_RUN(test_hash_is_fnv1a);
+
+    return TEST_REPORT("twin_request");
+}
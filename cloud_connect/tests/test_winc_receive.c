@@ -0,0 +1,509 @@
+/**
+ * \file
+ * \brief Host tests for the WINC receive path, on the WINC socket double
+ *
+ * \copyright (c) 2021 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip software
+ * and any derivatives exclusively with Microchip products. It is your
+ * responsibility to comply with third party license terms applicable to your
+ * use of third party software (including open source software) that may
+ * accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+ * PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT,
+ * SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE
+ * OF ANY KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF
+ * MICROCHIP HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE
+ * FORESEEABLE. TO THE FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL
+ * LIABILITY ON ALL CLAIMS IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED
+ * THE AMOUNT OF FEES, IF ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR
+ * THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "winc_receive.h"
+#include "definitions.h"
+#include "test_common.h"
+
+/* As cloud_wifi_task.c sizes and wires it */
+#define RX_RING_SIZE    (2048)
+#define RX_CHUNK_SIZE   (256)
+
+static uint8_t rx_chunk[RX_CHUNK_SIZE];
+static uint8_t rx_ring_buffer[RX_RING_SIZE];
+static winc_receive_t rx;
+static bool rx_overflow;
+static bool rx_timeout;
+
+static void rx_socket_callback(SOCKET sock, uint8_t message_type, void *message)
+{
+    tstrSocketRecvMsg *receive_message = message;
+
+    if (message_type != SOCKET_MSG_RECV)
+    {
+        return;
+    }
+
+    if (receive_message->s16BufferSize < 0)
+    {
+        winc_receive_failed(&rx);
+        rx_timeout = receive_message->s16BufferSize == SOCK_ERR_TIMEOUT;
+    }
+    else if (!winc_receive_chunk(&rx, receive_message))
+    {
+        rx_overflow = true;
+    }
+}
+
+static void rx_init(void)
+{
+    sys_time_double_set(0, SYS_TIME_DOUBLE_FREQUENCY);
+    winc_double_init(rx_socket_callback);
+
+    winc_receive_init(&rx, rx_ring_buffer, sizeof(rx_ring_buffer), rx_chunk, sizeof(rx_chunk));
+    winc_receive_start(&rx, 0);
+    rx_overflow = false;
+    rx_timeout = false;
+}
+
+/* The reader comes back pass after pass until its bytes are in */
+static bool rx_read(uint8_t *data, uint32_t length)
+{
+    uint32_t passes;
+
+    for (passes = 0; passes < 1000; passes++)
+    {
+        if (winc_receive_read(&rx, data, length) == length)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void test_receive_stream_through_winc_double(void)
+{
+    static uint8_t sent[32 * 1024];
+    static uint8_t received[sizeof(sent)];
+    uint32_t arrived = 0;
+    uint32_t read = 0;
+    uint32_t i;
+
+    rx_init();
+
+    for (i = 0; i < sizeof(sent); i++)
+    {
+        sent[i] = (uint8_t)test_random();
+    }
+
+    while (read < sizeof(sent))
+    {
+        // TCP segments of any size, the reader asks for packet sized pieces
+        uint32_t segment = test_random_range(1, 3000);
+        uint32_t piece = test_random_range(1, 600);
+
+        if (segment > sizeof(sent) - arrived)
+        {
+            segment = sizeof(sent) - arrived;
+        }
+        winc_double_arrive(&sent[arrived], segment);
+        arrived += segment;
+
+        if (piece > sizeof(sent) - read)
+        {
+            piece = sizeof(sent) - read;
+        }
+
+        while (piece > 0 && read + piece <= arrived)
+        {
+            TEST_CHECK(rx_read(&received[read], piece));
+            read += piece;
+            piece = test_random_range(1, 600);
+            if (piece > sizeof(sent) - read)
+            {
+                piece = sizeof(sent) - read;
+            }
+        }
+    }
+
+    TEST_CHECK(!rx_overflow);
+    TEST_CHECK(memcmp(sent, received, sizeof(sent)) == 0);
+}
+
+static void test_receive_rearms_after_reader_drains(void)
+{
+    static uint8_t data[3 * SOCKET_BUFFER_MAX_LENGTH];
+    uint8_t out[SOCKET_BUFFER_MAX_LENGTH];
+    uint32_t spins;
+
+    rx_init();
+    memset(data, 0x5A, sizeof(data));
+    winc_double_arrive(data, sizeof(data));
+
+    for (spins = 0; spins < 100; spins++)
+    {
+        m2m_wifi_handle_events();
+    }
+
+    // One message fits the empty ring, after it there is no room for a second one
+    TEST_CHECK_EQUAL(SOCKET_BUFFER_MAX_LENGTH, byte_ring_count(&rx.ring));
+    TEST_CHECK(!winc_double_recv_armed());
+    TEST_CHECK_EQUAL(1, winc_double_recv_calls());
+
+    // Draining it queues the next receive
+    TEST_CHECK(rx_read(out, sizeof(out)));
+    TEST_CHECK(winc_double_recv_armed());
+    TEST_CHECK(!rx_overflow);
+}
+
+static void test_partial_packet_would_block(void)
+{
+    uint8_t packet[300];
+    uint8_t out[sizeof(packet)];
+    uint64_t start;
+    uint32_t i;
+
+    rx_init();
+    winc_double_set_event_cost_us(100);
+
+    for (i = 0; i < sizeof(packet); i++)
+    {
+        packet[i] = (uint8_t)i;
+    }
+
+    // The first TCP segment is in, the rest of the packet is 2 s away
+    winc_double_arrive(packet, 100);
+    winc_double_arrive_at(2 * (uint64_t)SYS_TIME_DOUBLE_FREQUENCY, &packet[100], sizeof(packet) - 100);
+
+    start = SYS_TIME_Counter64Get();
+    TEST_CHECK_EQUAL(0, winc_receive_read(&rx, out, sizeof(out)));
+
+    // One pass of the WINC events, no waiting for the rest of the packet
+    TEST_CHECK_EQUAL(SYS_TIME_DOUBLE_FREQUENCY / 10000, SYS_TIME_Counter64Get() - start);
+    TEST_CHECK_EQUAL(100, byte_ring_count(&rx.ring));
+
+    // Other reads come back empty handed too, and leave the part where it is
+    TEST_CHECK_EQUAL(0, winc_receive_read(&rx, out, sizeof(out)));
+    TEST_CHECK_EQUAL(100, byte_ring_count(&rx.ring));
+
+    // Once the rest is in, the read resumes the packet from its first byte
+    sys_time_double_advance_ms(2000);
+    TEST_CHECK_EQUAL(sizeof(out), winc_receive_read(&rx, out, sizeof(out)));
+    TEST_CHECK(memcmp(packet, out, sizeof(packet)) == 0);
+    TEST_CHECK_EQUAL(0, byte_ring_count(&rx.ring));
+}
+
+static void test_stop_drops_received_bytes(void)
+{
+    uint8_t data[64] = { 0 };
+    uint8_t out[sizeof(data)];
+
+    rx_init();
+    winc_double_arrive(data, sizeof(data));
+    TEST_CHECK_EQUAL(0, winc_receive_read(&rx, out, sizeof(out) + 1));
+    TEST_CHECK_EQUAL(sizeof(data), byte_ring_count(&rx.ring));
+
+    winc_receive_stop(&rx);
+    TEST_CHECK_EQUAL(0, byte_ring_count(&rx.ring));
+
+    // No receive is queued on a closed socket
+    winc_double_init(rx_socket_callback);
+    TEST_CHECK_EQUAL(0, winc_receive_read_available(&rx, out, sizeof(out)));
+    TEST_CHECK_EQUAL(0, winc_double_recv_calls());
+}
+
+/* The receive path the firmware had before: MQTTYield(500) read each packet
+ * with recv() and a timeout, then spun on the WINC events (after a 5 ms busy
+ * delay) until the socket message or the timeout came in. */
+#define OLD_YIELD_TIMEOUT_MS    (500)
+#define OLD_RX_BUFFER_SIZE      (1024)
+
+enum old_status
+{
+    OLD_STATUS_UNKNOWN,
+    OLD_STATUS_RECEIVED,
+    OLD_STATUS_TIMEOUT
+};
+
+static uint8_t old_rx_buffer[OLD_RX_BUFFER_SIZE];
+static uint32_t old_rx_length;
+static uint32_t old_rx_location;
+static enum old_status old_status;
+
+static void old_socket_callback(SOCKET sock, uint8_t message_type, void *message)
+{
+    tstrSocketRecvMsg *receive_message = message;
+
+    if (receive_message->s16BufferSize >= 0)
+    {
+        old_rx_length += (uint32_t)receive_message->s16BufferSize;
+
+        if (receive_message->u16RemainingSize == 0)
+        {
+            old_status = OLD_STATUS_RECEIVED;
+        }
+    }
+    else
+    {
+        old_status = OLD_STATUS_TIMEOUT;
+    }
+}
+
+static bool old_read(uint8_t *data, uint32_t length, uint32_t timeout_ms)
+{
+    if (old_rx_length >= length)
+    {
+        memcpy(data, &old_rx_buffer[old_rx_location], length);
+        old_rx_location += length;
+        old_rx_length -= length;
+        return true;
+    }
+
+    old_status = OLD_STATUS_UNKNOWN;
+    old_rx_location = 0;
+    old_rx_length = 0;
+
+    recv(0, old_rx_buffer, sizeof(old_rx_buffer), timeout_ms);
+    sys_time_double_advance_ms(5);
+
+    do
+    {
+        m2m_wifi_handle_events();
+
+        if (old_status == OLD_STATUS_TIMEOUT)
+        {
+            return false;
+        }
+    } while (old_status != OLD_STATUS_RECEIVED);
+
+    memcpy(data, old_rx_buffer, length);
+    old_rx_location += length;
+    old_rx_length -= length;
+    return true;
+}
+
+/* The workload: packets of a 2 byte length and a body, each arriving whole at
+ * a random point in time, read by an app loop over a simulated run */
+#define RUN_PACKETS         (40)
+#define RUN_MS              (20000)
+#define RUN_PASS_MS         (10)
+#define RUN_EVENT_COST_US   (100)
+#define RUN_BODY_MAX        (600)
+
+static uint8_t run_stream[RUN_PACKETS * (2 + RUN_BODY_MAX)];
+static uint64_t run_arrival[RUN_PACKETS];
+
+struct run_result
+{
+    uint32_t packets;
+    uint64_t busy;
+    uint64_t longest_call;
+    uint64_t worst_latency;
+    uint64_t total_latency;
+    bool intact;
+};
+
+static uint64_t ticks_to_us(uint64_t ticks)
+{
+    return (ticks * 1000000) / SYS_TIME_DOUBLE_FREQUENCY;
+}
+
+static void run_schedule(void)
+{
+    uint32_t offset = 0;
+    uint32_t i;
+
+    winc_double_set_event_cost_us(RUN_EVENT_COST_US);
+
+    for (i = 0; i < RUN_PACKETS; i++)
+    {
+        uint32_t body = test_random_range(1, RUN_BODY_MAX);
+        uint32_t b;
+
+        run_stream[offset] = (uint8_t)(body >> 8);
+        run_stream[offset + 1] = (uint8_t)body;
+        for (b = 0; b < body; b++)
+        {
+            run_stream[offset + 2 + b] = (uint8_t)(i + b);
+        }
+
+        run_arrival[i] = ((uint64_t)i * (RUN_MS / RUN_PACKETS) * 1000 +
+                          test_random_range(0, (RUN_MS / RUN_PACKETS - 100) * 1000)) *
+                         (SYS_TIME_DOUBLE_FREQUENCY / 1000000);
+        winc_double_arrive_at(run_arrival[i], &run_stream[offset], 2 + body);
+        offset += 2 + body;
+    }
+}
+
+static void run_deliver(struct run_result *result, const uint8_t *packet, uint32_t length, uint32_t *offset)
+{
+    uint64_t latency = SYS_TIME_Counter64Get() - run_arrival[result->packets];
+
+    if (memcmp(packet, &run_stream[*offset], length) != 0)
+    {
+        result->intact = false;
+    }
+    *offset += length;
+
+    if (latency > result->worst_latency)
+    {
+        result->worst_latency = latency;
+    }
+    result->total_latency += latency;
+    result->packets++;
+}
+
+static void run_account(struct run_result *result, uint64_t start)
+{
+    uint64_t call = SYS_TIME_Counter64Get() - start;
+
+    result->busy += call;
+    if (call > result->longest_call)
+    {
+        result->longest_call = call;
+    }
+}
+
+static void run_old(struct run_result *result)
+{
+    uint64_t end = (uint64_t)RUN_MS * (SYS_TIME_DOUBLE_FREQUENCY / 1000);
+    uint8_t packet[2 + RUN_BODY_MAX];
+    uint32_t offset = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->intact = true;
+
+    sys_time_double_set(0, SYS_TIME_DOUBLE_FREQUENCY);
+    winc_double_init(old_socket_callback);
+    old_rx_length = 0;
+    old_rx_location = 0;
+    run_schedule();
+
+    // The app loop is MQTTYield(), nothing else runs while it waits
+    while (SYS_TIME_Counter64Get() < end)
+    {
+        uint64_t start = SYS_TIME_Counter64Get();
+        bool read = old_read(packet, 2, OLD_YIELD_TIMEOUT_MS);
+        uint32_t body = ((uint32_t)packet[0] << 8) | packet[1];
+
+        if (read)
+        {
+            read = old_read(&packet[2], body, OLD_YIELD_TIMEOUT_MS);
+        }
+        run_account(result, start);
+
+        if (read)
+        {
+            run_deliver(result, packet, 2 + body, &offset);
+        }
+    }
+}
+
+static void run_new(struct run_result *result)
+{
+    uint64_t end = (uint64_t)RUN_MS * (SYS_TIME_DOUBLE_FREQUENCY / 1000);
+    uint8_t packet[2 + RUN_BODY_MAX];
+    uint32_t packet_length = 0;
+    uint32_t offset = 0;
+    uint64_t next_pass = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->intact = true;
+
+    rx_init();
+    run_schedule();
+
+    // A pass of the app loop every 10 ms, reading what is there like MQTTPoll()
+    while (SYS_TIME_Counter64Get() < end)
+    {
+        uint32_t read;
+
+        do
+        {
+            uint64_t start = SYS_TIME_Counter64Get();
+            uint32_t wanted = 2;
+
+            if (packet_length >= 2)
+            {
+                wanted = 2 + (((uint32_t)packet[0] << 8) | packet[1]);
+            }
+            read = winc_receive_read_available(&rx, &packet[packet_length], wanted - packet_length);
+            run_account(result, start);
+            packet_length += read;
+
+            if (packet_length > 2 && packet_length == 2 + (((uint32_t)packet[0] << 8) | packet[1]))
+            {
+                run_deliver(result, packet, packet_length, &offset);
+                packet_length = 0;
+            }
+        } while (read > 0);
+
+        // The rest of the pass belongs to the sensors, the buttons and the idle task
+        next_pass += (uint64_t)RUN_PASS_MS * (SYS_TIME_DOUBLE_FREQUENCY / 1000);
+        if (SYS_TIME_Counter64Get() < next_pass)
+        {
+            sys_time_double_set(next_pass, SYS_TIME_DOUBLE_FREQUENCY);
+        }
+    }
+}
+
+static void test_receive_latency_and_idle(void)
+{
+    uint32_t seed = test_random();
+    struct run_result old_result;
+    struct run_result new_result;
+    uint32_t old_idle;
+    uint32_t new_idle;
+
+    test_random_state = seed;
+    run_old(&old_result);
+    test_random_state = seed;
+    run_new(&new_result);
+
+    old_idle = (uint32_t)(100 - (old_result.busy * 100) / ((uint64_t)RUN_MS * (SYS_TIME_DOUBLE_FREQUENCY / 1000)));
+    new_idle = (uint32_t)(100 - (new_result.busy * 100) / ((uint64_t)RUN_MS * (SYS_TIME_DOUBLE_FREQUENCY / 1000)));
+
+    printf("receive, %u packets in %u s: recv and spin %u%% idle, longest call %lu us, latency %lu us mean %lu us worst\n",
+           (unsigned)old_result.packets, (unsigned)(RUN_MS / 1000), (unsigned)old_idle,
+           (unsigned long)ticks_to_us(old_result.longest_call),
+           (unsigned long)ticks_to_us(old_result.total_latency / (old_result.packets ? old_result.packets : 1)),
+           (unsigned long)ticks_to_us(old_result.worst_latency));
+    printf("receive, %u packets in %u s: ring per %u ms pass %u%% idle, longest call %lu us, latency %lu us mean %lu us worst\n",
+           (unsigned)new_result.packets, (unsigned)(RUN_MS / 1000), (unsigned)RUN_PASS_MS, (unsigned)new_idle,
+           (unsigned long)ticks_to_us(new_result.longest_call),
+           (unsigned long)ticks_to_us(new_result.total_latency / (new_result.packets ? new_result.packets : 1)),
+           (unsigned long)ticks_to_us(new_result.worst_latency));
+
+    TEST_CHECK_EQUAL(RUN_PACKETS, old_result.packets);
+    TEST_CHECK_EQUAL(RUN_PACKETS, new_result.packets);
+    TEST_CHECK(old_result.intact);
+    TEST_CHECK(new_result.intact);
+    TEST_CHECK(!rx_overflow);
+
+    // A read never holds the app loop for more than one pass of the WINC events
+    TEST_CHECK(new_result.longest_call <= RUN_EVENT_COST_US * (SYS_TIME_DOUBLE_FREQUENCY / 1000000));
+    TEST_CHECK(new_idle >= 85);
+    TEST_CHECK(new_result.worst_latency <= (uint64_t)(RUN_PASS_MS + 1) * (SYS_TIME_DOUBLE_FREQUENCY / 1000));
+
+    // where the old path kept the CPU for the whole yield window
+    TEST_CHECK(old_idle < 5);
+    TEST_CHECK(old_result.longest_call >= (uint64_t)OLD_YIELD_TIMEOUT_MS * (SYS_TIME_DOUBLE_FREQUENCY / 1000));
+}
+
+int main(void)
+{
+    TEST_RUN(test_receive_stream_through_winc_double);
+    TEST_RUN(test_receive_rearms_after_reader_drains);
+    TEST_RUN(test_partial_packet_would_block);
+    TEST_RUN(test_stop_drops_received_bytes);
+    TEST_RUN(test_receive_latency_and_idle);
+
+    return TEST_REPORT("winc_receive");
+}
@@ -0,0 +1,505 @@
+# -*- coding: utf-8 -*-
+# 2021 to present - Copyright Microchip Technology Inc. and its subsidiaries.
+
+# Subject to your compliance with these terms, you may use Microchip software
+# and any derivatives exclusively with Microchip products. It is your
+# responsibility to comply with third party license terms applicable to your
+# use of third party software (including open source software) that may
+# accompany Microchip software.
+
+# THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+# EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+# WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A PARTICULAR
+# PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL,
+# PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY
+# KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP
+# HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+# FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+# ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+# THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+# Generates C structs, encoders and decoders for the telemetry of a DTDL v2
+# interface, and the enums of its telemetry and properties.
+#
+#   python3 dtdl_codegen.py [model.json] [output directory] [prefix]
+#
+# With no arguments it reads cryptoauthtrustplatform_hr9-2.json and writes
+# cloud_connect/hr9_model.h and hr9_model.c.
+#
+# The encoders write the field names and separators as literal bytes. The
+# destination is checked once against the worst case size of the document,
+# which the generator works out from the schemas, so nothing is checked while
+# writing. The decoders read a document with az_json_reader and reject values
+# the model does not allow (enum values, minimum/maximum, string lengths).
+#
+# Writable properties are not generated. The firmware receives them in twin
+# documents that also carry properties outside the model, and dispatches them
+# through the perfect hash table twin_property_hash.py generates for azutil.c.
+
+import os
+import re
+import sys
+import json
+
+# Schemas the generator supports, with the C type of the struct member
+INT_SCHEMAS = ('integer', 'long')
+INT32_MAX_CHARS = 11        # "-2147483648"
+STRING_DEFAULT_MAX_LENGTH = 63
+
+# Strings the model does not give a maxLength for
+STRING_MAX_LENGTH = {
+    'ipAddress': 15,        # dotted IPv4 address
+}
+
+
+def snake_case(name):
+    name = re.sub(r'([a-z0-9])([A-Z])', r'\1_\2', name)
+    return re.sub(r'[^A-Za-z0-9]', '_', name).lower()
+
+
+def c_string(text):
+    return '"' + text.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+class Field(object):
+    def __init__(self, prefix, content, schemas):
+        self.name = content['name']
+        self.member = snake_case(self.name)
+        self.macro = '{}_{}'.format(prefix.upper(), self.member.upper())
+        self.writable = content.get('writable', False)
+        self.minimum = content.get('minValue')
+        self.maximum = content.get('maxValue')
+        self.min_length = content.get('minLength')
+        self.max_length = None
+        self.enum = None
+        self.enum_type = None
+
+        schema = content['schema']
+        if isinstance(schema, str) and schema in schemas:
+            schema = schemas[schema]
+
+        if isinstance(schema, dict) and schema.get('@type') == 'Enum' and schema.get('valueSchema') == 'integer':
+            self.kind = 'enum'
+            self.enum = [(v['name'], v['enumValue']) for v in schema['enumValues']]
+            if '@id' in schema:
+                type_name = schema['@id'].split(':')[-1].split(';')[0]
+            else:
+                type_name = self.name
+            self.enum_type = '{}_{}_t'.format(prefix, snake_case(type_name))
+            self.enum_prefix = '{}_{}'.format(prefix.upper(), snake_case(type_name).upper())
+        elif schema in INT_SCHEMAS:
+            self.kind = 'int'
+        elif schema == 'string':
+            self.kind = 'string'
+            self.max_length = content.get('maxLength',
+                                          STRING_MAX_LENGTH.get(self.name, STRING_DEFAULT_MAX_LENGTH))
+        else:
+            raise ValueError('{}: schema {} is not supported'.format(self.name, json.dumps(schema)))
+
+    def key(self):
+        # "name": as written in the document
+        return '"{}":'.format(self.name)
+
+    def max_value_size(self):
+        if self.kind == 'string':
+            # every byte may need a \u00XX escape
+            return 2 + 6 * self.max_length
+        return INT32_MAX_CHARS
+
+    def max_size(self):
+        return len(self.key()) + self.max_value_size()
+
+    def declaration(self):
+        if self.kind == 'string':
+            return 'char    {}[{}_MAX_LENGTH + 1];'.format(self.member, self.macro)
+        if self.kind == 'enum':
+            return 'int32_t {};  // {}'.format(self.member, self.enum_type)
+        return 'int32_t {};'.format(self.member)
+
+
+def load_model(path, prefix):
+    with open(path) as f:
+        model = json.load(f)
+
+    schemas = {}
+    for schema in model.get('schemas', []):
+        schemas[schema['@id']] = schema
+
+    telemetry = []
+    properties = []
+    for content in model['contents']:
+        types = content['@type'] if isinstance(content['@type'], list) else [content['@type']]
+        if 'Telemetry' in types:
+            telemetry.append(Field(prefix, content, schemas))
+        elif 'Property' in types:
+            properties.append(Field(prefix, content, schemas))
+    return model, telemetry, properties
+
+
+def emit_header(out, model_file, model, prefix, telemetry, properties):
+    guard = '_{}_MODEL_H'.format(prefix.upper())
+    P = prefix.upper()
+    w = out.append
+
+    w('// Generated by device_model/dtdl_codegen.py from {}, do not edit'.format(os.path.basename(model_file)))
+    w('// Model: {}'.format(model['@id']))
+    w('')
+    w('#ifndef {}'.format(guard))
+    w('#define {}'.format(guard))
+    w('')
+    w('#include <stdint.h>')
+    w('#include "azure/core/az_span.h"')
+    w('#include "azure/core/az_json.h"')
+    w('')
+
+    enums = []
+    for field in telemetry + properties:
+        if field.kind == 'enum' and field.enum_type not in enums:
+            enums.append(field.enum_type)
+            w('typedef enum')
+            w('{')
+            for name, value in field.enum:
+                w('    {}_{} = {},'.format(field.enum_prefix, snake_case(name).upper(), value))
+            w('}} {};'.format(field.enum_type))
+            w('')
+
+    strings = [field for field in telemetry if field.kind == 'string']
+    for field in strings:
+        w('#define {}_MAX_LENGTH {}'.format(field.macro, field.max_length))
+    if strings:
+        w('')
+
+    for index, field in enumerate(telemetry):
+        w('#define {}_TELEMETRY_{} (1u << {})'.format(P, field.member.upper(), index))
+    w('#define {}_TELEMETRY_ALL (0x{:x}u)'.format(P, (1 << len(telemetry)) - 1))
+    w('')
+
+    w('// Worst case size of a document with every telemetry')
+    w('#define {}_TELEMETRY_MAX_SIZE {}'.format(P, document_max_size(telemetry)))
+    w('')
+
+    for kind, fields in (('telemetry', telemetry),):
+        w('typedef struct')
+        w('{')
+        for field in fields:
+            w('    ' + field.declaration())
+        w('}} {}_{}_t;'.format(prefix, kind))
+        w('')
+
+    for kind, bits in (('telemetry', 'TELEMETRY'),):
+        w('/**********************************************')
+        w('* Worst case size of a {} document holding the'.format(kind))
+        w('* fields selected by mask ({}_{}_*)'.format(P, bits))
+        w('**********************************************/')
+        w('int32_t {}_{}_max_size(uint32_t mask);'.format(prefix, kind))
+        w('')
+        w('/**********************************************')
+        w('* Write the fields selected by mask as a JSON object.')
+        w('* Fails with AZ_ERROR_NOT_ENOUGH_SPACE when destination')
+        w('* is smaller than {}_{}_max_size(mask).'.format(prefix, kind))
+        w('**********************************************/')
+        w('az_result {}_{}_encode('.format(prefix, kind))
+        parameters(w, encode_parameters(prefix, kind), ');')
+        w('')
+        w('/**********************************************')
+        w('* Read a JSON object of {}, the reader is'.format(kind))
+        w('* positioned before the object. out_mask is set to the')
+        w('* fields found, unknown names are skipped.')
+        w('**********************************************/')
+        w('az_result {}_{}_decode('.format(prefix, kind))
+        parameters(w, decode_parameters(prefix, kind), ');')
+        w('')
+
+    w('#endif // {}'.format(guard))
+
+
+def encode_parameters(prefix, kind):
+    return [('{}_{}_t const*'.format(prefix, kind), kind),
+            ('uint32_t', 'mask'),
+            ('az_span', 'destination'),
+            ('az_span*', 'out_payload')]
+
+
+def decode_parameters(prefix, kind):
+    return [('az_json_reader*', 'jr'),
+            ('{}_{}_t*'.format(prefix, kind), kind),
+            ('uint32_t*', 'out_mask')]
+
+
+def parameters(w, params, end):
+    width = max(len(t) for t, _ in params)
+    for index, (ctype, name) in enumerate(params):
+        w('    {} {}{}'.format(ctype.ljust(width), name, end if index == len(params) - 1 else ','))
+
+
+def document_max_size(fields):
+    if not fields:
+        return 2
+    return 2 + sum(f.max_size() for f in fields) + len(fields) - 1
+
+
+def emit_source(out, model_file, prefix, telemetry, properties):
+    P = prefix.upper()
+    w = out.append
+
+    w('// Generated by device_model/dtdl_codegen.py from {}, do not edit'.format(os.path.basename(model_file)))
+    w('')
+    w('#include <string.h>')
+    w('#include "{}_model.h"'.format(prefix))
+    w('')
+    w('#define RETURN_ERR_IF_FAILED(expression)       \\')
+    w('    do                                         \\')
+    w('    {                                          \\')
+    w('        az_result const result = (expression); \\')
+    w('        if (az_result_failed(result))          \\')
+    w('        {                                      \\')
+    w('            return result;                     \\')
+    w('        }                                      \\')
+    w('    } while (0)')
+    w('')
+    w('#define WRITE_LITERAL(out, literal)                    \\')
+    w('    do                                                 \\')
+    w('    {                                                  \\')
+    w('        memcpy((out), (literal), sizeof(literal) - 1); \\')
+    w('        (out) += sizeof(literal) - 1;                  \\')
+    w('    } while (0)')
+    w('')
+    w('static uint8_t* write_int32(uint8_t* out, int32_t value)')
+    w('{')
+    w('    uint8_t  digits[10];')
+    w('    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;')
+    w('    int32_t  count     = 0;')
+    w('')
+    w('    if (value < 0)')
+    w('    {')
+    w("        *out++ = '-';")
+    w('    }')
+    w('')
+    w('    do')
+    w('    {')
+    w("        digits[count++] = (uint8_t)('0' + magnitude % 10);")
+    w('        magnitude /= 10;')
+    w('    } while (magnitude != 0);')
+    w('')
+    w('    while (count > 0)')
+    w('    {')
+    w('        *out++ = digits[--count];')
+    w('    }')
+    w('')
+    w('    return out;')
+    w('}')
+    w('')
+    string_helpers = len(out)
+    w('static uint8_t* write_string(uint8_t* out, const char* value, int32_t max_length)')
+    w('{')
+    w('    static const char hex[] = "0123456789abcdef";')
+    w('    int32_t index;')
+    w('')
+    w("    *out++ = '\"';")
+    w("    for (index = 0; index < max_length && value[index] != '\\0'; index++)")
+    w('    {')
+    w('        uint8_t c = (uint8_t)value[index];')
+    w('')
+    w("        if (c == '\"' || c == '\\\\')")
+    w('        {')
+    w("            *out++ = '\\\\';")
+    w('            *out++ = c;')
+    w('        }')
+    w("        else if (c == '\\b' || c == '\\f' || c == '\\n' || c == '\\r' || c == '\\t')")
+    w('        {')
+    w("            *out++ = '\\\\';")
+    w("            *out++ = (uint8_t)(c == '\\b' ? 'b' : c == '\\f' ? 'f' : c == '\\n' ? 'n' : c == '\\r' ? 'r' : 't');")
+    w('        }')
+    w('        else if (c < 0x20)')
+    w('        {')
+    w('            // az_json_token_get_string() cannot read these back (AZ_ERROR_NOT_IMPLEMENTED)')
+    w('            WRITE_LITERAL(out, "\\\\u00");')
+    w('            *out++ = (uint8_t)hex[c >> 4];')
+    w('            *out++ = (uint8_t)hex[c & 0xF];')
+    w('        }')
+    w('        else')
+    w('        {')
+    w('            *out++ = c;')
+    w('        }')
+    w('    }')
+    w("    *out++ = '\"';")
+    w('')
+    w('    return out;')
+    w('}')
+    w('')
+    w('static az_result read_string(az_json_token* token, char* destination, int32_t max_length, int32_t min_length)')
+    w('{')
+    w('    int32_t length;')
+    w('')
+    w('    if (token->kind != AZ_JSON_TOKEN_STRING)')
+    w('    {')
+    w('        return AZ_ERROR_UNEXPECTED_CHAR;')
+    w('    }')
+    w('')
+    w('    if (az_result_failed(az_json_token_get_string(token, destination, max_length + 1, &length)) ||')
+    w('        length < min_length)')
+    w('    {')
+    w('        return AZ_ERROR_ARG;')
+    w('    }')
+    w('')
+    w('    return AZ_OK;')
+    w('}')
+    w('')
+    if not any(field.kind == 'string' for field in telemetry):
+        del out[string_helpers:]
+
+    for kind, fields, bits in (('telemetry', telemetry, 'TELEMETRY'),):
+        arg = kind
+        w('int32_t {}_{}_max_size(uint32_t mask)'.format(prefix, kind))
+        w('{')
+        w('    int32_t size = 2;   // braces, each field below also counts a separator')
+        w('')
+        for field in fields:
+            w('    if (mask & {}_{}_{})'.format(P, bits, field.member.upper()))
+            w('    {')
+            w('        size += {};'.format(field.max_size() + 1))
+            w('    }')
+        w('')
+        w('    // The first field has no separator')
+        w('    return mask != 0 ? size - 1 : size;')
+        w('}')
+        w('')
+
+        w('az_result {}_{}_encode('.format(prefix, kind))
+        parameters(w, encode_parameters(prefix, kind), ')')
+        w('{')
+        w('    uint8_t* start = az_span_ptr(destination);')
+        w('    uint8_t* out   = start;')
+        w('')
+        w('    if (az_span_size(destination) < {}_{}_max_size(mask))'.format(prefix, kind))
+        w('    {')
+        w('        return AZ_ERROR_NOT_ENOUGH_SPACE;')
+        w('    }')
+        w('')
+        w("    *out++ = '{';")
+        for field in fields:
+            w('')
+            w('    if (mask & {}_{}_{})'.format(P, bits, field.member.upper()))
+            w('    {')
+            w('        if (out != start + 1)')
+            w('        {')
+            w("            *out++ = ',';")
+            w('        }')
+            w('        WRITE_LITERAL(out, {});'.format(c_string(field.key())))
+            if field.kind == 'string':
+                w('        out = write_string(out, {}->{}, {}_MAX_LENGTH);'.format(arg, field.member, field.macro))
+            else:
+                w('        out = write_int32(out, {}->{});'.format(arg, field.member))
+            w('    }')
+        w("    *out++ = '}';")
+        w('')
+        w('    *out_payload = az_span_slice(destination, 0, (int32_t)(out - start));')
+        w('    return AZ_OK;')
+        w('}')
+        w('')
+
+        if fields:
+            w('static const az_span {}_{}_names[] = {{'.format(prefix, kind))
+            for field in fields:
+                w('    AZ_SPAN_LITERAL_FROM_STR({}),'.format(c_string(field.name)))
+            w('};')
+            w('')
+
+        w('az_result {}_{}_decode('.format(prefix, kind))
+        parameters(w, decode_parameters(prefix, kind), ')')
+        w('{')
+        w('    uint32_t mask = 0;')
+        w('')
+        w('    RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));')
+        w('')
+        w('    if (jr->token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT)')
+        w('    {')
+        w('        return AZ_ERROR_UNEXPECTED_CHAR;')
+        w('    }')
+        w('')
+        w('    RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));')
+        w('')
+        w('    while (jr->token.kind == AZ_JSON_TOKEN_PROPERTY_NAME)')
+        w('    {')
+        if fields:
+            w('        switch (az_json_token_find_text(&jr->token, {0}_{1}_names, {2}))'.format(
+                prefix, kind, len(fields)))
+            w('        {')
+        for index, field in enumerate(fields):
+            w('            case {}:    // {}'.format(index, field.name))
+            w('                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));')
+            if field.kind == 'string':
+                w('                RETURN_ERR_IF_FAILED(read_string(&jr->token, {}->{}, {}_MAX_LENGTH, {}));'.format(
+                    arg, field.member, field.macro, field.min_length or 0))
+            else:
+                w('                RETURN_ERR_IF_FAILED(az_json_token_get_int32(&jr->token, &{}->{}));'.format(
+                    arg, field.member))
+                checks = []
+                if field.kind == 'enum':
+                    values = sorted(v for _, v in field.enum)
+                    if values == list(range(values[0], values[-1] + 1)):
+                        checks = ['{}->{} < {}'.format(arg, field.member, values[0]),
+                                  '{}->{} > {}'.format(arg, field.member, values[-1])]
+                        condition = ' || '.join(checks)
+                    else:
+                        checks = ['{}->{} != {}'.format(arg, field.member, v) for v in values]
+                        condition = ' && '.join(checks)
+                else:
+                    if field.minimum is not None:
+                        checks.append('{}->{} < {}'.format(arg, field.member, field.minimum))
+                    if field.maximum is not None:
+                        checks.append('{}->{} > {}'.format(arg, field.member, field.maximum))
+                    condition = ' || '.join(checks)
+                if checks:
+                    w('                if ({})'.format(condition))
+                    w('                {')
+                    w('                    return AZ_ERROR_ARG;')
+                    w('                }')
+            w('                mask |= {}_{}_{};'.format(P, bits, field.member.upper()))
+            w('                break;')
+            w('')
+        if fields:
+            w('            default:')
+            w('                RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));')
+            w('                RETURN_ERR_IF_FAILED(az_json_reader_skip_children(jr));')
+            w('                break;')
+            w('        }')
+        else:
+            w('        RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));')
+            w('        RETURN_ERR_IF_FAILED(az_json_reader_skip_children(jr));')
+        w('')
+        w('        RETURN_ERR_IF_FAILED(az_json_reader_next_token(jr));')
+        w('    }')
+        w('')
+        w('    if (jr->token.kind != AZ_JSON_TOKEN_END_OBJECT)')
+        w('    {')
+        w('        return AZ_ERROR_UNEXPECTED_CHAR;')
+        w('    }')
+        w('')
+        w('    *out_mask = mask;')
+        w('    return AZ_OK;')
+        w('}')
+        w('')
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    model_file = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, 'cryptoauthtrustplatform_hr9-2.json')
+    out_dir = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, '..', 'cloud_connect')
+    prefix = sys.argv[3] if len(sys.argv) > 3 else 'hr9'
+
+    model, telemetry, properties = load_model(model_file, prefix)
+
+    header = []
+    source = []
+    emit_header(header, model_file, model, prefix, telemetry, properties)
+    emit_source(source, model_file, prefix, telemetry, properties)
+
+    for name, lines in (('{}_model.h'.format(prefix), header), ('{}_model.c'.format(prefix), source)):
+        with open(os.path.join(out_dir, name), 'w', newline='\n') as f:
+            f.write('\n'.join(lines).rstrip('\n') + '\n')
+        print('wrote ' + os.path.join(out_dir, name))
+
+
+if __name__ == '__main__':
+    main()
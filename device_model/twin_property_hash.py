@@ -0,0 +1,117 @@
+# -*- coding: utf-8 -*-
+# 2021 to present - Copyright Microchip Technology Inc. and its subsidiaries.
+
+# Subject to your compliance with these terms, you may use Microchip software
+# and any derivatives exclusively with Microchip products. It is your
+# responsibility to comply with third party license terms applicable to your
+# use of third party software (including open source software) that may
+# accompany Microchip software.
+
+# THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+# EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+# WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A PARTICULAR
+# PURPOSE. IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL,
+# PUNITIVE, INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY
+# KIND WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP
+# HAS BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+# FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+# ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+# THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+# Generates the desired property lookup table of cloud_connect/azutil.c from the
+# writable properties of the device model. The table is a perfect hash: every
+# name lands in its own slot, so a lookup is one hash and one compare.
+#
+#   python twin_property_hash.py [cryptoauthtrustplatform_hr9-2.json]
+#
+# Paste the output over the generated block in azutil.c.
+
+import os
+import sys
+import json
+
+# Firmware handler of each writable property
+HANDLERS = {
+    '$version':             'twin_property_version',
+    'telemetryInterval':    'twin_property_telemetry_interval',
+    'telemetryBatchWindow': 'twin_property_telemetry_batch_window',
+    'debugLevel':           'twin_property_debug_level',
+}
+
+# Writable properties the firmware supports that are not in the model
+EXTRA_PROPERTIES = ['led_y', 'property_3', 'property_4', 'disableTelemetry']
+HANDLERS.update({
+    'led_y':                'twin_property_led_yellow',
+    'property_3':           'twin_property_app_property_3',
+    'property_4':           'twin_property_app_property_4',
+    'disableTelemetry':     'twin_property_disable_telemetry',
+})
+
+
+def fnv1a(name, seed):
+    h = seed
+    for c in name.encode('utf-8'):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def writable_properties(model):
+    names = []
+    for content in model['contents']:
+        types = content['@type'] if isinstance(content['@type'], list) else [content['@type']]
+        if 'Property' in types and content.get('writable', False):
+            names.append(content['name'])
+    return names
+
+
+def find_seed(names, size):
+    for seed in range(2166136261, 2166136261 + 1000000):
+        slots = set(fnv1a(n, seed) & (size - 1) for n in names)
+        if len(slots) == len(names):
+            return seed
+    return None
+
+
+def main():
+    model_file = sys.argv[1] if len(sys.argv) > 1 else \
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), 'cryptoauthtrustplatform_hr9-2.json')
+    with open(model_file) as f:
+        model = json.load(f)
+
+    names = ['$version']
+    for name in writable_properties(model) + EXTRA_PROPERTIES:
+        if name not in HANDLERS:
+            sys.stderr.write('warning: no handler for writable property {}, left out\n'.format(name))
+        elif name not in names:
+            names.append(name)
+
+    size = 1
+    while size < len(names):
+        size <<= 1
+    seed = find_seed(names, size)
+    while seed is None:
+        size <<= 1
+        seed = find_seed(names, size)
+
+    table = [None] * size
+    for name in names:
+        table[fnv1a(name, seed) & (size - 1)] = name
+
+    print('// Generated by device_model/twin_property_hash.py from {}, do not edit'.format(
+        os.path.basename(model_file)))
+    print('#define TWIN_PROPERTY_HASH_SEED  {}u'.format(seed))
+    print('#define TWIN_PROPERTY_TABLE_SIZE {}'.format(size))
+    print('#define TWIN_PROPERTY_NAME_MAX   {}'.format(max(len(n) for n in names)))
+    print('')
+    print('static const twin_property_t twin_property_table[TWIN_PROPERTY_TABLE_SIZE] = {')
+    for name in table:
+        if name is None:
+            print('    {AZ_SPAN_LITERAL_FROM_STR(""), NULL},')
+        else:
+            print('    {{AZ_SPAN_LITERAL_FROM_STR("{}"), {}}},'.format(name, HANDLERS[name]))
+    print('};')
+    print('// End of generated code')
+
+
+if __name__ == '__main__':
+    main()